@@ -144,6 +144,25 @@ VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
+/**
+ * Block allocator statistics.
+ *
+ * Blocks small enough to fit one of the allocator size classes are recycled
+ * through per-thread caches; larger blocks always come from the heap.
+ */
+typedef struct block_stats_t
+{
+    uint64_t hits; /**< size class allocations served from a cache */
+    uint64_t misses; /**< size class allocations served by the heap */
+    size_t in_use; /**< bytes currently allocated by block_Alloc() */
+    size_t peak; /**< highest value of in_use so far */
+} block_stats_t;
+
+/**
+ * Gets the block_Alloc() statistics of the process.
+ */
+VLC_API void block_GetStats(block_stats_t *);
+
 /**
  * Reallocates a block.
  *
@@ -619,6 +638,122 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 }
 #define vlc_fifo_CleanupPush(fifo) vlc_cleanup_push(vlc_fifo_Cleanup, fifo)
 
+/**
+ * @}
+ * \defgroup block_queue Block queue
+ * Bounded lock-free block queue functions
+ *
+ * Unlike the block FIFO, a block queue has a fixed capacity and is not
+ * protected by a lock: blocks are queued and dequeued with atomic operations
+ * only. A thread only ever enters the kernel to sleep because the queue is
+ * empty (or full), or to wake up such a sleeping thread.
+ *
+ * A block queue has a single consumer thread at a time. It has either a
+ * single producer thread at a time, or any number of concurrent producers,
+ * depending on how it was created.
+ * @{
+ */
+
+typedef struct block_queue_t block_queue_t;
+
+/**
+ * Creates a lock-free queue of blocks.
+ *
+ * The created queue must be released with block_QueueRelease().
+ *
+ * @param capacity maximum number of queued blocks (rounded up to a power
+ *                 of two)
+ * @param multi_producer whether several threads may queue blocks
+ *                       concurrently
+ * @return the queue or NULL on memory error
+ */
+VLC_API block_queue_t *block_QueueNew(size_t capacity, bool multi_producer)
+VLC_USED VLC_MALLOC;
+
+/**
+ * Destroys a queue created by block_QueueNew().
+ *
+ * @note Any queued blocks are also destroyed.
+ * @warning No other threads may be using the queue when this function is
+ * called.
+ */
+VLC_API void block_QueueRelease(block_queue_t *);
+
+/**
+ * Queues a block if the queue is not full.
+ *
+ * @param block block to queue (its p_next must be NULL)
+ * @retval true if the block was queued
+ * @retval false if the queue was full (the block is left to the caller)
+ */
+VLC_API bool block_QueueTryPut(block_queue_t *, block_t *block) VLC_USED;
+
+/**
+ * Queues a list of blocks, waiting for room in the queue if necessary.
+ *
+ * This function is not a cancellation point.
+ *
+ * @param block head of a block list to queue (may be NULL)
+ */
+VLC_API void block_QueuePut(block_queue_t *, block_t *block);
+
+/**
+ * Dequeues the first block from the queue, if any.
+ *
+ * This function must only be called from the consumer thread.
+ *
+ * @return a block or NULL if the queue was empty
+ */
+VLC_API block_t *block_QueueTryGet(block_queue_t *) VLC_USED;
+
+/**
+ * Dequeues the first block from the queue, waiting until there is one if
+ * necessary. This function is (always) a cancellation point.
+ *
+ * This function must only be called from the consumer thread.
+ *
+ * @return a valid block
+ */
+VLC_API block_t *block_QueueGet(block_queue_t *) VLC_USED;
+
+/**
+ * Dequeues up to a given number of blocks from the queue, waiting until
+ * there is at least one if necessary. This function is (always) a
+ * cancellation point.
+ *
+ * This function must only be called from the consumer thread.
+ *
+ * @param max maximum number of blocks to dequeue, 0 for no limit
+ * @return a valid list of blocks, in queue order
+ */
+VLC_API block_t *block_QueueGetBatch(block_queue_t *, size_t max) VLC_USED;
+
+/**
+ * Destroys all blocks in a queue.
+ *
+ * This function must only be called from the consumer thread.
+ */
+VLC_API void block_QueueEmpty(block_queue_t *);
+
+/**
+ * Counts blocks in a queue.
+ *
+ * Blocks being queued concurrently may or may not be accounted for.
+ *
+ * @return the number of blocks in the queue
+ */
+VLC_API size_t block_QueueGetCount(const block_queue_t *) VLC_USED;
+
+/**
+ * Counts bytes in a queue.
+ *
+ * This is the total of the i_buffer of the queued blocks. Blocks being
+ * queued concurrently may or may not be accounted for.
+ *
+ * @return the total number of bytes in the queue
+ */
+VLC_API size_t block_QueueGetBytes(const block_queue_t *) VLC_USED;
+
 /** @} */
 
 /** @} */
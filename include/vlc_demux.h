@@ -507,6 +507,54 @@ static inline int vlc_demux_chained_Control(vlc_demux_chained_t *dc, int query,
     return ret;
 }
 
+/**
+ * @}
+ */
+
+/**
+ * \defgroup demux_index Demultiplexer index cache
+ * Seek indexes kept on disk between openings of a local file
+ *
+ * Demultiplexers that have to scan the whole file to build their index
+ * (broken or missing index) can store the result, and read it back the next
+ * time the same file is opened. An index is only returned if the file size
+ * and modification time are unchanged since it was stored.
+ * @{
+ */
+
+typedef struct
+{
+    int64_t  i_time;   /**< timestamp, or demuxer defined unit */
+    uint64_t i_offset; /**< byte offset in the input stream */
+    uint32_t i_stream; /**< demuxer defined stream identifier */
+    uint32_t i_size;   /**< size of the indexed data, if relevant */
+    uint32_t i_flags;  /**< demuxer defined flags (e.g. keyframe) */
+} vlc_demux_index_entry_t;
+
+/**
+ * Reads back a stored index.
+ *
+ * \param name name of the index, typically the demux module name with a
+ * version number to change whenever the entries meaning changes
+ * \param entries pointer to the table of entries, to free() [OUT]
+ * \param count pointer to the number of entries [OUT]
+ * \retval VLC_SUCCESS on success
+ * \retval VLC_EGENERIC if there is no valid index for the input file
+ */
+VLC_API int vlc_demux_index_Load(demux_t *, const char *name,
+                                 vlc_demux_index_entry_t **entries,
+                                 size_t *count) VLC_USED;
+
+/**
+ * Stores an index, replacing any previous one.
+ *
+ * This does nothing if the input is not a local file, or if the index cache
+ * is disabled.
+ */
+VLC_API void vlc_demux_index_Store(demux_t *, const char *name,
+                                   const vlc_demux_index_entry_t *entries,
+                                   size_t count);
+
 /**
  * @}
  */
@@ -107,7 +107,15 @@ struct filter_t
 
     union
     {
-        /* TODO: video filter drain */
+        /** Drain (video filter)
+         *
+         * Returns the pictures that the filter holds back, without a new
+         * input picture. If the second parameter is false, only the pictures
+         * that are already complete are returned, without waiting for the
+         * ones still being processed (e.g. on another thread). Unlike an
+         * audio filter drain, this does not reset the filter state. */
+        picture_t *(*pf_video_drain) ( filter_t *, bool );
+
         /** Drain (audio filter) */
         block_t *(*pf_audio_drain) ( filter_t * );
     };
@@ -182,6 +190,20 @@ static inline block_t *filter_DrainAudio( filter_t *p_filter )
         return NULL;
 }
 
+/**
+ * This function will drain a video filter.
+ *
+ * \param b_wait whether to wait for the pictures still being processed
+ * \return the pictures held back by the filter (linked list) or NULL
+ */
+static inline picture_t *filter_DrainVideo( filter_t *p_filter, bool b_wait )
+{
+    if( p_filter->pf_video_drain )
+        return p_filter->pf_video_drain( p_filter, b_wait );
+    else
+        return NULL;
+}
+
 /**
  * This function will return a new subpicture usable by p_filter as an output
  * buffer. You have to release it using subpicture_Delete or by returning it to
@@ -381,6 +403,34 @@ VLC_API const es_format_t *filter_chain_GetFmtOut(filter_chain_t *chain);
 VLC_API picture_t *filter_chain_VideoFilter(filter_chain_t *chain,
                                             picture_t *pic);
 
+/**
+ * Drain a video filter chain.
+ *
+ * The pictures held back by the filters are passed through the rest of the
+ * chain. Like filter_chain_VideoFilter(), this returns a single picture:
+ * call it again until it returns NULL.
+ *
+ * This waits for the pictures that the filters are still processing. It is
+ * meant for the end of the stream.
+ *
+ * \param chain pointer to filter chain
+ * \return a picture or NULL if the chain is drained
+ */
+VLC_API picture_t *filter_chain_VideoDrain(filter_chain_t *chain);
+
+/**
+ * Collect the pictures completed by a video filter chain.
+ *
+ * Same as filter_chain_VideoDrain(), but the pictures that the filters are
+ * still processing are left in the chain, so this never blocks. This lets
+ * a caller without new input output the pictures that filters working
+ * ahead (e.g. on another thread) have completed in the meantime.
+ *
+ * \param chain pointer to filter chain
+ * \return a picture or NULL if no picture is complete
+ */
+VLC_API picture_t *filter_chain_VideoCollect(filter_chain_t *chain);
+
 /**
  * Flush a video filter chain.
  */
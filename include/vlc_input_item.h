@@ -351,7 +351,8 @@ typedef enum input_item_meta_request_option_t
     META_REQUEST_OPTION_SCOPE_LOCAL   = 0x01,
     META_REQUEST_OPTION_SCOPE_NETWORK = 0x02,
     META_REQUEST_OPTION_SCOPE_ANY     = 0x03,
-    META_REQUEST_OPTION_DO_INTERACT   = 0x04
+    META_REQUEST_OPTION_DO_INTERACT   = 0x04,
+    META_REQUEST_OPTION_PRIORITY      = 0x08, /* visible to the user */
 } input_item_meta_request_option_t;
 
 /* status of the vlc_InputItemPreparseEnded event */
@@ -379,6 +380,7 @@ struct input_stats_t
 
     /* Input */
     int64_t i_read_packets;
+    int64_t i_read_calls;   /* system calls made to read the packets */
     int64_t i_read_bytes;
     float f_input_bitrate;
     float f_average_input_bitrate;
@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * vlc_slices.h: slice-threaded picture processing
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SLICES_H
+#define VLC_SLICES_H 1
+
+/**
+ * \defgroup slices Slice threading
+ * \ingroup thread
+ * Runs a job on horizontal bands of a picture from a shared thread pool.
+ *
+ * The job is split in as many bands as there are threads in the pool (see
+ * the "filter-threads" option), but each band has at least four times as
+ * many lines as the halo, that is the number of lines above and below its
+ * own that a band reads or recomputes. The calling thread runs bands too,
+ * and returns once all of them are done.
+ *
+ * Bands are started in increasing index order, each one by a thread that
+ * runs it right away. A band may therefore wait for lines produced by the
+ * previous bands (wavefront processing), but not for the next ones.
+ * @{
+ * \file
+ * Slice threading functions
+ */
+
+/**
+ * Band of a slice-threaded job.
+ */
+typedef struct vlc_slice_t
+{
+    unsigned i_index; /**< band index, from 0 */
+    unsigned i_count; /**< number of bands of the job */
+} vlc_slice_t;
+
+/**
+ * Runs one band of a job.
+ *
+ * \param opaque data pointer given to vlc_slices_Run()
+ * \param slice band to process
+ */
+typedef void (*vlc_slice_cb)(void *opaque, const vlc_slice_t *slice);
+
+/**
+ * Runs a job on all the bands of a picture.
+ *
+ * \param i_lines number of lines (or rows of any kind) to split
+ * \param i_halo number of extra lines each band reads or recomputes above
+ *               and below its own ones
+ * \param pf_run band callback, invoked from the calling thread and from the
+ *               pool threads
+ * \param opaque data pointer for the callback
+ *
+ * \note This function is not a cancellation point.
+ */
+VLC_API void vlc_slices_Run(vlc_object_t *, unsigned i_lines, unsigned i_halo,
+                            vlc_slice_cb pf_run, void *opaque);
+#define vlc_slices_Run(o, l, h, cb, d) \
+    vlc_slices_Run(VLC_OBJECT(o), l, h, cb, d)
+
+/**
+ * Gets the first line of a band.
+ *
+ * Planes with different numbers of lines are split in the same proportions,
+ * so that each band covers the same part of the picture in every plane.
+ *
+ * \param i_lines number of lines of the plane
+ */
+static inline unsigned vlc_slice_First(const vlc_slice_t *slice,
+                                       unsigned i_lines)
+{
+    return (uint64_t)i_lines * slice->i_index / slice->i_count;
+}
+
+/**
+ * Gets the line after the last one of a band.
+ *
+ * \param i_lines number of lines of the plane
+ */
+static inline unsigned vlc_slice_End(const vlc_slice_t *slice,
+                                     unsigned i_lines)
+{
+    return (uint64_t)i_lines * (slice->i_index + 1) / slice->i_count;
+}
+
+/** @} */
+
+#endif
@@ -51,6 +51,9 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 #include <dirent.h>
 
 #include <vlc_common.h>
@@ -64,12 +67,32 @@
 #include <vlc_fs.h>
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
+#include <vlc_block.h>
+
+#ifdef HAVE_MMAP
+/* size of the mapped blocks, a multiple of the page size */
+# define MMAP_BLOCK_SIZE (1 << 18)
+/* number of blocks mapped (and read ahead) past the current position */
+# define MMAP_WINDOW 64
+#endif
 
 struct access_sys_t
 {
     int fd;
 
     bool b_pace_control;
+#ifdef HAVE_MMAP
+    bool b_mmap;
+    uint64_t i_size;       /* size of the file when it was opened */
+    uint64_t i_offset;     /* offset of the next block */
+    uint64_t i_window_end; /* offset after the last mapped block */
+    block_t *p_window;     /* blocks mapped ahead */
+    block_t **pp_window_last;
+    unsigned i_window;
+#endif
+#ifdef HAVE_IO_URING
+    file_uring_t *uring;
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -127,11 +150,23 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t Read (access_t *, void *, size_t);
 static int FileSeek (access_t *, uint64_t);
 static int NoSeek (access_t *, uint64_t);
 static int FileControl (access_t *, int, va_list);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (access_t *, bool *);
+static int MmapSeek (access_t *, uint64_t);
+static void MmapFlush (access_sys_t *);
+#endif
+#ifdef HAVE_IO_URING
+static ssize_t UringRead (access_t *, void *, size_t);
+static int UringSeek (access_t *, uint64_t);
+#endif
 
 /*****************************************************************************
  * FileOpen: open the file
@@ -219,6 +254,15 @@ int FileOpen( vlc_object_t *p_this )
     p_access->pf_control = FileControl;
     p_access->p_sys = p_sys;
     p_sys->fd = fd;
+#ifdef HAVE_MMAP
+    p_sys->b_mmap = false;
+    p_sys->p_window = NULL;
+    p_sys->pp_window_last = &p_sys->p_window;
+    p_sys->i_window = 0;
+#endif
+#ifdef HAVE_IO_URING
+    p_sys->uring = NULL;
+#endif
 
     if (S_ISREG (st.st_mode) || S_ISBLK (st.st_mode))
     {
@@ -237,6 +281,37 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Hand out blocks mapping the file rather than copies of it */
+        if (S_ISREG (st.st_mode) && st.st_size >= MMAP_BLOCK_SIZE
+         && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            msg_Dbg (p_access, "mapping file in memory");
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            /* fd:// may pass a file descriptor that was already read from */
+            off_t pos = lseek (fd, 0, SEEK_CUR);
+
+            p_sys->b_mmap = true;
+            p_sys->i_size = st.st_size;
+            p_sys->i_offset = (pos > 0) ? pos : 0;
+            p_sys->i_window_end = p_sys->i_offset;
+        }
+#endif
+#ifdef HAVE_IO_URING
+        /* Keep several reads in flight, for high latency storage */
+        if (p_access->pf_read == Read
+         && var_InheritBool (p_access, "file-io-uring"))
+            p_sys->uring = FileUringNew (p_this, fd);
+        if (p_sys->uring != NULL)
+        {
+            msg_Dbg (p_access, "reading file with io_uring");
+            p_access->pf_read = UringRead;
+            p_access->pf_seek = UringSeek;
+        }
 #endif
     }
     else
@@ -259,7 +334,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -267,16 +342,19 @@ void FileClose (vlc_object_t * p_this)
 
     access_sys_t *p_sys = p_access->p_sys;
 
+#ifdef HAVE_MMAP
+    MmapFlush (p_sys);
+#endif
+#ifdef HAVE_IO_URING
+    if (p_sys->uring != NULL)
+        FileUringDelete (p_sys->uring);
+#endif
     vlc_close (p_sys->fd);
 }
 
 
-static ssize_t Read (access_t *p_access, void *p_buffer, size_t i_len)
+static ssize_t ReadError (access_t *p_access, ssize_t val)
 {
-    access_sys_t *p_sys = p_access->p_sys;
-    int fd = p_sys->fd;
-
-    ssize_t val = vlc_read_i11e (fd, p_buffer, i_len);
     if (val < 0)
     {
         switch (errno)
@@ -296,6 +374,30 @@ static ssize_t Read (access_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+static ssize_t Read (access_t *p_access, void *p_buffer, size_t i_len)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    return ReadError (p_access, vlc_read_i11e (p_sys->fd, p_buffer, i_len));
+}
+
+#ifdef HAVE_IO_URING
+static ssize_t UringRead (access_t *p_access, void *p_buffer, size_t i_len)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    return ReadError (p_access, FileUringRead (p_sys->uring, p_buffer, i_len));
+}
+
+static int UringSeek (access_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    FileUringSeek (p_sys->uring, i_pos);
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -308,6 +410,141 @@ static int FileSeek (access_t *p_access, uint64_t i_pos)
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_MMAP
+/*****************************************************************************
+ * Memory-mapped reading
+ *****************************************************************************/
+static void MmapFlush (access_sys_t *sys)
+{
+    block_ChainRelease (sys->p_window);
+    sys->p_window = NULL;
+    sys->pp_window_last = &sys->p_window;
+    sys->i_window = 0;
+}
+
+static block_t *MmapMap (int fd, uint64_t offset, size_t length)
+{
+    const uint64_t page_mask = sysconf (_SC_PAGESIZE) - 1;
+    const size_t left = offset & page_mask;
+
+    void *addr = mmap (NULL, left + length, PROT_READ, MAP_SHARED, fd,
+                       offset - left);
+    if (addr == MAP_FAILED)
+        return NULL;
+
+    /* Start reading the pages in the background */
+    posix_madvise (addr, left + length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, left + length, POSIX_MADV_WILLNEED);
+    return block_mmap_Alloc ((char *)addr + left, length);
+}
+
+/* Reads a block the usual way, once the file cannot be mapped anymore */
+static block_t *MmapReadBlock (access_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+    block_t *block = block_Alloc (MMAP_BLOCK_SIZE);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    ssize_t val = Read (p_access, block->p_buffer, block->i_buffer);
+    if (val <= 0)
+    {
+        if (val == 0)
+            *eof = true;
+        block_Release (block);
+        return NULL;
+    }
+
+    block->i_buffer = val;
+    sys->i_offset += val;
+    return block;
+}
+
+static void MmapStop (access_t *p_access)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    MmapFlush (sys);
+    sys->b_mmap = false;
+    if (lseek (sys->fd, sys->i_offset, SEEK_SET) == (off_t)-1)
+        msg_Err (p_access, "seek error: %s", vlc_strerror_c(errno));
+}
+
+static block_t *MmapBlock (access_t *p_access, bool *restrict eof)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    if (sys->b_mmap)
+    {
+        struct stat st;
+
+        /* Touching a page past the end of the file raises SIGBUS: check
+         * that the file did not shrink before handing out each block.
+         * This cannot protect the blocks that were already handed out,
+         * hence the small block size. */
+        if (fstat (sys->fd, &st) == 0 && (uint64_t)st.st_size < sys->i_size)
+        {
+            msg_Warn (p_access, "file truncated, reading it normally");
+            MmapStop (p_access);
+        }
+    }
+
+    /* Data appended after opening the file is read normally */
+    if (sys->b_mmap && sys->i_offset >= sys->i_size)
+        MmapStop (p_access);
+    if (!sys->b_mmap)
+        return MmapReadBlock (p_access, eof);
+
+    /* Slide the read-ahead window */
+    while (sys->i_window < MMAP_WINDOW && sys->i_window_end < sys->i_size)
+    {
+        /* After a seek, align the next blocks on the block size */
+        size_t length = MMAP_BLOCK_SIZE
+                      - (sys->i_window_end & (MMAP_BLOCK_SIZE - 1));
+        if (length > sys->i_size - sys->i_window_end)
+            length = sys->i_size - sys->i_window_end;
+
+        block_t *block = MmapMap (sys->fd, sys->i_window_end, length);
+        if (block == NULL)
+            break;
+
+        *sys->pp_window_last = block;
+        sys->pp_window_last = &block->p_next;
+        sys->i_window++;
+        sys->i_window_end += length;
+    }
+
+    block_t *block = sys->p_window;
+    if (unlikely(block == NULL))
+    {
+        msg_Warn (p_access, "cannot map file: %s", vlc_strerror_c(errno));
+        MmapStop (p_access);
+        return MmapReadBlock (p_access, eof);
+    }
+
+    sys->p_window = block->p_next;
+    if (sys->p_window == NULL)
+        sys->pp_window_last = &sys->p_window;
+    sys->i_window--;
+    block->p_next = NULL;
+    sys->i_offset += block->i_buffer;
+    return block;
+}
+
+static int MmapSeek (access_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *sys = p_access->p_sys;
+
+    if (lseek(sys->fd, i_pos, SEEK_SET) == (off_t)-1)
+        return VLC_EGENERIC;
+
+    MmapFlush (sys);
+    sys->i_offset = i_pos;
+    sys->i_window_end = i_pos;
+    return VLC_SUCCESS;
+}
+#endif
+
 static int NoSeek (access_t *p_access, uint64_t i_pos)
 {
     /* vlc_assert_unreachable(); ?? */
@@ -361,6 +598,19 @@ static int FileControl( access_t *p_access, int i_query, va_list args )
             /* Nothing to do */
             break;
 
+#ifdef HAVE_IO_URING
+        case STREAM_SET_READAHEAD:
+        {
+            uint64_t bytes = va_arg( args, uint64_t );
+            int64_t duration = va_arg( args, int64_t );
+
+            if (p_sys->uring == NULL)
+                return VLC_EGENERIC;
+            FileUringSetDepth (p_sys->uring, bytes, duration);
+            break;
+        }
+#endif
+
         default:
             return VLC_EGENERIC;
 
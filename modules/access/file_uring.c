@@ -0,0 +1,518 @@
+/*****************************************************************************
+ * file_uring.c: asynchronous file reading with io_uring
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_interrupt.h>
+#include "fs.h"
+
+/* size of each read request */
+#define URING_READ_SIZE (1 << 17)
+/* maximum number of read requests, each with its own buffer */
+#define URING_BUFFERS 32
+/* minimum number of buffers, so that a seek can start new reads while the
+ * stale ones complete */
+#define URING_BUFFERS_MIN 2
+/* default number of read requests in flight */
+#define URING_DEPTH 8
+
+enum
+{
+    BUF_FREE,
+    BUF_PENDING,  /* read in flight */
+    BUF_DONE,     /* read completed */
+    BUF_STALE,    /* read in flight, but the data will not be used (seek) */
+};
+
+struct file_uring
+{
+    vlc_object_t *obj;
+    int fd;
+    int ring_fd;
+
+    /* submission queue */
+    void *sq_ring;
+    size_t sq_ring_size;
+    atomic_uint *sq_head;
+    atomic_uint *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned sq_pending; /* prepared entries not submitted yet */
+
+    /* completion queue */
+    void *cq_ring;
+    size_t cq_ring_size;
+    atomic_uint *cq_head;
+    atomic_uint *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    bool fixed; /* buffers are registered with the kernel */
+    char *mem;
+    unsigned buffers; /* number of buffers, at most URING_BUFFERS */
+    struct
+    {
+        int state;
+        int result;      /* bytes read, or negated error code */
+        size_t pos;      /* bytes already returned */
+        uint64_t offset; /* file offset */
+    } bufs[URING_BUFFERS];
+
+    /* requests in file order, the first one holds the next data */
+    unsigned queue[URING_BUFFERS];
+    unsigned queue_head;
+    unsigned queue_count;
+
+    uint64_t read_offset;   /* offset of the next returned data */
+    uint64_t submit_offset; /* offset of the next read request */
+    bool eof;
+
+    /* read-ahead depth */
+    unsigned depth;
+    uint64_t depth_bytes;
+    mtime_t depth_time;
+    mtime_t rate_start;
+    uint64_t rate_bytes;
+    uint64_t rate; /* bytes per second read by the caller */
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned min_complete,
+                       unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, submit, min_complete, flags,
+                   NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg, unsigned n)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, n);
+}
+
+static void UpdateDepth(file_uring_t *ur)
+{
+    uint64_t bytes = ur->depth_bytes;
+
+    if (ur->depth_time > 0 && ur->rate > 0)
+    {
+        uint64_t timed = ur->rate * ur->depth_time / CLOCK_FREQ;
+        if (timed > bytes)
+            bytes = timed;
+    }
+
+    bytes = (bytes + URING_READ_SIZE - 1) / URING_READ_SIZE;
+    ur->depth = VLC_CLIP(bytes, 1, ur->buffers);
+}
+
+/* Queues read requests until the wanted depth is reached */
+static void Submit(file_uring_t *ur)
+{
+    unsigned tail = atomic_load_explicit(ur->sq_tail, memory_order_relaxed);
+
+    while (ur->queue_count < ur->depth && !ur->eof)
+    {
+        unsigned idx;
+
+        for (idx = 0; idx < ur->buffers; idx++)
+            if (ur->bufs[idx].state == BUF_FREE)
+                break;
+        if (idx == ur->buffers)
+            break; /* stale reads are still using the buffers */
+
+        unsigned head = atomic_load_explicit(ur->sq_head,
+                                             memory_order_acquire);
+        if (tail - head > ur->sq_mask)
+            break; /* submission queue full */
+
+        struct io_uring_sqe *sqe = &ur->sqes[tail & ur->sq_mask];
+
+        memset(sqe, 0, sizeof (*sqe));
+        sqe->opcode = ur->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = ur->fd;
+        sqe->off = ur->submit_offset;
+        sqe->addr = (uintptr_t)(ur->mem + idx * URING_READ_SIZE);
+        sqe->len = URING_READ_SIZE;
+        sqe->buf_index = idx;
+        sqe->user_data = idx;
+        ur->sq_array[tail & ur->sq_mask] = tail & ur->sq_mask;
+        tail++;
+        ur->sq_pending++;
+
+        ur->bufs[idx].state = BUF_PENDING;
+        ur->bufs[idx].pos = 0;
+        ur->bufs[idx].offset = ur->submit_offset;
+        ur->submit_offset += URING_READ_SIZE;
+        ur->queue[(ur->queue_head + ur->queue_count) % URING_BUFFERS] = idx;
+        ur->queue_count++;
+    }
+
+    atomic_store_explicit(ur->sq_tail, tail, memory_order_release);
+
+    if (ur->sq_pending > 0)
+    {
+        int val = uring_enter(ur->ring_fd, ur->sq_pending, 0, 0);
+        if (val > 0)
+            ur->sq_pending -= val;
+    }
+}
+
+/* Processes the completed requests, without waiting */
+static void Reap(file_uring_t *ur)
+{
+    unsigned head = atomic_load_explicit(ur->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(ur->cq_tail, memory_order_acquire);
+
+    while (head != tail)
+    {
+        const struct io_uring_cqe *cqe = &ur->cqes[head & ur->cq_mask];
+        unsigned idx = cqe->user_data;
+
+        assert(idx < ur->buffers);
+        if (ur->bufs[idx].state == BUF_STALE)
+            ur->bufs[idx].state = BUF_FREE;
+        else
+        {
+            assert(ur->bufs[idx].state == BUF_PENDING);
+            ur->bufs[idx].state = BUF_DONE;
+            ur->bufs[idx].result = cqe->res;
+        }
+        head++;
+    }
+    atomic_store_explicit(ur->cq_head, head, memory_order_release);
+}
+
+/* Removes the first queued request */
+static void Dequeue(file_uring_t *ur)
+{
+    unsigned idx = ur->queue[ur->queue_head];
+
+    if (ur->bufs[idx].state == BUF_PENDING)
+        ur->bufs[idx].state = BUF_STALE;
+    else
+        ur->bufs[idx].state = BUF_FREE;
+    ur->queue_head = (ur->queue_head + 1) % URING_BUFFERS;
+    ur->queue_count--;
+}
+
+/* Drops the queued requests, the reads in flight complete in the background */
+static void Flush(file_uring_t *ur)
+{
+    while (ur->queue_count > 0)
+        Dequeue(ur);
+}
+
+file_uring_t *FileUringNew(vlc_object_t *obj, int fd)
+{
+    file_uring_t *ur = malloc(sizeof (*ur));
+    if (unlikely(ur == NULL))
+        return NULL;
+
+    /* The buffers are locked in memory if they can be registered: do not
+     * take more than configured for each open file. */
+    int64_t size = var_InheritInteger(obj, "file-io-uring-buffer") * 1024;
+    ur->buffers = VLC_CLIP(size / URING_READ_SIZE, URING_BUFFERS_MIN,
+                           URING_BUFFERS);
+
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof (p));
+    ur->ring_fd = uring_setup(ur->buffers, &p);
+    if (ur->ring_fd == -1)
+    {
+        msg_Dbg(obj, "io_uring not available: %s", vlc_strerror_c(errno));
+        free(ur);
+        return NULL;
+    }
+
+    ur->obj = obj;
+    ur->fd = fd;
+    ur->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+    ur->cq_ring_size = p.cq_off.cqes
+                     + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ur->cq_ring_size > ur->sq_ring_size)
+            ur->sq_ring_size = ur->cq_ring_size;
+        ur->cq_ring_size = ur->sq_ring_size;
+    }
+    ur->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+
+    ur->sq_ring = mmap(NULL, ur->sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ur->ring_fd,
+                       IORING_OFF_SQ_RING);
+    if (ur->sq_ring == MAP_FAILED)
+        goto error;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        ur->cq_ring = ur->sq_ring;
+    else
+    {
+        ur->cq_ring = mmap(NULL, ur->cq_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ur->ring_fd,
+                           IORING_OFF_CQ_RING);
+        if (ur->cq_ring == MAP_FAILED)
+            goto error_sq;
+    }
+
+    ur->sqes = mmap(NULL, ur->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ur->ring_fd, IORING_OFF_SQES);
+    if (ur->sqes == MAP_FAILED)
+        goto error_cq;
+
+    char *sq = ur->sq_ring, *cq = ur->cq_ring;
+
+    ur->sq_head = (atomic_uint *)(sq + p.sq_off.head);
+    ur->sq_tail = (atomic_uint *)(sq + p.sq_off.tail);
+    ur->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ur->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ur->sq_pending = 0;
+    ur->cq_head = (atomic_uint *)(cq + p.cq_off.head);
+    ur->cq_tail = (atomic_uint *)(cq + p.cq_off.tail);
+    ur->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ur->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    ur->mem = aligned_alloc(4096, ur->buffers * URING_READ_SIZE);
+    if (unlikely(ur->mem == NULL))
+        goto error_sqes;
+
+    /* Registered buffers save the kernel from mapping the pages of each
+     * read, but they count against the locked memory limit. */
+    struct iovec iov[URING_BUFFERS];
+
+    for (unsigned i = 0; i < ur->buffers; i++)
+    {
+        iov[i].iov_base = ur->mem + i * URING_READ_SIZE;
+        iov[i].iov_len = URING_READ_SIZE;
+        ur->bufs[i].state = BUF_FREE;
+    }
+    ur->fixed = uring_register(ur->ring_fd, IORING_REGISTER_BUFFERS, iov,
+                               ur->buffers) == 0;
+    if (!ur->fixed)
+        msg_Dbg(obj, "cannot register buffers: %s", vlc_strerror_c(errno));
+
+    /* fd:// may pass a file descriptor that was already read from */
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+
+    ur->queue_head = 0;
+    ur->queue_count = 0;
+    ur->read_offset = (pos > 0) ? pos : 0;
+    ur->submit_offset = ur->read_offset;
+    ur->eof = false;
+    ur->depth_bytes = URING_DEPTH * URING_READ_SIZE;
+    ur->depth_time = 0;
+    ur->rate_start = mdate();
+    ur->rate_bytes = 0;
+    ur->rate = 0;
+    UpdateDepth(ur);
+    return ur;
+
+error_sqes:
+    munmap(ur->sqes, ur->sqes_size);
+error_cq:
+    if (ur->cq_ring != ur->sq_ring)
+        munmap(ur->cq_ring, ur->cq_ring_size);
+error_sq:
+    munmap(ur->sq_ring, ur->sq_ring_size);
+error:
+    msg_Dbg(obj, "cannot map io_uring: %s", vlc_strerror_c(errno));
+    close(ur->ring_fd);
+    free(ur);
+    return NULL;
+}
+
+void FileUringDelete(file_uring_t *ur)
+{
+    /* The kernel may still write to the buffers until the reads complete */
+    Flush(ur);
+    for (;;)
+    {
+        unsigned i = 0;
+
+        while (i < ur->buffers && ur->bufs[i].state == BUF_FREE)
+            i++;
+        if (i == ur->buffers)
+            break;
+
+        /* Submit the prepared reads too: their completion is awaited */
+        int val = uring_enter(ur->ring_fd, ur->sq_pending, 1,
+                              IORING_ENTER_GETEVENTS);
+        if (val == -1)
+        {
+            if (errno != EINTR)
+                break;
+        }
+        else
+            ur->sq_pending -= __MIN((unsigned)val, ur->sq_pending);
+        Reap(ur);
+    }
+
+    munmap(ur->sqes, ur->sqes_size);
+    if (ur->cq_ring != ur->sq_ring)
+        munmap(ur->cq_ring, ur->cq_ring_size);
+    munmap(ur->sq_ring, ur->sq_ring_size);
+    close(ur->ring_fd);
+    free(ur->mem);
+    free(ur);
+}
+
+ssize_t FileUringRead(file_uring_t *ur, void *buf, size_t len)
+{
+    unsigned idx;
+    int res;
+
+    for (;;)
+    {
+        Reap(ur);
+        Submit(ur);
+
+        if (ur->queue_count == 0)
+            return 0; /* end of file */
+
+        idx = ur->queue[ur->queue_head];
+        while (ur->bufs[idx].state == BUF_PENDING)
+        {
+            struct pollfd ufd = { .fd = ur->ring_fd, .events = POLLIN };
+
+            if (ur->sq_pending > 0)
+                Submit(ur);
+            if (vlc_poll_i11e(&ufd, 1, -1) < 0)
+                return -1;
+            Reap(ur);
+        }
+
+        assert(ur->bufs[idx].state == BUF_DONE);
+        res = ur->bufs[idx].result;
+        if (res < 0)
+        {
+            Flush(ur);
+            ur->submit_offset = ur->read_offset;
+            errno = -res;
+            return -1;
+        }
+        if ((size_t)res > ur->bufs[idx].pos)
+            break;
+
+        /* End of file, or offset past a short read: the next requests are
+         * not contiguous with the data anymore. */
+        Flush(ur);
+        ur->submit_offset = ur->read_offset;
+        if (res == 0)
+        {
+            ur->eof = true;
+            return 0;
+        }
+    }
+
+    size_t copy = res - ur->bufs[idx].pos;
+    if (copy > len)
+        copy = len;
+
+    memcpy(buf, ur->mem + idx * URING_READ_SIZE + ur->bufs[idx].pos, copy);
+    ur->bufs[idx].pos += copy;
+    ur->read_offset += copy;
+
+    if (ur->bufs[idx].pos == (size_t)res)
+    {
+        Dequeue(ur);
+        if (res < URING_READ_SIZE)
+        {   /* Short read: the next requests are not contiguous anymore */
+            Flush(ur);
+            ur->submit_offset = ur->read_offset;
+        }
+    }
+
+    /* Estimate the read rate for time-based read-ahead */
+    mtime_t now = mdate();
+
+    ur->rate_bytes += copy;
+    if (now - ur->rate_start >= CLOCK_FREQ)
+    {
+        ur->rate = ur->rate_bytes * CLOCK_FREQ / (now - ur->rate_start);
+        ur->rate_start = now;
+        ur->rate_bytes = 0;
+        UpdateDepth(ur);
+    }
+
+    Submit(ur);
+    return copy;
+}
+
+void FileUringSeek(file_uring_t *ur, uint64_t offset)
+{
+    if (offset == ur->read_offset)
+        return;
+
+    Reap(ur);
+
+    /* Seeking forward within the queued requests keeps them */
+    while (ur->queue_count > 0)
+    {
+        unsigned idx = ur->queue[ur->queue_head];
+        uint64_t start = ur->bufs[idx].offset;
+
+        if (offset < start)
+            break;
+        if (offset < start + URING_READ_SIZE)
+        {   /* Read() handles offsets past a short read */
+            ur->bufs[idx].pos = offset - start;
+            ur->read_offset = offset;
+            return;
+        }
+        if (ur->bufs[idx].state == BUF_DONE
+         && ur->bufs[idx].result < URING_READ_SIZE)
+            break;
+        Dequeue(ur);
+    }
+
+    Flush(ur);
+    ur->read_offset = offset;
+    ur->submit_offset = offset;
+    ur->eof = false;
+}
+
+void FileUringSetDepth(file_uring_t *ur, uint64_t bytes, mtime_t duration)
+{
+    ur->depth_bytes = bytes;
+    ur->depth_time = duration;
+    UpdateDepth(ur);
+    msg_Dbg(ur->obj, "read-ahead: %u requests of %u bytes", ur->depth,
+            URING_READ_SIZE);
+}
@@ -40,6 +40,21 @@ vlc_module_begin ()
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
 
+    add_bool("file-mmap", false, N_("Memory-map files"),
+             N_("Map large local files in memory instead of copying their "
+                "data. This saves a copy of all the data read, but a file "
+                "truncated while it is being read may crash VLC."), true)
+#ifdef HAVE_IO_URING
+    add_bool("file-io-uring", false, N_("Asynchronous reading"),
+             N_("Keep several reads in flight with io_uring. This helps "
+                "with network and other high latency storage."), true)
+    add_integer_with_range("file-io-uring-buffer", 2048, 256, 4096,
+                           N_("Asynchronous reading buffer (KiB)"),
+                           N_("Memory set aside for the reads in flight of "
+                              "each open file. It bounds the read-ahead "
+                              "depth, and may be locked in memory."), true)
+#endif
+
     add_submodule()
     set_section( N_("Directory" ), NULL )
     set_capability( "access", 55 )
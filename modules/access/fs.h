@@ -28,3 +28,13 @@ int DirInit (access_t *p_access, DIR *handle);
 int DirRead (access_t *, input_item_node_t *);
 int DirControl (access_t *, int, va_list);
 void DirClose (vlc_object_t *);
+
+#ifdef HAVE_IO_URING
+typedef struct file_uring file_uring_t;
+
+file_uring_t *FileUringNew (vlc_object_t *, int fd);
+void FileUringDelete (file_uring_t *);
+ssize_t FileUringRead (file_uring_t *, void *, size_t);
+void FileUringSeek (file_uring_t *, uint64_t);
+void FileUringSetDepth (file_uring_t *, uint64_t bytes, mtime_t duration);
+#endif
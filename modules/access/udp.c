@@ -76,11 +76,22 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+/* maximum number of datagrams received by a single system call */
+#define VLEN 32
+
 struct access_sys_t
 {
     int fd;
     int timeout;
     size_t mtu;
+    uint64_t read_calls;
+#ifdef HAVE_RECVMMSG
+    unsigned next; /* first datagram not returned yet */
+    unsigned count; /* number of datagrams received by the last call */
+    block_t *pkts[VLEN];
+    struct mmsghdr msgs[VLEN];
+    struct iovec iovecs[VLEN];
+#endif
 };
 
 /*****************************************************************************
@@ -169,6 +180,17 @@ static int Open( vlc_object_t *p_this )
     }
 
     sys->mtu = 7 * 188;
+    sys->read_calls = 0;
+#ifdef HAVE_RECVMMSG
+    sys->next = sys->count = 0;
+    for (unsigned i = 0; i < VLEN; i++)
+    {
+        memset(&sys->msgs[i], 0, sizeof (sys->msgs[i]));
+        sys->msgs[i].msg_hdr.msg_iov = &sys->iovecs[i];
+        sys->msgs[i].msg_hdr.msg_iovlen = 1;
+        sys->pkts[i] = NULL;
+    }
+#endif
 
     sys->timeout = var_InheritInteger( p_access, "udp-timeout");
     if( sys->timeout > 0)
@@ -185,6 +207,11 @@ static void Close( vlc_object_t *p_this )
     access_t     *p_access = (access_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < VLEN; i++ )
+        if( sys->pkts[i] != NULL )
+            block_Release( sys->pkts[i] );
+#endif
     net_Close( sys->fd );
 }
 
@@ -193,6 +220,7 @@ static void Close( vlc_object_t *p_this )
  *****************************************************************************/
 static int Control( access_t *p_access, int i_query, va_list args )
 {
+    access_sys_t *sys = p_access->p_sys;
     bool    *pb_bool;
     int64_t *pi_64;
 
@@ -212,6 +240,10 @@ static int Control( access_t *p_access, int i_query, va_list args )
                    * var_InheritInteger(p_access, "network-caching");
             break;
 
+        case STREAM_GET_READ_CALLS:
+            *va_arg( args, uint64_t * ) = sys->read_calls;
+            break;
+
         default:
             return VLC_EGENERIC;
     }
@@ -221,6 +253,103 @@ static int Control( access_t *p_access, int i_query, va_list args )
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
+#ifdef HAVE_RECVMMSG
+/* Receives as many pending datagrams as possible with a single system call */
+static unsigned RecvUDP(access_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    /* Refill the pool, the datagrams returned so far belong to the input */
+    unsigned n;
+
+    for (n = 0; n < VLEN; n++)
+    {
+        block_t *pkt = sys->pkts[n];
+
+        if (pkt != NULL && pkt->i_buffer < sys->mtu)
+        {   /* the MTU was increased since this block was allocated */
+            block_Release(pkt);
+            pkt = NULL;
+        }
+        if (pkt == NULL)
+        {
+            pkt = block_Alloc(sys->mtu);
+            sys->pkts[n] = pkt;
+            if (unlikely(pkt == NULL))
+                break;
+        }
+        sys->iovecs[n].iov_base = pkt->p_buffer;
+        sys->iovecs[n].iov_len = pkt->i_buffer;
+    }
+
+    if (unlikely(n == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return 0;
+    }
+
+    struct pollfd ufd[1];
+
+    ufd[0].fd = sys->fd;
+    ufd[0].events = POLLIN;
+
+    switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+    {
+        case 0:
+            msg_Err(access, "receive time-out");
+            *eof = true;
+            /* fall through */
+        case -1:
+            return 0;
+    }
+
+#ifdef __linux__
+    const int flags = MSG_DONTWAIT | MSG_TRUNC;
+#else
+    const int flags = MSG_DONTWAIT;
+#endif
+    int val = recvmmsg(sys->fd, sys->msgs, n, flags, NULL);
+    if (val <= 0)
+        return 0;
+
+    sys->read_calls++;
+    for (int i = 0; i < val; i++)
+    {
+        block_t *pkt = sys->pkts[i];
+        size_t len = sys->msgs[i].msg_len;
+
+        if (sys->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            msg_Err(access, "%zu bytes packet truncated (MTU was %zu)",
+                    len, sys->mtu);
+            pkt->i_flags |= BLOCK_FLAG_CORRUPTED;
+            if (len > sys->mtu)
+                sys->mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+    }
+    return val;
+}
+
+static block_t *BlockUDP(access_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->next >= sys->count)
+    {
+        sys->next = 0;
+        sys->count = RecvUDP(access, eof);
+        if (sys->count == 0)
+            return NULL;
+    }
+
+    block_t *pkt = sys->pkts[sys->next];
+    sys->pkts[sys->next++] = NULL;
+    return pkt;
+}
+#else
 static block_t *BlockUDP(access_t *access, bool *restrict eof)
 {
     access_sys_t *sys = access->p_sys;
@@ -267,6 +396,7 @@ skip:
         block_Release(pkt);
         return NULL;
     }
+    sys->read_calls++;
 
 #ifdef MSG_TRUNC
     if (msg.msg_flags & MSG_TRUNC)
@@ -282,3 +412,4 @@ skip:
 
     return pkt;
 }
+#endif
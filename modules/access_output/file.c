@@ -216,6 +216,10 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
             break;
         }
 
+        case ACCESS_OUT_GET_FD:
+            *va_arg( args, int * ) = (intptr_t)p_access->p_sys;
+            break;
+
         default:
             return VLC_EGENERIC;
     }
@@ -392,9 +392,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                 /* send the combined header here instead of sending them as regular
                  * data, so that we get them as a single Metacube header block */
                 httpd_StreamHeader( p_sys->p_httpd_stream, p_hdr_block->p_buffer, p_hdr_block->i_buffer );
-                httpd_StreamSend( p_sys->p_httpd_stream, p_hdr_block );
-
-                block_Release( p_hdr_block );
+                httpd_StreamSendBlock( p_sys->p_httpd_stream, p_hdr_block );
             }
             else
             {
@@ -440,10 +438,8 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
             memcpy( p_buffer->p_buffer, &hdr, sizeof( hdr ) );
         }
 
-        /* send data */
-        i_err = httpd_StreamSend( p_sys->p_httpd_stream, p_buffer );
-
-        block_Release( p_buffer );
+        /* send data, the stream keeps the block for its clients */
+        i_err = httpd_StreamSendBlock( p_sys->p_httpd_stream, p_buffer );
         p_buffer = p_next;
 
         if( i_err < 0 )
@@ -46,10 +46,21 @@
 #else
 #   include <sys/socket.h>
 #endif
+#ifdef HAVE_SENDMMSG
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
-#define MAX_EMPTY_BLOCKS 200
+#define MAX_EMPTY_BLOCKS 256
+/* maximum number of packets waiting to be sent, more are dropped */
+#define MAX_QUEUED_BLOCKS 16384
+/* block given by the muxer and sent as is, not to be recycled */
+#define BLOCK_FLAG_FOREIGN (1 << BLOCK_FLAG_PRIVATE_SHIFT)
+/* maximum number of packets sent by a single system call */
+#define VLEN 32
+/* maximum size of a message split by the kernel (largest UDP/IPv4 payload) */
+#define GSO_MAX_SIZE 65507
 
 /*****************************************************************************
  * Module descriptor
@@ -71,6 +82,10 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split runs of same size packets " \
+                        "(UDP GSO) when sending several packets at once.")
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +94,9 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef UDP_SEGMENT
+    add_bool( SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT, true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +110,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef UDP_SEGMENT
+    "gso",
+#endif
     NULL
 };
 
@@ -115,11 +136,17 @@ struct sout_access_out_sys_t
     mtime_t       i_caching;
     int           i_handle;
     bool          b_mtu_warning;
+    bool          b_gso;
     size_t        i_mtu;
 
-    block_fifo_t *p_fifo;
-    block_fifo_t *p_empty_blocks;
+    block_queue_t *p_queue;
+    block_queue_t *p_empty_blocks;
     block_t      *p_buffer;
+    unsigned      i_overflow;   /* packets dropped since the last warning */
+
+    /* packets due, not sent yet */
+    block_t      *pp_batch[VLEN];
+    unsigned      i_batch;
 
     vlc_thread_t  thread;
 };
@@ -210,16 +237,40 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
-    p_sys->p_empty_blocks = block_FifoNew();
+    p_sys->p_queue = block_QueueNew( MAX_QUEUED_BLOCKS, false );
+    p_sys->p_empty_blocks = block_QueueNew( MAX_EMPTY_BLOCKS, false );
+    if( unlikely(p_sys->p_queue == NULL || p_sys->p_empty_blocks == NULL) )
+    {
+        if( p_sys->p_queue != NULL )
+            block_QueueRelease( p_sys->p_queue );
+        if( p_sys->p_empty_blocks != NULL )
+            block_QueueRelease( p_sys->p_empty_blocks );
+        net_Close (i_handle);
+        free (p_sys);
+        return VLC_ENOMEM;
+    }
     p_sys->p_buffer = NULL;
+    p_sys->i_overflow = 0;
+    p_sys->i_batch = 0;
+    p_sys->b_gso = false;
+#ifdef UDP_SEGMENT
+    if( var_GetBool( p_access, SOUT_CFG_PREFIX "gso" ) )
+    {
+        int val;
+        socklen_t len = sizeof (val);
+
+        /* the option only exists if the kernel supports it */
+        p_sys->b_gso = getsockopt( i_handle, SOL_UDP, UDP_SEGMENT,
+                                   &val, &len ) == 0;
+    }
+#endif
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
-        block_FifoRelease( p_sys->p_fifo );
-        block_FifoRelease( p_sys->p_empty_blocks );
+        block_QueueRelease( p_sys->p_queue );
+        block_QueueRelease( p_sys->p_empty_blocks );
         net_Close (i_handle);
         free (p_sys);
         return VLC_EGENERIC;
@@ -242,10 +293,12 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
-    block_FifoRelease( p_sys->p_fifo );
-    block_FifoRelease( p_sys->p_empty_blocks );
+    block_QueueRelease( p_sys->p_queue );
+    block_QueueRelease( p_sys->p_empty_blocks );
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        block_Release( p_sys->pp_batch[i] );
 
     net_Close( p_sys->i_handle );
     free( p_sys );
@@ -253,20 +306,49 @@ static void Close( vlc_object_t * p_this )
 
 static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 {
-    (void)p_access;
-
     switch( i_query )
     {
         case ACCESS_OUT_CONTROLS_PACE:
             *va_arg( args, bool * ) = false;
             break;
 
+        case ACCESS_OUT_GET_FD:
+            /* the socket is connected: each write is one datagram */
+            *va_arg( args, int * ) = p_access->p_sys->i_handle;
+            break;
+
         default:
             return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * Queue: pass a packet to the sender thread
+ *****************************************************************************
+ * The muxer must not wait for the sender thread, which paces the packets at
+ * their date: if that thread falls behind by a whole queue, the packets are
+ * late anyway and are dropped.
+ *****************************************************************************/
+static void Queue( sout_access_out_t *p_access, block_t *p_pk )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( likely(block_QueueTryPut( p_sys->p_queue, p_pk )) )
+    {
+        if( unlikely(p_sys->i_overflow > 0) )
+        {
+            msg_Warn( p_access, "sending too slow, dropped %u packets",
+                      p_sys->i_overflow );
+            p_sys->i_overflow = 0;
+        }
+        return;
+    }
+
+    p_sys->i_overflow++;
+    block_Release( p_pk );
+}
+
 /*****************************************************************************
  * Write: standard write on a file descriptor.
  *****************************************************************************/
@@ -298,10 +380,25 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                          now - p_sys->p_buffer->i_dts
                           - p_sys->i_caching );
             }
-            block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+            Queue( p_access, p_sys->p_buffer );
             p_sys->p_buffer = NULL;
         }
 
+        /* A block too large to share a datagram with another one of its
+         * size, such as gathered TS packets, is sent without copy */
+        if( !p_sys->p_buffer && p_buffer->i_buffer <= p_sys->i_mtu &&
+            p_buffer->i_buffer > p_sys->i_mtu / 2 )
+        {
+            p_next = p_buffer->p_next;
+            p_buffer->p_next = NULL;
+            p_buffer->i_flags = (p_buffer->i_flags & BLOCK_FLAG_CLOCK)
+                              | BLOCK_FLAG_FOREIGN;
+            i_len += p_buffer->i_buffer;
+            Queue( p_access, p_buffer );
+            p_buffer = p_next;
+            continue;
+        }
+
         i_len += p_buffer->i_buffer;
         while( p_buffer->i_buffer )
         {
@@ -338,7 +435,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                              mdate() - p_sys->p_buffer->i_dts
                               - p_sys->i_caching );
                 }
-                block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+                Queue( p_access, p_sys->p_buffer );
                 p_sys->p_buffer = NULL;
             }
         }
@@ -369,22 +466,18 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     sout_access_out_sys_t *p_sys = p_access->p_sys;
     block_t *p_buffer;
 
-    while ( block_FifoCount( p_sys->p_empty_blocks ) > MAX_EMPTY_BLOCKS )
-    {
-        p_buffer = block_FifoGet( p_sys->p_empty_blocks );
-        block_Release( p_buffer );
-    }
-
-    if( block_FifoCount( p_sys->p_empty_blocks ) == 0 )
+    p_buffer = block_QueueTryGet( p_sys->p_empty_blocks );
+    if( p_buffer == NULL )
     {
         p_buffer = block_Alloc( p_sys->i_mtu );
     }
     else
     {
-        p_buffer = block_FifoGet(p_sys->p_empty_blocks );
         p_buffer->i_flags = 0;
         p_buffer = block_Realloc( p_buffer, 0, p_sys->i_mtu );
     }
+    if( unlikely(p_buffer == NULL) )
+        return NULL;
 
     p_buffer->i_dts = i_dts;
     p_buffer->i_buffer = 0;
@@ -392,6 +485,125 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+/*****************************************************************************
+ * SendPackets: send packets with as few system calls as possible
+ *****************************************************************************/
+static void SendPackets( sout_access_out_t *p_access, block_t **pp_pk,
+                         unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[VLEN];
+    struct iovec iov[VLEN];
+    unsigned first[VLEN]; /* first packet of each message */
+    unsigned i_msgs = 0;
+# ifdef UDP_SEGMENT
+    union
+    {
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+        struct cmsghdr align;
+    } control[VLEN];
+# endif
+
+    assert( i_count <= VLEN );
+
+    for( unsigned i = 0; i < i_count; i_msgs++ )
+    {
+        struct msghdr *msg = &msgs[i_msgs].msg_hdr;
+        const size_t i_size = pp_pk[i]->i_buffer;
+        unsigned n = 1;
+
+        memset( msg, 0, sizeof (*msg) );
+        msg->msg_iov = &iov[i];
+        iov[i].iov_base = pp_pk[i]->p_buffer;
+        iov[i].iov_len = i_size;
+# ifdef UDP_SEGMENT
+        /* The kernel splits the message in datagrams of the size of the
+         * first one, only the last datagram can be shorter. */
+        if( p_sys->b_gso )
+        {
+            size_t i_total = i_size;
+
+            while( i + n < i_count && pp_pk[i + n - 1]->i_buffer == i_size
+                && pp_pk[i + n]->i_buffer <= i_size
+                && (i_total += pp_pk[i + n]->i_buffer) <= GSO_MAX_SIZE )
+            {
+                iov[i + n].iov_base = pp_pk[i + n]->p_buffer;
+                iov[i + n].iov_len = pp_pk[i + n]->i_buffer;
+                n++;
+            }
+        }
+
+        if( n > 1 )
+        {
+            uint16_t i_segment = i_size;
+
+            msg->msg_control = control[i_msgs].buf;
+            msg->msg_controllen = sizeof (control[i_msgs].buf);
+
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR( msg );
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof (i_segment));
+            memcpy( CMSG_DATA(cmsg), &i_segment, sizeof (i_segment) );
+        }
+# endif
+        msg->msg_iovlen = n;
+        first[i_msgs] = i;
+        i += n;
+    }
+
+    for( unsigned i = 0; i < i_msgs; )
+    {
+        int val = sendmmsg( p_sys->i_handle, msgs + i, i_msgs - i, 0 );
+        if( val == -1 )
+        {
+# ifdef UDP_SEGMENT
+            if( p_sys->b_gso && (errno == EIO || errno == EINVAL) )
+            {   /* no segmentation offload on this route or device */
+                msg_Warn( p_access, "segmentation offload failed: %s",
+                          vlc_strerror_c(errno) );
+                p_sys->b_gso = false;
+                SendPackets( p_access, pp_pk + first[i],
+                             i_count - first[i] );
+                return;
+            }
+# endif
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            val = 1; /* skip the failed message */
+        }
+        i += val;
+    }
+#else
+    for( unsigned i = 0; i < i_count; i++ )
+        if( send( p_sys->i_handle, pp_pk[i]->p_buffer,
+                  pp_pk[i]->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+#endif
+}
+
+/*****************************************************************************
+ * Flush: send the pending packets and recycle them
+ *****************************************************************************/
+static void Recycle( sout_access_out_sys_t *p_sys, block_t *p_buffer )
+{
+    if( (p_buffer->i_flags & BLOCK_FLAG_FOREIGN)
+     || !block_QueueTryPut( p_sys->p_empty_blocks, p_buffer ) )
+        block_Release( p_buffer );
+}
+
+static void Flush( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    SendPackets( p_access, p_sys->pp_batch, p_sys->i_batch );
+
+    for( unsigned i = 0; i < p_sys->i_batch; i++ )
+        Recycle( p_sys, p_sys->pp_batch[i] );
+    p_sys->i_batch = 0;
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -407,7 +619,16 @@ static void* ThreadWrite( void *data )
 
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        /* Packets are sent together as long as more are queued, so that the
+         * thread never sleeps with packets pending. */
+        if( p_sys->i_batch > 0 )
+        {
+            if( block_QueueGetCount( p_sys->p_queue ) == 0
+             || p_sys->i_batch == VLEN )
+                Flush( p_access );
+        }
+
+        block_t *p_pk = block_QueueGet( p_sys->p_queue );
         mtime_t       i_date, i_sent;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
@@ -419,7 +640,7 @@ static void* ThreadWrite( void *data )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
                              i_date - i_date_last );
 
-                block_FifoPut( p_sys->p_empty_blocks, p_pk );
+                Recycle( p_sys, p_pk );
 
                 i_date_last = i_date;
                 i_dropped_packets++;
@@ -433,16 +654,19 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        block_cleanup_push( p_pk );
+        /* The packet joins the batch before waiting: Close() releases the
+         * batch if the thread is cancelled. */
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
+            if( p_sys->i_batch > 0 && i_date > mdate() )
+                Flush( p_access );
+            p_sys->pp_batch[p_sys->i_batch++] = p_pk;
             mwait( i_date );
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
+        else
+            p_sys->pp_batch[p_sys->i_batch++] = p_pk;
 
         if( i_dropped_packets )
         {
@@ -459,8 +683,6 @@ static void* ThreadWrite( void *data )
         }
 #endif
 
-        block_FifoPut( p_sys->p_empty_blocks, p_pk );
-
         i_date_last = i_date;
     }
     return NULL;
@@ -76,8 +76,10 @@ SegmentTrackerEvent::SegmentTrackerEvent(const ID &id, mtime_t duration)
     u.segment.id = &id;
 }
 
-SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet)
+SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSet *adaptSet,
+                               mtime_t prefetchTime_)
 {
+    prefetchTime = prefetchTime_;
     first = true;
     curNumber = next = 0;
     initializing = true;
@@ -127,6 +129,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    flushPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -247,7 +250,18 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = NULL;
+    if(!prefetched.empty() && prefetched.front().rep == rep &&
+       prefetched.front().number == next)
+    {
+        chunk = prefetched.front().chunk;
+        prefetched.pop_front();
+    }
+    else
+    {
+        flushPrefetched();
+        chunk = segment->toChunk(next, rep, connManager);
+    }
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -274,11 +288,62 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        if(prefetchTime > 0)
+            prefetchChunks(rep, connManager);
     }
 
     return chunk;
 }
 
+void SegmentTracker::prefetchChunks(BaseRepresentation *rep,
+                                    AbstractConnectionManager *connManager)
+{
+    const Timescale timescale = rep->inheritTimescale();
+    uint64_t number = next;
+    mtime_t ahead = 0;
+
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+    {
+        ahead += (*it).duration;
+        number = (*it).number + 1;
+    }
+
+    while(ahead < prefetchTime)
+    {
+        bool b_gap = false;
+        uint64_t found;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &found, &b_gap);
+        /* Only prefetch contiguous segments we know the length of */
+        if(!segment || b_gap || found != number)
+            break;
+
+        PrefetchedChunk entry;
+        entry.rep = rep;
+        entry.number = number;
+        entry.duration = timescale.ToTime(segment->duration.Get());
+        if(entry.duration <= 0)
+            break;
+        entry.chunk = segment->toChunk(number, rep, connManager, true);
+        if(!entry.chunk)
+            break;
+        prefetched.push_back(entry);
+
+        ahead += entry.duration;
+        number++;
+    }
+}
+
+void SegmentTracker::flushPrefetched()
+{
+    while(!prefetched.empty())
+    {
+        delete prefetched.front().chunk;
+        prefetched.pop_front();
+    }
+}
+
 bool SegmentTracker::setPositionByTime(mtime_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -304,6 +369,7 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         index_sent = false;
         init_sent = false;
     }
+    flushPrefetched();
     curNumber = next = segnumber;
 }
 
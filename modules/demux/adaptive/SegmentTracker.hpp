@@ -112,7 +112,7 @@ namespace adaptive
     class SegmentTracker
     {
         public:
-            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *);
+            SegmentTracker(AbstractAdaptationLogic *, BaseAdaptationSet *, mtime_t = 0);
             ~SegmentTracker();
 
             StreamFormat getCurrentFormat() const;
@@ -131,6 +131,8 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            void prefetchChunks(BaseRepresentation *, AbstractConnectionManager *);
+            void flushPrefetched();
             bool first;
             bool initializing;
             bool index_sent;
@@ -142,6 +144,16 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            /* media chunks requested ahead of the current one */
+            struct PrefetchedChunk
+            {
+                BaseRepresentation *rep;
+                uint64_t number;
+                mtime_t duration;
+                SegmentChunk *chunk;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            mtime_t prefetchTime;
     };
 }
 
@@ -71,6 +71,18 @@ static void Close   (vlc_object_t *);
 
 #define ADAPT_LOGIC_TEXT N_("Adaptive Logic")
 
+#define ADAPT_CONNECTIONS_TEXT N_("Connections per server")
+#define ADAPT_CONNECTIONS_LONGTEXT N_("Maximum number of segments downloaded at once from the same server")
+
+#define ADAPT_CACHE_SIZE_TEXT N_("Segments cache size (MiB)")
+#define ADAPT_CACHE_SIZE_LONGTEXT N_("Maximum disk space used to keep the downloaded segments for later sessions (0 disables)")
+
+#define ADAPT_CACHE_PATH_TEXT N_("Segments cache directory")
+#define ADAPT_CACHE_PATH_LONGTEXT N_("Directory of the segments cache, which can be shared by several instances. Defaults to the user cache directory.")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments prefetch (ms)")
+#define ADAPT_PREFETCH_LONGTEXT N_("Duration of the segments to request ahead of the one being read (0 disables)")
+
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using http access instead of custom http code")
 
@@ -120,6 +132,14 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-connections", 2, 1, 8,
+                     ADAPT_CONNECTIONS_TEXT, ADAPT_CONNECTIONS_LONGTEXT, true )
+        add_integer( "adaptive-prefetch", 0,
+                     ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+        add_integer( "adaptive-cache-size", 0,
+                     ADAPT_CACHE_SIZE_TEXT, ADAPT_CACHE_SIZE_LONGTEXT, true )
+        add_directory( "adaptive-cache-path", NULL,
+                     ADAPT_CACHE_PATH_TEXT, ADAPT_CACHE_PATH_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -29,6 +29,7 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
@@ -133,7 +134,7 @@ HTTPChunkSource::HTTPChunkSource(const std::string& url, AbstractConnectionManag
 HTTPChunkSource::~HTTPChunkSource()
 {
     if(connection)
-        connection->setUsed(false);
+        connManager->recycleConnection(connection);
 }
 
 bool HTTPChunkSource::init(const std::string &url)
@@ -158,6 +159,11 @@ bool HTTPChunkSource::hasMoreData() const
     else return true;
 }
 
+const ConnectionParams & HTTPChunkSource::getConnectionParams() const
+{
+    return params;
+}
+
 block_t * HTTPChunkSource::read(size_t readsize)
 {
     if(!prepare())
@@ -249,7 +255,12 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     vlc_cond_init(&avail);
     done = false;
     eof = false;
+    ahead = false;
+    scheduled = 0;
     downloadstart = 0;
+    cacheable = false;
+    cacheexpiry = 0;
+    cachewriter = NULL;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -266,6 +277,7 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
     vlc_mutex_unlock(&lock);
 
     connManager->cancel(this);
+    delete cachewriter;
 
     vlc_cond_destroy(&avail);
     vlc_mutex_destroy(&lock);
@@ -280,6 +292,29 @@ bool HTTPChunkBufferedSource::isDone() const
     return b_done;
 }
 
+void HTTPChunkBufferedSource::setCacheable(time_t expiry)
+{
+    cacheable = true;
+    cacheexpiry = expiry;
+}
+
+bool HTTPChunkBufferedSource::isAhead() const
+{
+    bool b_ahead;
+    vlc_mutex_lock(const_cast<vlc_mutex_t *>(&lock));
+    b_ahead = ahead;
+    vlc_mutex_unlock(const_cast<vlc_mutex_t *>(&lock));
+    return b_ahead;
+}
+
+void HTTPChunkBufferedSource::setScheduled(bool b_ahead)
+{
+    vlc_mutex_lock(&lock);
+    scheduled = mdate();
+    ahead = b_ahead;
+    vlc_mutex_unlock(&lock);
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     vlc_mutex_lock(&lock);
@@ -298,6 +333,13 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(contentLength && readsize > contentLength - buffered)
         readsize = contentLength - buffered;
 
+    if(done) /* served from the cache */
+    {
+        vlc_cond_signal(&avail);
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+
     vlc_mutex_unlock(&lock);
 
     block_t *p_block = block_Alloc(readsize);
@@ -314,11 +356,15 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     } rate = {0,0};
 
     ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    bool b_complete = false;
     if(ret <= 0)
     {
         block_Release(p_block);
         vlc_mutex_lock(&lock);
         done = true;
+        /* without a length, a closed connection cannot be told apart from
+         * the end of the body: do not cache such segments */
+        b_complete = (ret == 0 && contentLength && buffered + consumed == contentLength);
         rate.size = buffered + consumed;
         rate.time = mdate() - downloadstart;
         downloadstart = 0;
@@ -327,12 +373,15 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     else
     {
         p_block->i_buffer = (size_t) ret;
+        if(cachewriter)
+            cachewriter->write(p_block);
         vlc_mutex_lock(&lock);
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
         if((size_t) ret < readsize)
         {
             done = true;
+            b_complete = (contentLength && buffered + consumed == contentLength);
             rate.size = buffered + consumed;
             rate.time = mdate() - downloadstart;
             downloadstart = 0;
@@ -343,6 +392,22 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(rate.size)
     {
         connManager->updateDownloadRate(sourceid, rate.size, rate.time);
+        /* Body is complete, let the next download reuse the connection */
+        vlc_mutex_lock(&lock);
+        if(connection)
+        {
+            connManager->recycleConnection(connection);
+            connection = NULL;
+        }
+        vlc_mutex_unlock(&lock);
+    }
+
+    if(cachewriter && (rate.size || b_complete))
+    {
+        if(b_complete)
+            cachewriter->commit();
+        delete cachewriter;
+        cachewriter = NULL;
     }
 
     vlc_cond_signal(&avail);
@@ -353,6 +418,27 @@ bool HTTPChunkBufferedSource::prepare()
     if(!prepared)
     {
         downloadstart = mdate();
+        if(scheduled)
+            connManager->updateQueueWait(sourceid, downloadstart - scheduled);
+
+        SegmentCache *cache = connManager->getSegmentCache();
+        if(cache && cacheable)
+        {
+            const std::string key = SegmentCache::key(getConnectionParams().getUrl(),
+                                                      bytesRange);
+            block_t *p_block = cache->get(key);
+            if(p_block)
+            {
+                contentLength = p_block->i_buffer;
+                buffered = p_block->i_buffer;
+                block_ChainLastAppend(&pp_tail, p_block);
+                prepared = true;
+                done = true;
+                return true;
+            }
+            cachewriter = cache->put(key, cacheexpiry);
+        }
+
         return HTTPChunkSource::prepare();
     }
     return true;
@@ -367,10 +453,24 @@ bool HTTPChunkBufferedSource::hasMoreData() const
     return b_hasdata;
 }
 
+/* A source fetched ahead is being read: it goes before the other ones */
+void HTTPChunkBufferedSource::promote()
+{
+    vlc_mutex_lock(&lock);
+    bool b_schedule = ahead && !done;
+    ahead = false;
+    vlc_mutex_unlock(&lock);
+
+    if(b_schedule)
+        connManager->start(this);
+}
+
 block_t * HTTPChunkBufferedSource::readBlock()
 {
     block_t *p_block = NULL;
 
+    promote();
+
     vlc_mutex_lock(&lock);
 
     while(!p_head && !done)
@@ -406,6 +506,8 @@ block_t * HTTPChunkBufferedSource::readBlock()
 
 block_t * HTTPChunkBufferedSource::read(size_t readsize)
 {
+    promote();
+
     vlc_mutex_lock(&lock);
 
     while(readsize > buffered && !done)
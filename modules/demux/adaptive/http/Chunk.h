@@ -41,6 +41,7 @@ namespace adaptive
         class AbstractConnection;
         class AbstractConnectionManager;
         class AbstractChunk;
+        class SegmentCacheWriter;
 
         class AbstractChunkSource
         {
@@ -90,6 +91,7 @@ namespace adaptive
                 virtual block_t *   readBlock       (); /* impl */
                 virtual block_t *   read            (size_t); /* impl */
                 virtual bool        hasMoreData     () const; /* impl */
+                const ConnectionParams & getConnectionParams() const;
 
                 static const size_t CHUNK_SIZE = 32768;
 
@@ -118,11 +120,16 @@ namespace adaptive
                 virtual block_t *  readBlock       (); /* reimpl */
                 virtual block_t *  read            (size_t); /* reimpl */
                 virtual bool       hasMoreData     () const; /* impl */
+                /* expiry is a wall clock time, 0 for never */
+                void               setCacheable    (time_t);
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                bool               isAhead() const;
+                void               setScheduled(bool);
+                void               promote();
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -130,7 +137,12 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
+                bool                ahead; /* prefetched, not read yet */
+                mtime_t             scheduled;
                 mtime_t             downloadstart;
+                bool                cacheable;
+                time_t              cacheexpiry;
+                SegmentCacheWriter *cachewriter;
                 vlc_mutex_t         lock;
                 vlc_cond_t          avail;
         };
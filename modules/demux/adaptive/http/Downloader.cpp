@@ -26,44 +26,57 @@
 #include <vlc_threads.h>
 #include <vlc_atomic.h>
 
+#include <algorithm>
+
 using namespace adaptive::http;
 
 Downloader::Downloader()
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    maxPerHost = 1;
 }
 
-bool Downloader::start()
+bool Downloader::start(unsigned workers, unsigned perhost)
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    maxPerHost = perhost ? perhost : 1;
+    while(threads.size() < workers)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        threads.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !threads.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = threads.begin(); it != threads.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
-void Downloader::schedule(HTTPChunkBufferedSource *source)
+
+void Downloader::schedule(HTTPChunkBufferedSource *source, bool b_ahead)
 {
     vlc_mutex_lock(&lock);
-    chunks.push_back(source);
+    /* a source fetched ahead is scheduled again once it is read */
+    if(std::find(chunks.begin(), chunks.end(), source) == chunks.end())
+    {
+        source->setScheduled(b_ahead);
+        chunks.push_back(source);
+    }
     vlc_cond_signal(&waitcond);
     vlc_mutex_unlock(&lock);
 }
@@ -72,6 +85,10 @@ void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     chunks.remove(source);
+    /* wait for the worker reading it */
+    while(std::find(active.begin(), active.end(), source) != active.end())
+        vlc_cond_wait(&updatedcond, &lock);
+    release(source);
     vlc_mutex_unlock(&lock);
 }
 
@@ -90,24 +107,80 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+/* Frees the connection slot of a source */
+void Downloader::release(HTTPChunkBufferedSource *source)
+{
+    std::list<HTTPChunkBufferedSource *>::iterator it =
+            std::find(started.begin(), started.end(), source);
+    if(it != started.end())
+    {
+        started.erase(it);
+        hostConnections[source->getConnectionParams().getHostname()]--;
+        vlc_cond_broadcast(&waitcond);
+    }
+}
+
+/* Returns the first queued source no worker is reading, which already has
+ * a connection or can open one to its host. The last connection to a host
+ * is kept for the segments being played: sources fetched ahead never take
+ * it, so they cannot hold back the playback. */
+HTTPChunkBufferedSource * Downloader::getNextSource(bool b_ahead)
+{
+    const unsigned limit = b_ahead ? maxPerHost - 1 : maxPerHost;
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+        HTTPChunkBufferedSource *source = *it;
+        if(source->isAhead() != b_ahead ||
+           std::find(active.begin(), active.end(), source) != active.end())
+            continue;
+
+        if(std::find(started.begin(), started.end(), source) != started.end())
+            return source;
+
+        unsigned &connections =
+                hostConnections[source->getConnectionParams().getHostname()];
+        if(connections < limit)
+        {
+            connections++;
+            started.push_back(source);
+            return source;
+        }
+    }
+    return NULL;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source = NULL;
+
+        /* Segments being played go first, then the ones fetched ahead */
+        while(!killed && !(source = getNextSource(false)) &&
+                         !(source = getNextSource(true)))
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        active.push_back(source);
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        active.remove(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-                chunks.pop_front();
+            chunks.remove(source);
+            release(source);
         }
+        vlc_cond_broadcast(&updatedcond);
+        /* let another worker pick the source up if it has still data */
+        vlc_cond_signal(&waitcond);
     }
     vlc_mutex_unlock(&lock);
 }
@@ -24,6 +24,9 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace adaptive
 {
@@ -36,20 +39,29 @@ namespace adaptive
             public:
                 Downloader();
                 ~Downloader();
-                bool start();
-                void schedule(HTTPChunkBufferedSource *);
+                bool start(unsigned = 1, unsigned = 1);
+                void schedule(HTTPChunkBufferedSource *, bool = false);
                 void cancel(HTTPChunkBufferedSource *);
 
             private:
                 static void * downloaderThread(void *);
                 void Run();
+                HTTPChunkBufferedSource * getNextSource(bool);
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                void release(HTTPChunkBufferedSource *);
+                std::vector<vlc_thread_t> threads;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
                 bool         killed;
+                unsigned     maxPerHost;
+                /* queued sources, in scheduling order */
                 std::list<HTTPChunkBufferedSource *> chunks;
+                /* sources being read by a worker */
+                std::list<HTTPChunkBufferedSource *> active;
+                /* started sources, holding a connection, per host */
+                std::list<HTTPChunkBufferedSource *> started;
+                std::map<std::string, unsigned> hostConnections;
         };
 
     }
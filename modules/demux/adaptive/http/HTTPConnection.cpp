@@ -196,11 +196,13 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
         bytesRead += ret;
 
     if(ret < 0 || (size_t)ret < len || /* set EOF */
-       contentLength == bytesRead )
+       (contentLength == bytesRead && connectionClose) )
     {
         socket->disconnect();
         return ret;
     }
+    /* else complete body on a persistent connection: keep it open
+       for the next request, see setUsed() */
 
     return ret;
 }
@@ -30,6 +30,7 @@
 #include "ConnectionParams.hpp"
 #include "Sockets.hpp"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 #include <vlc_url.h>
 
 using namespace adaptive::http;
@@ -39,17 +40,44 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    cache = NULL;
+    vlc_mutex_init(&ratelock);
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
 {
-
+    delete cache;
+    vlc_mutex_destroy(&ratelock);
 }
 
 void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, mtime_t time)
 {
+    /* Downloads complete on several threads: the logics expect
+       their updates to be serialized */
+    vlc_mutex_lock(&ratelock);
+    DownloadStats &s = stats[sourceid];
+    s.size += size;
+    s.time += time;
+    if(++s.count % 16 == 0 && s.time > 0)
+        msg_Dbg(p_object, "stream %s: %u segments, %" PRIu64 " KiB/s, "
+                "%" PRId64 " ms average queue wait", sourceid.str().c_str(),
+                s.count, s.size * CLOCK_FREQ / s.time / 1024,
+                s.wait / s.count / 1000);
     if(rateObserver)
         rateObserver->updateDownloadRate(sourceid, size, time);
+    vlc_mutex_unlock(&ratelock);
+}
+
+void AbstractConnectionManager::updateQueueWait(const adaptive::ID &sourceid, mtime_t time)
+{
+    vlc_mutex_lock(&ratelock);
+    stats[sourceid].wait += time;
+    vlc_mutex_unlock(&ratelock);
+}
+
+SegmentCache * AbstractConnectionManager::getSegmentCache() const
+{
+    return cache;
 }
 
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
@@ -62,7 +90,14 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Connec
 {
     vlc_mutex_init(&lock);
     downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    if(downloader)
+    {
+        unsigned perhost = var_InheritInteger(p_object, "adaptive-connections");
+        /* enough workers to use every connection to two servers, such as
+         * separate audio and video ones */
+        downloader->start(2 * perhost, perhost);
+    }
+    cache = SegmentCache::create(p_object);
     if(!factory_)
     {
         if(var_InheritBool(p_object, "adaptive-use-access"))
@@ -138,6 +173,13 @@ AbstractConnection * HTTPConnectionManager::getConnection(ConnectionParams &para
     return conn;
 }
 
+void HTTPConnectionManager::recycleConnection(AbstractConnection *conn)
+{
+    vlc_mutex_lock(&lock);
+    conn->setUsed(false);
+    vlc_mutex_unlock(&lock);
+}
+
 void HTTPConnectionManager::start(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
@@ -145,6 +187,13 @@ void HTTPConnectionManager::start(AbstractChunkSource *source)
         downloader->schedule(src);
 }
 
+void HTTPConnectionManager::prefetch(AbstractChunkSource *source)
+{
+    HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
+    if(src)
+        downloader->schedule(src, true);
+}
+
 void HTTPConnectionManager::cancel(AbstractChunkSource *source)
 {
     HTTPChunkBufferedSource *src = dynamic_cast<HTTPChunkBufferedSource *>(source);
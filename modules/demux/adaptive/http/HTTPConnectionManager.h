@@ -30,6 +30,7 @@
 #include <vlc_common.h>
 #include <vector>
 #include <string>
+#include <map>
 
 namespace adaptive
 {
@@ -40,6 +41,7 @@ namespace adaptive
         class AbstractConnection;
         class Downloader;
         class AbstractChunkSource;
+        class SegmentCache;
 
         class AbstractConnectionManager : public IDownloadRateObserver
         {
@@ -48,16 +50,31 @@ namespace adaptive
                 ~AbstractConnectionManager();
                 virtual void    closeAllConnections () = 0;
                 virtual AbstractConnection * getConnection(ConnectionParams &) = 0;
+                virtual void    recycleConnection(AbstractConnection *) = 0;
                 virtual void start(AbstractChunkSource *) = 0;
+                virtual void prefetch(AbstractChunkSource *) = 0;
                 virtual void cancel(AbstractChunkSource *) = 0;
 
                 virtual void updateDownloadRate(const ID &, size_t, mtime_t); /* impl */
+                void updateQueueWait(const ID &, mtime_t);
                 void setDownloadRateObserver(IDownloadRateObserver *);
+                SegmentCache * getSegmentCache() const;
 
             protected:
                 vlc_object_t                                       *p_object;
+                SegmentCache                                       *cache;
 
             private:
+                /* per stream counters */
+                struct DownloadStats
+                {
+                    uint64_t size;
+                    mtime_t  time; /* spent transferring */
+                    mtime_t  wait; /* spent queued, before transferring */
+                    unsigned count;
+                };
+                vlc_mutex_t                                         ratelock;
+                std::map<ID, DownloadStats>                         stats;
                 IDownloadRateObserver                              *rateObserver;
         };
 
@@ -69,8 +86,10 @@ namespace adaptive
 
                 virtual void    closeAllConnections () /* impl */;
                 virtual AbstractConnection * getConnection(ConnectionParams &) /* impl */;
+                virtual void    recycleConnection(AbstractConnection *) /* impl */;
 
                 virtual void start(AbstractChunkSource *) /* impl */;
+                virtual void prefetch(AbstractChunkSource *) /* impl */;
                 virtual void cancel(AbstractChunkSource *) /* impl */;
 
             private:
@@ -0,0 +1,366 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+#include "BytesRange.hpp"
+
+#include <vlc_block.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+# include <utime.h>
+#endif
+
+using namespace adaptive::http;
+
+/* magic, reserved, expiry (64 bits big endian) */
+#define SEGMENTCACHE_HEADER_SIZE 16
+#define SEGMENTCACHE_MAGIC       "VASC"
+#define SEGMENTCACHE_EXT         ".seg"
+/* other instances write to the same directory: rescan it that often */
+#define SEGMENTCACHE_SCAN_PERIOD (CLOCK_FREQ * 60)
+/* entries being written are left by crashed instances once that old (s) */
+#define SEGMENTCACHE_TEMP_EXPIRY 3600
+
+SegmentCache::SegmentCache(vlc_object_t *p_object_, const std::string &dir_,
+                           uint64_t maxsize_)
+{
+    p_object = p_object_;
+    dir = dir_;
+    maxsize = maxsize_;
+    usage = 0;
+    lastscan = VLC_TS_INVALID;
+    vlc_mutex_init(&lock);
+}
+
+SegmentCache::~SegmentCache()
+{
+    vlc_mutex_destroy(&lock);
+}
+
+SegmentCache * SegmentCache::create(vlc_object_t *p_object)
+{
+    const uint64_t maxsize =
+            (uint64_t) var_InheritInteger(p_object, "adaptive-cache-size") << 20;
+    if(maxsize == 0)
+        return NULL;
+
+    std::string dir;
+    char *psz_dir = var_InheritString(p_object, "adaptive-cache-path");
+    if(psz_dir)
+    {
+        dir = psz_dir;
+        free(psz_dir);
+    }
+    else
+    {
+        psz_dir = config_GetUserDir(VLC_CACHE_DIR);
+        if(!psz_dir)
+            return NULL;
+        vlc_mkdir(psz_dir, 0700);
+        dir = std::string(psz_dir) + DIR_SEP "adaptive";
+        free(psz_dir);
+    }
+
+    if(vlc_mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        msg_Warn(p_object, "cannot create segments cache %s: %s",
+                 dir.c_str(), vlc_strerror_c(errno));
+        return NULL;
+    }
+
+    msg_Dbg(p_object, "using segments cache %s", dir.c_str());
+    return new (std::nothrow) SegmentCache(p_object, dir, maxsize);
+}
+
+std::string SegmentCache::key(const std::string &url, const BytesRange &range)
+{
+    std::stringstream ss;
+    ss << url;
+    if(range.isValid())
+        ss << "@" << range.getStartByte() << "-" << range.getEndByte();
+    return ss.str();
+}
+
+std::string SegmentCache::path(const std::string &key) const
+{
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, key.c_str(), key.length());
+    EndMD5(&md5);
+
+    std::string entry;
+    char *psz_hash = psz_md5_hash(&md5);
+    if(psz_hash)
+    {
+        entry = dir + DIR_SEP + psz_hash + SEGMENTCACHE_EXT;
+        free(psz_hash);
+    }
+    return entry;
+}
+
+block_t * SegmentCache::get(const std::string &key)
+{
+    const std::string entry = path(key);
+    if(entry.empty())
+        return NULL;
+
+    int fd = vlc_open(entry.c_str(), O_RDONLY);
+    if(fd == -1)
+        return NULL;
+
+    block_t *p_block = NULL;
+    uint8_t header[SEGMENTCACHE_HEADER_SIZE];
+    if(read(fd, header, sizeof(header)) == sizeof(header) &&
+       !memcmp(header, SEGMENTCACHE_MAGIC, 4))
+    {
+        const time_t expiry = GetQWBE(&header[8]);
+        if(expiry == 0 || expiry > time(NULL))
+            p_block = block_File(fd, false);
+    }
+    vlc_close(fd);
+
+    if(p_block == NULL)
+    {
+        /* expired or invalid */
+        vlc_unlink(entry.c_str());
+        return NULL;
+    }
+
+    p_block->p_buffer += SEGMENTCACHE_HEADER_SIZE;
+    p_block->i_buffer -= SEGMENTCACHE_HEADER_SIZE;
+#ifndef _WIN32
+    /* the modification time orders the entries for eviction */
+    utime(entry.c_str(), NULL);
+#endif
+    return p_block;
+}
+
+SegmentCacheWriter * SegmentCache::put(const std::string &key, time_t expiry)
+{
+    const std::string entry = path(key);
+    if(entry.empty())
+        return NULL;
+
+    std::string temp = entry + ".XXXXXX";
+    std::vector<char> psz_temp(temp.begin(), temp.end());
+    psz_temp.push_back('\0');
+    int fd = vlc_mkstemp(&psz_temp[0]);
+    if(fd == -1)
+        return NULL;
+    temp = &psz_temp[0];
+
+    uint8_t header[SEGMENTCACHE_HEADER_SIZE];
+    memcpy(header, SEGMENTCACHE_MAGIC, 4);
+    SetDWBE(&header[4], 0);
+    SetQWBE(&header[8], expiry);
+
+    SegmentCacheWriter *writer = new (std::nothrow) SegmentCacheWriter(this, entry, temp, fd);
+    if(!writer)
+    {
+        vlc_close(fd);
+        vlc_unlink(temp.c_str());
+        return NULL;
+    }
+
+    block_t header_block;
+    block_Init(&header_block, header, sizeof(header));
+    if(!writer->write(&header_block))
+    {
+        delete writer;
+        return NULL;
+    }
+    return writer;
+}
+
+namespace
+{
+    struct CacheEntry
+    {
+        std::string path;
+        time_t mtime;
+        uint64_t size;
+        bool operator<(const CacheEntry &other) const
+        {
+            return mtime < other.mtime;
+        }
+    };
+}
+
+void SegmentCache::committed(uint64_t size)
+{
+    vlc_mutex_lock(&lock);
+    usage += size;
+    bool b_scan = lastscan == VLC_TS_INVALID || usage > maxsize ||
+                  mdate() - lastscan >= SEGMENTCACHE_SCAN_PERIOD;
+    vlc_mutex_unlock(&lock);
+
+    if(b_scan)
+        trim();
+}
+
+/* Scans the directory and removes the least recently used entries, and the
+ * ones which an aborted write left behind. Other instances may trim the
+ * same directory concurrently: entries that are gone already are accounted
+ * as removed. */
+void SegmentCache::trim()
+{
+    vlc_mutex_lock(&lock);
+
+    DIR *d = vlc_opendir(dir.c_str());
+    if(!d)
+    {
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+
+    std::vector<CacheEntry> entries;
+    uint64_t total = 0;
+    const char *psz_name;
+    const size_t extlen = strlen(SEGMENTCACHE_EXT);
+    const time_t now = time(NULL);
+    while((psz_name = vlc_readdir(d)) != NULL)
+    {
+        const size_t len = strlen(psz_name);
+        if(psz_name[0] == '.' || len <= extlen)
+            continue;
+
+        /* entries being written, by any instance, are named
+         * <entry>.XXXXXX: only remove them once they are stale */
+        if(len > extlen + 7 && psz_name[len - 7] == '.' &&
+           !strncmp(&psz_name[len - 7 - extlen], SEGMENTCACHE_EXT, extlen))
+        {
+            const std::string temp = dir + DIR_SEP + psz_name;
+            struct stat st;
+            if(vlc_stat(temp.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+               now - st.st_mtime > SEGMENTCACHE_TEMP_EXPIRY)
+            {
+                msg_Dbg(p_object, "removing stale cache entry %s", psz_name);
+                vlc_unlink(temp.c_str());
+            }
+            continue;
+        }
+
+        if(strcmp(&psz_name[len - extlen], SEGMENTCACHE_EXT))
+            continue;
+
+        CacheEntry entry;
+        entry.path = dir + DIR_SEP + psz_name;
+        struct stat st;
+        if(vlc_stat(entry.path.c_str(), &st) || !S_ISREG(st.st_mode))
+            continue;
+        entry.mtime = st.st_mtime;
+        entry.size = st.st_size;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    closedir(d);
+
+    if(total > maxsize)
+    {
+        /* least recently used first */
+        std::sort(entries.begin(), entries.end());
+        std::vector<CacheEntry>::const_iterator it;
+        for(it = entries.begin(); it != entries.end() && total > maxsize; ++it)
+        {
+            if(vlc_unlink((*it).path.c_str()) == 0 || errno == ENOENT)
+                total -= (*it).size;
+        }
+    }
+
+    usage = total;
+    lastscan = mdate();
+    vlc_mutex_unlock(&lock);
+}
+
+SegmentCacheWriter::SegmentCacheWriter(SegmentCache *cache_, const std::string &entry,
+                                       const std::string &temp, int fd_)
+{
+    cache = cache_;
+    entrypath = entry;
+    temppath = temp;
+    size = 0;
+    fd = fd_;
+}
+
+SegmentCacheWriter::~SegmentCacheWriter()
+{
+    /* not committed, drop it */
+    if(fd != -1)
+    {
+        vlc_close(fd);
+        vlc_unlink(temppath.c_str());
+    }
+}
+
+bool SegmentCacheWriter::write(const block_t *p_block)
+{
+    if(fd == -1)
+        return false;
+
+    for(size_t i = 0; i < p_block->i_buffer;)
+    {
+        ssize_t ret = ::write(fd, &p_block->p_buffer[i], p_block->i_buffer - i);
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            msg_Warn(cache->p_object, "cannot write segments cache: %s",
+                     vlc_strerror_c(errno));
+            vlc_close(fd);
+            vlc_unlink(temppath.c_str());
+            fd = -1;
+            return false;
+        }
+        i += ret;
+    }
+    size += p_block->i_buffer;
+    return true;
+}
+
+void SegmentCacheWriter::commit()
+{
+    if(fd == -1)
+        return;
+
+    vlc_close(fd);
+    fd = -1;
+    /* replaces atomically any entry stored by another instance meanwhile */
+    if(vlc_rename(temppath.c_str(), entrypath.c_str()) != 0)
+    {
+        vlc_unlink(temppath.c_str());
+        return;
+    }
+    cache->committed(size);
+}
@@ -0,0 +1,83 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2017 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP
+#define SEGMENTCACHE_HPP
+
+#include <vlc_common.h>
+#include <string>
+
+namespace adaptive
+{
+    namespace http
+    {
+        class BytesRange;
+        class SegmentCacheWriter;
+
+        /* Segments stored on disk, shared by all the instances using the
+         * same directory. Entries are named after the hash of their url and
+         * byte range, and the least recently used are removed once the
+         * directory grows beyond its maximum size. The size of the directory
+         * is only scanned from time to time, and estimated in between. */
+        class SegmentCache
+        {
+            friend class SegmentCacheWriter;
+
+            public:
+                SegmentCache(vlc_object_t *, const std::string &, uint64_t);
+                ~SegmentCache();
+                static SegmentCache * create(vlc_object_t *);
+                static std::string key(const std::string &, const BytesRange &);
+                /* returns the whole mapped segment, or NULL */
+                block_t * get(const std::string &);
+                /* expiry is a wall clock time, 0 for never */
+                SegmentCacheWriter * put(const std::string &, time_t);
+
+            private:
+                std::string path(const std::string &) const;
+                void committed(uint64_t);
+                void trim();
+                vlc_object_t *p_object;
+                std::string dir;
+                uint64_t maxsize;
+                uint64_t usage; /* estimated size of the directory */
+                mtime_t lastscan; /* VLC_TS_INVALID if never scanned */
+                vlc_mutex_t lock;
+        };
+
+        class SegmentCacheWriter
+        {
+            public:
+                SegmentCacheWriter(SegmentCache *, const std::string &,
+                                   const std::string &, int);
+                ~SegmentCacheWriter();
+                bool write(const block_t *);
+                void commit();
+
+            private:
+                SegmentCache *cache;
+                std::string entrypath;
+                std::string temppath;
+                uint64_t size;
+                int fd;
+        };
+    }
+}
+
+#endif // SEGMENTCACHE_HPP
@@ -35,10 +35,14 @@
 #include "../http/HTTPConnectionManager.h"
 #include "../http/Downloader.hpp"
 #include <cassert>
+#include <ctime>
 
 using namespace adaptive::http;
 using namespace adaptive::playlist;
 
+/* cache lifetime of live segments, when the playlist has no timeshift depth */
+#define LIVE_SEGMENT_LIFETIME (60 * CLOCK_FREQ)
+
 const int ISegment::SEQUENCE_INVALID = 0;
 const int ISegment::SEQUENCE_FIRST   = 1;
 
@@ -67,7 +71,8 @@ void ISegment::onChunkDownload(block_t **, SegmentChunk *, BaseRepresentation *)
 
 }
 
-SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager)
+SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractConnectionManager *connManager,
+                                bool b_prefetch)
 {
     const std::string url = getUrlSegment().toString(index, rep);
     HTTPChunkBufferedSource *source = new (std::nothrow) HTTPChunkBufferedSource(url, connManager,
@@ -77,10 +82,26 @@ SegmentChunk* ISegment::toChunk(size_t index, BaseRepresentation *rep, AbstractC
         if(startByte != endByte)
             source->setBytesRange(BytesRange(startByte, endByte));
 
+        /* Live segments leave the playlist: don't serve them from the
+           cache once they can't be listed anymore */
+        time_t expiry = 0;
+        AbstractPlaylist *playlist = rep->getPlaylist();
+        if(playlist->isLive())
+        {
+            mtime_t lifetime = playlist->timeShiftBufferDepth.Get();
+            if(lifetime == 0)
+                lifetime = LIVE_SEGMENT_LIFETIME;
+            expiry = time(NULL) + lifetime / CLOCK_FREQ;
+        }
+        source->setCacheable(expiry);
+
         SegmentChunk *chunk = new (std::nothrow) SegmentChunk(this, source, rep);
         if( chunk )
         {
-            connManager->start(source);
+            if(b_prefetch)
+                connManager->prefetch(source);
+            else
+                connManager->start(source);
             return chunk;
         }
         else
@@ -228,6 +228,7 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static bool AVI_IndexLoadCache( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -767,11 +768,17 @@ aviindex:
                            "approximative or will exhibit strange behavior" );
         if( (i_do_index == 0 || i_do_index == 3) && !b_index )
         {
-            if( !p_sys->b_fastseekable ) {
+            if( p_sys->b_fastseekable && AVI_IndexLoadCache( p_demux ) )
+            {
+                /* fixed during a previous opening of this file */
+                b_index = true;
+                p_sys->i_length = AVI_MovieGetLength( p_demux );
+            }
+            else if( !p_sys->b_fastseekable ) {
                 b_index = true;
                 goto aviindex;
             }
-            if( i_do_index == 0 )
+            else if( i_do_index == 0 )
             {
                 const char *psz_msg = _(
                     "Because this file index is broken or missing, "
@@ -2614,6 +2621,77 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
+/* Index built by a previous AVI_IndexCreate() on the same file */
+#define AVI_INDEX_CACHE_NAME "avi-1"
+
+static bool AVI_IndexLoadCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    vlc_demux_index_entry_t *p_entries;
+    size_t i_entries;
+
+    if( vlc_demux_index_Load( p_demux, AVI_INDEX_CACHE_NAME,
+                              &p_entries, &i_entries ) )
+        return false;
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        avi_index_Clean( &p_sys->track[i_stream]->idx );
+        avi_index_Init( &p_sys->track[i_stream]->idx );
+    }
+
+    for( size_t i = 0; i < i_entries; i++ )
+    {
+        unsigned int i_stream, i_cat;
+
+        AVI_ParseStreamHeader( p_entries[i].i_stream, &i_stream, &i_cat );
+        if( i_stream >= p_sys->i_track ||
+            i_cat != p_sys->track[i_stream]->i_cat )
+            continue;
+
+        avi_entry_t index;
+        index.i_id      = p_entries[i].i_stream;
+        index.i_flags   = p_entries[i].i_flags;
+        index.i_pos     = p_entries[i].i_offset;
+        index.i_length  = p_entries[i].i_size;
+        index.i_lengthtotal = index.i_length;
+        avi_index_Append( &p_sys->track[i_stream]->idx,
+                          &p_sys->i_movi_lastchunk_pos, &index );
+    }
+    free( p_entries );
+    return true;
+}
+
+static void AVI_IndexStoreCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_entries = 0;
+
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+        i_entries += p_sys->track[i_stream]->idx.i_size;
+
+    vlc_demux_index_entry_t *p_entries =
+        calloc( i_entries ? i_entries : 1, sizeof(*p_entries) );
+    if( !p_entries )
+        return;
+
+    size_t i = 0;
+    for( unsigned i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i_stream]->idx;
+        for( unsigned j = 0; j < p_index->i_size; j++, i++ )
+        {
+            p_entries[i].i_stream = p_index->p_entry[j].i_id;
+            p_entries[i].i_flags  = p_index->p_entry[j].i_flags;
+            p_entries[i].i_offset = p_index->p_entry[j].i_pos;
+            p_entries[i].i_size   = p_index->p_entry[j].i_length;
+        }
+    }
+
+    vlc_demux_index_Store( p_demux, AVI_INDEX_CACHE_NAME, p_entries, i_entries );
+    free( p_entries );
+}
+
 static void AVI_IndexCreate( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2626,6 +2704,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2636,6 +2715,9 @@ static void AVI_IndexCreate( demux_t *p_demux )
         return;
     }
 
+    if( AVI_IndexLoadCache( p_demux ) )
+        return;
+
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
@@ -2664,7 +2746,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && mdate() - i_dialog_update > 100000 )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2743,6 +2828,9 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( !b_cancelled )
+        AVI_IndexStoreCache( p_demux );
 }
 
 /* */
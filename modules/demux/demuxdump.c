@@ -24,10 +24,22 @@
 # include "config.h"
 #endif
 
+#include <errno.h>
+#ifdef HAVE_SPLICE
+# include <fcntl.h>
+# include <poll.h>
+# include <sys/mman.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_demux.h>
 #include <vlc_sout.h>
+#include <vlc_interrupt.h>
+#include <vlc_fs.h>
 
 #define ACCESS_TEXT N_("Dump module")
 #define FILE_TEXT N_("Dump filename")
@@ -36,6 +48,11 @@
 #define APPEND_TEXT N_("Append to existing file")
 #define APPEND_LONGTEXT N_( \
     "If the file already exists, it will not be overwritten." )
+#define PACE_TEXT N_("Pace MPEG-TS on the PCR")
+#define PACE_LONGTEXT N_( \
+    "Relay MPEG-TS streams in real time, following their program clock " \
+    "references, instead of as fast as possible. This is useful to relay " \
+    "unmodified TS files to the network with the udp or http outputs." )
 
 static int  Open( vlc_object_t * );
 static void Close ( vlc_object_t * );
@@ -52,13 +69,66 @@ vlc_module_begin ()
                   FILE_LONGTEXT, false )
     add_bool( "demuxdump-append", false, APPEND_TEXT, APPEND_LONGTEXT,
               false )
+    add_bool( "demuxdump-pace", false, PACE_TEXT, PACE_LONGTEXT, true )
     set_callbacks( Open, Close )
     add_shortcut( "dump" )
 vlc_module_end ()
 
 #define DUMP_BLOCKSIZE  16384
 
+/* paced TS is relayed one datagram worth of packets at a time */
+#define TS_PACKET_SIZE  188
+#define TS_PACKETS      7
+
+/* TS packet formats: plain, M2TS (4-byte time code first), and with FEC */
+static const struct
+{
+    unsigned i_size;
+    unsigned i_sync;    /* offset of the sync byte */
+} ts_formats[] = {
+    { 188, 0 },
+    { 192, 4 },
+    { 204, 0 },
+};
+
+struct demux_sys_t
+{
+    sout_access_out_t *out;
+
+    /* PCR pacing */
+    bool     b_pace;
+    unsigned i_packet_size;
+    unsigned i_sync;
+    int      i_pcr_pid;     /* PID carrying the followed PCR, -1 if none yet */
+    int64_t  i_last_pcr;    /* last PCR (90 kHz), -1 if none yet */
+    uint64_t i_pcr_pos;     /* stream offset of the last PCR packet */
+    mtime_t  i_date;        /* date at which to send the last PCR */
+    /* stream rate between the last two PCRs, 0 bytes if unknown */
+    int64_t  i_rate_bytes;
+    mtime_t  i_rate_time;
+
+#ifdef HAVE_SPLICE
+    /* zero-copy relay of a local file to the output descriptor */
+    int      fd;            /* input file, -1 if not relayed directly */
+    int      out_fd;
+    int      pipefd[2];     /* pipe the data is spliced through */
+    size_t   i_piped;       /* bytes left in the pipe after an error */
+    size_t   i_chunk;       /* bytes relayed at a time, if not paced */
+    uint64_t i_offset;      /* input file offset */
+    bool     b_spliced;     /* data went through splice() already */
+    const uint8_t *p_map;   /* input file mapping for the PCR scan */
+    size_t   i_map;
+    uint8_t  scan[TS_PACKETS * 204]; /* PCR scan beyond the mapping */
+#endif
+};
+
 static int Demux( demux_t * );
+static int DemuxPaced( demux_t * );
+#ifdef HAVE_SPLICE
+static int DemuxSplice( demux_t * );
+static void SpliceOpen( demux_t * );
+static void SpliceClose( demux_sys_t * );
+#endif
 static int Control( demux_t *, int,va_list );
 
 /**
@@ -91,18 +161,65 @@ static int Open( vlc_object_t * p_this )
         return VLC_EGENERIC;
     }
 
+    demux_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        free( path );
+        free( access );
+        return VLC_ENOMEM;
+    }
+
     sout_access_out_t *out = sout_AccessOutNew( p_demux, access, path );
     free( path );
     free( access );
     if( out == NULL )
     {
         msg_Err( p_demux, "cannot create output" );
+        free( p_sys );
         return VLC_EGENERIC;
     }
 
-    p_demux->p_sys = (void *)out;
-    p_demux->pf_demux = Demux;
+    p_sys->out = out;
+    p_sys->b_pace = false;
+    p_sys->i_pcr_pid = -1;
+    p_sys->i_last_pcr = -1;
+    p_sys->i_pcr_pos = 0;
+    p_sys->i_date = VLC_TS_INVALID;
+    p_sys->i_rate_bytes = 0;
+    p_sys->i_rate_time = 0;
+
+    if( var_InheritBool( p_demux, "demuxdump-pace" ) )
+    {
+        const uint8_t *p_peek;
+        ssize_t i_peek = vlc_stream_Peek( p_demux->s, &p_peek,
+                                          3 * 204 );
+
+        /* check for 3 consecutive sync bytes */
+        for( size_t i = 0; i < ARRAY_SIZE(ts_formats) && !p_sys->b_pace; i++ )
+        {
+            unsigned i_size = ts_formats[i].i_size;
+            unsigned i_sync = ts_formats[i].i_sync;
+
+            if( i_peek >= (ssize_t)(2 * i_size + i_sync + 1)
+             && p_peek[i_sync] == 0x47 && p_peek[i_size + i_sync] == 0x47
+             && p_peek[2 * i_size + i_sync] == 0x47 )
+            {
+                p_sys->b_pace = true;
+                p_sys->i_packet_size = i_size;
+                p_sys->i_sync = i_sync;
+                msg_Dbg( p_demux, "pacing %u-byte TS packets", i_size );
+            }
+        }
+        if( !p_sys->b_pace )
+            msg_Warn( p_demux, "not a MPEG-TS stream, pacing disabled" );
+    }
+
+    p_demux->p_sys = p_sys;
+    p_demux->pf_demux = p_sys->b_pace ? DemuxPaced : Demux;
     p_demux->pf_control = Control;
+#ifdef HAVE_SPLICE
+    SpliceOpen( p_demux );
+#endif
     return VLC_SUCCESS;
 }
 
@@ -112,9 +229,13 @@ static int Open( vlc_object_t * p_this )
 static void Close( vlc_object_t *p_this )
 {
     demux_t *p_demux = (demux_t*)p_this;
-    sout_access_out_t *out = (void *)p_demux->p_sys;
+    demux_sys_t *p_sys = p_demux->p_sys;
 
-    sout_AccessOutDelete( out );
+#ifdef HAVE_SPLICE
+    SpliceClose( p_sys );
+#endif
+    sout_AccessOutDelete( p_sys->out );
+    free( p_sys );
 }
 
 /**
@@ -122,7 +243,7 @@ static void Close( vlc_object_t *p_this )
  */
 static int Demux( demux_t *p_demux )
 {
-    sout_access_out_t *out = (void *)p_demux->p_sys;
+    sout_access_out_t *out = p_demux->p_sys->out;
 
     block_t *block = block_Alloc( DUMP_BLOCKSIZE );
     if( unlikely(block == NULL) )
@@ -145,7 +266,353 @@ static int Demux( demux_t *p_demux )
     return 1;
 }
 
+/**
+ * Returns the PCR (90 kHz) of a TS packet, or -1 if there is none.
+ */
+static int64_t GetPCR( const uint8_t *p, int *pi_pid )
+{
+    if( p[0] != 0x47 || !(p[3] & 0x20) /* no adaptation field */
+     || p[4] < 7 || !(p[5] & 0x10) /* no PCR */ )
+        return -1;
+
+    *pi_pid = ((p[1] & 0x1f) << 8) | p[2];
+    return ((int64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9) | (p[9] << 1)
+         | (p[10] >> 7);
+}
+
+/**
+ * Follows a PCR at a given stream offset.
+ */
+static void DatePCR( demux_sys_t *p_sys, int64_t i_pcr, uint64_t i_pos )
+{
+    mtime_t now = mdate();
+    /* modulo 2^33 so that the PCR can wrap around */
+    int64_t i_delta = (i_pcr - p_sys->i_last_pcr) & INT64_C(0x1FFFFFFFF);
+
+    if( p_sys->i_last_pcr < 0 || i_delta > 90000 || i_pos <= p_sys->i_pcr_pos
+     || p_sys->i_date + CLOCK_FREQ < now )
+    {
+        /* first PCR, discontinuity, seek or too late: restart here */
+        p_sys->i_date = now;
+        p_sys->i_rate_bytes = 0;
+    }
+    else
+    {
+        p_sys->i_rate_time = i_delta * CLOCK_FREQ / 90000;
+        p_sys->i_rate_bytes = i_pos - p_sys->i_pcr_pos;
+        p_sys->i_date += p_sys->i_rate_time;
+    }
+    p_sys->i_last_pcr = i_pcr;
+    p_sys->i_pcr_pos = i_pos;
+}
+
+/**
+ * Returns the date at which to send a chunk of TS packets, or VLC_TS_INVALID
+ * if no PCR was seen yet.
+ *
+ * Only the PCR of the first PID seen with one is followed, so that the
+ * programs of a multiplex do not reset the clock of one another. Between
+ * PCRs, the departure date of each chunk is interpolated from its stream
+ * offset, at the rate of the last PCR interval.
+ */
+static mtime_t DateChunk( demux_t *p_demux, const uint8_t *p, size_t i_buffer,
+                          uint64_t i_pos, bool *pb_clock )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+
+    *pb_clock = false;
+    for( size_t i = 0; i + i_size <= i_buffer; i += i_size )
+    {
+        int i_pid;
+        int64_t i_pcr = GetPCR( &p[i + p_sys->i_sync], &i_pid );
+        if( i_pcr < 0 )
+            continue;
+
+        if( p_sys->i_pcr_pid < 0 )
+        {
+            msg_Dbg( p_demux, "following the PCR of PID %d", i_pid );
+            p_sys->i_pcr_pid = i_pid;
+        }
+        if( i_pid != p_sys->i_pcr_pid )
+            continue;
+
+        DatePCR( p_sys, i_pcr, i_pos + i );
+        *pb_clock = true;
+    }
+
+    if( p_sys->i_date == VLC_TS_INVALID )
+        return VLC_TS_INVALID;
+
+    mtime_t i_date = p_sys->i_date;
+    if( p_sys->i_rate_bytes > 0 )
+        i_date += ((int64_t)i_pos - (int64_t)p_sys->i_pcr_pos)
+                * p_sys->i_rate_time / p_sys->i_rate_bytes;
+    return i_date;
+}
+
+/**
+ * Copy data from input stream to the output, in real time.
+ *
+ * Each block carries the date at which it should be sent as DTS, and the
+ * demuxer waits for that date so that the output does not buffer the stream.
+ */
+static int DemuxPaced( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint64_t i_pos = vlc_stream_Tell( p_demux->s );
+
+    block_t *block = vlc_stream_Block( p_demux->s,
+                                       TS_PACKETS * p_sys->i_packet_size );
+    if( block == NULL )
+        return 0;
+
+    bool b_clock;
+    mtime_t i_date = DateChunk( p_demux, block->p_buffer, block->i_buffer,
+                                i_pos, &b_clock );
+    if( b_clock )
+        block->i_flags |= BLOCK_FLAG_CLOCK;
+
+    if( i_date != VLC_TS_INVALID )
+    {
+        block->i_dts = i_date;
+        if( vlc_mwait_i11e( i_date ) )
+        {
+            block_Release( block );
+            return 0;
+        }
+    }
+
+    size_t rd = block->i_buffer;
+    if( sout_AccessOutWrite( p_sys->out, block ) != (ssize_t)rd )
+    {
+        msg_Err( p_demux, "cannot write data" );
+        return -1;
+    }
+    return 1;
+}
+
+#ifdef HAVE_SPLICE
+/**
+ * Relays a local input file straight to the output descriptor.
+ *
+ * The data is spliced from the file to a pipe, and from the pipe to the
+ * output, so that it never goes through user space. This only works when
+ * the input is a regular file that the demuxer can open itself, and when the
+ * output exposes its descriptor (file and UDP outputs). The input stream is
+ * left at its position, and only synchronized for the Control() queries.
+ */
+static void SpliceOpen( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    struct stat st;
+
+    p_sys->fd = -1;
+
+    if( p_demux->psz_file == NULL || strcmp( p_demux->psz_access, "file" )
+     || sout_AccessOutControl( p_sys->out, ACCESS_OUT_GET_FD, &p_sys->out_fd ) )
+        return;
+
+    int fd = vlc_open( p_demux->psz_file, O_RDONLY );
+    if( fd == -1 )
+        return;
+    if( fstat( fd, &st ) || !S_ISREG( st.st_mode ) )
+        goto error;
+    if( vlc_pipe( p_sys->pipefd ) )
+        goto error;
+
+    p_sys->fd = fd;
+    p_sys->i_piped = 0;
+    p_sys->i_offset = vlc_stream_Tell( p_demux->s );
+    p_sys->b_spliced = false;
+
+    /* each write to a datagram socket is one datagram */
+    int i_type;
+    socklen_t i_len = sizeof( i_type );
+    if( getsockopt( p_sys->out_fd, SOL_SOCKET, SO_TYPE, &i_type, &i_len ) == 0
+     && i_type == SOCK_DGRAM )
+        p_sys->i_chunk = TS_PACKETS * TS_PACKET_SIZE;
+    else
+        p_sys->i_chunk = DUMP_BLOCKSIZE;
+
+    /* The PCR scan reads the packet headers from a mapping of the file, or
+     * into a small buffer past its end if the file grows. */
+    p_sys->p_map = NULL;
+    p_sys->i_map = 0;
+    if( p_sys->b_pace && st.st_size > 0
+     && (uintmax_t)st.st_size <= SIZE_MAX )
+    {
+        void *p_map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+        if( p_map != MAP_FAILED )
+        {
+            p_sys->p_map = p_map;
+            p_sys->i_map = st.st_size;
+        }
+    }
+
+    msg_Dbg( p_demux, "relaying the file with splice()" );
+    p_demux->pf_demux = DemuxSplice;
+    return;
+error:
+    vlc_close( fd );
+}
+
+static void SpliceClose( demux_sys_t *p_sys )
+{
+    if( p_sys->fd == -1 )
+        return;
+
+    if( p_sys->p_map != NULL )
+        munmap( (void *)p_sys->p_map, p_sys->i_map );
+    vlc_close( p_sys->pipefd[1] );
+    vlc_close( p_sys->pipefd[0] );
+    vlc_close( p_sys->fd );
+    p_sys->fd = -1;
+}
+
+/**
+ * Falls back to copying the input stream, e.g. if the kernel cannot splice
+ * these descriptors. The data left in the pipe is written to the output.
+ */
+static int SpliceFallback( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    int i_ret = 1;
+
+    msg_Warn( p_demux, "cannot splice: %s, copying", vlc_strerror_c(errno) );
+
+    if( p_sys->i_piped > 0 )
+    {
+        block_t *block = block_Alloc( p_sys->i_piped );
+        size_t i_read = 0;
+
+        while( block != NULL && i_read < block->i_buffer )
+        {
+            ssize_t rd = read( p_sys->pipefd[0], &block->p_buffer[i_read],
+                               block->i_buffer - i_read );
+            if( rd > 0 )
+                i_read += rd;
+            else if( rd == 0 || errno != EINTR )
+                break;
+        }
+        if( block == NULL || i_read < block->i_buffer
+         || sout_AccessOutWrite( p_sys->out, block ) != (ssize_t)i_read )
+        {
+            if( block != NULL && i_read < block->i_buffer )
+                block_Release( block );
+            i_ret = -1;
+        }
+    }
+
+    if( vlc_stream_Seek( p_demux->s, p_sys->i_offset ) )
+        i_ret = -1;
+    SpliceClose( p_sys );
+    p_demux->pf_demux = p_sys->b_pace ? DemuxPaced : Demux;
+    return i_ret;
+}
+
+/**
+ * Relays up to i_size bytes from the input file offset to the output.
+ * Returns the number of bytes relayed, 0 at end of file, or -1 on error.
+ */
+static ssize_t SpliceRelay( demux_t *p_demux, size_t i_size )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    loff_t i_off = p_sys->i_offset;
+
+    ssize_t i_in = splice( p_sys->fd, &i_off, p_sys->pipefd[1], NULL,
+                           i_size, SPLICE_F_MOVE );
+    if( i_in <= 0 )
+        return i_in;
+
+    p_sys->i_offset += i_in;
+
+    for( ssize_t i_out = 0; i_out < i_in; )
+    {
+        ssize_t val = splice( p_sys->pipefd[0], NULL, p_sys->out_fd, NULL,
+                              i_in - i_out, SPLICE_F_MOVE );
+        if( val >= 0 )
+        {
+            i_out += val;
+            continue;
+        }
+        if( errno == EINTR )
+            continue;
+        if( errno == EAGAIN )
+        {   /* non-blocking socket with a full send buffer */
+            struct pollfd ufd = { .fd = p_sys->out_fd, .events = POLLOUT };
+            if( vlc_poll_i11e( &ufd, 1, -1 ) >= 0 )
+                continue;
+        }
+        p_sys->i_piped = i_in - i_out;
+        return -1;
+    }
+
+    p_sys->b_spliced = true;
+    return i_in;
+}
+
+/**
+ * Copy data from input file to the output, without copying it.
+ */
+static int DemuxSplice( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_size = p_sys->i_chunk;
+
+    if( p_sys->b_pace )
+    {
+        const uint8_t *p = NULL;
+        i_size = TS_PACKETS * p_sys->i_packet_size;
+
+        if( p_sys->i_offset + i_size <= p_sys->i_map )
+            p = &p_sys->p_map[p_sys->i_offset];
+        else
+        {
+            ssize_t rd = pread( p_sys->fd, p_sys->scan, i_size,
+                                p_sys->i_offset );
+            if( rd <= 0 )
+                return rd == 0 ? 0 : -1;
+            p = p_sys->scan;
+            i_size = rd;
+        }
+
+        bool b_clock;
+        mtime_t i_date = DateChunk( p_demux, p, i_size, p_sys->i_offset,
+                                    &b_clock );
+        if( i_date != VLC_TS_INVALID && vlc_mwait_i11e( i_date ) )
+            return 0;
+    }
+
+    ssize_t val = SpliceRelay( p_demux, i_size );
+    if( val < 0 && errno == EINTR ) /* interrupted */
+        return 0;
+    if( val < 0 )
+    {
+        if( !p_sys->b_spliced )
+            return SpliceFallback( p_demux );
+        msg_Err( p_demux, "cannot write data: %s", vlc_strerror_c(errno) );
+        return -1;
+    }
+    return val > 0;
+}
+#endif
+
 static int Control( demux_t *p_demux, int i_query, va_list args )
 {
+#ifdef HAVE_SPLICE
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->fd != -1 )
+    {   /* the stream position follows the spliced data */
+        if( vlc_stream_Tell( p_demux->s ) != p_sys->i_offset )
+            vlc_stream_Seek( p_demux->s, p_sys->i_offset );
+
+        int ret = demux_vaControlHelper( p_demux->s, 0, -1, 0, 1,
+                                         i_query, args );
+        p_sys->i_offset = vlc_stream_Tell( p_demux->s );
+        return ret;
+    }
+#endif
     return demux_vaControlHelper( p_demux->s, 0, -1, 0, 1, i_query, args );
 }
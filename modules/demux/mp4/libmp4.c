@@ -2747,6 +2747,48 @@ static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
     MP4_READBOX_EXIT( 1 );
 }
 
+static void MP4_FreeBox_stz2( MP4_Box_t *p_box )
+{
+    FREENULL( p_box->data.p_stz2->p_entry_size );
+}
+
+static int MP4_ReadBox_stz2( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    MP4_READBOX_ENTER( MP4_Box_data_stz2_t, MP4_FreeBox_stz2 );
+
+    MP4_Box_data_stz2_t *p_stz2 = p_box->data.p_stz2;
+    uint32_t i_reserved;
+
+    MP4_GETVERSIONFLAGS( p_stz2 );
+
+    MP4_GET3BYTES( i_reserved );
+    VLC_UNUSED(i_reserved);
+    MP4_GET1BYTE( p_stz2->i_field_size );
+    MP4_GET4BYTES( p_stz2->i_sample_count );
+
+    if( p_stz2->i_field_size != 4 && p_stz2->i_field_size != 8 &&
+        p_stz2->i_field_size != 16 )
+        MP4_READBOX_EXIT( 0 );
+
+    /* entries are kept packed, not expanded */
+    const uint64_t i_entries_size =
+            ((uint64_t) p_stz2->i_sample_count * p_stz2->i_field_size + 7) / 8;
+    if( i_entries_size > (uint64_t) i_read )
+        MP4_READBOX_EXIT( 0 );
+
+    p_stz2->p_entry_size = malloc( i_entries_size ? i_entries_size : 1 );
+    if( unlikely( !p_stz2->p_entry_size ) )
+        MP4_READBOX_EXIT( 0 );
+    memcpy( p_stz2->p_entry_size, p_peek, i_entries_size );
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"stz2\" field-size %"PRIu8" sample-count %"PRIu32,
+                      p_stz2->i_field_size, p_stz2->i_sample_count );
+
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
 static void MP4_FreeBox_stsc( MP4_Box_t *p_box )
 {
     FREENULL( p_box->data.p_stsc->i_first_chunk );
@@ -4239,6 +4281,7 @@ static const struct
     { ATOM_cslg,    MP4_ReadBox_cslg,         ATOM_stbl },
     { ATOM_stsd,    MP4_ReadBox_LtdContainer, ATOM_stbl },
     { ATOM_stsz,    MP4_ReadBox_stsz,         ATOM_stbl },
+    { ATOM_stz2,    MP4_ReadBox_stz2,         ATOM_stbl },
     { ATOM_stsc,    MP4_ReadBox_stsc,         ATOM_stbl },
     { ATOM_stco,    MP4_ReadBox_stco_co64,    ATOM_stbl },
     { ATOM_co64,    MP4_ReadBox_stco_co64,    ATOM_stbl },
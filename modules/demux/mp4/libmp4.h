@@ -859,11 +859,10 @@ typedef struct MP4_Box_data_stz2_s
     uint8_t  i_version;
     uint32_t i_flags;
 
-    uint32_t i_sample_size; /* 24 bits */
-    uint8_t  i_field_size;
+    uint8_t  i_field_size; /* 4, 8 or 16 */
     uint32_t i_sample_count;
 
-    uint32_t *i_entry_size; /* array: unsigned int(i_field_size) entry_size */
+    uint8_t *p_entry_size; /* packed i_field_size bits entries, big endian */
 
 } MP4_Box_data_stz2_t;
 
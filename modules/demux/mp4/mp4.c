@@ -165,6 +165,7 @@ static void MP4_GetDefaultSizeAndDuration( MP4_Box_t *p_moov,
 static stime_t GetMoovTrackDuration( demux_sys_t *p_sys, unsigned i_track_ID );
 
 static int  ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented );
+static bool LoadFragmentsIndexCache( demux_t * );
 static int  ProbeIndex( demux_t *p_demux );
 
 static int FragCreateTrunIndex( demux_t *, MP4_Box_t *, MP4_Box_t *, stime_t, bool );
@@ -292,32 +293,103 @@ static es_out_id_t * MP4_AddTrackES( es_out_t *out, mp4_track_t *p_track )
     return p_es;
 }
 
-/* Return time in microsecond of a track */
-static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+/* Moves a run-length table cursor forward to i_sample, summing the sample
+ * deltas if pi_sample_delta is not NULL.
+ * Returns false if the table ends before i_sample */
+static bool MP4_TableCursorMove( mp4_table_cursor_t *p_cursor, uint32_t i_sample,
+                                 const uint32_t *pi_sample_count,
+                                 const int32_t *pi_sample_delta,
+                                 uint32_t i_entry_count )
+{
+    for( ;; )
+    {
+        /* skip exhausted entries */
+        while( p_cursor->i_index < i_entry_count &&
+               p_cursor->i_skip >= pi_sample_count[p_cursor->i_index] )
+        {
+            p_cursor->i_index++;
+            p_cursor->i_skip = 0;
+        }
+
+        if( p_cursor->i_sample >= i_sample || p_cursor->i_index >= i_entry_count )
+            break;
+
+        const uint32_t i_step = __MIN( i_sample - p_cursor->i_sample,
+                                       pi_sample_count[p_cursor->i_index] - p_cursor->i_skip );
+        if( pi_sample_delta )
+            p_cursor->i_dts += (uint64_t) i_step *
+                               (uint32_t) pi_sample_delta[p_cursor->i_index];
+        p_cursor->i_sample += i_step;
+        p_cursor->i_skip += i_step;
+    }
+
+    return p_cursor->i_sample == i_sample;
+}
+
+/* Positions a cursor at the beginning of the current chunk, unless the last
+ * lookup is already in this chunk and before the current sample */
+static void MP4_TableCursorReset( mp4_table_cursor_t *p_cursor,
+                                  const mp4_track_t *p_track,
+                                  uint32_t i_index, uint32_t i_skip )
 {
-    demux_sys_t *p_sys = p_demux->p_sys;
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
-    int64_t i_dts = p_chunk->i_first_dts;
+    if( p_cursor->i_sample > p_track->i_sample ||
+        p_cursor->i_sample < p_chunk->i_sample_first )
+    {
+        p_cursor->i_sample = p_chunk->i_sample_first;
+        p_cursor->i_index = i_index;
+        p_cursor->i_skip = i_skip;
+        p_cursor->i_dts = p_chunk->i_first_dts;
+    }
+}
+
+static inline uint32_t MP4_TrackGetSampleSize( const mp4_track_t *p_track,
+                                               uint32_t i_sample )
+{
+    if( p_track->i_sample_size )
+        return p_track->i_sample_size;
 
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+    if( p_track->p_stz2 )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
-        {
-            i_dts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        const uint8_t *p_entries = p_track->p_stz2->p_entry_size;
+        switch( p_track->p_stz2->i_field_size )
         {
-            i_dts += i_sample * p_chunk->p_sample_delta_dts[i_index];
-            break;
+            case 4:
+                return ( i_sample & 1 ) ? p_entries[i_sample / 2] & 0x0F
+                                        : p_entries[i_sample / 2] >> 4;
+            case 8:
+                return p_entries[i_sample];
+            default:
+                return GetWBE( &p_entries[i_sample * 2] );
         }
     }
 
+    return p_track->p_stsz->i_entry_size[i_sample];
+}
+
+/* Return time in microsecond of a track */
+static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    mp4_table_cursor_t *p_cursor = &p_track->stts_cursor;
+
+    MP4_TableCursorReset( p_cursor, p_track,
+                          p_chunk->i_stts_index, p_chunk->i_stts_skip );
+    if( p_track->p_stts )
+    {
+        /* TrackCreateSamplesIndex() checked that stts covers every chunk */
+        bool b_covered =
+            MP4_TableCursorMove( p_cursor, p_track->i_sample,
+                                 p_track->p_stts->pi_sample_count,
+                                 p_track->p_stts->pi_sample_delta,
+                                 p_track->p_stts->i_entry_count );
+        assert( b_covered );
+        VLC_UNUSED( b_covered );
+    }
+    int64_t i_dts = p_cursor->i_dts;
+
     /* now handle elst */
     if( p_track->p_elst )
     {
@@ -344,26 +416,22 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
                                          int64_t *pi_delta )
 {
     VLC_UNUSED( p_demux );
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
-
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    const MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
+    mp4_table_cursor_t *p_cursor = &p_track->ctts_cursor;
 
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( ctts == NULL )
         return false;
 
-    for( i_index = 0; i_index < ck->i_entries_pts ; i_index++ )
-    {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
-        {
-            *pi_delta = MP4_rescale( ck->p_sample_offset_pts[i_index],
-                                     p_track->i_timescale, CLOCK_FREQ );
-            return true;
-        }
+    MP4_TableCursorReset( p_cursor, p_track, ck->i_ctts_index, ck->i_ctts_skip );
+    if( !MP4_TableCursorMove( p_cursor, p_track->i_sample,
+                              ctts->pi_sample_count, NULL, ctts->i_entry_count ) ||
+        p_cursor->i_index >= ctts->i_entry_count )
+        return false;
 
-        i_sample -= ck->p_sample_count_pts[i_index];
-    }
-    return false;
+    *pi_delta = MP4_rescale( ctts->pi_sample_offset[p_cursor->i_index] + p_track->i_cts_shift,
+                             p_track->i_timescale, CLOCK_FREQ );
+    return true;
 }
 
 static inline int64_t MP4_GetMoviePTS(demux_sys_t *p_sys )
@@ -1679,7 +1747,8 @@ static int FragSeekToTime( demux_t *p_demux, mtime_t i_nztime )
             msg_Dbg( p_demux, "seeking to sync point %" PRId64, i_sync_time );
             b_iframesync = true;
         }
-        else if( !p_sys->b_fragments_probed && !p_sys->b_fastseekable )
+        else if( !p_sys->b_fragments_probed && !p_sys->b_fastseekable &&
+                 !LoadFragmentsIndexCache( p_demux ) )
         {
             const char *psz_msg = _(
                 "Because this file index is broken or missing, "
@@ -2321,12 +2390,10 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = BOXDATA(p_co64)->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->i_entries_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->i_entries_pts = 0;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
+        ck->i_stts_index = 0;
+        ck->i_stts_skip = 0;
+        ck->i_ctts_index = 0;
+        ck->i_ctts_skip = 0;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -2388,233 +2455,95 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
     MP4_Box_t *p_box;
-    MP4_Box_data_stsz_t *stsz;
-    /* TODO use also stss and stsh table for seeking */
+    uint32_t i_sizes_count;
     /* FIXME use edit table */
 
-    /* Find stsz
-     *  Gives the sample size for each samples. There is also a stz2 table
-     *  (compressed form) that we need to implement TODO */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" );
-    if( !p_box )
-    {
-        /* FIXME and stz2 */
-        msg_Warn( p_demux, "cannot find STSZ box" );
-        return VLC_EGENERIC;
-    }
-    stsz = p_box->data.p_stsz;
-
-    /* Use stsz table to create a sample number -> sample size table */
-    if( p_demux_track->i_sample_count != stsz->i_sample_count )
+    /* Find stsz, or its compact form stz2
+     *  Gives the sample size for each samples. The table is not copied but
+     *  read from the box when needed */
+    if( ( p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" ) ) && p_box->data.p_stsz )
     {
-        msg_Warn( p_demux, "Incorrect total samples stsc %" PRIu32 " <> stsz %"PRIu32 ", "
-                           " expect truncated media playback",
-                           p_demux_track->i_sample_count, stsz->i_sample_count );
-        p_demux_track->i_sample_count = __MIN(p_demux_track->i_sample_count, stsz->i_sample_count);
+        const MP4_Box_data_stsz_t *stsz = p_box->data.p_stsz;
+        i_sizes_count = stsz->i_sample_count;
+        /* 1: all sample have the same size, so no need for a table */
+        p_demux_track->i_sample_size = stsz->i_sample_size;
+        if( stsz->i_sample_size == 0 )
+            p_demux_track->p_stsz = stsz;
     }
-
-    if( stsz->i_sample_size )
+    else if( ( p_box = MP4_BoxGet( p_demux_track->p_stbl, "stz2" ) ) && p_box->data.p_stz2 )
     {
-        /* 1: all sample have the same size, so no need to construct a table */
-        p_demux_track->i_sample_size = stsz->i_sample_size;
-        p_demux_track->p_sample_size = NULL;
+        const MP4_Box_data_stz2_t *stz2 = p_box->data.p_stz2;
+        i_sizes_count = stz2->i_sample_count;
+        p_demux_track->i_sample_size = 0;
+        p_demux_track->p_stz2 = stz2;
     }
     else
     {
-        /* 2: each sample can have a different size */
-        p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
+        msg_Warn( p_demux, "cannot find STSZ or STZ2 box" );
+        return VLC_EGENERIC;
+    }
 
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+    if( p_demux_track->i_sample_count != i_sizes_count )
+    {
+        msg_Warn( p_demux, "Incorrect total samples stsc %" PRIu32 " <> stsz %"PRIu32 ", "
+                           " expect truncated media playback",
+                           p_demux_track->i_sample_count, i_sizes_count );
+        p_demux_track->i_sample_count = __MIN(p_demux_track->i_sample_count, i_sizes_count);
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
     {
         const mp4_chunk_t *lastchunk = &p_demux_track->chunk[p_demux_track->i_chunk_count - 1];
-        if( (uint64_t)lastchunk->i_sample_count + p_demux_track->i_chunk_count - 1 > stsz->i_sample_count )
+        if( (uint64_t)lastchunk->i_sample_count + p_demux_track->i_chunk_count - 1 > i_sizes_count )
         {
             msg_Err( p_demux, "invalid samples table: stsz table is too small" );
             return VLC_EGENERIC;
         }
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+    /* The stts and ctts tables are not expanded: each chunk only records
+     * where its first sample is in them, and the entries are then decoded
+     * on demand, see MP4_TableCursorMove() */
 
-    mtime_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
     }
-    else
-    {
-        MP4_Box_data_stts_t *stts = p_box->data.p_stts;
-
-        msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
-
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
 
-        for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
+    const MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+    p_demux_track->p_stts = stts;
 
-            /* save first dts */
-            ck->i_first_dts = i_next_dts;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
+    msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
+    mp4_table_cursor_t cursor = { 0, 0, 0, 0 };
+    for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+    {
+        mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
+        /* the tables only need to cover the samples that will be played */
+        const uint32_t i_last = __MIN( ck->i_sample_first + ck->i_sample_count,
+                                       p_demux_track->i_sample_count );
 
-            }
+        ck->i_first_dts = cursor.i_dts;
+        ck->i_stts_index = cursor.i_index;
+        ck->i_stts_skip = cursor.i_skip;
+        if( !MP4_TableCursorMove( &cursor, i_last, stts->pi_sample_count,
+                                  stts->pi_sample_delta, stts->i_entry_count ) )
+        {
+            msg_Err( p_demux, "invalid samples table: stts table is too short" );
+            return VLC_EGENERIC;
         }
+        ck->i_duration = cursor.i_dts - ck->i_first_dts;
     }
-
+    mtime_t i_next_dts = cursor.i_dts;
 
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
@@ -2622,97 +2551,37 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
     if( p_box && p_box->data.p_ctts )
     {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        const MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        p_demux_track->p_ctts = ctts;
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        int64_t i_cts_shift = 0;
         const MP4_Box_t *p_cslg = MP4_BoxGet( p_demux_track->p_stbl, "cslg" );
         if( p_cslg && BOXDATA(p_cslg) )
-            i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
-
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+            p_demux_track->i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
 
+        memset( &cursor, 0, sizeof(cursor) );
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
+            const uint32_t i_last = __MIN( ck->i_sample_first + ck->i_sample_count,
+                                           p_demux_track->i_sample_count );
 
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
+            ck->i_ctts_index = cursor.i_index;
+            ck->i_ctts_skip = cursor.i_skip;
+            if( !MP4_TableCursorMove( &cursor, i_last, ctts->pi_sample_count,
+                                      NULL, ctts->i_entry_count ) )
             {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
+                msg_Err( p_demux, "invalid samples table: ctts table is too short" );
+                return VLC_EGENERIC;
             }
         }
     }
 
+    /* cursors start at the first chunk */
+    memset( &p_demux_track->stts_cursor, 0, sizeof(p_demux_track->stts_cursor) );
+    memset( &p_demux_track->ctts_cursor, 0, sizeof(p_demux_track->ctts_cursor) );
+
     msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
              i_next_dts / p_demux_track->i_timescale );
@@ -2891,17 +2760,22 @@ static int TrackGetNearestSeekPoint( demux_t *p_demux, mp4_track_t *p_track,
         const MP4_Box_data_stss_t *p_stss_data = BOXDATA(p_stss);
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss_data->i_entry_count; i_index++ )
+        if( p_stss_data->i_entry_count > 0 )
         {
-            if( i_index >= p_stss_data->i_entry_count - 1 ||
-                i_sample < p_stss_data->i_sample_number[i_index+1] )
+            /* last sync sample before i_sample, or the first one */
+            uint32_t i_low = 0, i_high = p_stss_data->i_entry_count - 1;
+            while( i_low < i_high )
             {
-                *pi_sync_sample = p_stss_data->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stss gives %d --> %" PRIu32 " (sample number)",
-                         i_sample, *pi_sync_sample );
-                i_ret = VLC_SUCCESS;
-                break;
+                const uint32_t i_mid = i_low + ( i_high - i_low + 1 ) / 2;
+                if( p_stss_data->i_sample_number[i_mid] <= i_sample )
+                    i_low = i_mid;
+                else
+                    i_high = i_mid - 1;
             }
+            *pi_sync_sample = p_stss_data->i_sample_number[i_low];
+            msg_Dbg( p_demux, "stss gives %d --> %" PRIu32 " (sample number)",
+                     i_sample, *pi_sync_sample );
+            i_ret = VLC_SUCCESS;
         }
     }
 
@@ -2959,7 +2833,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -3023,29 +2896,31 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
-    {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    const uint32_t i_chunk_end = ck->i_sample_first + ck->i_sample_count;
+    uint32_t i_index = ck->i_stts_index;
+    uint32_t i_skip = ck->i_stts_skip;
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    while( i_sample < i_chunk_end && i_index < stts->i_entry_count )
+    {
+        const uint32_t i_count = __MIN( stts->pi_sample_count[i_index] - i_skip,
+                                        i_chunk_end - i_sample );
+        const uint32_t i_delta = stts->pi_sample_delta[i_index];
+
+        if( i_dts + (uint64_t) i_count * i_delta < (uint64_t)i_start )
+        {
+            i_dts    += (uint64_t) i_count * i_delta;
+            i_sample += i_count;
             i_index++;
+            i_skip = 0;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
+            if( i_delta == 0 )
                 break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            i_sample += ( i_start - i_dts ) / i_delta;
             break;
         }
     }
@@ -3476,15 +3351,6 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     p_track->b_ok = true;
 }
 
-static void DestroyChunk( mp4_chunk_t *ck )
-{
-    free( ck->p_sample_count_dts );
-    free( ck->p_sample_delta_dts );
-    free( ck->p_sample_count_pts );
-    free( ck->p_sample_offset_pts );
-    free( ck->p_sample_size );
-}
-
 /****************************************************************************
  * MP4_TrackClean:
  ****************************************************************************
@@ -3497,16 +3363,8 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
-    }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 
@@ -3625,10 +3483,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
     {
         *pi_nb_samples = 1;
 
-        if( p_track->i_sample_size == 0 ) /* all sizes are different */
-            return p_track->p_sample_size[p_track->i_sample];
-        else
-            return p_track->i_sample_size;
+        return MP4_TrackGetSampleSize( p_track, p_track->i_sample );
     }
     else
     {
@@ -3659,7 +3514,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         if( p_track->i_sample_size == 0 )
         {
             *pi_nb_samples = 1;
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_TrackGetSampleSize( p_track, p_track->i_sample );
         }
 
         if( p_soun->i_qt_version == 1 )
@@ -3667,10 +3522,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
             if ( p_soun->i_compressionid == 0xFFFE )
             {
                 *pi_nb_samples = 1; /* != number of audio samples */
-                if ( p_track->i_sample_size )
-                    return p_track->i_sample_size;
-                else
-                    return p_track->p_sample_size[p_track->i_sample];
+                return MP4_TrackGetSampleSize( p_track, p_track->i_sample );
             }
             else if ( p_soun->i_compressionid != 0 || p_soun->i_bytes_per_sample > 1 ) /* compressed */
             {
@@ -3746,7 +3598,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         {
             (*pi_nb_samples)++;
             if ( p_track->i_sample_size == 0 )
-                i_size += p_track->p_sample_size[i];
+                i_size += MP4_TrackGetSampleSize( p_track, i );
             else
                 i_size += MP4_GetFixedSampleSize( p_track, p_soun );
 
@@ -3813,7 +3665,7 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
         for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
              i_sample < p_track->i_sample; i_sample++ )
         {
-            i_pos += p_track->p_sample_size[i_sample];
+            i_pos += MP4_TrackGetSampleSize( p_track, i_sample );
         }
     }
 
@@ -4106,6 +3958,72 @@ static bool GetMoofTrackDuration( MP4_Box_t *p_moov, MP4_Box_t *p_moof,
     return true;
 }
 
+/* Fragments index built by a previous ProbeFragments() on the same file:
+ * one entry per fragment and track, then the end time */
+#define MP4_FRAGMENTS_CACHE_NAME "mp4-fragments-1"
+
+static bool LoadFragmentsIndexCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    vlc_demux_index_entry_t *p_entries;
+    size_t i_entries;
+
+    if( p_sys->i_tracks == 0 ||
+        vlc_demux_index_Load( p_demux, MP4_FRAGMENTS_CACHE_NAME,
+                              &p_entries, &i_entries ) )
+        return false;
+
+    mp4_fragments_index_t *p_index = NULL;
+    if( i_entries > 1 && (i_entries - 1) % p_sys->i_tracks == 0 &&
+        p_entries[i_entries - 1].i_stream == p_sys->i_tracks )
+        p_index = MP4_Fragments_Index_New( p_sys->i_tracks,
+                                           (i_entries - 1) / p_sys->i_tracks );
+    if( p_index )
+    {
+        for( size_t i = 0; i < i_entries - 1; i++ )
+        {
+            if( p_entries[i].i_stream != i % p_sys->i_tracks )
+            {
+                MP4_Fragments_Index_Delete( p_index );
+                p_index = NULL;
+                break;
+            }
+            p_index->p_times[i] = p_entries[i].i_time;
+            p_index->pi_pos[i / p_sys->i_tracks] = p_entries[i].i_offset;
+        }
+    }
+    if( p_index )
+    {
+        p_index->i_last_time = p_entries[i_entries - 1].i_time;
+        p_sys->p_fragsindex = p_index;
+        p_sys->b_fragments_probed = true;
+    }
+    free( p_entries );
+    return p_index != NULL;
+}
+
+static void StoreFragmentsIndexCache( demux_t *p_demux )
+{
+    const mp4_fragments_index_t *p_index = p_demux->p_sys->p_fragsindex;
+    const size_t i_entries = (size_t) p_index->i_entries * p_index->i_tracks + 1;
+
+    vlc_demux_index_entry_t *p_entries = calloc( i_entries, sizeof(*p_entries) );
+    if( !p_entries )
+        return;
+
+    for( size_t i = 0; i < i_entries - 1; i++ )
+    {
+        p_entries[i].i_time = p_index->p_times[i];
+        p_entries[i].i_offset = p_index->pi_pos[i / p_index->i_tracks];
+        p_entries[i].i_stream = i % p_index->i_tracks;
+    }
+    p_entries[i_entries - 1].i_time = p_index->i_last_time;
+    p_entries[i_entries - 1].i_stream = p_index->i_tracks;
+
+    vlc_demux_index_Store( p_demux, MP4_FRAGMENTS_CACHE_NAME, p_entries, i_entries );
+    free( p_entries );
+}
+
 static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -4118,7 +4036,12 @@ static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
     if( !p_vroot )
         return VLC_EGENERIC;
 
-    if( p_sys->b_seekable && (p_sys->b_fastseekable || b_force) )
+    if( p_sys->b_seekable && (p_sys->b_fastseekable || b_force) &&
+        !p_sys->p_fragsindex && LoadFragmentsIndexCache( p_demux ) )
+    {
+        *pb_fragmented = true;
+    }
+    else if( p_sys->b_seekable && (p_sys->b_fastseekable || b_force) )
     {
         MP4_ReadBoxContainerChildren( p_demux->s, p_vroot, NULL ); /* Get the rest of the file */
         p_sys->b_fragments_probed = true;
@@ -4193,6 +4116,7 @@ static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
 #ifdef MP4_VERBOSE
             MP4_Fragments_Index_Dump( VLC_OBJECT(p_demux), p_sys->p_fragsindex, p_sys->i_timescale );
 #endif
+            StoreFragmentsIndexCache( p_demux );
         }
     }
     else
@@ -47,20 +47,25 @@ typedef struct
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_duration;    /* total duration of all samples */
 
-    uint32_t     i_entries_dts;
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-
-    uint32_t     i_entries_pts;
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
-
-    uint32_t     *p_sample_size;
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
+    /* position of the first sample in the stts and ctts run tables,
+       which are decoded on demand, see mp4_table_cursor_t */
+    uint32_t     i_stts_index;
+    uint32_t     i_stts_skip;   /* samples of that entry in previous chunks */
+    uint32_t     i_ctts_index;
+    uint32_t     i_ctts_skip;
 
 } mp4_chunk_t;
 
+/* Last sample looked up in a run-length table (stts or ctts), so that
+   sequential lookups don't restart from the chunk beginning */
+typedef struct
+{
+    uint32_t     i_sample;      /* track sample number */
+    uint32_t     i_index;       /* table entry of this sample */
+    uint32_t     i_skip;        /* samples of that entry before this one */
+    uint64_t     i_dts;         /* dts of this sample (stts only) */
+} mp4_table_cursor_t;
+
 typedef struct
 {
     uint64_t i_offset;
@@ -117,11 +122,18 @@ typedef struct
 
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
 
-    /* sample size, p_sample_size defined only if i_sample_size == 0
+    /* sample size, p_stsz or p_stz2 defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-//                                    too much time to do sumations each time*/
+    const MP4_Box_data_stsz_t *p_stsz;
+    const MP4_Box_data_stz2_t *p_stz2;
+
+    /* timing tables, p_ctts can be NULL */
+    const MP4_Box_data_stts_t *p_stts;
+    const MP4_Box_data_ctts_t *p_ctts;
+    int64_t          i_cts_shift;
+    mp4_table_cursor_t stts_cursor;
+    mp4_table_cursor_t ctts_cursor;
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -35,6 +35,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -111,6 +112,12 @@ static void Close ( vlc_object_t * );
     "Seek and position based on a percent byte position, not a PCR generated " \
     "time position. If seeking doesn't work property, turn on this option." )
 
+#define READ_BATCH_TEXT N_("Packets read at once")
+#define READ_BATCH_LONGTEXT N_( \
+    "Number of TS packets read from the input in a single call. " \
+    "Packets are then sliced out of the shared buffer without copying. " \
+    "Use 1 to read packets one by one." )
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -148,6 +155,8 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer_with_range( "ts-read-batch", 64, 1, 1024,
+                            READ_BATCH_TEXT, READ_BATCH_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -174,6 +183,7 @@ static inline int PIDGet( block_t *p )
     return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
 }
 static mtime_t GetPCR( const block_t * );
+static bool PIDIsDescrambled( const demux_sys_t *, const ts_pid_t * );
 
 static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, int * );
 static bool GatherPESData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk, size_t );
@@ -181,6 +191,9 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static uint64_t TSTell( demux_sys_t *p_sys );
+static int TSSeek( demux_sys_t *p_sys, uint64_t i_pos );
+static void TSBatchDrop( demux_sys_t *p_sys );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, mtime_t );
@@ -191,6 +204,7 @@ static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 #define TS_PACKET_SIZE_204 204
 #define TS_PACKET_SIZE_MAX 204
 #define TS_HEADER_SIZE 4
+#define TS_RESYNC_PACKETS 10
 
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
 {
@@ -386,6 +400,8 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->i_read_batch = var_InheritInteger( p_demux, "ts-read-batch" );
+    p_sys->p_batch = NULL;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -472,6 +488,10 @@ static int Open( vlc_object_t *p_this )
             else
                 p_sys->i_csa_pkt_size = i_pkt;
             msg_Dbg( p_demux, "decrypting %d bytes of packet", p_sys->i_csa_pkt_size );
+
+            /* descramble whole batches at once */
+            if( p_sys->i_read_batch > 1 )
+                p_sys->i_read_batch = __MAX( p_sys->i_read_batch, CSA_BATCH );
         }
         free( psz_csa2 );
     }
@@ -568,6 +588,8 @@ static void Close( vlc_object_t *p_this )
     /* Release all non default pids */
     ts_pid_list_Release( p_demux, &p_sys->pids );
 
+    TSBatchDrop( p_sys );
+
     /* Clear up attachments */
     vlc_dictionary_clear( &p_sys->attachments, FreeDictAttachment, NULL );
 
@@ -925,7 +947,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = TSTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -972,7 +994,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            TSSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1104,9 +1126,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        TSBatchDrop( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        TSBatchDrop( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1684,7 +1708,7 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
-static block_t* ReadTSPacket( demux_t *p_demux )
+static block_t* ReadTSPacketSingle( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
@@ -1694,10 +1718,10 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
     {
         int64_t size = stream_Size( p_sys->stream );
-        if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+        if( size >= 0 && (uint64_t)size == TSTell( p_sys ) )
+            msg_Dbg( p_demux, "EOF at %"PRIu64, TSTell( p_sys ) );
         else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, TSTell( p_sys ) );
         return NULL;
     }
 
@@ -1760,6 +1784,269 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     return p_pkt;
 }
 
+/*****************************************************************************
+ * Batched packet reading:
+ *  Packets are read by chunks of i_read_batch packets into a single buffer.
+ *  Each packet handed to the demuxer is a block_t view on that buffer, which
+ *  is only freed once all its views and the demuxer have released it.
+ *****************************************************************************/
+typedef struct
+{
+    block_t     self;
+    ts_batch_t *p_batch;
+} ts_batch_view_t;
+
+struct ts_batch_t
+{
+    atomic_uint     refs;
+    uint8_t        *p_buffer;
+    size_t          i_size;     /* allocated bytes */
+    size_t          i_buffer;   /* bytes read from the stream */
+    size_t          i_offset;   /* first byte not yet handed out */
+    size_t          i_csa_offset; /* first byte not yet descrambled */
+    unsigned        i_views;
+    unsigned        i_max_views;
+    ts_batch_view_t views[];
+};
+
+static void TSBatchRelease( ts_batch_t *p_batch )
+{
+    if( atomic_fetch_sub( &p_batch->refs, 1 ) == 1 )
+        free( p_batch );
+}
+
+static void TSBatchViewRelease( block_t *p_block )
+{
+    ts_batch_view_t *p_view = container_of( p_block, ts_batch_view_t, self );
+    TSBatchRelease( p_view->p_batch );
+}
+
+static ts_batch_t *TSBatchNew( unsigned i_packet_size, unsigned i_packets )
+{
+    const size_t i_views = i_packets + 1;
+    const size_t i_size = (size_t)i_packet_size * i_packets;
+    ts_batch_t *p_batch = malloc( sizeof(*p_batch) +
+                                  i_views * sizeof(ts_batch_view_t) + i_size );
+    if( unlikely(p_batch == NULL) )
+        return NULL;
+
+    atomic_init( &p_batch->refs, 1 );
+    p_batch->p_buffer = (uint8_t *) &p_batch->views[i_views];
+    p_batch->i_size = i_size;
+    p_batch->i_buffer = 0;
+    p_batch->i_offset = 0;
+    p_batch->i_csa_offset = 0;
+    p_batch->i_views = 0;
+    p_batch->i_max_views = i_views;
+    return p_batch;
+}
+
+static void TSBatchDrop( demux_sys_t *p_sys )
+{
+    if( p_sys->p_batch )
+    {
+        TSBatchRelease( p_sys->p_batch );
+        p_sys->p_batch = NULL;
+    }
+}
+
+static inline size_t TSBatchAvailable( const ts_batch_t *p_batch )
+{
+    return p_batch ? p_batch->i_buffer - p_batch->i_offset : 0;
+}
+
+/* Ensures at least i_want unread bytes are buffered, unless the stream ends.
+ * Unread bytes are carried over to a new buffer when the current one is full,
+ * so that packets and resync windows can span batch boundaries.
+ * Returns the number of buffered unread bytes. */
+static size_t TSBatchFill( demux_t *p_demux, size_t i_want )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_batch_t *p_batch = p_sys->p_batch;
+    size_t i_avail = TSBatchAvailable( p_batch );
+
+    if( i_avail >= i_want )
+        return i_avail;
+
+    if( p_batch == NULL || p_batch->i_size - p_batch->i_offset < i_want ||
+        p_batch->i_views == p_batch->i_max_views )
+    {
+        unsigned i_packets = __MAX( p_sys->i_read_batch, TS_RESYNC_PACKETS );
+        ts_batch_t *p_new = TSBatchNew( p_sys->i_packet_size, i_packets );
+        if( unlikely(p_new == NULL) )
+            return i_avail;
+        assert( i_avail < p_new->i_size && i_want <= p_new->i_size );
+
+        if( i_avail )
+            memcpy( p_new->p_buffer, &p_batch->p_buffer[p_batch->i_offset], i_avail );
+        p_new->i_buffer = i_avail;
+        if( p_batch && p_batch->i_csa_offset > p_batch->i_offset )
+            p_new->i_csa_offset = p_batch->i_csa_offset - p_batch->i_offset;
+
+        if( p_batch )
+            TSBatchRelease( p_batch );
+        p_sys->p_batch = p_batch = p_new;
+    }
+
+    while( i_avail < i_want )
+    {
+        ssize_t i_read = vlc_stream_ReadPartial( p_sys->stream,
+                                                 &p_batch->p_buffer[p_batch->i_buffer],
+                                                 p_batch->i_size - p_batch->i_buffer );
+        if( i_read <= 0 )
+            break;
+        p_batch->i_buffer += i_read;
+        i_avail += i_read;
+    }
+
+    return i_avail;
+}
+
+/* Descrambles the buffered packets ahead of the read offset at once, which
+ * lets csa_DecryptBatch() run the stream cypher of all of them in parallel.
+ * Descrambled packets have their scrambling control cleared, so that
+ * ProcessTSPacket() leaves them alone. */
+static void TSBatchDescramble( demux_t *p_demux, ts_batch_t *p_batch )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+    const unsigned i_header = p_sys->i_packet_header_size;
+    uint8_t *pp_pkts[CSA_BATCH];
+    int i_pkts = 0;
+
+    size_t i_pos = __MAX( p_batch->i_offset, p_batch->i_csa_offset );
+    while( i_pkts < CSA_BATCH && i_pos + i_size <= p_batch->i_buffer &&
+           p_batch->p_buffer[i_pos + i_header] == 0x47 )
+    {
+        uint8_t *p_pkt = &p_batch->p_buffer[i_pos + i_header];
+        const ts_pid_t *p_pid = GetPID( p_sys, ((p_pkt[1] & 0x1f) << 8) | p_pkt[2] );
+
+        /* skip the packets which will be dropped anyway */
+        if( PIDIsDescrambled( p_sys, p_pid ) )
+            pp_pkts[i_pkts++] = p_pkt;
+        i_pos += i_size;
+    }
+    p_batch->i_csa_offset = i_pos;
+
+    if( i_pkts == 0 )
+        return;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    csa_DecryptBatch( p_sys->csa, pp_pkts, i_pkts, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+static block_t* ReadTSPacketBatched( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+    const unsigned i_header = p_sys->i_packet_header_size;
+
+    if( TSBatchFill( p_demux, i_size ) < i_size )
+    {
+        int64_t size = stream_Size( p_sys->stream );
+        if( size >= 0 && (uint64_t)size == TSTell( p_sys ) )
+            msg_Dbg( p_demux, "EOF at %"PRIu64, TSTell( p_sys ) );
+        else
+            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, TSTell( p_sys ) );
+        return NULL;
+    }
+
+    ts_batch_t *p_batch = p_sys->p_batch;
+
+    /* Check sync byte and re-sync if needed */
+    if( p_batch->p_buffer[p_batch->i_offset + i_header] != 0x47 )
+    {
+        msg_Warn( p_demux, "lost synchro" );
+        for( ;; )
+        {
+            size_t i_avail = TSBatchFill( p_demux, i_size * TS_RESYNC_PACKETS );
+            if( i_avail < i_size + 1 )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
+            }
+
+            p_batch = p_sys->p_batch;
+            const uint8_t *p_peek = &p_batch->p_buffer[p_batch->i_offset];
+            size_t i_skip = 0;
+            while( i_skip < i_avail - i_size )
+            {
+                if( p_peek[i_skip + i_header] == 0x47 &&
+                    p_peek[i_skip + i_header + i_size] == 0x47 )
+                {
+                    break;
+                }
+                i_skip++;
+            }
+            msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+            p_batch->i_offset += i_skip;
+
+            if( i_skip < i_avail - i_size )
+                break;
+        }
+
+        if( TSBatchFill( p_demux, i_size ) < i_size )
+        {
+            msg_Dbg( p_demux, "eof ?" );
+            return NULL;
+        }
+        p_batch = p_sys->p_batch;
+    }
+
+    if( p_sys->csa && p_batch->i_csa_offset <= p_batch->i_offset )
+        TSBatchDescramble( p_demux, p_batch );
+
+    assert( p_batch->i_views < p_batch->i_max_views );
+    ts_batch_view_t *p_view = &p_batch->views[p_batch->i_views++];
+    block_Init( &p_view->self, &p_batch->p_buffer[p_batch->i_offset], i_size );
+    p_view->self.pf_release = TSBatchViewRelease;
+    p_view->p_batch = p_batch;
+    atomic_fetch_add( &p_batch->refs, 1 );
+    p_batch->i_offset += i_size;
+
+    /* Skip header (BluRay streams), see ReadTSPacketSingle() */
+    block_t *p_pkt = &p_view->self;
+    p_pkt->p_buffer += i_header;
+    p_pkt->i_buffer -= i_header;
+
+    return p_pkt;
+}
+
+static block_t* ReadTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->i_read_batch > 1 )
+        return ReadTSPacketBatched( p_demux );
+    return ReadTSPacketSingle( p_demux );
+}
+
+/* Stream position of the next packet, accounting for batched bytes */
+static uint64_t TSTell( demux_sys_t *p_sys )
+{
+    return vlc_stream_Tell( p_sys->stream ) - TSBatchAvailable( p_sys->p_batch );
+}
+
+static int TSSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    TSBatchDrop( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+/* Gives the packets buffered but not read yet back to the stream, before
+ * another stream is stacked on top of it. They are lost if it cannot seek. */
+void TSBatchFlush( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_avail = TSBatchAvailable( p_sys->p_batch );
+
+    if( i_avail > 0 &&
+        TSSeek( p_sys, vlc_stream_Tell( p_sys->stream ) - i_avail ) )
+        msg_Warn( p_demux, "dropping %zu buffered bytes", i_avail );
+    TSBatchDrop( p_sys );
+}
+
 static mtime_t GetPCR( const block_t *p_pkt )
 {
     const uint8_t *p = p_pkt->p_buffer;
@@ -1781,6 +2068,14 @@ static mtime_t GetPCR( const block_t *p_pkt )
     return i_pcr;
 }
 
+/* Whether the packets of a PID are descrambled, rather than dropped by the
+ * emulated hardware filter because no selected ES needs them */
+static bool PIDIsDescrambled( const demux_sys_t *p_sys, const ts_pid_t *p_pid )
+{
+    return p_pid->type != TYPE_STREAM || p_sys->b_access_control ||
+           p_sys->es_creation == DELAY_ES || (p_pid->i_flags & FLAG_FILTERED);
+}
+
 static inline void UpdateESScrambledState( es_out_t *out, const ts_es_t *p_es, bool b_scrambled )
 {
     for( ; p_es; p_es = p_es->p_next )
@@ -1866,13 +2161,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return TSSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1888,7 +2183,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( TSSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1902,7 +2197,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TSTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -1957,7 +2252,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, int64_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        TSSeek( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -2040,7 +2335,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = TSTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2068,7 +2363,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2081,7 +2376,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2090,7 +2385,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (2 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2099,7 +2394,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TSTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2112,7 +2407,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TSSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2121,7 +2416,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_probe_count += PROBE_CHUNK_COUNT;
     } while( i_pos > 0 && (i_pcr == -1 || !b_found) && i_probe_count < (6 * PROBE_CHUNK_COUNT) );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TSSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2172,10 +2467,10 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            TSTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             p_pmt->i_last_dts = i_pcr;
-            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+            p_pmt->i_last_dts_byte = TSTell( p_sys );
         }
     }
 }
@@ -2399,14 +2694,15 @@ static block_t * ProcessTSPacket( demux_t *p_demux, ts_pid_t *pid, block_t *p_pk
 
     if( b_scrambled )
     {
-        if( p_demux->p_sys->csa )
+        if( p_demux->p_sys->csa == NULL )
+            p_pkt->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        else if( PIDIsDescrambled( p_demux->p_sys, pid ) )
         {
             vlc_mutex_lock( &p_demux->p_sys->csa_lock );
             csa_Decrypt( p_demux->p_sys->csa, p_pkt->p_buffer, p_demux->p_sys->i_csa_pkt_size );
             vlc_mutex_unlock( &p_demux->p_sys->csa_lock );
         }
-        else
-            p_pkt->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        /* else dropped by the filters, do not waste time on it */
     }
 
     /* We don't have any adaptation_field, so payload starts
@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_batch_t ts_batch_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -60,6 +61,11 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* how many TS packets we fetch from the stream at once, and the
+     * buffer they are sliced from */
+    unsigned    i_read_batch;
+    ts_batch_t *p_batch;
+
     bool        b_ignore_time_for_positions;
 
     ts_standards_e standard;
@@ -137,6 +143,7 @@ int ProbeStart( demux_t *p_demux, int i_program );
 int ProbeEnd( demux_t *p_demux, int i_program );
 
 void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool b_create_delayed );
+void TSBatchFlush( demux_t *p_demux );
 int FindPCRCandidate( ts_pmt_t *p_pmt );
 
 #endif
@@ -310,10 +310,9 @@ void MissingPATPMTFixup( demux_t *p_demux )
     if( esstreams && mapped )
     {
         int j=0;
-        for( int i=0; i<p_sys->pids.i_all; i++ )
+        ts_pid_next_context_t esnextctx = ts_pid_NextContextInitValue;
+        while( (p_pid = ts_pid_Next( &p_sys->pids, &esnextctx )) )
         {
-            const ts_pid_t *p_pid = p_sys->pids.pp_all[i];
-
             if( !SEEN(p_pid) ||
                 p_pid->probed.i_fourcc == 0 )
                 continue;
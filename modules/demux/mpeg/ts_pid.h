@@ -79,19 +79,16 @@ struct ts_pid_t
 
 };
 
+#define TS_PID_COUNT 0x2000 /* 13 bits */
+
 struct ts_pid_list_t
 {
     ts_pid_t   pat;
     ts_pid_t   dummy;
     ts_pid_t   base_si;
-    /* all non commons ones, dynamically allocated */
-    ts_pid_t **pp_all;
+    /* all non commons ones, indexed by pid and allocated on first use */
+    ts_pid_t  *pp_all[TS_PID_COUNT];
     int        i_all;
-    int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
-
 };
 
 /* opacified pid list */
@@ -101,7 +98,7 @@ void ts_pid_list_Release( demux_t *, ts_pid_list_t * );
 /* creates missing pid on the fly */
 ts_pid_t * ts_pid_Get( ts_pid_list_t *, uint16_t i_pid );
 
-/* returns NULL on end. requires context */
+/* returns NULL on end, in increasing pid order. requires context */
 typedef struct
 {
     int i_pos;
@@ -119,6 +119,7 @@ private:
     QTreeWidgetItem *input;
     QTreeWidgetItem *read_media_stat;
     QTreeWidgetItem *input_bitrate_stat;
+    QTreeWidgetItem *read_batch_stat;
     QTreeWidgetItem *input_bitrate_graph;
     QTreeWidgetItem *demuxed_stat;
     QTreeWidgetItem *stream_bitrate_stat;
@@ -199,6 +199,7 @@ static int vlclua_input_item_stats( lua_State *L )
 #define STATS_FLOAT( n ) lua_pushnumber( L, p_item->p_stats->f_ ## n ); \
                          lua_setfield( L, -2, #n );
         STATS_INT( read_packets )
+        STATS_INT( read_calls )
         STATS_INT( read_bytes )
         STATS_FLOAT( input_bitrate )
         STATS_FLOAT( average_input_bitrate )
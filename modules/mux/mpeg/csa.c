@@ -26,10 +26,22 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 
 #include "csa.h"
 
+/* Word of the bitsliced stream cypher, see csa_StreamCypherBatch() */
+#ifdef __GNUC__
+typedef uint64_t bs_t __attribute__((vector_size(16)));
+# define BS_WORDS 2
+#else
+typedef uint64_t bs_t;
+# define BS_WORDS 1
+#endif
+#define BS_LANES (64 * BS_WORDS)
+
 struct csa_t
 {
     /* odd and even keys */
@@ -47,6 +59,9 @@ struct csa_t
     int     p, q, r;
 
     bool    use_odd;
+
+    /* stream cypher output of the packets of a batch */
+    uint8_t bs_stream[BS_LANES][184];
 };
 
 static void csa_ComputeKey( uint8_t kk[57], uint8_t ck[8] );
@@ -56,6 +71,10 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
 
+static void csa_StreamCypherBatch( csa_t *c, uint8_t *const *iv,
+                                   const bool *odd, int i_lanes,
+                                   int i_blocks );
+
 /*****************************************************************************
  * csa_New:
  *****************************************************************************/
@@ -307,6 +326,154 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t **pp_pkts, int i_pkts,
+                       int i_pkt_size )
+{
+    uint8_t *lanes[BS_LANES], *iv[BS_LANES];
+    bool     odd[BS_LANES];
+
+    while( i_pkts > 0 )
+    {
+        int i_lanes = 0;
+        int i_blocks = 0;
+
+        for( ; i_pkts > 0 && i_lanes < BS_LANES; pp_pkts++, i_pkts-- )
+        {
+            uint8_t *pkt = *pp_pkts;
+            int i_hdr = 4;
+
+            if( (pkt[3]&0x80) == 0 )
+                continue; /* not scrambled */
+            if( pkt[3]&0x20 )
+                i_hdr += pkt[4] + 1;
+
+            const int n = (i_pkt_size - i_hdr) / 8;
+            if( 188 - i_hdr < 8 || n < 1 )
+            {
+                /* nothing to batch */
+                csa_Decrypt( c, pkt, i_pkt_size );
+                continue;
+            }
+
+            odd[i_lanes] = pkt[3]&0x40;
+            pkt[3] &= 0x3f;
+            iv[i_lanes] = &pkt[i_hdr];
+            lanes[i_lanes++] = pkt;
+
+            /* n - 1 blocks, and the residue */
+            const int i_needed = n - 1 + ( (i_pkt_size - i_hdr) % 8 > 0 );
+            i_blocks = __MAX( i_blocks, i_needed );
+        }
+
+        if( i_lanes == 0 )
+            break;
+
+        csa_StreamCypherBatch( c, iv, odd, i_lanes, i_blocks );
+
+        /* the blocks are independent once the stream is known */
+        for( int l = 0; l < i_lanes; l++ )
+        {
+            uint8_t *kk = odd[l] ? c->o_kk : c->e_kk;
+            uint8_t *p = iv[l];
+            const uint8_t *stream = c->bs_stream[l];
+            const int i_payload = &lanes[l][i_pkt_size] - p;
+            const int n = i_payload / 8;
+            const int i_residue = i_payload % 8;
+            uint8_t ib[8], block[8];
+
+            memcpy( ib, p, 8 );
+            for( int i = 1; i < n + 1; i++ )
+            {
+                csa_BlockDecypher( kk, ib, block );
+                for( int j = 0; j < 8; j++ )
+                    ib[j] = ( i != n ) ? p[8*i+j] ^ stream[8*(i-1)+j] : 0;
+                for( int j = 0; j < 8; j++ )
+                    p[8*(i-1)+j] = ib[j] ^ block[j];
+            }
+
+            for( int j = 0; j < i_residue; j++ )
+                p[8*n+j] ^= stream[8*(n-1)+j];
+        }
+    }
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkts, int i_pkts,
+                       int i_pkt_size )
+{
+    uint8_t *lanes[BS_LANES], *iv[BS_LANES];
+    bool     odd[BS_LANES];
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+
+    while( i_pkts > 0 )
+    {
+        int i_lanes = 0;
+        int i_blocks = 0;
+
+        for( ; i_pkts > 0 && i_lanes < BS_LANES; pp_pkts++, i_pkts-- )
+        {
+            uint8_t *pkt = *pp_pkts;
+            int i_hdr = 4;
+
+            if( pkt[3]&0x20 )
+                i_hdr += pkt[4] + 1;
+
+            const int n = (i_pkt_size - i_hdr) / 8;
+            if( n <= 0 )
+            {
+                /* nothing to batch */
+                csa_Encrypt( c, pkt, i_pkt_size );
+                continue;
+            }
+
+            /* set transport scrambling control */
+            pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+
+            /* block cypher, in place from the last block */
+            uint8_t *p = &pkt[i_hdr];
+            uint8_t block[8];
+
+            for( int j = 0; j < 8; j++ )
+                block[j] = p[8*(n-1)+j];
+            csa_BlockCypher( kk, block, &p[8*(n-1)] );
+            for( int i = n - 1; i > 0; i-- )
+            {
+                for( int j = 0; j < 8; j++ )
+                    block[j] = p[8*(i-1)+j] ^ p[8*i+j];
+                csa_BlockCypher( kk, block, &p[8*(i-1)] );
+            }
+
+            odd[i_lanes] = c->use_odd;
+            iv[i_lanes] = p;
+            lanes[i_lanes++] = pkt;
+
+            const int i_needed = n - 1 + ( (i_pkt_size - i_hdr) % 8 > 0 );
+            i_blocks = __MAX( i_blocks, i_needed );
+        }
+
+        if( i_lanes == 0 )
+            break;
+
+        csa_StreamCypherBatch( c, iv, odd, i_lanes, i_blocks );
+
+        for( int l = 0; l < i_lanes; l++ )
+        {
+            uint8_t *p = iv[l];
+            const uint8_t *stream = c->bs_stream[l];
+            const int i_payload = &lanes[l][i_pkt_size] - p;
+
+            /* the first block is the stream initialisation vector */
+            for( int j = 8; j < i_payload; j++ )
+                p[j] ^= stream[j - 8];
+        }
+    }
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -494,6 +661,393 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 }
 
 
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************
+ * Each bit of the cypher state is a bs_t word holding that bit for up to
+ * BS_LANES packets, one per bit of the word. The same sequence of logical
+ * operations then runs the stream cypher of all the packets at once.
+ *****************************************************************************/
+#define BS_ZERO ((bs_t){ 0 })
+#define BS_ONES (~BS_ZERO)
+
+struct csa_bs_state
+{
+    /* A[1..10], B[1..10], nibbles split into bits 0..3 */
+    bs_t A[11][4];
+    bs_t B[11][4];
+    bs_t X[4], Y[4], Z[4];
+    bs_t D[4], E[4], F[4];
+    bs_t p, q, r;
+};
+
+/* Boolean circuits of sbox1..sbox7, derived from their tables */
+static inline void bs_sbox1( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = ~x4;
+    const bs_t t2 = x4 ^ x2;
+    const bs_t t3 = x0 & t2;
+    const bs_t t4 = t3 ^ x1;
+    const bs_t t5 = x2 | t1;
+    const bs_t t6 = t5 ^ (x0 & (t5 ^ x2));
+    const bs_t t7 = x2 & x4;
+    const bs_t t8 = t7 ^ (x0 & (t7 ^ t2));
+    const bs_t t9 = t6 ^ (x1 & (t6 ^ t8));
+    const bs_t t10 = t4 ^ (x3 & (t4 ^ t9));
+    const bs_t t11 = x2 | x4;
+    const bs_t t12 = t5 ^ (x0 & (t5 ^ t11));
+    const bs_t t13 = t2 & ~x0;
+    const bs_t t14 = t12 ^ (x1 & (t12 ^ t13));
+    const bs_t t15 = ~x2;
+    const bs_t t16 = ~t2;
+    const bs_t t17 = t16 ^ x0;
+    const bs_t t18 = t15 ^ (x1 & (t15 ^ t17));
+    const bs_t t19 = t14 ^ (x3 & (t14 ^ t18));
+    *s0 = t10;
+    *s1 = t19;
+}
+
+static inline void bs_sbox2( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = ~x2;
+    const bs_t t2 = x0 | t1;
+    const bs_t t3 = ~t2;
+    const bs_t t4 = t2 ^ x1;
+    const bs_t t5 = ~t1;
+    const bs_t t6 = t5 ^ x0;
+    const bs_t t7 = t1 ^ (x1 & (t1 ^ t6));
+    const bs_t t8 = t4 ^ (x3 & (t4 ^ t7));
+    const bs_t t9 = t1 | ~x0;
+    const bs_t t10 = x0 & t1;
+    const bs_t t11 = t9 ^ (x1 & (t9 ^ t10));
+    const bs_t t12 = t11 ^ x3;
+    const bs_t t13 = t8 ^ (x4 & (t8 ^ t12));
+    const bs_t t14 = ~t10;
+    const bs_t t15 = t14 ^ (x1 & (t14 ^ t6));
+    const bs_t t16 = t15 ^ x3;
+    const bs_t t17 = t14 ^ (x1 & (t14 ^ x0));
+    const bs_t t18 = t3 ^ (x1 & (t3 ^ t6));
+    const bs_t t19 = t17 ^ (x3 & (t17 ^ t18));
+    const bs_t t20 = t16 ^ (x4 & (t16 ^ t19));
+    *s0 = t13;
+    *s1 = t20;
+}
+
+static inline void bs_sbox3( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = ~x1;
+    const bs_t t2 = x1 ^ x4;
+    const bs_t t3 = x4 ^ x2;
+    const bs_t t4 = t2 ^ (x0 & (t2 ^ t3));
+    const bs_t t5 = t4 ^ x3;
+    const bs_t t6 = t1 & ~x4;
+    const bs_t t7 = x2 | t6;
+    const bs_t t8 = t2 ^ x2;
+    const bs_t t9 = t7 ^ (x0 & (t7 ^ t8));
+    const bs_t t10 = x4 & t1;
+    const bs_t t11 = t10 ^ x2;
+    const bs_t t12 = x1 ^ (x2 & (x1 ^ t10));
+    const bs_t t13 = t11 ^ (x0 & (t11 ^ t12));
+    const bs_t t14 = t9 ^ (x3 & (t9 ^ t13));
+    *s0 = t5;
+    *s1 = t14;
+}
+
+static inline void bs_sbox4( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = x0 | ~x1;
+    const bs_t t2 = t1 ^ x2;
+    const bs_t t3 = ~x0;
+    const bs_t t4 = t3 ^ x1;
+    const bs_t t5 = t2 ^ (x3 & (t2 ^ t4));
+    const bs_t t6 = x1 | t3;
+    const bs_t t7 = t6 ^ (x2 & (t6 ^ x0));
+    const bs_t t8 = ~t6;
+    const bs_t t9 = t8 ^ (x2 & (t8 ^ t4));
+    const bs_t t10 = t7 ^ (x3 & (t7 ^ t9));
+    const bs_t t11 = t5 ^ (x4 & (t5 ^ t10));
+    const bs_t t12 = ~t5;
+    const bs_t t13 = t10 ^ (x4 & (t10 ^ t12));
+    *s0 = t11;
+    *s1 = t13;
+}
+
+static inline void bs_sbox5( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = x1 & x3;
+    const bs_t t2 = t1 ^ x2;
+    const bs_t t3 = ~x3;
+    const bs_t t4 = x3 ^ x1;
+    const bs_t t5 = x3 ^ (x2 & (x3 ^ t4));
+    const bs_t t6 = t2 ^ (x4 & (t2 ^ t5));
+    const bs_t t7 = x1 | x3;
+    const bs_t t8 = t7 ^ (x2 & (t7 ^ t1));
+    const bs_t t9 = t8 ^ x4;
+    const bs_t t10 = t6 ^ (x0 & (t6 ^ t9));
+    const bs_t t11 = ~t4;
+    const bs_t t12 = x1 | t3;
+    const bs_t t13 = t11 ^ (x2 & (t11 ^ t12));
+    const bs_t t14 = t12 ^ x2;
+    const bs_t t15 = t13 ^ (x4 & (t13 ^ t14));
+    const bs_t t16 = ~x3;
+    const bs_t t17 = t1 ^ (x2 & (t1 ^ t16));
+    const bs_t t18 = t17 ^ (x4 & (t17 ^ t11));
+    const bs_t t19 = t15 ^ (x0 & (t15 ^ t18));
+    *s0 = t10;
+    *s1 = t19;
+}
+
+static inline void bs_sbox6( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = x4 | ~x1;
+    const bs_t t2 = x2 & t1;
+    const bs_t t3 = t2 ^ (x3 & (t2 ^ x1));
+    const bs_t t4 = ~x4;
+    const bs_t t5 = t4 | ~x1;
+    const bs_t t6 = t5 ^ x2;
+    const bs_t t7 = ~x1;
+    const bs_t t8 = t7 ^ (x2 & (t7 ^ t5));
+    const bs_t t9 = t6 ^ (x3 & (t6 ^ t8));
+    const bs_t t10 = t3 ^ (x0 & (t3 ^ t9));
+    const bs_t t11 = x4 ^ x1;
+    const bs_t t12 = t11 ^ x2;
+    const bs_t t13 = t11 ^ (x3 & (t11 ^ t12));
+    const bs_t t14 = x1 | x4;
+    const bs_t t15 = t14 ^ x2;
+    const bs_t t16 = ~t6;
+    const bs_t t17 = t15 ^ (x3 & (t15 ^ t16));
+    const bs_t t18 = t13 ^ (x0 & (t13 ^ t17));
+    *s0 = t10;
+    *s1 = t18;
+}
+
+static inline void bs_sbox7( bs_t x4, bs_t x3, bs_t x2, bs_t x1, bs_t x0,
+                              bs_t *s1, bs_t *s0 )
+{
+    const bs_t t1 = ~x2;
+    const bs_t t2 = x2 ^ x0;
+    const bs_t t3 = t2 ^ x4;
+    const bs_t t4 = ~x0;
+    const bs_t t5 = t4 ^ x4;
+    const bs_t t6 = t3 ^ (x3 & (t3 ^ t5));
+    const bs_t t7 = x0 & x2;
+    const bs_t t8 = t7 ^ x4;
+    const bs_t t9 = x0 | t1;
+    const bs_t t10 = t1 & ~x0;
+    const bs_t t11 = t9 ^ (x4 & (t9 ^ t10));
+    const bs_t t12 = t8 ^ (x3 & (t8 ^ t11));
+    const bs_t t13 = t6 ^ (x1 & (t6 ^ t12));
+    const bs_t t14 = t2 & ~x4;
+    const bs_t t15 = t14 ^ x3;
+    const bs_t t16 = t1 ^ (x4 & (t1 ^ t9));
+    const bs_t t17 = t2 ^ (x4 & (t2 ^ t7));
+    const bs_t t18 = t16 ^ (x3 & (t16 ^ t17));
+    const bs_t t19 = t15 ^ (x1 & (t15 ^ t18));
+    *s0 = t13;
+    *s1 = t19;
+}
+
+/* One iteration of the stream cypher. in_A and in_B are the input nibbles
+ * during initialisation, NULL afterwards. o1 and o0 are the output bits. */
+static void bs_StreamStep( struct csa_bs_state *s, const bs_t *in_A,
+                           const bs_t *in_B, bs_t *o1, bs_t *o0 )
+{
+    bs_t s1[2], s2[2], s3[2], s4[2], s5[2], s6[2], s7[2];
+    bs_t extra_B[4], next_A1[4], next_B1[4], next_D[4], next_F[4];
+
+    bs_sbox1( s->A[4][0], s->A[1][2], s->A[6][1], s->A[7][3], s->A[9][0], &s1[1], &s1[0] );
+    bs_sbox2( s->A[2][1], s->A[3][2], s->A[6][3], s->A[7][0], s->A[9][1], &s2[1], &s2[0] );
+    bs_sbox3( s->A[1][3], s->A[2][0], s->A[5][1], s->A[5][3], s->A[6][2], &s3[1], &s3[0] );
+    bs_sbox4( s->A[3][3], s->A[1][1], s->A[2][3], s->A[4][2], s->A[8][0], &s4[1], &s4[0] );
+    bs_sbox5( s->A[5][2], s->A[4][3], s->A[6][0], s->A[8][1], s->A[9][2], &s5[1], &s5[0] );
+    bs_sbox6( s->A[3][1], s->A[4][1], s->A[5][0], s->A[7][2], s->A[9][3], &s6[1], &s6[0] );
+    bs_sbox7( s->A[2][2], s->A[3][0], s->A[7][1], s->A[8][2], s->A[8][3], &s7[1], &s7[0] );
+
+    /* 4x4 xor producing the extra nibble for T3 */
+    extra_B[3] = s->B[3][0] ^ s->B[6][1] ^ s->B[7][2] ^ s->B[9][3];
+    extra_B[2] = s->B[6][0] ^ s->B[8][1] ^ s->B[3][3] ^ s->B[4][2];
+    extra_B[1] = s->B[5][3] ^ s->B[8][2] ^ s->B[4][0] ^ s->B[5][1];
+    extra_B[0] = s->B[9][2] ^ s->B[6][3] ^ s->B[3][1] ^ s->B[8][0];
+
+    for( int k = 0; k < 4; k++ )
+    {
+        /* T1, T2 */
+        next_A1[k] = s->A[10][k] ^ s->X[k];
+        next_B1[k] = s->B[7][k] ^ s->B[10][k] ^ s->Y[k];
+        if( in_A )
+        {
+            next_A1[k] ^= s->D[k] ^ in_A[k];
+            next_B1[k] ^= in_B[k];
+        }
+        /* T3 */
+        next_D[k] = s->E[k] ^ s->Z[k] ^ extra_B[k];
+    }
+
+    /* if p=1, rotate T2 left */
+    const bs_t b3 = next_B1[3];
+    for( int k = 3; k > 0; k-- )
+        next_B1[k] ^= s->p & ( next_B1[k] ^ next_B1[k-1] );
+    next_B1[0] ^= s->p & ( next_B1[0] ^ b3 );
+
+    /* T4: if q=1, F = Z + E + r with r the carry, else F = E */
+    bs_t carry = s->r;
+    for( int k = 0; k < 4; k++ )
+    {
+        const bs_t half = s->Z[k] ^ s->E[k];
+        const bs_t sum = half ^ carry;
+
+        carry = ( s->Z[k] & s->E[k] ) | ( carry & half );
+        next_F[k] = s->E[k] ^ ( s->q & ( sum ^ s->E[k] ) );
+    }
+    s->r ^= s->q & ( carry ^ s->r );
+
+    memcpy( s->E, s->F, sizeof( s->E ) );
+    memcpy( s->F, next_F, sizeof( s->F ) );
+    memcpy( s->D, next_D, sizeof( s->D ) );
+
+    memmove( s->A[2], s->A[1], 9 * sizeof( s->A[1] ) );
+    memmove( s->B[2], s->B[1], 9 * sizeof( s->B[1] ) );
+    memcpy( s->A[1], next_A1, sizeof( s->A[1] ) );
+    memcpy( s->B[1], next_B1, sizeof( s->B[1] ) );
+
+    s->X[0] = s1[1]; s->X[1] = s2[1]; s->X[2] = s3[0]; s->X[3] = s4[0];
+    s->Y[0] = s3[1]; s->Y[1] = s4[1]; s->Y[2] = s5[0]; s->Y[3] = s6[0];
+    s->Z[0] = s5[1]; s->Z[1] = s6[1]; s->Z[2] = s1[0]; s->Z[3] = s2[0];
+    s->p = s7[1];
+    s->q = s7[0];
+
+    /* 2 output bits are a function of the 4 bits of D */
+    *o1 = s->D[3] ^ s->D[2];
+    *o0 = s->D[1] ^ s->D[0];
+}
+
+/* Transposes a 8x8 bits matrix, bit 8*r+c to bit 8*c+r */
+static inline uint64_t bs_Transpose8( uint64_t x )
+{
+    uint64_t t;
+
+    t = ( x ^ ( x >> 7 ) ) & UINT64_C(0x00AA00AA00AA00AA);
+    x ^= t ^ ( t << 7 );
+    t = ( x ^ ( x >> 14 ) ) & UINT64_C(0x0000CCCC0000CCCC);
+    x ^= t ^ ( t << 14 );
+    t = ( x ^ ( x >> 28 ) ) & UINT64_C(0x00000000F0F0F0F0);
+    x ^= t ^ ( t << 28 );
+    return x;
+}
+
+/* Gathers one byte of each lane into 8 bit planes */
+static void bs_Slice( bs_t planes[8], uint8_t *const *bytes, int i_lanes,
+                      int i_offset )
+{
+    uint64_t w[8][BS_WORDS] = { { 0 } };
+
+    for( int g = 0; g < BS_LANES / 8 && 8 * g < i_lanes; g++ )
+    {
+        uint64_t x = 0;
+
+        for( int l = 0; l < 8 && 8 * g + l < i_lanes; l++ )
+            x |= (uint64_t)bytes[8*g+l][i_offset] << (8 * l);
+        x = bs_Transpose8( x );
+        for( int b = 0; b < 8; b++ )
+            w[b][g / 8] |= ( ( x >> (8 * b) ) & 0xff ) << (8 * (g % 8));
+    }
+    for( int b = 0; b < 8; b++ )
+        memcpy( &planes[b], w[b], sizeof( planes[b] ) );
+}
+
+/* Scatters 8 bit planes into one byte of each lane */
+static void bs_Unslice( const bs_t planes[8], uint8_t (*bytes)[184],
+                        int i_lanes, int i_offset )
+{
+    uint64_t w[8][BS_WORDS];
+
+    for( int b = 0; b < 8; b++ )
+        memcpy( w[b], &planes[b], sizeof( planes[b] ) );
+
+    for( int g = 0; g < BS_LANES / 8 && 8 * g < i_lanes; g++ )
+    {
+        uint64_t x = 0;
+
+        for( int b = 0; b < 8; b++ )
+            x |= ( ( w[b][g / 8] >> (8 * (g % 8)) ) & 0xff ) << (8 * b);
+        x = bs_Transpose8( x );
+        for( int l = 0; l < 8 && 8 * g + l < i_lanes; l++ )
+            bytes[8*g+l][i_offset] = x >> (8 * l);
+    }
+}
+
+/* Runs the stream cypher of up to BS_LANES packets, initialised with their
+ * own 8 bytes iv and their key of parity odd, and stores i_blocks blocks of
+ * output for each of them in c->bs_stream. */
+static void csa_StreamCypherBatch( csa_t *c, uint8_t *const *iv,
+                                   const bool *odd, int i_lanes,
+                                   int i_blocks )
+{
+    struct csa_bs_state s;
+    bs_t odd_mask;
+    uint64_t w[BS_WORDS] = { 0 };
+
+    assert( i_lanes <= BS_LANES && i_blocks <= 184 / 8 );
+
+    for( int l = 0; l < i_lanes; l++ )
+        if( odd[l] )
+            w[l / 64] |= UINT64_C(1) << (l % 64);
+    memcpy( &odd_mask, w, sizeof( odd_mask ) );
+
+    /* load first 32 bits of CK into A[1]..A[8]
+     * load last  32 bits of CK into B[1]..B[8]
+     * all other regs = 0 */
+    memset( &s, 0, sizeof( s ) );
+    for( int i = 0; i < 8; i++ )
+    {
+        const int shift = ( i & 1 ) ? 0 : 4;
+
+        for( int k = 0; k < 4; k++ )
+        {
+            const int bit = shift + k;
+            const bs_t o_a = ( c->o_ck[i/2] >> bit ) & 1 ? BS_ONES : BS_ZERO;
+            const bs_t e_a = ( c->e_ck[i/2] >> bit ) & 1 ? BS_ONES : BS_ZERO;
+            const bs_t o_b = ( c->o_ck[4+i/2] >> bit ) & 1 ? BS_ONES : BS_ZERO;
+            const bs_t e_b = ( c->e_ck[4+i/2] >> bit ) & 1 ? BS_ONES : BS_ZERO;
+
+            s.A[1+i][k] = ( o_a & odd_mask ) | ( e_a & ~odd_mask );
+            s.B[1+i][k] = ( o_b & odd_mask ) | ( e_b & ~odd_mask );
+        }
+    }
+
+    /* initialisation with the first 8 bytes of the payload */
+    for( int i = 0; i < 8; i++ )
+    {
+        bs_t in[8], o1, o0;
+
+        bs_Slice( in, iv, i_lanes, i );
+        for( int j = 0; j < 4; j++ )
+        {
+            /* in1 is the high nibble, in2 the low one */
+            const bs_t *in1 = &in[4], *in2 = &in[0];
+
+            bs_StreamStep( &s, ( j % 2 ) ? in2 : in1, ( j % 2 ) ? in1 : in2,
+                           &o1, &o0 );
+        }
+    }
+
+    /* generation, 4 iterations per output byte */
+    for( int i = 0; i < 8 * i_blocks; i++ )
+    {
+        bs_t out[8];
+
+        for( int j = 0; j < 4; j++ )
+            bs_StreamStep( &s, NULL, NULL, &out[7 - 2*j], &out[6 - 2*j] );
+        bs_Unslice( out, c->bs_stream, i_lanes, i );
+    }
+}
+
 // block - sbox
 static const uint8_t block_sbox[256] =
 {
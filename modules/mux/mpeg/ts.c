@@ -163,6 +163,15 @@ static const char *const ts_standards_list_text[] =
   "stream, compared to the PCRs. This allows for some buffering inside " \
   "the client decoder.")
 
+#define MUXRATE_TEXT N_("Mux rate (bits/s)")
+#define MUXRATE_LONGTEXT N_("Output a constant bitrate stream, padded with " \
+  "null packets, where each packet is dated with its exact departure time. " \
+  "0 keeps the variable bitrate.")
+
+#define DATAGRAM_TEXT N_("Packets per output block")
+#define DATAGRAM_LONGTEXT N_("Number of TS packets gathered in each block " \
+  "sent to the access output. 7 matches the usual 1316 bytes UDP payload.")
+
 #define ACRYPT_TEXT N_("Crypt audio")
 #define ACRYPT_LONGTEXT N_("Crypt audio using CSA")
 #define VCRYPT_TEXT N_("Crypt video")
@@ -227,6 +236,9 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "bmin", 0, BMIN_TEXT, BMIN_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "bmax", 0, BMAX_TEXT, BMAX_LONGTEXT, true)
     add_integer( SOUT_CFG_PREFIX "dts-delay", 400, DTS_TEXT, DTS_LONGTEXT, true)
+    add_integer( SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
+    add_integer_with_range( SOUT_CFG_PREFIX "datagram", 1, 1, 64,
+                            DATAGRAM_TEXT, DATAGRAM_LONGTEXT, true)
 
     add_bool( SOUT_CFG_PREFIX "crypt-audio", true, ACRYPT_TEXT, ACRYPT_LONGTEXT, true)
     add_bool( SOUT_CFG_PREFIX "crypt-video", true, VCRYPT_TEXT, VCRYPT_LONGTEXT, true)
@@ -246,7 +258,7 @@ static const char *const ppsz_sout_options[] = {
     "pid-video", "pid-audio", "pid-spu", "pid-pmt", "tsid",
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
-    "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
+    "dts-delay", "muxrate", "datagram", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
     "muxpmt", "program-pmt", "alignment",
     NULL
 };
@@ -379,6 +391,18 @@ struct sout_mux_sys_t
 
     mtime_t         i_pcr;  /* last PCR emited */
 
+    /* constant bitrate output */
+    int64_t         i_muxrate;      /* bits/s, 0 for variable bitrate */
+    mtime_t         i_cbr_origin;   /* departure time of the first packet */
+    int64_t         i_cbr_packets;  /* packets sent since the origin */
+    block_t         *p_null;        /* null packet, sent over and over */
+
+    bool            b_cbr_resync;   /* flag the next PCR as discontinuous */
+
+    unsigned        i_datagram;     /* TS packets per output block */
+    block_t         *p_datagram;    /* output block being filled */
+    sout_buffer_chain_t packets;    /* sent packets, recycled by TSNew */
+
     csa_t           *csa;
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
@@ -473,6 +497,8 @@ static block_t *FixPES( sout_mux_t *p_mux, block_fifo_t *p_fifo );
 static block_t *Add_ADTS( block_t *, const es_format_t * );
 static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
+static block_t *TSNull  ( void );
+static void TSFlush     ( sout_mux_t *p_mux );
 static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
@@ -733,6 +759,24 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
+    p_sys->i_muxrate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    if( p_sys->i_muxrate < 0 )
+        p_sys->i_muxrate = 0;
+    p_sys->i_cbr_origin = VLC_TS_INVALID;
+    p_sys->i_cbr_packets = 0;
+    p_sys->b_cbr_resync = false;
+    p_sys->p_null = NULL;
+    p_sys->i_datagram = var_GetInteger( p_mux, SOUT_CFG_PREFIX "datagram" );
+    p_sys->p_datagram = NULL;
+    BufferChainInit( &p_sys->packets );
+    if( p_sys->i_muxrate )
+    {
+        msg_Dbg( p_mux, "constant bitrate of %"PRId64" bits/s", p_sys->i_muxrate );
+        p_sys->p_null = TSNull();
+        if( unlikely(p_sys->p_null == NULL) )
+            p_sys->i_muxrate = 0;
+    }
+
     p_mux->p_sys        = p_sys;
 
     p_sys->csa = csaSetup(p_this);
@@ -771,6 +815,10 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    TSFlush( p_mux );
+    BufferChainClean( &p_sys->packets );
+    if( p_sys->p_null )
+        block_Release( p_sys->p_null );
     free( p_sys );
 }
 
@@ -1670,6 +1718,158 @@ static block_t *Add_ADTS( block_t *p_data, const es_format_t *p_fmt )
     return p_new_block;
 }
 
+#define TS_PACKET_BITS (188 * 8)
+
+/* Departure time of the next packet at the constant mux rate */
+static mtime_t TSCbrClock( const sout_mux_sys_t *p_sys )
+{
+    return p_sys->i_cbr_origin + p_sys->i_cbr_packets *
+           TS_PACKET_BITS * CLOCK_FREQ / p_sys->i_muxrate;
+}
+
+static mtime_t TSCbrNext( sout_mux_sys_t *p_sys )
+{
+    mtime_t i_dts = TSCbrClock( p_sys );
+
+    /* move the origin forward exactly, to keep the product in range */
+    if( ++p_sys->i_cbr_packets == p_sys->i_muxrate )
+    {
+        p_sys->i_cbr_origin += TS_PACKET_BITS * CLOCK_FREQ;
+        p_sys->i_cbr_packets = 0;
+    }
+    return i_dts;
+}
+
+/* Number of packets the mux rate allows to send until i_end */
+static int TSCbrSlots( const sout_mux_sys_t *p_sys, mtime_t i_end )
+{
+    if( i_end <= p_sys->i_cbr_origin )
+        return 0;
+
+    int64_t i_slots = (i_end - p_sys->i_cbr_origin) * p_sys->i_muxrate /
+                      (TS_PACKET_BITS * CLOCK_FREQ) - p_sys->i_cbr_packets;
+    return __MIN( __MAX( i_slots, 0 ), INT_MAX );
+}
+
+static void TSNullWrite( uint8_t *p )
+{
+    p[0] = 0x47;
+    p[1] = 0x1f; /* PID 0x1fff */
+    p[2] = 0xff;
+    p[3] = 0x10; /* payload only */
+    memset( &p[4], 0xff, 184 );
+}
+
+static block_t *TSNull( void )
+{
+    block_t *p_ts = block_Alloc( 188 );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    TSNullWrite( p_ts->p_buffer );
+    return p_ts;
+}
+
+/* Packets gathered in datagrams are copied out, keep them for TSNew rather
+ * than going through the allocator for every one of them */
+#define TS_PACKET_POOL 4096
+
+static block_t *TSPacket( sout_mux_sys_t *p_sys )
+{
+    block_t *p_ts = BufferChainGet( &p_sys->packets );
+    if( p_ts == NULL )
+        return block_Alloc( 188 );
+
+    p_ts->i_flags  = 0;
+    p_ts->i_pts    = VLC_TS_INVALID;
+    p_ts->i_dts    = VLC_TS_INVALID;
+    p_ts->i_length = 0;
+    return p_ts;
+}
+
+static void TSRecycle( sout_mux_sys_t *p_sys, block_t *p_ts )
+{
+    if( p_ts->i_buffer == 188 && p_sys->packets.i_depth < TS_PACKET_POOL )
+        BufferChainAppend( &p_sys->packets, p_ts );
+    else
+        block_Release( p_ts );
+}
+
+static void TSFlush( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->p_datagram )
+    {
+        sout_AccessOutWrite( p_mux->p_access, p_sys->p_datagram );
+        p_sys->p_datagram = NULL;
+    }
+}
+
+/* A partial datagram is held for the next packets only while they are due
+ * close enough to its departure time, so that pacing is not delayed */
+static bool TSDatagramLate( const sout_mux_sys_t *p_sys, mtime_t i_dts )
+{
+    return p_sys->p_datagram != NULL &&
+           i_dts - p_sys->p_datagram->i_dts > p_sys->i_shaping_delay / 2;
+}
+
+/* Sends a dated TS packet. Packets are gathered by i_datagram in a single
+ * contiguous block, which the access output can send as is. */
+static void TSOutput( sout_mux_t *p_mux, block_t *p_ts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    if( p_sys->i_datagram <= 1 )
+    {
+        /* the access output takes ownership: send a copy of the null packet */
+        if( p_ts == p_sys->p_null )
+            p_ts = block_Duplicate( p_ts );
+        if( likely(p_ts != NULL) )
+            sout_AccessOutWrite( p_mux->p_access, p_ts );
+        return;
+    }
+
+    block_t *p_dgram = p_sys->p_datagram;
+
+    /* segmenters cut the stream before header packets */
+    if( p_dgram && ((p_ts->i_flags & BLOCK_FLAG_HEADER)
+                 || TSDatagramLate( p_sys, p_ts->i_dts )) )
+    {
+        TSFlush( p_mux );
+        p_dgram = NULL;
+    }
+
+    if( p_dgram == NULL )
+    {
+        p_dgram = block_Alloc( p_sys->i_datagram * 188 );
+        if( unlikely(p_dgram == NULL) )
+        {
+            if( p_ts != p_sys->p_null )
+                TSRecycle( p_sys, p_ts );
+            return;
+        }
+        p_dgram->i_buffer = 0;
+        p_dgram->i_dts = p_ts->i_dts;
+        p_dgram->i_length = 0;
+        p_sys->p_datagram = p_dgram;
+    }
+
+    uint8_t *p = &p_dgram->p_buffer[p_dgram->i_buffer];
+    if( p_ts == p_sys->p_null )
+        TSNullWrite( p );
+    else
+        memcpy( p, p_ts->p_buffer, 188 );
+    p_dgram->i_buffer += 188;
+    p_dgram->i_length += p_ts->i_length;
+    p_dgram->i_flags |= p_ts->i_flags & (BLOCK_FLAG_CLOCK | BLOCK_FLAG_HEADER);
+    if( p_ts != p_sys->p_null )
+        TSRecycle( p_sys, p_ts );
+
+    if( p_dgram->i_buffer == p_sys->i_datagram * 188 )
+        TSFlush( p_mux );
+}
+
 static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                         mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1751,38 +1951,119 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    /* Scramble the packets by batches, the stream cypher of a whole batch is
+     * run at once. The adaptation field carrying the PCR is left clear. */
+    if( p_sys->csa )
+    {
+        uint8_t *pp_pkts[CSA_BATCH];
+        int i_pkts = 0;
+
+        vlc_mutex_lock( &p_sys->csa_lock );
+        for( block_t *p_ts = p_chain_ts->p_first; p_ts; p_ts = p_ts->p_next )
+        {
+            if( !(p_ts->i_flags & BLOCK_FLAG_SCRAMBLED) )
+                continue;
+            pp_pkts[i_pkts++] = p_ts->p_buffer;
+            if( i_pkts == CSA_BATCH )
+            {
+                csa_EncryptBatch( p_sys->csa, pp_pkts, i_pkts, p_sys->i_csa_pkt_size );
+                i_pkts = 0;
+            }
+        }
+        if( i_pkts > 0 )
+            csa_EncryptBatch( p_sys->csa, pp_pkts, i_pkts, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
+    /* At constant bitrate, the slice gets as many packet slots as the mux
+     * rate allows until its end, the free ones are padded with nulls */
+    int i_slots = i_packet_count;
+    if( p_sys->i_muxrate )
+    {
+        /* Follow the input after a discontinuity or a gap, rather than
+         * filling it with nulls, and catch up after an overrun. */
+        if( p_sys->i_cbr_origin != VLC_TS_INVALID )
+        {
+            mtime_t i_drift = i_pcr_dts - TSCbrClock( p_sys );
+            if( i_drift > p_sys->i_shaping_delay
+             || i_drift < -p_sys->i_shaping_delay )
+            {
+                msg_Dbg( p_mux, "resyncing the mux rate clock (%"PRId64" us)",
+                         i_drift );
+                p_sys->i_cbr_origin = VLC_TS_INVALID;
+                /* the PCR jumps along */
+                p_sys->b_cbr_resync = true;
+            }
+        }
+        if( p_sys->i_cbr_origin == VLC_TS_INVALID )
+        {
+            p_sys->i_cbr_origin = i_pcr_dts;
+            p_sys->i_cbr_packets = 0;
+        }
+        i_slots = TSCbrSlots( p_sys, i_pcr_dts + i_pcr_length );
+        if( i_slots < i_packet_count )
+        {
+            msg_Warn( p_mux, "mux rate exceeded (%d packets for %d slots)",
+                      i_packet_count, __MAX( i_slots, 0 ) );
+            i_slots = i_packet_count;
+        }
+    }
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
-    for (int i = 0; i < i_packet_count; i++ )
+    for (int i = 0, j = 0; j < i_slots; j++ )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
-        mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
+        block_t *p_ts;
+
+        /* spread the null packets evenly between the real ones */
+        if( i < i_packet_count &&
+            (int64_t)i * i_slots <= (int64_t)j * i_packet_count )
+        {
+            p_ts = BufferChainGet( p_chain_ts );
+            i++;
+        }
+        else
+            p_ts = p_sys->p_null;
 
-        p_ts->i_dts    = i_new_dts;
-        p_ts->i_length = i_pcr_length / i_packet_count;
+        if( p_sys->i_muxrate )
+        {
+            mtime_t i_new_dts = TSCbrNext( p_sys );
+            if( unlikely(p_ts == NULL) )
+                continue;
+            p_ts->i_dts    = i_new_dts;
+            p_ts->i_length = TS_PACKET_BITS * CLOCK_FREQ / p_sys->i_muxrate;
+        }
+        else
+        {
+            p_ts->i_dts    = i_pcr_dts + i_pcr_length * j / i_packet_count;
+            p_ts->i_length = i_pcr_length / i_packet_count;
+        }
 
         if( p_ts->i_flags & BLOCK_FLAG_CLOCK )
         {
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
-        }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            if( p_sys->b_cbr_resync )
+            {
+                p_ts->p_buffer[5] |= 0x80; /* discontinuity_indicator */
+                p_sys->b_cbr_resync = false;
+            }
         }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        TSOutput( p_mux, p_ts );
     }
+
+    /* complete the datagram with the next slice, unless it would leave late */
+    if( TSDatagramLate( p_sys, i_pcr_dts + i_pcr_length +
+                               p_sys->i_shaping_delay * 3 / 2 ) )
+        TSFlush( p_mux );
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
                        bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1802,7 +2083,7 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
+    block_t *p_ts = TSPacket( p_mux->p_sys );
 
     if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
     {
@@ -413,7 +413,15 @@ static int Open(vlc_object_t *obj)
      * support for title/seekpoint and meta control requests. */
     vlc_stream_Control(stream->p_source, STREAM_CAN_FASTSEEK, &fast_seek);
     if (fast_seek)
+    {   /* Let the access read ahead by itself, if it can */
+        uint64_t bytes = var_InheritInteger(obj, "prefetch-readahead") << 10u;
+        int64_t duration = var_InheritInteger(obj, "prefetch-readahead-time")
+                         * INT64_C(1000);
+
+        vlc_stream_Control(stream->p_source, STREAM_SET_READAHEAD, bytes,
+                           duration);
         return VLC_EGENERIC;
+    }
 
     /* PID-filtered streams are not suitable for prefetching, as they would
      * suffer excessive latency to enable a PID. DVB would also require support
@@ -540,4 +548,14 @@ vlc_module_begin()
     add_integer("prefetch-seek-threshold", 1 << 14, N_("Seek threshold"),
                 N_("Prefetch forward seek threshold (bytes)"), true)
         change_integer_range(0, UINT64_C(1) << 60)
+    add_integer("prefetch-readahead", 1 << 10, N_("Read-ahead size"),
+                N_("Data read ahead by accesses that can prefetch by "
+                   "themselves, such as asynchronous file reading (KiB)"),
+                true)
+        change_integer_range(0, 1 << 20)
+    add_integer("prefetch-readahead-time", 0, N_("Read-ahead duration"),
+                N_("Duration of data read ahead by accesses that can "
+                   "prefetch by themselves, estimated from the read "
+                   "rate (ms)"), true)
+        change_integer_range(0, 60000)
 vlc_module_end()
@@ -80,6 +80,14 @@
 #define VFILTER_LONGTEXT N_( \
     "Video filters will be applied to the video streams (after overlays " \
     "are applied). You can enter a colon-separated list of filters." )
+#define LADDER_TEXT N_("Video renditions")
+#define LADDER_LONGTEXT N_( \
+    "Comma-separated list of renditions encoded from the same decoded " \
+    "video, as WIDTHxHEIGHT@BITRATE (eg: 1280x720@3000,640x360@800). A null " \
+    "dimension keeps the aspect ratio and the bitrate defaults to the video " \
+    "bitrate. Each rendition is scaled and encoded by its own thread, with " \
+    "the same encoder settings, and uses the ES id of the source plus 1000 " \
+    "times its index." )
 
 #define AENC_TEXT N_("Audio encoder")
 #define AENC_LONGTEXT N_( \
@@ -182,6 +190,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list( SOUT_CFG_PREFIX "vfilter", "video filter",
                      NULL, VFILTER_TEXT, VFILTER_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "ladder", NULL, LADDER_TEXT,
+                LADDER_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module( SOUT_CFG_PREFIX "aenc", "encoder", NULL, AENC_TEXT,
@@ -232,7 +242,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "osd", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "ladder", NULL
 };
 
 /*****************************************************************************
@@ -242,6 +252,95 @@ static sout_stream_id_sys_t *Add( sout_stream_t *, const es_format_t * );
 static void              Del ( sout_stream_t *, sout_stream_id_sys_t * );
 static int               Send( sout_stream_t *, sout_stream_id_sys_t *, block_t* );
 
+/*****************************************************************************
+ * LadderAlignGOP: keep the keyframes of the video renditions on the same
+ * pictures
+ *****************************************************************************
+ * The renditions share the encoder options, hence the GOP size. x264 also
+ * inserts keyframes on scene changes, which it detects differently at each
+ * size and bitrate: turn that off.
+ *****************************************************************************/
+static void LadderAlignGOP( sout_stream_t *p_stream, sout_stream_sys_t *p_sys )
+{
+    if( p_sys->psz_venc ? strncmp( p_sys->psz_venc, "x264", 4 )
+                        : p_sys->i_vcodec != VLC_CODEC_H264 )
+        return;
+
+    config_chain_t **pp_cfg = &p_sys->p_video_cfg;
+    while( *pp_cfg != NULL && strcmp( (*pp_cfg)->psz_name, "scenecut" ) )
+        pp_cfg = &(*pp_cfg)->p_next;
+
+    config_chain_t *p_cfg = *pp_cfg;
+    if( p_cfg == NULL )
+    {
+        p_cfg = calloc( 1, sizeof( *p_cfg ) );
+        if( !p_cfg || !( p_cfg->psz_name = strdup( "scenecut" ) ) )
+        {
+            free( p_cfg );
+            return;
+        }
+        *pp_cfg = p_cfg;
+    }
+    else if( p_cfg->psz_value && !strcmp( p_cfg->psz_value, "0" ) )
+        return;
+    else
+        msg_Warn( p_stream, "disabling scene cuts of the video renditions" );
+
+    free( p_cfg->psz_value );
+    p_cfg->psz_value = strdup( "0" );
+}
+
+/*****************************************************************************
+ * ParseLadder: parse the list of video renditions
+ *****************************************************************************/
+static void ParseLadder( sout_stream_t *p_stream, sout_stream_sys_t *p_sys,
+                         const char *psz_ladder )
+{
+    char *psz_dup = strdup( psz_ladder );
+    char *psz_save;
+
+    if( !psz_dup )
+        return;
+
+    for( char *psz_rung = strtok_r( psz_dup, ",", &psz_save );
+         psz_rung != NULL;
+         psz_rung = strtok_r( NULL, ",", &psz_save ) )
+    {
+        unsigned int i_width, i_height;
+        int i_bitrate = 0;
+
+        if( sscanf( psz_rung, "%ux%u@%d", &i_width, &i_height,
+                    &i_bitrate ) < 2 )
+        {
+            msg_Warn( p_stream, "ignoring invalid video rendition `%s'",
+                      psz_rung );
+            continue;
+        }
+
+        if( i_bitrate <= 0 )
+            i_bitrate = p_sys->i_vbitrate;
+        else if( i_bitrate < 16000 )
+            i_bitrate *= 1000;
+
+        void *p_ladder = realloc( p_sys->p_ladder, ( p_sys->i_ladder + 1 ) *
+                                  sizeof( *p_sys->p_ladder ) );
+        if( !p_ladder )
+            break;
+        p_sys->p_ladder = p_ladder;
+        p_sys->p_ladder[p_sys->i_ladder].i_width = i_width;
+        p_sys->p_ladder[p_sys->i_ladder].i_height = i_height;
+        p_sys->p_ladder[p_sys->i_ladder].i_bitrate = i_bitrate;
+        p_sys->i_ladder++;
+
+        msg_Dbg( p_stream, "video rendition %ux%u %dkb/s",
+                 i_width, i_height, i_bitrate / 1000 );
+    }
+    free( psz_dup );
+
+    if( p_sys->i_ladder )
+        LadderAlignGOP( p_stream, p_sys );
+}
+
 /*****************************************************************************
  * Open:
  *****************************************************************************/
@@ -377,6 +476,14 @@ static int Open( vlc_object_t *p_this )
     p_sys->pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
     p_sys->b_high_priority = var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" );
 
+    psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "ladder" );
+    p_sys->p_ladder = NULL;
+    p_sys->i_ladder = 0;
+    TAB_INIT( p_sys->i_es_ids, p_sys->pi_es_ids );
+    if( psz_string && *psz_string )
+        ParseLadder( p_stream, p_sys, psz_string );
+    free( psz_string );
+
     if( p_sys->i_vcodec )
     {
         msg_Dbg( p_stream, "codec video=%4.4s %dx%d scaling: %f %dkb/s",
@@ -480,6 +587,8 @@ static void Close( vlc_object_t * p_this )
     free( p_sys->psz_alang );
 
     free( p_sys->psz_vf2 );
+    free( p_sys->p_ladder );
+    TAB_CLEAN( p_sys->i_es_ids, p_sys->pi_es_ids );
 
     config_ChainDestroy( p_sys->p_video_cfg );
     free( p_sys->psz_venc );
@@ -499,6 +608,36 @@ static void Close( vlc_object_t * p_this )
     free( p_sys );
 }
 
+/*****************************************************************************
+ * transcode_es_id_new: number an additional output ES
+ *****************************************************************************
+ * Returns the first ES id after i_id which is not in use. ES ids may become
+ * TS PIDs: they stay below the null packet PID.
+ *****************************************************************************/
+int transcode_es_id_new( sout_stream_t *p_stream, int i_id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    int i_index;
+
+    do
+    {
+        if( ++i_id >= 0x1fff )
+            i_id = 0x20;
+        TAB_FIND( p_sys->i_es_ids, p_sys->pi_es_ids, i_id, i_index );
+    }
+    while( i_index >= 0 );
+
+    TAB_APPEND( p_sys->i_es_ids, p_sys->pi_es_ids, i_id );
+    return i_id;
+}
+
+void transcode_es_id_del( sout_stream_t *p_stream, int i_id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    TAB_REMOVE( p_sys->i_es_ids, p_sys->pi_es_ids, i_id );
+}
+
 static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
                                   const es_format_t *p_fmt )
 {
@@ -562,6 +701,7 @@ static sout_stream_id_sys_t *Add( sout_stream_t *p_stream,
     if(!success)
         goto error;
 
+    TAB_APPEND( p_sys->i_es_ids, p_sys->pi_es_ids, p_fmt->i_id );
     return id;
 
 error:
@@ -615,6 +755,7 @@ static void Del( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 
     if( id->p_decoder )
     {
+        transcode_es_id_del( p_stream, id->p_decoder->fmt_in.i_id );
         vlc_object_release( id->p_decoder );
         id->p_decoder = NULL;
     }
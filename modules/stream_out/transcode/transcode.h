@@ -54,6 +54,17 @@ struct sout_stream_sys_t
 
     char            *psz_vf2;
 
+    /* Video renditions encoded from the same decoded pictures */
+    struct
+    {
+        unsigned int i_width, i_height;
+        int          i_bitrate;
+    }               *p_ladder;
+    unsigned int    i_ladder;
+    /* ES ids in use downstream, to number the renditions */
+    int             i_es_ids;
+    int             *pi_es_ids;
+
     /* SPU */
     vlc_fourcc_t    i_scodec;   /* codec spu (0 if not transcode) */
     char            *psz_senc;
@@ -75,6 +86,7 @@ struct sout_stream_sys_t
 };
 
 struct aout_filters;
+struct transcode_rung;
 
 struct sout_stream_id_sys_t
 {
@@ -113,6 +125,9 @@ struct sout_stream_id_sys_t
              filter_chain_t  *p_f_chain; /**< Video filters */
              filter_chain_t  *p_uf_chain; /**< User-specified video filters */
              video_format_t  fmt_input_video;
+             struct transcode_rung *p_rungs; /**< Video renditions */
+             unsigned        i_rungs;
+             bool            b_unaligned; /**< Renditions GOPs differ */
          };
          struct
          {
@@ -131,6 +146,9 @@ struct sout_stream_id_sys_t
 
 };
 
+int  transcode_es_id_new( sout_stream_t *, int );
+void transcode_es_id_del( sout_stream_t *, int );
+
 /* OSD */
 
 int transcode_osd_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id );
@@ -82,12 +82,6 @@ static picture_t *video_new_buffer_decoder( decoder_t *p_dec )
     return picture_NewFromFormat( &p_dec->fmt_out.video );
 }
 
-static picture_t *video_new_buffer_encoder( encoder_t *p_enc )
-{
-    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
-    return picture_NewFromFormat( &p_enc->fmt_in.video );
-}
-
 static picture_t *transcode_video_filter_buffer_new( filter_t *p_filter )
 {
     p_filter->fmt_out.video.i_chroma = p_filter->fmt_out.i_codec;
@@ -148,6 +142,158 @@ static void* EncoderThread( void *obj )
     return NULL;
 }
 
+/* Number of keyframe dates kept per rendition to check the GOP alignment */
+#define LADDER_KEYS 16
+
+struct transcode_rung
+{
+    sout_stream_t  *p_stream;
+    encoder_t      *p_encoder;
+    filter_chain_t *p_conv_chain; /**< Scaling and chroma conversion */
+    video_format_t  fmt_conv;     /**< Input format of p_conv_chain */
+    void           *id;           /**< id of the out stream */
+    int             i_es_id;      /**< ES id numbered for it, or -1 */
+
+    /* Encoder thread */
+    vlc_thread_t    thread;
+    vlc_mutex_t     lock;
+    vlc_cond_t      cond;
+    vlc_sem_t       has_room;
+    picture_t     **pp_pics;      /**< Ring of pool_size pictures, which are
+                                       shared by all the renditions */
+    unsigned        i_first;
+    unsigned        i_pics;
+    block_t        *p_buffers;
+    bool            b_abort;
+
+    /* Dates of the last keyframes output */
+    mtime_t         keys[LADDER_KEYS];
+    unsigned        i_keys;
+};
+
+/* Converts a picture of the shared filter chains to the rendition format.
+ * The conversion chain is owned by the rendition thread, and rebuilt if the
+ * pictures format changes. */
+static picture_t *RungConvert( struct transcode_rung *p_rung, picture_t *p_pic )
+{
+    sout_stream_t *p_stream = p_rung->p_stream;
+    encoder_t *p_enc = p_rung->p_encoder;
+
+    if( !video_format_IsSimilar( &p_rung->fmt_conv, &p_pic->format ) )
+    {
+        filter_owner_t owner = {
+            .sys = p_stream->p_sys,
+            .video = {
+                .buffer_new = transcode_video_filter_buffer_new,
+            },
+        };
+        es_format_t fmt;
+
+        if( p_rung->p_conv_chain )
+            filter_chain_Delete( p_rung->p_conv_chain );
+
+        p_rung->fmt_conv = p_pic->format;
+        es_format_Init( &fmt, VIDEO_ES, p_pic->format.i_chroma );
+        fmt.video = p_pic->format;
+        if( !fmt.video.i_visible_width || !fmt.video.i_visible_height )
+        {
+            fmt.video.i_visible_width = fmt.video.i_width;
+            fmt.video.i_visible_height = fmt.video.i_height;
+        }
+
+        p_rung->p_conv_chain = filter_chain_NewVideo( p_stream, false, &owner );
+        if( p_rung->p_conv_chain )
+        {
+            filter_chain_Reset( p_rung->p_conv_chain, &fmt, &p_enc->fmt_in );
+            if( ( fmt.video.i_chroma != p_enc->fmt_in.video.i_chroma ||
+                  fmt.video.i_width != p_enc->fmt_in.video.i_width ||
+                  fmt.video.i_height != p_enc->fmt_in.video.i_height ) &&
+                filter_chain_AppendConverter( p_rung->p_conv_chain, &fmt,
+                                              &p_enc->fmt_in ) )
+            {
+                msg_Err( p_stream, "cannot convert %4.4s %ux%u pictures to "
+                         "%4.4s %ux%u", (char *)&fmt.video.i_chroma,
+                         fmt.video.i_width, fmt.video.i_height,
+                         (char *)&p_enc->fmt_in.video.i_chroma,
+                         p_enc->fmt_in.video.i_width,
+                         p_enc->fmt_in.video.i_height );
+                filter_chain_Delete( p_rung->p_conv_chain );
+                p_rung->p_conv_chain = NULL;
+            }
+        }
+    }
+
+    if( !p_rung->p_conv_chain )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+    return filter_chain_VideoFilter( p_rung->p_conv_chain, p_pic );
+}
+
+static void* RungThread( void *obj )
+{
+    struct transcode_rung *p_rung = obj;
+    encoder_t *p_enc = p_rung->p_encoder;
+    int canc = vlc_savecancel ();
+    block_t *p_block;
+
+    vlc_mutex_lock( &p_rung->lock );
+
+    for( ;; )
+    {
+        while( !p_rung->b_abort && p_rung->i_pics == 0 )
+            vlc_cond_wait( &p_rung->cond, &p_rung->lock );
+
+        /* Encode what we have in the buffer on closing */
+        if( p_rung->i_pics == 0 )
+            break;
+
+        picture_t *p_pic = p_rung->pp_pics[p_rung->i_first];
+        p_rung->i_first = ( p_rung->i_first + 1 ) %
+                          p_rung->p_stream->p_sys->pool_size;
+        p_rung->i_pics--;
+        vlc_sem_post( &p_rung->has_room );
+
+        /* release lock while scaling and encoding */
+        vlc_mutex_unlock( &p_rung->lock );
+        p_pic = RungConvert( p_rung, p_pic );
+        p_block = NULL;
+        if( p_pic )
+        {
+            p_block = p_enc->pf_encode_video( p_enc, p_pic );
+            picture_Release( p_pic );
+        }
+        vlc_mutex_lock( &p_rung->lock );
+
+        block_ChainAppend( &p_rung->p_buffers, p_block );
+    }
+
+    /*Now flush encoder*/
+    do {
+        p_block = p_enc->pf_encode_video( p_enc, NULL );
+        block_ChainAppend( &p_rung->p_buffers, p_block );
+    } while( p_block );
+
+    vlc_mutex_unlock( &p_rung->lock );
+
+    vlc_restorecancel (canc);
+
+    return NULL;
+}
+
+static void RungPush( struct transcode_rung *p_rung, picture_t *p_pic )
+{
+    unsigned i_size = p_rung->p_stream->p_sys->pool_size;
+
+    vlc_sem_wait( &p_rung->has_room );
+    vlc_mutex_lock( &p_rung->lock );
+    p_rung->pp_pics[( p_rung->i_first + p_rung->i_pics ) % i_size] = p_pic;
+    p_rung->i_pics++;
+    vlc_cond_signal( &p_rung->cond );
+    vlc_mutex_unlock( &p_rung->lock );
+}
+
 static int decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
 {
     sout_stream_id_sys_t *id = p_dec->p_queue_ctx;
@@ -267,7 +413,8 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
     }
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads <= 0 )
+    /* The renditions have their own encoder threads */
+    if( p_sys->i_threads <= 0 || id->i_rungs )
         return VLC_SUCCESS;
 
     int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
@@ -395,49 +542,49 @@ static void conversion_video_filter_append( sout_stream_id_sys_t *id )
 }
 
 static void transcode_video_framerate_init( sout_stream_t *p_stream,
-                                            sout_stream_id_sys_t *id,
+                                            encoder_t *p_enc,
                                             const es_format_t *p_fmt_out )
 {
     /* Handle frame rate conversion */
-    if( !id->p_encoder->fmt_out.video.i_frame_rate ||
-        !id->p_encoder->fmt_out.video.i_frame_rate_base )
+    if( !p_enc->fmt_out.video.i_frame_rate ||
+        !p_enc->fmt_out.video.i_frame_rate_base )
     {
         if( p_fmt_out->video.i_frame_rate &&
             p_fmt_out->video.i_frame_rate_base )
         {
-            id->p_encoder->fmt_out.video.i_frame_rate =
+            p_enc->fmt_out.video.i_frame_rate =
                 p_fmt_out->video.i_frame_rate;
-            id->p_encoder->fmt_out.video.i_frame_rate_base =
+            p_enc->fmt_out.video.i_frame_rate_base =
                 p_fmt_out->video.i_frame_rate_base;
         }
         else
         {
             /* Pick a sensible default value */
-            id->p_encoder->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
-            id->p_encoder->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
+            p_enc->fmt_out.video.i_frame_rate = ENC_FRAMERATE;
+            p_enc->fmt_out.video.i_frame_rate_base = ENC_FRAMERATE_BASE;
         }
     }
 
-    id->p_encoder->fmt_in.video.i_frame_rate =
-        id->p_encoder->fmt_out.video.i_frame_rate;
-    id->p_encoder->fmt_in.video.i_frame_rate_base =
-        id->p_encoder->fmt_out.video.i_frame_rate_base;
+    p_enc->fmt_in.video.i_frame_rate =
+        p_enc->fmt_out.video.i_frame_rate;
+    p_enc->fmt_in.video.i_frame_rate_base =
+        p_enc->fmt_out.video.i_frame_rate_base;
 
-    vlc_ureduce( &id->p_encoder->fmt_in.video.i_frame_rate,
-        &id->p_encoder->fmt_in.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base,
+    vlc_ureduce( &p_enc->fmt_in.video.i_frame_rate,
+        &p_enc->fmt_in.video.i_frame_rate_base,
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base,
         0 );
      msg_Dbg( p_stream, "source fps %u/%u, destination %u/%u",
-        id->p_decoder->fmt_out.video.i_frame_rate,
-        id->p_decoder->fmt_out.video.i_frame_rate_base,
-        id->p_encoder->fmt_in.video.i_frame_rate,
-        id->p_encoder->fmt_in.video.i_frame_rate_base );
+        p_fmt_out->video.i_frame_rate,
+        p_fmt_out->video.i_frame_rate_base,
+        p_enc->fmt_in.video.i_frame_rate,
+        p_enc->fmt_in.video.i_frame_rate_base );
 
 }
 
 static void transcode_video_size_init( sout_stream_t *p_stream,
-                                     sout_stream_id_sys_t *id,
+                                     encoder_t *p_enc,
                                      const es_format_t *p_fmt_out )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -470,8 +617,8 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
     msg_Dbg( p_stream, "source pixel aspect is %f:1", f_aspect );
 
     /* Calculate scaling factor for specified parameters */
-    if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-        id->p_encoder->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
+    if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+        p_enc->fmt_out.video.i_visible_height <= 0 && p_sys->f_scale )
     {
         /* Global scaling. Make sure width will remain a factor of 16 */
         float f_real_scale;
@@ -490,26 +637,26 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
         f_scale_width = f_real_scale;
         f_scale_height = (float) i_new_height / (float) i_src_visible_height;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height <= 0 )
+    else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+             p_enc->fmt_out.video.i_visible_height <= 0 )
     {
         /* Only width specified */
-        f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
+        f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
         f_scale_height = f_scale_width;
     }
-    else if( id->p_encoder->fmt_out.video.i_visible_width <= 0 &&
-             id->p_encoder->fmt_out.video.i_visible_height > 0 )
+    else if( p_enc->fmt_out.video.i_visible_width <= 0 &&
+             p_enc->fmt_out.video.i_visible_height > 0 )
     {
          /* Only height specified */
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
          f_scale_width = f_scale_height;
      }
-     else if( id->p_encoder->fmt_out.video.i_visible_width > 0 &&
-              id->p_encoder->fmt_out.video.i_visible_height > 0 )
+     else if( p_enc->fmt_out.video.i_visible_width > 0 &&
+              p_enc->fmt_out.video.i_visible_height > 0 )
      {
          /* Width and height specified */
-         f_scale_width = (float)id->p_encoder->fmt_out.video.i_visible_width/i_src_visible_width;
-         f_scale_height = (float)id->p_encoder->fmt_out.video.i_visible_height/i_src_visible_height;
+         f_scale_width = (float)p_enc->fmt_out.video.i_visible_width/i_src_visible_width;
+         f_scale_height = (float)p_enc->fmt_out.video.i_visible_height/i_src_visible_height;
      }
 
      /* check maxwidth and maxheight */
@@ -541,15 +688,15 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
      int i_dst_height = 2 * lroundf(f_scale_height*p_fmt_out->video.i_height/2);
 
      /* Store calculated values */
-     id->p_encoder->fmt_out.video.i_width = i_dst_width;
-     id->p_encoder->fmt_out.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_out.video.i_height = i_dst_height;
-     id->p_encoder->fmt_out.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_out.video.i_width = i_dst_width;
+     p_enc->fmt_out.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_out.video.i_height = i_dst_height;
+     p_enc->fmt_out.video.i_visible_height = i_dst_visible_height;
 
-     id->p_encoder->fmt_in.video.i_width = i_dst_width;
-     id->p_encoder->fmt_in.video.i_visible_width = i_dst_visible_width;
-     id->p_encoder->fmt_in.video.i_height = i_dst_height;
-     id->p_encoder->fmt_in.video.i_visible_height = i_dst_visible_height;
+     p_enc->fmt_in.video.i_width = i_dst_width;
+     p_enc->fmt_in.video.i_visible_width = i_dst_visible_width;
+     p_enc->fmt_in.video.i_height = i_dst_height;
+     p_enc->fmt_in.video.i_visible_height = i_dst_visible_height;
 
      msg_Dbg( p_stream, "source %ix%i, destination %ix%i",
          i_src_visible_width, i_src_visible_height,
@@ -558,7 +705,7 @@ static void transcode_video_size_init( sout_stream_t *p_stream,
 };
 
 static void transcode_video_sar_init( sout_stream_t *p_stream,
-                                     sout_stream_id_sys_t *id,
+                                     encoder_t *p_enc,
                                      const es_format_t *p_fmt_out )
 {
     int i_src_visible_width = p_fmt_out->video.i_visible_width;
@@ -570,32 +717,32 @@ static void transcode_video_sar_init( sout_stream_t *p_stream,
         i_src_visible_height = p_fmt_out->video.i_height;
 
     /* Check whether a particular aspect ratio was requested */
-    if( id->p_encoder->fmt_out.video.i_sar_num <= 0 ||
-        id->p_encoder->fmt_out.video.i_sar_den <= 0 )
+    if( p_enc->fmt_out.video.i_sar_num <= 0 ||
+        p_enc->fmt_out.video.i_sar_den <= 0 )
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
-                     (uint64_t)p_fmt_out->video.i_sar_num * id->p_encoder->fmt_out.video.i_width * p_fmt_out->video.i_height,
-                     (uint64_t)p_fmt_out->video.i_sar_den * id->p_encoder->fmt_out.video.i_height * p_fmt_out->video.i_width,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     (uint64_t)p_fmt_out->video.i_sar_num * p_enc->fmt_out.video.i_width * p_fmt_out->video.i_height,
+                     (uint64_t)p_fmt_out->video.i_sar_den * p_enc->fmt_out.video.i_height * p_fmt_out->video.i_width,
                      0 );
     }
     else
     {
-        vlc_ureduce( &id->p_encoder->fmt_out.video.i_sar_num,
-                     &id->p_encoder->fmt_out.video.i_sar_den,
-                     id->p_encoder->fmt_out.video.i_sar_num,
-                     id->p_encoder->fmt_out.video.i_sar_den,
+        vlc_ureduce( &p_enc->fmt_out.video.i_sar_num,
+                     &p_enc->fmt_out.video.i_sar_den,
+                     p_enc->fmt_out.video.i_sar_num,
+                     p_enc->fmt_out.video.i_sar_den,
                      0 );
     }
 
-    id->p_encoder->fmt_in.video.i_sar_num =
-        id->p_encoder->fmt_out.video.i_sar_num;
-    id->p_encoder->fmt_in.video.i_sar_den =
-        id->p_encoder->fmt_out.video.i_sar_den;
+    p_enc->fmt_in.video.i_sar_num =
+        p_enc->fmt_out.video.i_sar_num;
+    p_enc->fmt_in.video.i_sar_den =
+        p_enc->fmt_out.video.i_sar_den;
 
     msg_Dbg( p_stream, "encoder aspect is %i:%i",
-             id->p_encoder->fmt_out.video.i_sar_num * id->p_encoder->fmt_out.video.i_width,
-             id->p_encoder->fmt_out.video.i_sar_den * id->p_encoder->fmt_out.video.i_height );
+             p_enc->fmt_out.video.i_sar_num * p_enc->fmt_out.video.i_width,
+             p_enc->fmt_out.video.i_sar_den * p_enc->fmt_out.video.i_height );
 
 }
 
@@ -614,10 +761,10 @@ static void transcode_video_encoder_init( sout_stream_t *p_stream,
         id->p_encoder->fmt_out.video.orientation =
         id->p_decoder->fmt_in.video.orientation;
 
-    transcode_video_framerate_init( p_stream, id, p_fmt_out );
+    transcode_video_framerate_init( p_stream, id->p_encoder, p_fmt_out );
 
-    transcode_video_size_init( p_stream, id, p_fmt_out );
-    transcode_video_sar_init( p_stream, id, p_fmt_out );
+    transcode_video_size_init( p_stream, id->p_encoder, p_fmt_out );
+    transcode_video_sar_init( p_stream, id->p_encoder, p_fmt_out );
 
 }
 
@@ -657,10 +804,270 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
+static void transcode_rung_close( sout_stream_t *p_stream,
+                                  struct transcode_rung *p_rung )
+{
+    if( p_rung->pp_pics )
+    {
+        if( !p_rung->b_abort )
+        {
+            vlc_mutex_lock( &p_rung->lock );
+            p_rung->b_abort = true;
+            vlc_cond_signal( &p_rung->cond );
+            vlc_mutex_unlock( &p_rung->lock );
+
+            vlc_join( p_rung->thread, NULL );
+        }
+
+        free( p_rung->pp_pics );
+        p_rung->pp_pics = NULL;
+        block_ChainRelease( p_rung->p_buffers );
+        p_rung->p_buffers = NULL;
+        vlc_sem_destroy( &p_rung->has_room );
+        vlc_mutex_destroy( &p_rung->lock );
+        vlc_cond_destroy( &p_rung->cond );
+    }
+
+    if( p_rung->p_conv_chain )
+        filter_chain_Delete( p_rung->p_conv_chain );
+    p_rung->p_conv_chain = NULL;
+
+    if( p_rung->id )
+        sout_StreamIdDel( p_stream->p_next, p_rung->id );
+    p_rung->id = NULL;
+
+    if( p_rung->i_es_id >= 0 )
+        transcode_es_id_del( p_stream, p_rung->i_es_id );
+    p_rung->i_es_id = -1;
+
+    if( p_rung->p_encoder )
+    {
+        if( p_rung->p_encoder->p_module )
+            module_unneed( p_rung->p_encoder, p_rung->p_encoder->p_module );
+        es_format_Clean( &p_rung->p_encoder->fmt_out );
+        vlc_object_release( p_rung->p_encoder );
+        p_rung->p_encoder = NULL;
+    }
+}
+
+static int transcode_rung_open( sout_stream_t *p_stream,
+                                sout_stream_id_sys_t *id, unsigned i_rung,
+                                vlc_fourcc_t i_chroma,
+                                const es_format_t *p_fmt_out )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    struct transcode_rung *p_rung = &id->p_rungs[i_rung];
+    const encoder_t *p_tmpl = id->p_encoder;
+
+    p_rung->p_stream = p_stream;
+    p_rung->i_es_id = -1;
+    p_rung->p_encoder = sout_EncoderCreate( p_stream );
+    if( !p_rung->p_encoder )
+        return VLC_ENOMEM;
+
+    encoder_t *p_enc = p_rung->p_encoder;
+    p_enc->p_module = NULL;
+
+    es_format_Init( &p_enc->fmt_out, VIDEO_ES, p_sys->i_vcodec );
+    /* the first rendition replaces the source ES */
+    p_enc->fmt_out.i_id    = p_tmpl->fmt_out.i_id;
+    if( i_rung > 0 )
+        p_enc->fmt_out.i_id = p_rung->i_es_id =
+            transcode_es_id_new( p_stream, p_tmpl->fmt_out.i_id );
+    p_enc->fmt_out.i_group = p_tmpl->fmt_out.i_group;
+    if( p_tmpl->fmt_out.psz_language )
+        p_enc->fmt_out.psz_language = strdup( p_tmpl->fmt_out.psz_language );
+    p_enc->fmt_out.i_bitrate = p_sys->p_ladder[i_rung].i_bitrate;
+    p_enc->fmt_out.video.i_visible_width = p_sys->p_ladder[i_rung].i_width & ~1;
+    p_enc->fmt_out.video.i_visible_height = p_sys->p_ladder[i_rung].i_height & ~1;
+    p_enc->fmt_out.video.i_frame_rate = p_tmpl->fmt_out.video.i_frame_rate;
+    p_enc->fmt_out.video.i_frame_rate_base =
+        p_tmpl->fmt_out.video.i_frame_rate_base;
+
+    es_format_Init( &p_enc->fmt_in, VIDEO_ES, i_chroma );
+    p_enc->fmt_in.video.i_chroma = i_chroma;
+    p_enc->fmt_in.video.orientation =
+        p_enc->fmt_out.video.orientation =
+        id->p_decoder->fmt_in.video.orientation;
+
+    transcode_video_framerate_init( p_stream, p_enc, p_fmt_out );
+    transcode_video_size_init( p_stream, p_enc, p_fmt_out );
+    transcode_video_sar_init( p_stream, p_enc, p_fmt_out );
+
+    /* Keep colorspace etc info along */
+    p_enc->fmt_in.video.space     = id->p_decoder->fmt_out.video.space;
+    p_enc->fmt_in.video.transfer  = id->p_decoder->fmt_out.video.transfer;
+    p_enc->fmt_in.video.primaries = id->p_decoder->fmt_out.video.primaries;
+    p_enc->fmt_in.video.b_color_range_full = id->p_decoder->fmt_out.video.b_color_range_full;
+
+    p_enc->i_threads = p_sys->i_threads;
+    p_enc->p_cfg = p_sys->p_video_cfg;
+
+    p_enc->p_module = module_need( p_enc, "encoder", p_sys->psz_venc, true );
+    if( !p_enc->p_module )
+    {
+        msg_Err( p_stream, "cannot find video encoder (module:%s fourcc:%4.4s)",
+                 p_sys->psz_venc ? p_sys->psz_venc : "any",
+                 (char *)&p_sys->i_vcodec );
+        return VLC_EGENERIC;
+    }
+
+    p_enc->fmt_in.video.i_chroma = p_enc->fmt_in.i_codec;
+    p_enc->fmt_out.i_codec = vlc_fourcc_GetCodec( VIDEO_ES,
+                                                  p_enc->fmt_out.i_codec );
+
+    p_rung->id = sout_StreamIdAdd( p_stream->p_next, &p_enc->fmt_out );
+    if( !p_rung->id )
+    {
+        msg_Err( p_stream, "cannot add this stream" );
+        return VLC_EGENERIC;
+    }
+
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+    p_rung->pp_pics = malloc( p_sys->pool_size * sizeof( *p_rung->pp_pics ) );
+    if( !p_rung->pp_pics )
+        return VLC_ENOMEM;
+    p_rung->i_first = p_rung->i_pics = 0;
+    p_rung->p_buffers = NULL;
+    p_rung->b_abort = false;
+    vlc_sem_init( &p_rung->has_room, p_sys->pool_size );
+    vlc_mutex_init( &p_rung->lock );
+    vlc_cond_init( &p_rung->cond );
+    if( vlc_clone( &p_rung->thread, RungThread, p_rung, i_priority ) )
+    {
+        msg_Err( p_stream, "cannot spawn encoder thread" );
+        /* nothing to join */
+        p_rung->b_abort = true;
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_stream, "video rendition %u: %ux%u %dkb/s, ES id %d", i_rung,
+             p_enc->fmt_out.video.i_visible_width,
+             p_enc->fmt_out.video.i_visible_height,
+             p_enc->fmt_out.i_bitrate / 1000, p_enc->fmt_out.i_id );
+    return VLC_SUCCESS;
+}
+
+/* Output format of the shared filter chains */
+static const es_format_t *transcode_ladder_format( sout_stream_id_sys_t *id )
+{
+    if( id->p_uf_chain )
+        return filter_chain_GetFmtOut( id->p_uf_chain );
+    if( id->p_f_chain )
+        return filter_chain_GetFmtOut( id->p_f_chain );
+    return &id->p_decoder->fmt_out;
+}
+
+/* Builds the filter chains shared by all the renditions. They keep the
+ * source dimensions: each rendition scales on its own thread. */
+static void transcode_ladder_filter_init( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id )
+{
+    video_format_t *p_vfmt = &id->p_encoder->fmt_in.video;
+    const video_format_t *p_src = &id->p_decoder->fmt_out.video;
+
+    p_vfmt->i_width = p_src->i_width;
+    p_vfmt->i_height = p_src->i_height;
+    p_vfmt->i_visible_width = p_src->i_visible_width;
+    p_vfmt->i_visible_height = p_src->i_visible_height;
+    p_vfmt->i_x_offset = p_src->i_x_offset;
+    p_vfmt->i_y_offset = p_src->i_y_offset;
+    p_vfmt->i_sar_num = p_src->i_sar_num;
+    p_vfmt->i_sar_den = p_src->i_sar_den;
+
+    transcode_video_filter_init( p_stream, id );
+}
+
+static int transcode_ladder_open( sout_stream_t *p_stream,
+                                  sout_stream_id_sys_t *id )
+{
+    /* The encoders accept the chroma probed in transcode_video_new() */
+    const vlc_fourcc_t i_chroma = id->p_encoder->fmt_in.i_codec;
+
+    transcode_video_framerate_init( p_stream, id->p_encoder,
+                                    &id->p_decoder->fmt_out );
+    transcode_ladder_filter_init( p_stream, id );
+
+    const es_format_t *p_fmt_out = transcode_ladder_format( id );
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        if( transcode_rung_open( p_stream, id, i, i_chroma, p_fmt_out ) )
+        {
+            for( unsigned j = 0; j <= i; j++ )
+                transcode_rung_close( p_stream, &id->p_rungs[j] );
+            return VLC_EGENERIC;
+        }
+    }
+    return VLC_SUCCESS;
+}
+
+static bool transcode_video_opened( const sout_stream_id_sys_t *id )
+{
+    if( id->i_rungs )
+        return id->p_rungs[0].p_encoder != NULL;
+    return id->p_encoder->p_module != NULL;
+}
+
+/* Checks that all the renditions start their GOPs on the same pictures */
+static void transcode_ladder_check_keys( sout_stream_t *p_stream,
+                                         sout_stream_id_sys_t *id,
+                                         struct transcode_rung *p_rung,
+                                         const block_t *p_block )
+{
+    for( ; p_block != NULL; p_block = p_block->p_next )
+    {
+        if( !( p_block->i_flags & BLOCK_FLAG_TYPE_I ) )
+            continue;
+
+        unsigned n = p_rung->i_keys++;
+        p_rung->keys[n % LADDER_KEYS] = p_block->i_pts;
+
+        for( unsigned i = 0; i < id->i_rungs && !id->b_unaligned; i++ )
+        {
+            const struct transcode_rung *p_other = &id->p_rungs[i];
+
+            if( p_other->i_keys > n && p_other->i_keys - n <= LADDER_KEYS &&
+                p_other->keys[n % LADDER_KEYS] != p_block->i_pts )
+            {
+                msg_Warn( p_stream, "video renditions are not GOP-aligned "
+                          "(keyframe %u at %"PRId64" and %"PRId64"), check "
+                          "that the encoder does not insert keyframes on "
+                          "scene changes", n, p_other->keys[n % LADDER_KEYS],
+                          p_block->i_pts );
+                id->b_unaligned = true;
+            }
+        }
+    }
+}
+
+/* Sends what the renditions encoders output so far */
+static void transcode_ladder_send( sout_stream_t *p_stream,
+                                   sout_stream_id_sys_t *id )
+{
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+    {
+        struct transcode_rung *p_rung = &id->p_rungs[i];
+
+        vlc_mutex_lock( &p_rung->lock );
+        block_t *p_out = p_rung->p_buffers;
+        p_rung->p_buffers = NULL;
+        vlc_mutex_unlock( &p_rung->lock );
+
+        if( p_out )
+        {
+            transcode_ladder_check_keys( p_stream, id, p_rung, p_out );
+            sout_StreamIdSend( p_stream->p_next, p_rung->id, p_out );
+        }
+    }
+}
+
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_sys_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 && !p_stream->p_sys->b_abort )
+    bool b_thread = p_stream->p_sys->i_threads >= 1 && !id->i_rungs;
+
+    if( b_thread && !p_stream->p_sys->b_abort )
     {
         vlc_mutex_lock( &p_stream->p_sys->lock_out );
         p_stream->p_sys->b_abort = true;
@@ -673,7 +1080,7 @@ void transcode_video_close( sout_stream_t *p_stream,
         block_ChainRelease( p_stream->p_sys->p_buffers );
     }
 
-    if( p_stream->p_sys->i_threads >= 1 )
+    if( b_thread )
     {
         vlc_mutex_destroy( &p_stream->p_sys->lock_out );
         vlc_cond_destroy( &p_stream->p_sys->cond );
@@ -696,53 +1103,71 @@ void transcode_video_close( sout_stream_t *p_stream,
         filter_chain_Delete( id->p_f_chain );
     if( id->p_uf_chain )
         filter_chain_Delete( id->p_uf_chain );
+
+    /* Close renditions */
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+        transcode_rung_close( p_stream, &id->p_rungs[i] );
+    free( id->p_rungs );
+    id->p_rungs = NULL;
+    id->i_rungs = 0;
 }
 
-static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id, block_t **out )
+/* Overlays the subpictures on a picture of the given format */
+static picture_t *RenderSubpictures( sout_stream_t *p_stream,
+                                     sout_stream_id_sys_t *id,
+                                     picture_t *p_pic,
+                                     const video_format_t *p_fmt )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
 
-    /*
-     * Encoding
-     */
-    /* Check if we have a subpicture to overlay */
-    if( p_sys->p_spu )
+    video_format_t fmt = *p_fmt;
+    if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
     {
-        video_format_t fmt = id->p_encoder->fmt_in.video;
-        if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
-        {
-            fmt.i_visible_width  = fmt.i_width;
-            fmt.i_visible_height = fmt.i_height;
-            fmt.i_x_offset       = 0;
-            fmt.i_y_offset       = 0;
-        }
+        fmt.i_visible_width  = fmt.i_width;
+        fmt.i_visible_height = fmt.i_height;
+        fmt.i_x_offset       = 0;
+        fmt.i_y_offset       = 0;
+    }
 
-        subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt,
-                                             &id->p_decoder->fmt_out.video,
-                                             p_pic->date, p_pic->date, false );
+    subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt,
+                                         &id->p_decoder->fmt_out.video,
+                                         p_pic->date, p_pic->date, false );
 
-        /* Overlay subpicture */
-        if( p_subpic )
+    /* Overlay subpicture */
+    if( p_subpic )
+    {
+        if( picture_IsReferenced( p_pic ) && !filter_chain_GetLength( id->p_f_chain ) )
         {
-            if( picture_IsReferenced( p_pic ) && !filter_chain_GetLength( id->p_f_chain ) )
+            /* We can't modify the picture, we need to duplicate it,
+             * in this point the picture is already in the p_fmt format */
+            picture_t *p_tmp = picture_NewFromFormat( p_fmt );
+            if( likely( p_tmp ) )
             {
-                /* We can't modify the picture, we need to duplicate it,
-                 * in this point the picture is already p_encoder->fmt.in format*/
-                picture_t *p_tmp = video_new_buffer_encoder( id->p_encoder );
-                if( likely( p_tmp ) )
-                {
-                    picture_Copy( p_tmp, p_pic );
-                    picture_Release( p_pic );
-                    p_pic = p_tmp;
-                }
+                picture_Copy( p_tmp, p_pic );
+                picture_Release( p_pic );
+                p_pic = p_tmp;
             }
-            if( unlikely( !p_sys->p_spu_blend ) )
-                p_sys->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_sys->p_spu ), &fmt );
-            if( likely( p_sys->p_spu_blend ) )
-                picture_BlendSubpicture( p_pic, p_sys->p_spu_blend, p_subpic );
-            subpicture_Delete( p_subpic );
         }
+        if( unlikely( !p_sys->p_spu_blend ) )
+            p_sys->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_sys->p_spu ), &fmt );
+        if( likely( p_sys->p_spu_blend ) )
+            picture_BlendSubpicture( p_pic, p_sys->p_spu_blend, p_subpic );
+        subpicture_Delete( p_subpic );
     }
+    return p_pic;
+}
+
+static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_id_sys_t *id, block_t **out )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    /*
+     * Encoding
+     */
+    /* Check if we have a subpicture to overlay */
+    if( p_sys->p_spu )
+        p_pic = RenderSubpictures( p_stream, id, p_pic,
+                                   &id->p_encoder->fmt_in.video );
 
     if( p_sys->i_threads == 0 )
     {
@@ -765,6 +1190,61 @@ static void OutputFrame( sout_stream_t *p_stream, picture_t *p_pic, sout_stream_
         picture_Release( p_pic );
 }
 
+/* Hands a picture of the shared filter chains to every rendition */
+static void LadderOutputFrame( sout_stream_t *p_stream, picture_t *p_pic,
+                               sout_stream_id_sys_t *id )
+{
+    if( p_stream->p_sys->p_spu )
+        p_pic = RenderSubpictures( p_stream, id, p_pic,
+                                   &transcode_ladder_format( id )->video );
+
+    for( unsigned i = 0; i < id->i_rungs; i++ )
+        RungPush( &id->p_rungs[i], picture_Hold( p_pic ) );
+    picture_Release( p_pic );
+}
+
+/* Runs the user filter chain, then encodes */
+static void UserFilterOutput( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                              picture_t *p_filtered_pic, block_t **out )
+{
+    for ( ;; ) {
+        picture_t *p_user_filtered_pic = p_filtered_pic;
+
+        /* Run user specified filter chain */
+        if( id->p_uf_chain )
+            p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
+        if( !p_user_filtered_pic )
+            break;
+
+        if( id->i_rungs )
+            LadderOutputFrame( p_stream, p_user_filtered_pic, id );
+        else
+            OutputFrame( p_stream, p_user_filtered_pic, id, out );
+
+        p_filtered_pic = NULL;
+    }
+}
+
+/* Outputs the pictures still held back by the filters at end of stream */
+static void DrainFilters( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                          block_t **out )
+{
+    picture_t *p_pic;
+
+    if( id->p_f_chain )
+        while( (p_pic = filter_chain_VideoDrain( id->p_f_chain )) != NULL )
+            UserFilterOutput( p_stream, id, p_pic, out );
+
+    if( id->p_uf_chain )
+        while( (p_pic = filter_chain_VideoDrain( id->p_uf_chain )) != NULL )
+        {
+            if( id->i_rungs )
+                LadderOutputFrame( p_stream, p_pic, id );
+            else
+                OutputFrame( p_stream, p_pic, id, out );
+        }
+}
+
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                     block_t *in, block_t **out )
 {
@@ -793,7 +1273,7 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
         }
 
         if( unlikely (
-             id->p_encoder->p_module &&
+             transcode_video_opened( id ) &&
              !video_format_IsSimilar( &id->fmt_input_video, &id->p_decoder->fmt_out.video )
             )
           )
@@ -811,31 +1291,49 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             id->p_uf_chain = NULL;
 
             /* Reinitialize filters */
-            id->p_encoder->fmt_out.video.i_visible_width  = p_sys->i_width & ~1;
-            id->p_encoder->fmt_out.video.i_visible_height = p_sys->i_height & ~1;
-            id->p_encoder->fmt_out.video.i_sar_num = id->p_encoder->fmt_out.video.i_sar_den = 0;
+            if( id->i_rungs )
+                /* the renditions adapt to the new pictures format */
+                transcode_ladder_filter_init( p_stream, id );
+            else
+            {
+                id->p_encoder->fmt_out.video.i_visible_width  = p_sys->i_width & ~1;
+                id->p_encoder->fmt_out.video.i_visible_height = p_sys->i_height & ~1;
+                id->p_encoder->fmt_out.video.i_sar_num = id->p_encoder->fmt_out.video.i_sar_den = 0;
 
-            transcode_video_encoder_init( p_stream, id );
-            transcode_video_filter_init( p_stream, id );
-            conversion_video_filter_append( id );
+                transcode_video_encoder_init( p_stream, id );
+                transcode_video_filter_init( p_stream, id );
+                conversion_video_filter_append( id );
+            }
             memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
         }
 
 
-        if( unlikely( !id->p_encoder->p_module ) )
+        if( unlikely( !transcode_video_opened( id ) ) )
         {
+            int i_ret;
+
             if( id->p_f_chain )
                 filter_chain_Delete( id->p_f_chain );
             if( id->p_uf_chain )
                 filter_chain_Delete( id->p_uf_chain );
             id->p_f_chain = id->p_uf_chain = NULL;
 
-            transcode_video_encoder_init( p_stream, id );
-            transcode_video_filter_init( p_stream, id );
-            conversion_video_filter_append( id );
-            memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
+            if( id->i_rungs )
+            {
+                memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
+                i_ret = transcode_ladder_open( p_stream, id );
+            }
+            else
+            {
+                transcode_video_encoder_init( p_stream, id );
+                transcode_video_filter_init( p_stream, id );
+                conversion_video_filter_append( id );
+                memcpy( &id->fmt_input_video, &id->p_decoder->fmt_out.video, sizeof(video_format_t));
 
-            if( transcode_video_encoder_open( p_stream, id ) != VLC_SUCCESS )
+                i_ret = transcode_video_encoder_open( p_stream, id );
+            }
+
+            if( i_ret != VLC_SUCCESS )
             {
                 picture_Release( p_pic );
                 transcode_video_close( p_stream, id );
@@ -858,25 +1356,18 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             if( !p_filtered_pic )
                 break;
 
-            for ( ;; ) {
-                picture_t *p_user_filtered_pic = p_filtered_pic;
-
-                /* Run user specified filter chain */
-                if( id->p_uf_chain )
-                    p_user_filtered_pic = filter_chain_VideoFilter( id->p_uf_chain, p_user_filtered_pic );
-                if( !p_user_filtered_pic )
-                    break;
-
-                OutputFrame( p_stream, p_user_filtered_pic, id, out );
-
-                p_filtered_pic = NULL;
-            }
-
+            UserFilterOutput( p_stream, id, p_filtered_pic, out );
             p_pic = NULL;
         }
     } while( p_pics );
 
-    if( p_sys->i_threads >= 1 )
+    /* The chain was closed */
+    if( b_error )
+        return VLC_EGENERIC;
+
+    if( id->i_rungs )
+        transcode_ladder_send( p_stream, id );
+    else if( p_sys->i_threads >= 1 )
     {
         /* Pick up any return data the encoder thread wants to output. */
         vlc_mutex_lock( &p_sys->lock_out );
@@ -886,7 +1377,31 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
     }
 
 end:
-    if( unlikely( in == NULL ) )
+    if( unlikely( in == NULL ) && transcode_video_opened( id )
+     && ( id->i_rungs == 0 || !id->p_rungs[0].b_abort ) )
+        DrainFilters( p_stream, id, out );
+
+    if( unlikely( in == NULL ) && id->i_rungs )
+    {
+        if( transcode_video_opened( id ) && !id->p_rungs[0].b_abort )
+        {
+            msg_Dbg( p_stream, "Flushing renditions threads and waiting that");
+            for( unsigned i = 0; i < id->i_rungs; i++ )
+            {
+                struct transcode_rung *p_rung = &id->p_rungs[i];
+
+                vlc_mutex_lock( &p_rung->lock );
+                p_rung->b_abort = true;
+                vlc_cond_signal( &p_rung->cond );
+                vlc_mutex_unlock( &p_rung->lock );
+            }
+            for( unsigned i = 0; i < id->i_rungs; i++ )
+                vlc_join( id->p_rungs[i].thread, NULL );
+            transcode_ladder_send( p_stream, id );
+            msg_Dbg( p_stream, "Flushing done");
+        }
+    }
+    else if( unlikely( in == NULL ) )
     {
         if( p_sys->i_threads == 0 )
         {
@@ -935,10 +1450,23 @@ bool transcode_video_add( sout_stream_t *p_stream, const es_format_t *p_fmt,
     id->p_encoder->fmt_out.video.i_visible_height = p_sys->i_height & ~1;
     id->p_encoder->fmt_out.i_bitrate = p_sys->i_vbitrate;
 
+    if( p_sys->i_ladder )
+    {
+        id->p_rungs = calloc( p_sys->i_ladder, sizeof( *id->p_rungs ) );
+        if( !id->p_rungs )
+            return false;
+        id->i_rungs = p_sys->i_ladder;
+        for( unsigned i = 0; i < id->i_rungs; i++ )
+            id->p_rungs[i].i_es_id = -1;
+    }
+
     /* Build decoder -> filter -> encoder chain */
     if( transcode_video_new( p_stream, id ) )
     {
         msg_Err( p_stream, "cannot create video chain" );
+        free( id->p_rungs );
+        id->p_rungs = NULL;
+        id->i_rungs = 0;
         return false;
     }
 
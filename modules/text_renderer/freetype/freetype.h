@@ -47,6 +47,8 @@
 #include FT_GLYPH_H
 #include FT_STROKER_H
 
+#include "text_cache.h"
+
 /* Consistency between Freetype versions and platforms */
 #define FT_FLOOR(X)     ((X & -64) >> 6)
 #define FT_CEIL(X)      (((X + 63) & -64) >> 6)
@@ -111,6 +113,10 @@ struct filter_sys_t
     /** Font face cache */
     vlc_dictionary_t  face_map;
 
+    /** Glyph and shaped run caches, see text_layout.c */
+    text_cache_t     *p_glyph_cache;
+    text_cache_t     *p_run_cache;
+
     int               i_fallback_counter;
 
     /* Current scaling of the text, default is 100 (%) */
@@ -0,0 +1,200 @@
+/*****************************************************************************
+ * text_cache.c : LRU caches for the text renderer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "text_cache.h"
+
+typedef struct text_cache_entry_t text_cache_entry_t;
+struct text_cache_entry_t
+{
+    text_cache_entry_t *p_hash_next;
+    text_cache_entry_t *p_prev;     /* more recently used */
+    text_cache_entry_t *p_next;     /* less recently used */
+    void               *p_value;
+    uint32_t            i_hash;
+    size_t              i_key;
+    unsigned char       key[];
+};
+
+struct text_cache_t
+{
+    text_cache_entry_t **pp_buckets;
+    size_t               i_buckets; /* power of 2 */
+    text_cache_entry_t  *p_first;
+    text_cache_entry_t  *p_last;
+    size_t               i_count;
+    size_t               i_max;
+    void               (*pf_free)( void * );
+
+    uint64_t             i_hits;
+    uint64_t             i_misses;
+};
+
+/* FNV-1a */
+static uint32_t Hash( const void *p_key, size_t i_key )
+{
+    const unsigned char *p = p_key;
+    uint32_t i_hash = 2166136261u;
+
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619u;
+    return i_hash;
+}
+
+text_cache_t *TextCacheNew( size_t i_max, void (*pf_free)( void * ) )
+{
+    text_cache_t *p_cache = malloc( sizeof( *p_cache ) );
+    if( !p_cache )
+        return NULL;
+
+    /* keep chains short, even when a layout exceeds the capacity */
+    p_cache->i_buckets = 16;
+    while( p_cache->i_buckets < 2 * i_max )
+        p_cache->i_buckets *= 2;
+
+    p_cache->pp_buckets = calloc( p_cache->i_buckets,
+                                  sizeof( *p_cache->pp_buckets ) );
+    if( !p_cache->pp_buckets )
+    {
+        free( p_cache );
+        return NULL;
+    }
+
+    p_cache->p_first = p_cache->p_last = NULL;
+    p_cache->i_count = 0;
+    p_cache->i_max = i_max;
+    p_cache->pf_free = pf_free;
+    p_cache->i_hits = p_cache->i_misses = 0;
+    return p_cache;
+}
+
+static void Unlink( text_cache_t *p_cache, text_cache_entry_t *p_entry )
+{
+    if( p_entry->p_prev )
+        p_entry->p_prev->p_next = p_entry->p_next;
+    else
+        p_cache->p_first = p_entry->p_next;
+    if( p_entry->p_next )
+        p_entry->p_next->p_prev = p_entry->p_prev;
+    else
+        p_cache->p_last = p_entry->p_prev;
+}
+
+static void LinkFirst( text_cache_t *p_cache, text_cache_entry_t *p_entry )
+{
+    p_entry->p_prev = NULL;
+    p_entry->p_next = p_cache->p_first;
+    if( p_cache->p_first )
+        p_cache->p_first->p_prev = p_entry;
+    else
+        p_cache->p_last = p_entry;
+    p_cache->p_first = p_entry;
+}
+
+static void Evict( text_cache_t *p_cache, text_cache_entry_t *p_entry )
+{
+    text_cache_entry_t **pp =
+        &p_cache->pp_buckets[ p_entry->i_hash & ( p_cache->i_buckets - 1 ) ];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_hash_next;
+    *pp = p_entry->p_hash_next;
+
+    Unlink( p_cache, p_entry );
+    p_cache->i_count--;
+
+    p_cache->pf_free( p_entry->p_value );
+    free( p_entry );
+}
+
+void TextCacheDelete( text_cache_t *p_cache )
+{
+    while( p_cache->p_last )
+        Evict( p_cache, p_cache->p_last );
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+void *TextCacheGet( text_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    const uint32_t i_hash = Hash( p_key, i_key );
+
+    for( text_cache_entry_t *p_entry =
+            p_cache->pp_buckets[ i_hash & ( p_cache->i_buckets - 1 ) ];
+         p_entry; p_entry = p_entry->p_hash_next )
+    {
+        if( p_entry->i_hash != i_hash || p_entry->i_key != i_key
+         || memcmp( p_entry->key, p_key, i_key ) )
+            continue;
+
+        if( p_entry != p_cache->p_first )
+        {
+            Unlink( p_cache, p_entry );
+            LinkFirst( p_cache, p_entry );
+        }
+        p_cache->i_hits++;
+        return p_entry->p_value;
+    }
+
+    p_cache->i_misses++;
+    return NULL;
+}
+
+int TextCachePut( text_cache_t *p_cache, const void *p_key, size_t i_key,
+                  void *p_value )
+{
+    text_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key );
+    if( !p_entry )
+        return VLC_ENOMEM;
+
+    p_entry->p_value = p_value;
+    p_entry->i_hash = Hash( p_key, i_key );
+    p_entry->i_key = i_key;
+    memcpy( p_entry->key, p_key, i_key );
+
+    text_cache_entry_t **pp_bucket =
+        &p_cache->pp_buckets[ p_entry->i_hash & ( p_cache->i_buckets - 1 ) ];
+    p_entry->p_hash_next = *pp_bucket;
+    *pp_bucket = p_entry;
+
+    LinkFirst( p_cache, p_entry );
+    p_cache->i_count++;
+    return VLC_SUCCESS;
+}
+
+void TextCacheTrim( text_cache_t *p_cache )
+{
+    while( p_cache->i_count > p_cache->i_max )
+        Evict( p_cache, p_cache->p_last );
+}
+
+void TextCacheGetStats( const text_cache_t *p_cache, uint64_t *pi_hits,
+                        uint64_t *pi_misses )
+{
+    *pi_hits = p_cache->i_hits;
+    *pi_misses = p_cache->i_misses;
+}
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * text_cache.h : LRU caches for the text renderer
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_TEXT_CACHE_H
+#define VLC_FREETYPE_TEXT_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Least recently used caches, keyed by arbitrary byte strings
+ */
+
+typedef struct text_cache_t text_cache_t;
+
+/**
+ * Creates a cache.
+ *
+ * \param i_max number of entries kept by TextCacheTrim()
+ * \param pf_free destructor of the cached values
+ */
+text_cache_t *TextCacheNew( size_t i_max, void (*pf_free)( void * ) );
+void TextCacheDelete( text_cache_t * );
+
+/**
+ * Looks up a value, and marks it as the most recently used.
+ *
+ * \return the value or NULL if it is not cached
+ */
+void *TextCacheGet( text_cache_t *, const void *p_key, size_t i_key );
+
+/**
+ * Adds a value, the cache owns it on success.
+ *
+ * Entries are never evicted here, so that the values returned by
+ * TextCacheGet() remain valid until the next TextCacheTrim().
+ */
+int TextCachePut( text_cache_t *, const void *p_key, size_t i_key,
+                  void *p_value );
+
+/**
+ * Evicts the least recently used entries beyond the cache capacity.
+ */
+void TextCacheTrim( text_cache_t * );
+
+/**
+ * Gets the number of lookups that found and did not find a value.
+ */
+void TextCacheGetStats( const text_cache_t *, uint64_t *pi_hits,
+                        uint64_t *pi_misses );
+
+/** @} */
+
+#endif
@@ -64,6 +64,7 @@
 
 #include "freetype.h"
 #include "text_layout.h"
+#include "text_cache.h"
 #include "platform_fonts.h"
 
 /* Win32 */
@@ -115,6 +116,57 @@ typedef struct run_desc_t
 
 } run_desc_t;
 
+#define GLYPH_CACHE_SIZE     1024
+#define RUN_CACHE_SIZE       256
+#define CACHED_GLYPH_BITMAPS 4
+
+/**
+ * Glyph held by the glyph cache. The cache owns the outlines, which are
+ * rendered once per sub-pixel position, then copied and moved to the pen
+ * position.
+ */
+typedef struct cached_glyph_t
+{
+    FT_Glyph  p_glyph;
+    FT_Glyph  p_outline;
+    FT_Vector advance;
+    struct
+    {
+        FT_Glyph  p_source; /* p_glyph or p_outline */
+        FT_Vector origin;   /* 26.6 sub-pixel position */
+        FT_Glyph  p_bitmap;
+    } bitmaps[CACHED_GLYPH_BITMAPS];
+    unsigned  i_next_bitmap;
+} cached_glyph_t;
+
+typedef struct
+{
+    FT_Face  p_face;            /* faces are loaded per size */
+    FT_UInt  i_glyph_index;
+    int      i_synthesis;       /* emboldened and/or obliqued */
+    FT_Fixed i_outline_radius;  /* -1 without outline */
+} glyph_key_t;
+
+#ifdef HAVE_HARFBUZZ
+/**
+ * Shaped run held by the run cache, keyed by run_key_t followed by the
+ * code points of the run
+ */
+typedef struct
+{
+    unsigned int         i_glyph_count;
+    hb_glyph_info_t     *p_glyph_infos;
+    hb_glyph_position_t *p_glyph_positions;
+} shaped_run_t;
+
+typedef struct
+{
+    FT_Face              p_face;
+    hb_script_t          script;
+    hb_direction_t       direction;
+} run_key_t;
+#endif
+
 /**
  * Glyph bitmaps. Advance and offset are 26.6 values
  */
@@ -130,6 +182,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    cached_glyph_t *p_cached;   /**< owner of the outlines, if cached */
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -159,6 +212,76 @@ typedef struct paragraph_t
 
 } paragraph_t;
 
+static void FreeCachedGlyph( void *p_value )
+{
+    cached_glyph_t *p_cached = p_value;
+
+    FT_Done_Glyph( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        FT_Done_Glyph( p_cached->p_outline );
+    for( int i = 0; i < CACHED_GLYPH_BITMAPS; i++ )
+        if( p_cached->bitmaps[i].p_bitmap )
+            FT_Done_Glyph( p_cached->bitmaps[i].p_bitmap );
+    free( p_cached );
+}
+
+int LayoutCachesInit( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    p_sys->p_glyph_cache = TextCacheNew( GLYPH_CACHE_SIZE, FreeCachedGlyph );
+    if( !p_sys->p_glyph_cache )
+        return VLC_ENOMEM;
+#ifdef HAVE_HARFBUZZ
+    p_sys->p_run_cache = TextCacheNew( RUN_CACHE_SIZE, free );
+    if( !p_sys->p_run_cache )
+    {
+        TextCacheDelete( p_sys->p_glyph_cache );
+        p_sys->p_glyph_cache = NULL;
+        return VLC_ENOMEM;
+    }
+#endif
+    return VLC_SUCCESS;
+}
+
+static void CacheStats( filter_t *p_filter, const char *psz_name,
+                        const text_cache_t *p_cache )
+{
+    uint64_t i_hits, i_misses;
+
+    TextCacheGetStats( p_cache, &i_hits, &i_misses );
+    if( i_hits + i_misses > 0 )
+        msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses (%.1f%%)",
+                 psz_name, i_hits, i_misses, 100. * i_hits / (i_hits + i_misses) );
+}
+
+void LayoutCachesRelease( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_glyph_cache )
+    {
+        CacheStats( p_filter, "glyph", p_sys->p_glyph_cache );
+        TextCacheDelete( p_sys->p_glyph_cache );
+        p_sys->p_glyph_cache = NULL;
+    }
+    if( p_sys->p_run_cache )
+    {
+        CacheStats( p_filter, "shaped run", p_sys->p_run_cache );
+        TextCacheDelete( p_sys->p_run_cache );
+        p_sys->p_run_cache = NULL;
+    }
+}
+
+/* Drops the least recently used entries, once no paragraph refers to them */
+static void TrimCaches( filter_sys_t *p_sys )
+{
+    if( p_sys->p_glyph_cache )
+        TextCacheTrim( p_sys->p_glyph_cache );
+    if( p_sys->p_run_cache )
+        TextCacheTrim( p_sys->p_run_cache );
+}
+
 static void FreeLine( line_desc_t *p_line )
 {
     for( int i = 0; i < p_line->i_character_count; i++ )
@@ -657,6 +780,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     filter_sys_t *p_sys = p_filter->p_sys;
     int i_total_glyphs = 0;
     int i_ret = VLC_EGENERIC;
+    run_key_t *p_key = NULL;
 
     if( p_paragraph->i_size <= 0 || p_paragraph->i_runs_count <= 0 )
     {
@@ -695,6 +819,32 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        /* The shaping only depends on the face, script, direction and text */
+        const size_t i_run_size = p_run->i_end_offset - p_run->i_start_offset;
+        const size_t i_key = sizeof( *p_key ) + i_run_size * sizeof( uni_char_t );
+        if( p_sys->p_run_cache && ( p_key = malloc( i_key ) ) )
+        {
+            memset( p_key, 0, sizeof( *p_key ) );
+            p_key->p_face = p_face;
+            p_key->script = p_run->script;
+            p_key->direction = p_run->direction;
+            memcpy( p_key + 1, p_paragraph->p_code_points + p_run->i_start_offset,
+                    i_run_size * sizeof( uni_char_t ) );
+
+            const shaped_run_t *p_shaped =
+                TextCacheGet( p_sys->p_run_cache, p_key, i_key );
+            if( p_shaped )
+            {
+                free( p_key );
+                p_key = NULL;
+                p_run->p_glyph_infos = p_shaped->p_glyph_infos;
+                p_run->p_glyph_positions = p_shaped->p_glyph_positions;
+                p_run->i_glyph_count = p_shaped->i_glyph_count;
+                i_total_glyphs += p_run->i_glyph_count;
+                continue;
+            }
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
@@ -737,6 +887,28 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             goto error;
         }
 
+        if( p_key )
+        {
+            const unsigned i_count = p_run->i_glyph_count;
+            shaped_run_t *p_shaped = malloc( sizeof( *p_shaped ) +
+                    i_count * ( sizeof( hb_glyph_info_t ) + sizeof( hb_glyph_position_t ) ) );
+            if( p_shaped )
+            {
+                p_shaped->i_glyph_count = i_count;
+                p_shaped->p_glyph_positions = (hb_glyph_position_t *) ( p_shaped + 1 );
+                p_shaped->p_glyph_infos =
+                    (hb_glyph_info_t *) ( p_shaped->p_glyph_positions + i_count );
+                memcpy( p_shaped->p_glyph_infos, p_run->p_glyph_infos,
+                        i_count * sizeof( hb_glyph_info_t ) );
+                memcpy( p_shaped->p_glyph_positions, p_run->p_glyph_positions,
+                        i_count * sizeof( hb_glyph_position_t ) );
+                if( TextCachePut( p_sys->p_run_cache, p_key, i_key, p_shaped ) )
+                    free( p_shaped );
+            }
+            free( p_key );
+            p_key = NULL;
+        }
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -800,8 +972,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        /* runs found in the cache were not shaped */
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_buffer )
+            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -809,6 +984,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     return VLC_SUCCESS;
 
 error:
+    free( p_key );
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
         if( p_paragraph->p_runs[ i ].p_hb_font )
@@ -955,18 +1131,26 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
-        if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+        const bool b_outline =
+            p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE);
+        int i_radius = -1;
+        if( b_outline )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
         }
 
+        const bool b_embolden = ( p_style->i_style_flags & STYLE_BOLD )
+                             && !( p_face->style_flags & FT_STYLE_FLAG_BOLD );
+        const bool b_oblique = ( p_style->i_style_flags & STYLE_ITALIC )
+                            && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC );
+
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
         {
             int i_glyph_index;
@@ -1017,39 +1201,75 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            glyph_key_t key;
+            memset( &key, 0, sizeof( key ) );
+            key.p_face = p_face;
+            key.i_glyph_index = i_glyph_index;
+            key.i_synthesis = b_embolden | ( b_oblique << 1 );
+            key.i_outline_radius = i_radius;
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            cached_glyph_t *p_cached = NULL;
+            if( p_sys->p_glyph_cache )
+                p_cached = TextCacheGet( p_sys->p_glyph_cache, &key, sizeof( key ) );
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+            if( p_cached )
+            {
+                p_bitmaps->p_glyph = p_cached->p_glyph;
+                p_bitmaps->p_outline = p_cached->p_outline;
+            }
+            else
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-#undef SKIP_GLYPH
+                if( b_embolden )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( b_oblique )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-            if( p_filter->p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_filter->p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
+
+                if( b_outline )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
+
+                /* hand the outlines over to the cache */
+                if( p_sys->p_glyph_cache
+                 && ( p_cached = calloc( 1, sizeof( *p_cached ) ) ) )
+                {
+                    p_cached->p_glyph = p_bitmaps->p_glyph;
+                    p_cached->p_outline = p_bitmaps->p_outline;
+                    p_cached->advance = p_face->glyph->advance;
+                    if( TextCachePut( p_sys->p_glyph_cache, &key, sizeof( key ),
+                                      p_cached ) )
+                    {
+                        free( p_cached );
+                        p_cached = NULL;
+                    }
+                }
             }
 
+#undef SKIP_GLYPH
+
+            p_bitmaps->p_cached = p_cached;
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                const FT_Vector *p_advance = p_cached ? &p_cached->advance
+                                                      : &p_face->glyph->advance;
+                p_bitmaps->i_x_advance = p_advance->x;
+                p_bitmaps->i_y_advance = p_advance->y;
             }
         }
 
@@ -1060,6 +1280,62 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
     return VLC_SUCCESS;
 }
 
+/**
+ * Renders an outline to a bitmap at the pen position. Cached outlines are
+ * left untouched: their bitmaps are rendered once per sub-pixel position,
+ * then copied and moved by whole pixels.
+ */
+static FT_Error GlyphToBitmap( const glyph_bitmaps_t *p_bitmaps,
+                               FT_Glyph *pp_glyph, FT_Vector *p_pen,
+                               bool b_destroy )
+{
+    cached_glyph_t *p_cached = p_bitmaps->p_cached;
+    if( !p_cached )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   p_pen, b_destroy );
+
+    /* Embedded bitmaps (e.g. color emoji) are not rendered: FreeType returns
+     * the same glyph, and does not move it. Hand out a copy, as for rendered
+     * outlines, but do not cache it per origin. */
+    if( (*pp_glyph)->format == FT_GLYPH_FORMAT_BITMAP )
+        return FT_Glyph_Copy( *pp_glyph, pp_glyph );
+
+    FT_Vector origin = { .x = p_pen->x & 63, .y = p_pen->y & 63 };
+    FT_Glyph p_bitmap = NULL;
+    for( int i = 0; i < CACHED_GLYPH_BITMAPS && !p_bitmap; i++ )
+    {
+        if( p_cached->bitmaps[i].p_source == *pp_glyph
+         && p_cached->bitmaps[i].origin.x == origin.x
+         && p_cached->bitmaps[i].origin.y == origin.y )
+            p_bitmap = p_cached->bitmaps[i].p_bitmap;
+    }
+
+    if( !p_bitmap )
+    {
+        p_bitmap = *pp_glyph;
+        FT_Error err = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                           &origin, 0 );
+        if( err )
+            return err;
+
+        unsigned i_slot = p_cached->i_next_bitmap++ % CACHED_GLYPH_BITMAPS;
+        if( p_cached->bitmaps[i_slot].p_bitmap )
+            FT_Done_Glyph( p_cached->bitmaps[i_slot].p_bitmap );
+        p_cached->bitmaps[i_slot].p_source = *pp_glyph;
+        p_cached->bitmaps[i_slot].origin = origin;
+        p_cached->bitmaps[i_slot].p_bitmap = p_bitmap;
+    }
+
+    FT_Glyph p_copy;
+    FT_Error err = FT_Glyph_Copy( p_bitmap, &p_copy );
+    if( err )
+        return err;
+    ((FT_BitmapGlyph) p_copy)->left += FT_FLOOR( p_pen->x );
+    ((FT_BitmapGlyph) p_copy)->top  += FT_FLOOR( p_pen->y );
+    *pp_glyph = p_copy;
+    return 0;
+}
+
 static int LayoutLine( filter_t *p_filter,
                        paragraph_t *p_paragraph,
                        int i_first_char, int i_last_char,
@@ -1152,8 +1428,7 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( GlyphToBitmap( p_bitmaps, &p_bitmaps->p_shadow, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1161,12 +1436,14 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphToBitmap( p_bitmaps, &p_bitmaps->p_glyph, &pen_new, true ) )
             {
-                FT_Done_Glyph( p_bitmaps->p_glyph );
-                if( p_bitmaps->p_outline )
-                    FT_Done_Glyph( p_bitmaps->p_outline );
+                if( !p_bitmaps->p_cached )
+                {
+                    FT_Done_Glyph( p_bitmaps->p_glyph );
+                    if( p_bitmaps->p_outline )
+                        FT_Done_Glyph( p_bitmaps->p_outline );
+                }
                 if( p_bitmaps->p_shadow )
                     FT_Done_Glyph( p_bitmaps->p_shadow );
                 --i_line_index;
@@ -1178,10 +1455,10 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphToBitmap( p_bitmaps, &p_bitmaps->p_outline, &pen_new, true ) )
             {
-                FT_Done_Glyph( p_bitmaps->p_outline );
+                if( !p_bitmaps->p_cached )
+                    FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
             }
             else
@@ -1304,6 +1581,8 @@ static int LayoutLine( filter_t *p_filter,
 
 static inline void ReleaseGlyphBitMaps(glyph_bitmaps_t *p_bitmaps)
 {
+    if( p_bitmaps->p_cached )
+        return; /* the cache owns the outlines */
     if( p_bitmaps->p_glyph )
         FT_Done_Glyph( p_bitmaps->p_glyph );
     if( p_bitmaps->p_outline )
@@ -1602,6 +1881,8 @@ int LayoutText( filter_t *p_filter,
         i_base_line += i_max_face_height;
     }
 
+    TrimCaches( p_filter->p_sys );
+
     *pi_max_face_height = i_max_face_height;
     *pp_lines = p_first_line;
     *p_bbox = bbox;
@@ -1610,6 +1891,7 @@ int LayoutText( filter_t *p_filter,
 error:
     if( p_first_line ) FreeLines( p_first_line );
     if( p_paragraph ) FreeParagraph( p_paragraph );
+    TrimCaches( p_filter->p_sys );
     return VLC_EGENERIC;
 }
 
@@ -62,6 +62,16 @@ struct line_desc_t
 void FreeLines( line_desc_t *p_lines );
 line_desc_t *NewLine( int i_count );
 
+/**
+ * Creates the glyph and shaped run caches. Layout works without them.
+ */
+int LayoutCachesInit( filter_t *p_filter );
+
+/**
+ * Releases the caches, before the faces they reference.
+ */
+void LayoutCachesRelease( filter_t *p_filter );
+
 /**
  * Layout the text with shaping, bidirectional support, and font fallback if available.
  *
@@ -33,6 +33,10 @@
 
 #include "copy.h"
 
+#ifdef CAN_COMPILE_AVX2
+# include <immintrin.h>
+#endif
+
 int CopyInitCache(copy_cache_t *cache, unsigned width)
 {
 #ifdef CAN_COMPILE_SSE2
@@ -94,6 +98,163 @@ void CopyCleanCache(copy_cache_t *cache)
 # define vlc_CPU_SSE2() ((cpu & VLC_CPU_SSE2) != 0)
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+#ifndef __AVX2__
+# undef vlc_CPU_AVX2
+# define vlc_CPU_AVX2() ((cpu & VLC_CPU_AVX2) != 0)
+#endif
+
+/* 256-bits versions of the copy routines below. The cache lines are only
+ * 16 bytes aligned, so that unaligned loads and stores are used except for
+ * the streaming instructions. */
+VLC_AVX2
+static void AVX2_CopyFromUswc(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *src, size_t src_pitch,
+                              unsigned width, unsigned height)
+{
+    _mm_mfence();
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned unaligned = (-(uintptr_t)src) & 0x1f;
+        unsigned x = 0;
+
+        if (unaligned && width >= 32) {
+            _mm256_storeu_si256((__m256i *)dst,
+                                _mm256_loadu_si256((const __m256i *)src));
+            x = unaligned;
+        }
+
+        for (; x+127 < width; x += 128) {
+            const __m256i *s = (const __m256i *)&src[x];
+            __m256i *d = (__m256i *)&dst[x];
+            __m256i a = _mm256_stream_load_si256(s + 0);
+            __m256i b = _mm256_stream_load_si256(s + 1);
+            __m256i c = _mm256_stream_load_si256(s + 2);
+            __m256i e = _mm256_stream_load_si256(s + 3);
+            _mm256_storeu_si256(d + 0, a);
+            _mm256_storeu_si256(d + 1, b);
+            _mm256_storeu_si256(d + 2, c);
+            _mm256_storeu_si256(d + 3, e);
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_mfence();
+}
+
+VLC_AVX2
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        const __m256i *s = (const __m256i *)src;
+        __m256i *d = (__m256i *)dst;
+        unsigned x = 0;
+
+        if (((uintptr_t)dst & 0x1f) == 0) {
+            for (; x+127 < width; x += 128, s += 4, d += 4) {
+                __m256i a = _mm256_loadu_si256(s + 0);
+                __m256i b = _mm256_loadu_si256(s + 1);
+                __m256i c = _mm256_loadu_si256(s + 2);
+                __m256i e = _mm256_loadu_si256(s + 3);
+                _mm256_stream_si256(d + 0, a);
+                _mm256_stream_si256(d + 1, b);
+                _mm256_stream_si256(d + 2, c);
+                _mm256_stream_si256(d + 3, e);
+            }
+        } else {
+            for (; x+127 < width; x += 128, s += 4, d += 4) {
+                __m256i a = _mm256_loadu_si256(s + 0);
+                __m256i b = _mm256_loadu_si256(s + 1);
+                __m256i c = _mm256_loadu_si256(s + 2);
+                __m256i e = _mm256_loadu_si256(s + 3);
+                _mm256_storeu_si256(d + 0, a);
+                _mm256_storeu_si256(d + 1, b);
+                _mm256_storeu_si256(d + 2, c);
+                _mm256_storeu_si256(d + 3, e);
+            }
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+}
+
+VLC_AVX2
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height)
+{
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x;
+
+        for (x = 0; x < (width & ~31); x += 32) {
+            __m256i u = _mm256_loadu_si256((const __m256i *)&srcu[x]);
+            __m256i v = _mm256_loadu_si256((const __m256i *)&srcv[x]);
+            /* UV pairs 0-7 and 16-23, then 8-15 and 24-31 */
+            __m256i lo = _mm256_unpacklo_epi8(u, v);
+            __m256i hi = _mm256_unpackhi_epi8(u, v);
+            _mm256_storeu_si256((__m256i *)&dst[2*x],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dst[2*x+32],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+
+        for (; x < width; x++) {
+            dst[2*x+0] = srcu[x];
+            dst[2*x+1] = srcv[x];
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+}
+
+VLC_AVX2
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+        0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x;
+
+        for (x = 0; x < (width & ~31); x += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[2*x]);
+            __m256i b = _mm256_loadu_si256((const __m256i *)&src[2*x+32]);
+            /* U0-7 V0-7 U8-15 V8-15, then U0-15 V0-15 */
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle), 0xd8);
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle), 0xd8);
+            _mm256_storeu_si256((__m256i *)&dstu[x],
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstv[x],
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        for (; x < width; x++) {
+            dstu[x] = src[2*x+0];
+            dstv[x] = src[2*x+1];
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+#endif
+
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -109,6 +270,12 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 #endif
     assert(((intptr_t)dst & 0x0f) == 0 && (dst_pitch & 0x0f) == 0);
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_CopyFromUswc(dst, dst_pitch, src, src_pitch,
+                                 width, height);
+#endif
+
     asm volatile ("mfence");
 
     for (unsigned y = 0; y < height; y++) {
@@ -150,10 +317,17 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
 VLC_SSE
 static void Copy2d(uint8_t *dst, size_t dst_pitch,
                    const uint8_t *src, size_t src_pitch,
-                   unsigned width, unsigned height)
+                   unsigned width, unsigned height, unsigned cpu)
 {
     assert(((intptr_t)src & 0x0f) == 0 && (src_pitch & 0x0f) == 0);
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_Copy2d(dst, dst_pitch, src, src_pitch, width, height);
+#else
+    VLC_UNUSED(cpu);
+#endif
+
     for (unsigned y = 0; y < height; y++) {
         unsigned x = 0;
 
@@ -189,6 +363,12 @@ SSE_InterleaveUV(uint8_t *dst, size_t dst_pitch,
     VLC_UNUSED(cpu);
 #endif
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_InterleaveUV(dst, dst_pitch, srcu, srcu_pitch,
+                                 srcv, srcv_pitch, width, height);
+#endif
+
     uint8_t const       shuffle[] = { 0, 8,
                                       1, 9,
                                       2, 10,
@@ -294,6 +474,12 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
 
     assert(((intptr_t)src & 0xf) == 0 && (src_pitch & 0x0f) == 0);
 
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2())
+        return AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                            src, src_pitch, width, height);
+#endif
+
     for (unsigned y = 0; y < height; y++) {
         unsigned x = 0;
 
@@ -389,7 +575,7 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
         /* Copy from our cache to the destination */
         Copy2d(dst, dst_pitch,
                cache, w16,
-               src_pitch, hblock);
+               src_pitch, hblock, cpu);
 
         /* */
         src += src_pitch * hblock;
@@ -448,9 +634,10 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
         CopyFromUswc(cache, w16, src, src_pitch,
                      src_pitch, hblock, cpu);
 
-        /* Copy from our cache to the destination */
+        /* Copy from our cache to the destination, the width is in UV
+         * pairs */
         SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
-                    cache, w16, src_pitch, hblock, cpu);
+                    cache, w16, src_pitch / 2, hblock, cpu);
 
         /* */
         src  += src_pitch  * hblock;
@@ -32,7 +32,11 @@
 #include <vlc_cpu.h>
 
 #include "i420_rgb.h"
-#ifdef SSE2
+#if defined (AVX2)
+# include "i420_rgb_sse2.h"
+# include "i420_rgb_avx2.h"
+# define VLC_TARGET VLC_AVX2
+#elif defined (SSE2)
 # include "i420_rgb_sse2.h"
 # define VLC_TARGET VLC_SSE
 #else
@@ -636,7 +640,13 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
         {
             p_pic_start = p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_ARGB,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_ALIGNED
@@ -688,7 +698,13 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_ARGB,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_UNALIGNED
@@ -866,7 +882,13 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
         {
             p_pic_start = p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_RGBA,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_ALIGNED
@@ -918,7 +940,13 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_RGBA,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_UNALIGNED
@@ -1096,7 +1124,13 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
         {
             p_pic_start = p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_BGRA,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_ALIGNED
@@ -1148,7 +1182,13 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_BGRA,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_UNALIGNED
@@ -1323,7 +1363,13 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
         {
             p_pic_start = p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_ABGR,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_ALIGNED
@@ -1375,7 +1421,13 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
 
+#ifdef AVX2
+            AVX2_CALL_32( AVX2_UNPACK_32_ABGR,
+                          (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 );
+            for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 / 16; i_x--; )
+#else
             for ( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 16; i_x--; )
+#endif
             {
                 SSE2_CALL (
                     SSE2_INIT_32_UNALIGNED
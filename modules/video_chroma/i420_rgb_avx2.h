@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * i420_rgb_avx2.h: AVX2 YUV transformation
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#if defined(CAN_COMPILE_AVX2)
+
+#include <immintrin.h>
+
+/* Same arithmetic as SSE2_YUV_MUL and SSE2_YUV_ADD, 32 pixels at a time.
+ * Each 128-bits lane of the results holds 16 consecutive pixels: the first
+ * lane pixels 0 to 15, the second lane pixels 16 to 31. */
+VLC_AVX2
+static inline void AVX2_YUV(const uint8_t *p_y, const uint8_t *p_u,
+                            const uint8_t *p_v,
+                            __m256i *p_b, __m256i *p_g, __m256i *p_r)
+{
+    __m256i u = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p_u));
+    __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p_v));
+    __m256i y = _mm256_loadu_si256((const __m256i *)p_y);
+
+    /* chroma */
+    const __m256i c128 = _mm256_set1_epi16(0x0080);
+    u = _mm256_slli_epi16(_mm256_subs_epi16(u, c128), 3);
+    v = _mm256_slli_epi16(_mm256_subs_epi16(v, c128), 3);
+
+    __m256i g = _mm256_adds_epi16(
+        _mm256_mulhi_epi16(u, _mm256_set1_epi16((int16_t)0xf37d)),
+        _mm256_mulhi_epi16(v, _mm256_set1_epi16((int16_t)0xe5fc)));
+    __m256i b = _mm256_mulhi_epi16(u, _mm256_set1_epi16(0x4093));
+    __m256i r = _mm256_mulhi_epi16(v, _mm256_set1_epi16(0x3312));
+
+    /* luma, even and odd pixels */
+    y = _mm256_subs_epu8(y, _mm256_set1_epi8(0x10));
+    const __m256i coef = _mm256_set1_epi16(0x253f);
+    __m256i y0 = _mm256_and_si256(y, _mm256_set1_epi16(0x00ff));
+    __m256i y1 = _mm256_srli_epi16(y, 8);
+    y0 = _mm256_mulhi_epi16(_mm256_slli_epi16(y0, 3), coef);
+    y1 = _mm256_mulhi_epi16(_mm256_slli_epi16(y1, 3), coef);
+
+    /* the luma lanes hold pixels 0-15 and 16-31, as do the chroma ones */
+#define AVX2_ADD(c) \
+    _mm256_unpacklo_epi8( \
+        _mm256_packus_epi16(_mm256_adds_epi16(c, y0), \
+                            _mm256_adds_epi16(c, y0)), \
+        _mm256_packus_epi16(_mm256_adds_epi16(c, y1), \
+                            _mm256_adds_epi16(c, y1)))
+    *p_b = AVX2_ADD(b);
+    *p_g = AVX2_ADD(g);
+    *p_r = AVX2_ADD(r);
+#undef AVX2_ADD
+}
+
+/* Stores 32 pixels made of the bytes c0 c1 c2 c3 in memory order */
+VLC_AVX2
+static inline void AVX2_Store32(uint32_t *p_buffer, __m256i c0, __m256i c1,
+                                __m256i c2, __m256i c3)
+{
+    __m256i lo01 = _mm256_unpacklo_epi8(c0, c1);
+    __m256i lo23 = _mm256_unpacklo_epi8(c2, c3);
+    __m256i hi01 = _mm256_unpackhi_epi8(c0, c1);
+    __m256i hi23 = _mm256_unpackhi_epi8(c2, c3);
+    /* pixels 0-3|16-19, 4-7|20-23, 8-11|24-27 and 12-15|28-31 */
+    __m256i p0 = _mm256_unpacklo_epi16(lo01, lo23);
+    __m256i p1 = _mm256_unpackhi_epi16(lo01, lo23);
+    __m256i p2 = _mm256_unpacklo_epi16(hi01, hi23);
+    __m256i p3 = _mm256_unpackhi_epi16(hi01, hi23);
+
+    __m256i *p = (__m256i *)p_buffer;
+    _mm256_storeu_si256(p + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+    _mm256_storeu_si256(p + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+    _mm256_storeu_si256(p + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+    _mm256_storeu_si256(p + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+#define AVX2_UNPACK_32_ARGB AVX2_Store32(p_buffer, b, g, r, zero)
+#define AVX2_UNPACK_32_RGBA AVX2_Store32(p_buffer, zero, b, g, r)
+#define AVX2_UNPACK_32_BGRA AVX2_Store32(p_buffer, zero, r, g, b)
+#define AVX2_UNPACK_32_ABGR AVX2_Store32(p_buffer, r, g, b, zero)
+
+/* Converts i_count blocks of 32 pixels, and moves the pointers past them.
+ * The upper halves of the registers are cleared for the SSE2 code that
+ * converts the rest of the line. */
+#define AVX2_CALL_32(AVX2_UNPACK, i_count)                  \
+    do {                                                    \
+        const __m256i zero = _mm256_setzero_si256();        \
+        for( unsigned i_avx2 = (i_count); i_avx2--; )       \
+        {                                                   \
+            __m256i b, g, r;                                \
+            AVX2_YUV(p_y, p_u, p_v, &b, &g, &r);            \
+            AVX2_UNPACK;                                    \
+            p_y += 32;                                      \
+            p_u += 16;                                      \
+            p_v += 16;                                      \
+            p_buffer += 32;                                 \
+        }                                                   \
+        _mm256_zeroupper();                                 \
+    } while(0)
+
+#endif
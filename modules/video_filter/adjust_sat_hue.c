@@ -75,18 +75,22 @@
  *****************************************************************************/
 
 int planar_sat_hue_clip_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_cos,
-                         int i_sat, int i_x, int i_y )
+                         int i_sat, int i_x, int i_y,
+                         unsigned i_first, unsigned i_end )
 {
     uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint8_t *p_out, *p_out_v;
 
-    p_in = p_pic->p[U_PLANE].p_pixels;
-    p_in_v = p_pic->p[V_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[U_PLANE].i_visible_lines
-                      * p_pic->p[U_PLANE].i_pitch - 8;
+    p_in = p_pic->p[U_PLANE].p_pixels
+         + i_first * p_pic->p[U_PLANE].i_pitch;
+    p_in_v = p_pic->p[V_PLANE].p_pixels
+           + i_first * p_pic->p[V_PLANE].i_pitch;
+    p_in_end = p_in + ( i_end - i_first ) * p_pic->p[U_PLANE].i_pitch - 8;
 
-    p_out = p_outpic->p[U_PLANE].p_pixels;
-    p_out_v = p_outpic->p[V_PLANE].p_pixels;
+    p_out = p_outpic->p[U_PLANE].p_pixels
+          + i_first * p_outpic->p[U_PLANE].i_pitch;
+    p_out_v = p_outpic->p[V_PLANE].p_pixels
+            + i_first * p_outpic->p[V_PLANE].i_pitch;
 
     uint8_t i_u, i_v;
 
@@ -121,18 +125,22 @@ int planar_sat_hue_clip_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, i
 }
 
 int planar_sat_hue_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_cos,
-                         int i_sat, int i_x, int i_y )
+                         int i_sat, int i_x, int i_y,
+                         unsigned i_first, unsigned i_end )
 {
     uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint8_t *p_out, *p_out_v;
 
-    p_in = p_pic->p[U_PLANE].p_pixels;
-    p_in_v = p_pic->p[V_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[U_PLANE].i_visible_lines
-                      * p_pic->p[U_PLANE].i_pitch - 8;
+    p_in = p_pic->p[U_PLANE].p_pixels
+         + i_first * p_pic->p[U_PLANE].i_pitch;
+    p_in_v = p_pic->p[V_PLANE].p_pixels
+           + i_first * p_pic->p[V_PLANE].i_pitch;
+    p_in_end = p_in + ( i_end - i_first ) * p_pic->p[U_PLANE].i_pitch - 8;
 
-    p_out = p_outpic->p[U_PLANE].p_pixels;
-    p_out_v = p_outpic->p[V_PLANE].p_pixels;
+    p_out = p_outpic->p[U_PLANE].p_pixels
+          + i_first * p_outpic->p[U_PLANE].i_pitch;
+    p_out_v = p_outpic->p[V_PLANE].p_pixels
+            + i_first * p_outpic->p[V_PLANE].i_pitch;
 
     uint8_t i_u, i_v;
 
@@ -167,7 +175,8 @@ int planar_sat_hue_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_
 }
 
 int planar_sat_hue_clip_C_16( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_cos,
-                         int i_sat, int i_x, int i_y )
+                         int i_sat, int i_x, int i_y,
+                         unsigned i_first, unsigned i_end )
 {
     uint16_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint16_t *p_out, *p_out_v;
@@ -185,13 +194,17 @@ int planar_sat_hue_clip_C_16( picture_t * p_pic, picture_t * p_outpic, int i_sin
             vlc_assert_unreachable();
     }
 
-    p_in = (uint16_t *) p_pic->p[U_PLANE].p_pixels;
-    p_in_v = (uint16_t *) p_pic->p[V_PLANE].p_pixels;
-    p_in_end = p_in + p_pic->p[U_PLANE].i_visible_lines
+    p_in = (uint16_t *) ( p_pic->p[U_PLANE].p_pixels
+                         + i_first * p_pic->p[U_PLANE].i_pitch );
+    p_in_v = (uint16_t *) ( p_pic->p[V_PLANE].p_pixels
+                           + i_first * p_pic->p[V_PLANE].i_pitch );
+    p_in_end = p_in + ( i_end - i_first )
         * (p_pic->p[U_PLANE].i_pitch >> 1) - 8;
 
-    p_out = (uint16_t *) p_outpic->p[U_PLANE].p_pixels;
-    p_out_v = (uint16_t *) p_outpic->p[V_PLANE].p_pixels;
+    p_out = (uint16_t *) ( p_outpic->p[U_PLANE].p_pixels
+                          + i_first * p_outpic->p[U_PLANE].i_pitch );
+    p_out_v = (uint16_t *) ( p_outpic->p[V_PLANE].p_pixels
+                            + i_first * p_outpic->p[V_PLANE].i_pitch );
 
     uint16_t i_u, i_v;
 
@@ -226,7 +239,8 @@ int planar_sat_hue_clip_C_16( picture_t * p_pic, picture_t * p_outpic, int i_sin
 }
 
 int planar_sat_hue_C_16( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_cos,
-                            int i_sat, int i_x, int i_y )
+                            int i_sat, int i_x, int i_y,
+                            unsigned i_first, unsigned i_end )
 {
     uint16_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint16_t *p_out, *p_out_v;
@@ -244,13 +258,17 @@ int planar_sat_hue_C_16( picture_t * p_pic, picture_t * p_outpic, int i_sin, int
             vlc_assert_unreachable();
     }
 
-    p_in = (uint16_t *) p_pic->p[U_PLANE].p_pixels;
-    p_in_v = (uint16_t *) p_pic->p[V_PLANE].p_pixels;
-    p_in_end = (uint16_t *) p_in + p_pic->p[U_PLANE].i_visible_lines
+    p_in = (uint16_t *) ( p_pic->p[U_PLANE].p_pixels
+                         + i_first * p_pic->p[U_PLANE].i_pitch );
+    p_in_v = (uint16_t *) ( p_pic->p[V_PLANE].p_pixels
+                           + i_first * p_pic->p[V_PLANE].i_pitch );
+    p_in_end = (uint16_t *) p_in + ( i_end - i_first )
         * (p_pic->p[U_PLANE].i_pitch >> 1) - 8;
 
-    p_out = (uint16_t *) p_outpic->p[U_PLANE].p_pixels;
-    p_out_v = (uint16_t *) p_outpic->p[V_PLANE].p_pixels;
+    p_out = (uint16_t *) ( p_outpic->p[U_PLANE].p_pixels
+                          + i_first * p_outpic->p[U_PLANE].i_pitch );
+    p_out_v = (uint16_t *) ( p_outpic->p[V_PLANE].p_pixels
+                            + i_first * p_outpic->p[V_PLANE].i_pitch );
 
     uint16_t i_u, i_v;
 
@@ -285,29 +303,29 @@ int planar_sat_hue_C_16( picture_t * p_pic, picture_t * p_outpic, int i_sin, int
 }
 
 int packed_sat_hue_clip_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, int i_cos,
-                         int i_sat, int i_x, int i_y )
+                         int i_sat, int i_x, int i_y,
+                         unsigned i_first, unsigned i_end )
 {
     uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint8_t *p_out, *p_out_v;
 
     int i_y_offset, i_u_offset, i_v_offset;
-    int i_visible_lines, i_pitch, i_visible_pitch;
+    int i_pitch, i_visible_pitch;
 
 
     if ( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
                               &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
         return VLC_EGENERIC;
 
-    i_visible_lines = p_pic->p->i_visible_lines;
     i_pitch = p_pic->p->i_pitch;
     i_visible_pitch = p_pic->p->i_visible_pitch;
 
-    p_in = p_pic->p->p_pixels + i_u_offset;
-    p_in_v = p_pic->p->p_pixels + i_v_offset;
-    p_in_end = p_in + i_visible_lines * i_pitch - 8 * 4;
+    p_in = p_pic->p->p_pixels + i_first * i_pitch + i_u_offset;
+    p_in_v = p_pic->p->p_pixels + i_first * i_pitch + i_v_offset;
+    p_in_end = p_in + ( i_end - i_first ) * i_pitch - 8 * 4;
 
-    p_out = p_outpic->p->p_pixels + i_u_offset;
-    p_out_v = p_outpic->p->p_pixels + i_v_offset;
+    p_out = p_outpic->p->p_pixels + i_first * i_pitch + i_u_offset;
+    p_out_v = p_outpic->p->p_pixels + i_first * i_pitch + i_v_offset;
 
     uint8_t i_u, i_v;
 
@@ -338,29 +356,29 @@ int packed_sat_hue_clip_C( picture_t * p_pic, picture_t * p_outpic, int i_sin, i
 }
 
 int packed_sat_hue_C( picture_t * p_pic, picture_t * p_outpic, int i_sin,
-                      int i_cos, int i_sat, int i_x, int i_y )
+                      int i_cos, int i_sat, int i_x, int i_y,
+                         unsigned i_first, unsigned i_end )
 {
     uint8_t *p_in, *p_in_v, *p_in_end, *p_line_end;
     uint8_t *p_out, *p_out_v;
 
     int i_y_offset, i_u_offset, i_v_offset;
-    int i_visible_lines, i_pitch, i_visible_pitch;
+    int i_pitch, i_visible_pitch;
 
 
     if ( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
                               &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
         return VLC_EGENERIC;
 
-    i_visible_lines = p_pic->p->i_visible_lines;
     i_pitch = p_pic->p->i_pitch;
     i_visible_pitch = p_pic->p->i_visible_pitch;
 
-    p_in = p_pic->p->p_pixels + i_u_offset;
-    p_in_v = p_pic->p->p_pixels + i_v_offset;
-    p_in_end = p_in + i_visible_lines * i_pitch - 8 * 4;
+    p_in = p_pic->p->p_pixels + i_first * i_pitch + i_u_offset;
+    p_in_v = p_pic->p->p_pixels + i_first * i_pitch + i_v_offset;
+    p_in_end = p_in + ( i_end - i_first ) * i_pitch - 8 * 4;
 
-    p_out = p_outpic->p->p_pixels + i_u_offset;
-    p_out_v = p_outpic->p->p_pixels + i_v_offset;
+    p_out = p_outpic->p->p_pixels + i_first * i_pitch + i_u_offset;
+    p_out_v = p_outpic->p->p_pixels + i_first * i_pitch + i_v_offset;
 
     uint8_t i_u, i_v;
 
@@ -93,6 +93,15 @@
                                     "in the Phosphor framerate doubler. "\
                                     "Default: Low.")
 
+#define LOOKAHEAD_TEXT N_("Lookahead depth")
+#define LOOKAHEAD_LONGTEXT N_("Number of input frames to deinterlace ahead "\
+                              "on a separate thread, while the previous "\
+                              "frames are being displayed or encoded. "\
+                              "This delays the output by as many frames. "\
+                              "Useful for transcoding high resolution "\
+                              "interlaced sources in real time. "\
+                              "Default: 0 (disabled).")
+
 vlc_module_begin ()
     set_description( N_("Deinterlacing video filter") )
     set_shortname( N_("Deinterlace" ))
@@ -112,6 +121,9 @@ vlc_module_begin ()
                 PHOSPHOR_DIMMER_LONGTEXT, true )
         change_integer_list( phosphor_dimmer_list, phosphor_dimmer_list_text )
         change_safe ()
+    add_integer_with_range( FILTER_CFG_PREFIX "lookahead", 0, 0, LOOKAHEAD_MAX,
+                            LOOKAHEAD_TEXT, LOOKAHEAD_LONGTEXT, true )
+        change_safe ()
     add_shortcut( "deinterlace" )
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -127,7 +139,7 @@ vlc_module_end ()
  * and reading logic for them implemented in Open().
  */
 static const char *const ppsz_filter_options[] = {
-    "mode", "phosphor-chroma", "phosphor-dimmer",
+    "mode", "phosphor-chroma", "phosphor-dimmer", "lookahead",
     NULL
 };
 
@@ -279,6 +291,23 @@ static void GetOutputFormat( filter_t *p_filter,
 
 #define DEINTERLACE_DST_SIZE 3
 
+/* In pipelined mode, the output pictures were allocated by the caller */
+static picture_t *NewOutputPicture( filter_t *p_filter )
+{
+    pipeline_sys_t *p_pipe = &p_filter->p_sys->pipeline;
+
+    if( p_pipe->i_lookahead == 0 )
+        return filter_NewPicture( p_filter );
+
+    picture_t *p_pic = p_pipe->p_dst;
+    if( p_pic != NULL )
+    {
+        p_pipe->p_dst = p_pic->p_next;
+        p_pic->p_next = NULL;
+    }
+    return p_pic;
+}
+
 /* This is the filter function. See Open(). */
 picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
 {
@@ -286,7 +315,7 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
     picture_t *p_dst[DEINTERLACE_DST_SIZE];
 
     /* Request output picture */
-    p_dst[0] = filter_NewPicture( p_filter );
+    p_dst[0] = NewOutputPicture( p_filter );
     if( p_dst[0] == NULL )
     {
         picture_Release( p_pic );
@@ -411,7 +440,7 @@ picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic )
         for( int i = 1; i < i_double_rate_alloc_end ; ++i )
         {
             p_dst[i-1]->p_next =
-            p_dst[i]           = filter_NewPicture( p_filter );
+            p_dst[i]           = NewOutputPicture( p_filter );
             if( p_dst[i] )
             {
                 picture_CopyProperties( p_dst[i], p_pic );
@@ -558,6 +587,170 @@ drop:
     return NULL;
 }
 
+/*****************************************************************************
+ * Pipelined mode
+ *****************************************************************************/
+
+static void ReleasePictures( picture_t *p_pic )
+{
+    while( p_pic != NULL )
+    {
+        picture_t *p_next = p_pic->p_next;
+        p_pic->p_next = NULL;
+        picture_Release( p_pic );
+        p_pic = p_next;
+    }
+}
+
+static void *PipelineThread( void *data )
+{
+    filter_t *p_filter = data;
+    pipeline_sys_t *p_pipe = &p_filter->p_sys->pipeline;
+
+    vlc_mutex_lock( &p_pipe->lock );
+    for( ;; )
+    {
+        while( p_pipe->i_queued == 0 && !p_pipe->b_closing )
+            vlc_cond_wait( &p_pipe->wait_work, &p_pipe->lock );
+        if( p_pipe->i_queued == 0 )
+            break;
+
+        pipeline_frame_t frame = p_pipe->frames[p_pipe->i_first];
+        p_pipe->i_first = (p_pipe->i_first + 1) % LOOKAHEAD_MAX;
+        p_pipe->i_queued--;
+        vlc_mutex_unlock( &p_pipe->lock );
+
+        /* The history and metadata are only ever touched by this thread
+           while frames are in flight. */
+        p_pipe->p_dst = frame.p_dst;
+        picture_t *p_out = Deinterlace( p_filter, frame.p_pic );
+        ReleasePictures( p_pipe->p_dst );
+        p_pipe->p_dst = NULL;
+
+        vlc_mutex_lock( &p_pipe->lock );
+        *p_pipe->pp_out_last = p_out;
+        while( *p_pipe->pp_out_last != NULL )
+            p_pipe->pp_out_last = &(*p_pipe->pp_out_last)->p_next;
+        p_pipe->i_pending--;
+        vlc_cond_broadcast( &p_pipe->wait_done );
+    }
+    vlc_mutex_unlock( &p_pipe->lock );
+    return NULL;
+}
+
+/* Takes the rendered output pictures (with the lock held) */
+static picture_t *PipelineDequeue( pipeline_sys_t *p_pipe )
+{
+    picture_t *p_out = p_pipe->p_out;
+
+    p_pipe->p_out = NULL;
+    p_pipe->pp_out_last = &p_pipe->p_out;
+    return p_out;
+}
+
+picture_t *DeinterlacePipelined( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    pipeline_sys_t *p_pipe = &p_sys->pipeline;
+    picture_t *p_out;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_pipe->lock );
+    while( p_pipe->i_pending >= p_pipe->i_lookahead )
+        vlc_cond_wait( &p_pipe->wait_done, &p_pipe->lock );
+    vlc_mutex_unlock( &p_pipe->lock );
+
+    /* Allocate the output pictures here: the owner allocator may only be
+       called from this thread. Framerate doublers may render as many
+       pictures as the current or the previous frame has fields, depending
+       on the frame offset. */
+    int i_dst = 1;
+    if( p_sys->b_double_rate )
+    {
+        i_dst = __MAX( p_pic->i_nb_fields, p_pipe->i_last_nb_fields );
+        i_dst = VLC_CLIP( i_dst, 1, DEINTERLACE_DST_SIZE );
+    }
+    p_pipe->i_last_nb_fields = p_pic->i_nb_fields;
+
+    picture_t *p_dst = NULL, **pp_dst_last = &p_dst;
+    for( int i = 0; i < i_dst; i++ )
+    {
+        picture_t *p_new = filter_NewPicture( p_filter );
+        if( p_new == NULL )
+            break;
+        *pp_dst_last = p_new;
+        pp_dst_last = &p_new->p_next;
+    }
+
+    vlc_mutex_lock( &p_pipe->lock );
+    if( likely(p_dst != NULL) )
+    {
+        unsigned i_last = (p_pipe->i_first + p_pipe->i_queued) % LOOKAHEAD_MAX;
+
+        p_pic->p_next = NULL;
+        p_pipe->frames[i_last].p_pic = p_pic;
+        p_pipe->frames[i_last].p_dst = p_dst;
+        p_pipe->i_queued++;
+        p_pipe->i_pending++;
+        vlc_cond_signal( &p_pipe->wait_work );
+    }
+    else /* drop the frame, as Deinterlace() does */
+        picture_Release( p_pic );
+
+    p_out = PipelineDequeue( p_pipe );
+    vlc_mutex_unlock( &p_pipe->lock );
+
+    vlc_restorecancel( canc );
+    return p_out;
+}
+
+picture_t *DrainPipelined( filter_t *p_filter, bool b_wait )
+{
+    pipeline_sys_t *p_pipe = &p_filter->p_sys->pipeline;
+    picture_t *p_out;
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_pipe->lock );
+    while( b_wait && p_pipe->i_pending > 0 )
+        vlc_cond_wait( &p_pipe->wait_done, &p_pipe->lock );
+    p_out = PipelineDequeue( p_pipe );
+    vlc_mutex_unlock( &p_pipe->lock );
+
+    vlc_restorecancel( canc );
+    return p_out;
+}
+
+/**
+ * Discards the frames in flight, and waits for the worker thread to be idle.
+ */
+static void PipelineDiscard( filter_t *p_filter )
+{
+    pipeline_sys_t *p_pipe = &p_filter->p_sys->pipeline;
+    pipeline_frame_t frames[LOOKAHEAD_MAX];
+    unsigned i_queued;
+    picture_t *p_out;
+
+    vlc_mutex_lock( &p_pipe->lock );
+    i_queued = p_pipe->i_queued;
+    for( unsigned i = 0; i < i_queued; i++ )
+        frames[i] = p_pipe->frames[(p_pipe->i_first + i) % LOOKAHEAD_MAX];
+    p_pipe->i_queued = 0;
+    p_pipe->i_pending -= i_queued;
+
+    while( p_pipe->i_pending > 0 )
+        vlc_cond_wait( &p_pipe->wait_done, &p_pipe->lock );
+
+    p_out = PipelineDequeue( p_pipe );
+    vlc_mutex_unlock( &p_pipe->lock );
+
+    for( unsigned i = 0; i < i_queued; i++ )
+    {
+        picture_Release( frames[i].p_pic );
+        ReleasePictures( frames[i].p_dst );
+    }
+    ReleasePictures( p_out );
+}
+
 /*****************************************************************************
  * Flush
  *****************************************************************************/
@@ -566,6 +759,12 @@ void Flush( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    if( p_sys->pipeline.i_lookahead > 0 )
+    {
+        PipelineDiscard( p_filter );
+        p_sys->pipeline.i_last_nb_fields = 2;
+    }
+
     for( int i = 0; i < METADATA_SIZE; i++ )
     {
         p_sys->meta.pi_date[i] = VLC_TS_INVALID;
@@ -644,6 +843,7 @@ notsupp:
         return VLC_ENOMEM;
 
     p_sys->chroma = chroma;
+    p_sys->pipeline.i_lookahead = 0;
 
     config_ChainParse( p_filter, FILTER_CFG_PREFIX, ppsz_filter_options,
                        p_filter->p_cfg );
@@ -669,6 +869,22 @@ notsupp:
         p_sys->pf_merge = MergeAltivec;
     else
 #endif
+#if defined(CAN_COMPILE_AVX512)
+    if( vlc_CPU_AVX512() )
+    {
+        p_sys->pf_merge = pixel_size == 1 ? Merge8BitAVX512 : Merge16BitAVX512;
+        p_sys->pf_end_merge = NULL;
+    }
+    else
+#endif
+#if defined(CAN_COMPILE_AVX2)
+    if( vlc_CPU_AVX2() )
+    {
+        p_sys->pf_merge = pixel_size == 1 ? Merge8BitAVX2 : Merge16BitAVX2;
+        p_sys->pf_end_merge = NULL;
+    }
+    else
+#endif
 #if defined(CAN_COMPILE_SSE2)
     if( vlc_CPU_SSE2() )
     {
@@ -763,6 +979,42 @@ notsupp:
     p_filter->fmt_out.video = fmt;
     p_filter->fmt_out.i_codec = fmt.i_chroma;
     p_filter->pf_video_filter = Deinterlace;
+
+    /* Pipelined mode */
+    pipeline_sys_t *p_pipe = &p_sys->pipeline;
+    unsigned i_lookahead = var_GetInteger( p_filter,
+                                           FILTER_CFG_PREFIX "lookahead" );
+    if( i_lookahead > 0 )
+    {
+        vlc_mutex_init( &p_pipe->lock );
+        vlc_cond_init( &p_pipe->wait_work );
+        vlc_cond_init( &p_pipe->wait_done );
+        p_pipe->i_first = 0;
+        p_pipe->i_queued = 0;
+        p_pipe->p_out = NULL;
+        p_pipe->pp_out_last = &p_pipe->p_out;
+        p_pipe->i_pending = 0;
+        p_pipe->b_closing = false;
+        p_pipe->i_last_nb_fields = 2;
+        p_pipe->p_dst = NULL;
+
+        if( vlc_clone( &p_pipe->thread, PipelineThread, p_filter,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            msg_Err( p_filter, "cannot start the lookahead thread" );
+            vlc_cond_destroy( &p_pipe->wait_done );
+            vlc_cond_destroy( &p_pipe->wait_work );
+            vlc_mutex_destroy( &p_pipe->lock );
+        }
+        else
+        {
+            p_pipe->i_lookahead = i_lookahead;
+            p_filter->pf_video_filter = DeinterlacePipelined;
+            p_filter->pf_video_drain = DrainPipelined;
+            msg_Dbg( p_filter, "using a lookahead of %u frame(s)",
+                     i_lookahead );
+        }
+    }
     p_filter->pf_flush = Flush;
     p_filter->pf_video_mouse  = Mouse;
 
@@ -778,7 +1030,21 @@ notsupp:
 void Close( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t*)p_this;
+    pipeline_sys_t *p_pipe = &p_filter->p_sys->pipeline;
 
     Flush( p_filter );
+
+    if( p_pipe->i_lookahead > 0 )
+    {
+        vlc_mutex_lock( &p_pipe->lock );
+        p_pipe->b_closing = true;
+        vlc_cond_signal( &p_pipe->wait_work );
+        vlc_mutex_unlock( &p_pipe->lock );
+        vlc_join( p_pipe->thread, NULL );
+
+        vlc_cond_destroy( &p_pipe->wait_done );
+        vlc_cond_destroy( &p_pipe->wait_work );
+        vlc_mutex_destroy( &p_pipe->lock );
+    }
     free( p_filter->p_sys );
 }
@@ -84,6 +84,48 @@ typedef struct {
 
 #define HISTORY_SIZE (3)
 #define CUSTOM_PTS -1
+
+#define LOOKAHEAD_MAX (16)
+/**
+ * Input frame queued in pipelined mode, with its output pictures.
+ */
+typedef struct {
+    picture_t *p_pic;  /**< Input frame */
+    picture_t *p_dst;  /**< Output pictures allocated by the filter caller */
+} pipeline_frame_t;
+
+/**
+ * Pipelined mode state.
+ *
+ * When the lookahead depth is non-zero, input frames are queued and rendered
+ * by a worker thread, while Deinterlace() returns the frames rendered so far.
+ * Up to i_lookahead input frames are in flight at any time.
+ *
+ * The output pictures are allocated by the calling thread when the input
+ * frame is queued, as the picture allocator of the filter owner is not
+ * necessarily thread-safe (e.g. in the video output).
+ * @see DeinterlacePipelined()
+ */
+typedef struct {
+    unsigned     i_lookahead; /**< Lookahead depth, 0 if synchronous */
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait_work;   /**< An input frame was queued, or closing */
+    vlc_cond_t   wait_done;   /**< An input frame was rendered */
+    pipeline_frame_t frames[LOOKAHEAD_MAX]; /**< Queued input frames */
+    unsigned     i_first;     /**< Index of the oldest queued frame */
+    unsigned     i_queued;    /**< Number of queued frames */
+    picture_t   *p_out;       /**< Rendered output frames */
+    picture_t  **pp_out_last;
+    unsigned     i_pending;   /**< Input frames queued or being rendered */
+    bool         b_closing;
+
+    /* Owned by the calling thread */
+    int          i_last_nb_fields; /**< Fields of the previous input frame */
+
+    /* Owned by the worker thread */
+    picture_t   *p_dst;       /**< Output pictures for the current frame */
+} pipeline_sys_t;
 /**
  * Top-level deinterlace subsystem state.
  */
@@ -121,6 +163,8 @@ struct filter_sys_t
     /* Algorithm-specific substructures */
     phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
     ivtc_sys_t ivtc;         /**< IVTC algorithm state. */
+
+    pipeline_sys_t pipeline; /**< Pipelined mode state. */
 };
 
 /*****************************************************************************
@@ -131,7 +175,7 @@ struct filter_sys_t
  * Top-level filtering method.
  *
  * Open() sets this up as the processing method (pf_video_filter)
- * in the filter structure.
+ * in the filter structure, unless the lookahead depth is non-zero.
  *
  * Note that there is no guarantee that the returned picture directly
  * corresponds to p_pic. The first few times, the filter may not even
@@ -161,6 +205,10 @@ struct filter_sys_t
  *                                with an offset of one frame (in most cases)
  *                                and framerate conversion.
  *
+ * In pipelined mode (see pipeline_sys_t), this is run by the worker thread
+ * for each queued input picture, instead of directly by the filter chain,
+ * and renders into the output pictures allocated by DeinterlacePipelined().
+ *
  * @param p_filter The filter instance.
  * @param p_pic The latest input picture.
  * @return Deinterlaced picture(s). Linked list of picture_t's or NULL.
@@ -170,6 +218,44 @@ struct filter_sys_t
  */
 picture_t *Deinterlace( filter_t *p_filter, picture_t *p_pic );
 
+/**
+ * Pipelined filtering method.
+ *
+ * Open() sets this up as the processing method (pf_video_filter) when the
+ * lookahead depth is non-zero. It queues p_pic for the worker thread, which
+ * runs Deinterlace() on it, and returns the output pictures that the worker
+ * has rendered since the previous call. The output pictures for p_pic are
+ * allocated here, on the calling thread.
+ *
+ * If i_lookahead input pictures are already in flight, this waits for the
+ * oldest one to be rendered first. The filter output is thus delayed by
+ * i_lookahead input frames, in exchange for rendering a frame while the
+ * previous ones are being displayed or encoded.
+ *
+ * @param p_filter The filter instance.
+ * @param p_pic The latest input picture.
+ * @return Deinterlaced picture(s). Linked list of picture_t's or NULL.
+ * @see Deinterlace()
+ * @see pipeline_sys_t
+ */
+picture_t *DeinterlacePipelined( filter_t *p_filter, picture_t *p_pic );
+
+/**
+ * Pipelined drain method.
+ *
+ * Open() sets this up as the drain method (pf_video_drain) when the
+ * lookahead depth is non-zero. It returns the output pictures that were
+ * not returned yet, after waiting for the frames in flight to be rendered
+ * if b_wait is true. The algorithm state is kept, so that filtering can go
+ * on afterwards.
+ *
+ * @param p_filter The filter instance.
+ * @param b_wait Whether to wait for the frames in flight.
+ * @return Deinterlaced picture(s). Linked list of picture_t's or NULL.
+ * @see DeinterlacePipelined()
+ */
+picture_t *DrainPipelined( filter_t *p_filter, bool b_wait );
+
 /**
  * Reads the configuration, sets up and starts the filter.
  *
@@ -197,6 +283,9 @@ int Open( vlc_object_t *p_this );
  * Resets the filter state, including resetting all algorithm-specific state
  * and discarding all histories, but does not stop the filter.
  *
+ * In pipelined mode, the queued input frames and the rendered output frames
+ * that were not returned yet are discarded as well.
+ *
  * Open() sets this up as the flush method (pf_flush)
  * in the filter structure.
  *
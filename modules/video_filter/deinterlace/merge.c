@@ -38,6 +38,10 @@
 #   include "mmx.h"
 #endif
 
+#if defined(CAN_COMPILE_AVX2) || defined(CAN_COMPILE_AVX512)
+#   include <immintrin.h>
+#endif
+
 #ifdef HAVE_ALTIVEC_H
 #   include <altivec.h>
 #endif
@@ -178,6 +182,142 @@ void Merge16BitSSE2( void *_p_dest, const void *_p_s1, const void *_p_s2,
 
 #endif
 
+#if defined(CAN_COMPILE_AVX2)
+VLC_AVX2
+void Merge8BitAVX2( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                    size_t i_bytes )
+{
+    uint8_t *p_dest = _p_dest;
+    const uint8_t *p_s1 = _p_s1;
+    const uint8_t *p_s2 = _p_s2;
+
+    for( ; i_bytes >= 32; i_bytes -= 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)p_s1 );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)p_s2 );
+        _mm256_storeu_si256( (__m256i *)p_dest, _mm256_avg_epu8( a, b ) );
+        p_dest += 32;
+        p_s1 += 32;
+        p_s2 += 32;
+    }
+
+    /* same rounding as the SSE2 version on 16 bytes multiples */
+    for( ; i_bytes >= 16; i_bytes -= 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)p_s1 );
+        __m128i b = _mm_loadu_si128( (const __m128i *)p_s2 );
+        _mm_storeu_si128( (__m128i *)p_dest, _mm_avg_epu8( a, b ) );
+        p_dest += 16;
+        p_s1 += 16;
+        p_s2 += 16;
+    }
+
+    for( ; i_bytes > 0; i_bytes-- )
+        *p_dest++ = ( *p_s1++ + *p_s2++ ) >> 1;
+}
+
+VLC_AVX2
+void Merge16BitAVX2( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                     size_t i_bytes )
+{
+    uint16_t *p_dest = _p_dest;
+    const uint16_t *p_s1 = _p_s1;
+    const uint16_t *p_s2 = _p_s2;
+
+    size_t i_words = i_bytes / 2;
+    for( ; i_words >= 16; i_words -= 16 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)p_s1 );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)p_s2 );
+        _mm256_storeu_si256( (__m256i *)p_dest, _mm256_avg_epu16( a, b ) );
+        p_dest += 16;
+        p_s1 += 16;
+        p_s2 += 16;
+    }
+
+    for( ; i_words >= 8; i_words -= 8 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)p_s1 );
+        __m128i b = _mm_loadu_si128( (const __m128i *)p_s2 );
+        _mm_storeu_si128( (__m128i *)p_dest, _mm_avg_epu16( a, b ) );
+        p_dest += 8;
+        p_s1 += 8;
+        p_s2 += 8;
+    }
+
+    for( ; i_words > 0; i_words-- )
+        *p_dest++ = ( *p_s1++ + *p_s2++ ) >> 1;
+}
+#endif
+
+#if defined(CAN_COMPILE_AVX512)
+VLC_AVX512
+void Merge8BitAVX512( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                      size_t i_bytes )
+{
+    uint8_t *p_dest = _p_dest;
+    const uint8_t *p_s1 = _p_s1;
+    const uint8_t *p_s2 = _p_s2;
+
+    for( ; i_bytes >= 64; i_bytes -= 64 )
+    {
+        __m512i a = _mm512_loadu_si512( p_s1 );
+        __m512i b = _mm512_loadu_si512( p_s2 );
+        _mm512_storeu_si512( p_dest, _mm512_avg_epu8( a, b ) );
+        p_dest += 64;
+        p_s1 += 64;
+        p_s2 += 64;
+    }
+
+    /* same rounding as the SSE2 version on 16 bytes multiples */
+    for( ; i_bytes >= 16; i_bytes -= 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)p_s1 );
+        __m128i b = _mm_loadu_si128( (const __m128i *)p_s2 );
+        _mm_storeu_si128( (__m128i *)p_dest, _mm_avg_epu8( a, b ) );
+        p_dest += 16;
+        p_s1 += 16;
+        p_s2 += 16;
+    }
+
+    for( ; i_bytes > 0; i_bytes-- )
+        *p_dest++ = ( *p_s1++ + *p_s2++ ) >> 1;
+}
+
+VLC_AVX512
+void Merge16BitAVX512( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                       size_t i_bytes )
+{
+    uint16_t *p_dest = _p_dest;
+    const uint16_t *p_s1 = _p_s1;
+    const uint16_t *p_s2 = _p_s2;
+
+    size_t i_words = i_bytes / 2;
+    for( ; i_words >= 32; i_words -= 32 )
+    {
+        __m512i a = _mm512_loadu_si512( p_s1 );
+        __m512i b = _mm512_loadu_si512( p_s2 );
+        _mm512_storeu_si512( p_dest, _mm512_avg_epu16( a, b ) );
+        p_dest += 32;
+        p_s1 += 32;
+        p_s2 += 32;
+    }
+
+    for( ; i_words >= 8; i_words -= 8 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)p_s1 );
+        __m128i b = _mm_loadu_si128( (const __m128i *)p_s2 );
+        _mm_storeu_si128( (__m128i *)p_dest, _mm_avg_epu16( a, b ) );
+        p_dest += 8;
+        p_s1 += 8;
+        p_s2 += 8;
+    }
+
+    for( ; i_words > 0; i_words-- )
+        *p_dest++ = ( *p_s1++ + *p_s2++ ) >> 1;
+}
+#endif
+
 #ifdef CAN_COMPILE_C_ALTIVEC
 void MergeAltivec( void *_p_dest, const void *_p_s1,
                    const void *_p_s2, size_t i_bytes )
@@ -147,3 +147,75 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#if defined(CAN_COMPILE_AVX2) || defined(CAN_COMPILE_AVX512)
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+
+#ifdef CAN_COMPILE_AVX2
+// ================= AVX2 =================
+#define HAVE_YADIF_AVX2
+#define STEP 16
+#define V_VEC __m256i
+#define V_MASK __m256i
+#define V_OP(op) _mm256_ ## op
+#define V_ZERO _mm256_setzero_si256()
+#define V_ALL _mm256_set1_epi16(-1)
+#define V_LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define V_STORE(p, v) _mm_storeu_si128((__m128i *)(p), \
+    _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)))
+#define V_LT(a, b) _mm256_cmpgt_epi16(b, a)
+#define V_AND(m1, m2) _mm256_and_si256(m1, m2)
+#define V_BLEND(m, a, b) _mm256_blendv_epi8(a, b, m)
+#define VLC_TARGET VLC_AVX2
+#define RENAME(a) a ## _avx2
+#include "yadif_avx_template.h"
+#undef STEP
+#undef V_VEC
+#undef V_MASK
+#undef V_OP
+#undef V_ZERO
+#undef V_ALL
+#undef V_LOAD
+#undef V_STORE
+#undef V_LT
+#undef V_AND
+#undef V_BLEND
+#undef VLC_TARGET
+#undef RENAME
+#endif
+
+#ifdef CAN_COMPILE_AVX512
+// ================ AVX-512 ================
+#define HAVE_YADIF_AVX512
+#define STEP 32
+#define V_VEC __m512i
+#define V_MASK __mmask32
+#define V_OP(op) _mm512_ ## op
+#define V_ZERO _mm512_setzero_si512()
+#define V_ALL ((__mmask32)-1)
+#define V_LOAD(p) _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(p)))
+#define V_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), _mm512_cvtepi16_epi8(v))
+#define V_LT(a, b) _mm512_cmplt_epi16_mask(a, b)
+#define V_AND(m1, m2) ((m1) & (m2))
+#define V_BLEND(m, a, b) _mm512_mask_blend_epi16(m, a, b)
+#define VLC_TARGET VLC_AVX512
+#define RENAME(a) a ## _avx512
+#include "yadif_avx_template.h"
+#undef STEP
+#undef V_VEC
+#undef V_MASK
+#undef V_OP
+#undef V_ZERO
+#undef V_ALL
+#undef V_LOAD
+#undef V_STORE
+#undef V_LT
+#undef V_AND
+#undef V_BLEND
+#undef VLC_TARGET
+#undef RENAME
+#endif
+
+#endif
+#endif
@@ -0,0 +1,124 @@
+/*****************************************************************************
+ * yadif_avx_template.h: AVX2 and AVX-512 versions of the Yadif line filter
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Same algorithm as yadif_filter_line_c(), STEP pixels at a time in 16-bits
+ * lanes. The vector type, the lane mask type and the operations below are
+ * defined by the includer:
+ *   V_OP(op)        prefixes an intrinsic name with the vector width
+ *   V_ZERO, V_ALL   null vector and full lane mask
+ *   V_LOAD(p)       zero-extends STEP pixels at p
+ *   V_STORE(p, v)   packs and stores STEP pixels at p
+ *   V_LT(a, b)      mask of the lanes where a < b
+ *   V_AND(m1, m2)   intersection of two masks
+ *   V_BLEND(m,a,b)  b in the lanes of m, a elsewhere
+ * The last pixels of the line are left to the C version, so that no more
+ * data is read or written than by the C version. */
+
+#define V_SRL1(a) V_OP(srli_epi16)(a, 1)
+#define V_ADD(a, b) V_OP(add_epi16)(a, b)
+#define V_SUB(a, b) V_OP(sub_epi16)(a, b)
+#define V_MIN(a, b) V_OP(min_epi16)(a, b)
+#define V_MAX(a, b) V_OP(max_epi16)(a, b)
+#define V_ABSDIFF(a, b) V_OP(abs_epi16)(V_SUB(a, b))
+
+/* returns the lanes where the score along direction j wins */
+#define V_CHECK(j, m_prev) \
+    ({  V_VEC score = V_ADD(V_ADD( \
+                V_ABSDIFF(V_LOAD(cur+mrefs-1+(j)), V_LOAD(cur+prefs-1-(j))), \
+                V_ABSDIFF(V_LOAD(cur+mrefs  +(j)), V_LOAD(cur+prefs  -(j)))), \
+                V_ABSDIFF(V_LOAD(cur+mrefs+1+(j)), V_LOAD(cur+prefs+1-(j)))); \
+        V_MASK won = V_AND(V_LT(score, spatial_score), m_prev); \
+        spatial_score = V_BLEND(won, spatial_score, score); \
+        spatial_pred = V_BLEND(won, spatial_pred, \
+            V_SRL1(V_ADD(V_LOAD(cur+mrefs+(j)), V_LOAD(cur+prefs-(j))))); \
+        won; })
+
+VLC_TARGET static void RENAME(yadif_filter_line)(uint8_t *dst,
+                              uint8_t *prev, uint8_t *cur, uint8_t *next,
+                              int w, int prefs, int mrefs, int parity, int mode)
+{
+    uint8_t *prev2 = parity ? prev : cur ;
+    uint8_t *next2 = parity ? cur  : next;
+    const V_VEC one = V_OP(set1_epi16)(1);
+    int x;
+
+    for (x = 0; x + STEP <= w; x += STEP) {
+        V_VEC c = V_LOAD(cur+mrefs);
+        V_VEC e = V_LOAD(cur+prefs);
+        V_VEC p2 = V_LOAD(prev2);
+        V_VEC n2 = V_LOAD(next2);
+        V_VEC d = V_SRL1(V_ADD(p2, n2));
+        V_VEC temporal_diff0 = V_ABSDIFF(p2, n2);
+        V_VEC temporal_diff1 = V_SRL1(V_ADD(V_ABSDIFF(V_LOAD(prev+mrefs), c),
+                                            V_ABSDIFF(V_LOAD(prev+prefs), e)));
+        V_VEC temporal_diff2 = V_SRL1(V_ADD(V_ABSDIFF(V_LOAD(next+mrefs), c),
+                                            V_ABSDIFF(V_LOAD(next+prefs), e)));
+        V_VEC diff = V_MAX(V_MAX(V_SRL1(temporal_diff0), temporal_diff1),
+                           temporal_diff2);
+        V_VEC spatial_pred = V_SRL1(V_ADD(c, e));
+        V_VEC spatial_score =
+            V_SUB(V_ADD(V_ADD(V_ABSDIFF(V_LOAD(cur+mrefs-1),
+                                        V_LOAD(cur+prefs-1)),
+                              V_ABSDIFF(c, e)),
+                        V_ABSDIFF(V_LOAD(cur+mrefs+1), V_LOAD(cur+prefs+1))),
+                  one);
+
+        /* direction 2 only counts if direction 1 was better */
+        V_MASK m;
+        m = V_CHECK(-1, V_ALL);
+        (void) V_CHECK(-2, m);
+        m = V_CHECK( 1, V_ALL);
+        (void) V_CHECK( 2, m);
+
+        if (mode < 2) {
+            V_VEC b = V_SRL1(V_ADD(V_LOAD(prev2+2*mrefs), V_LOAD(next2+2*mrefs)));
+            V_VEC f = V_SRL1(V_ADD(V_LOAD(prev2+2*prefs), V_LOAD(next2+2*prefs)));
+            V_VEC de = V_SUB(d, e), dc = V_SUB(d, c);
+            V_VEC bc = V_SUB(b, c), fe = V_SUB(f, e);
+            V_VEC max = V_MAX(V_MAX(de, dc), V_MIN(bc, fe));
+            V_VEC min = V_MIN(V_MIN(de, dc), V_MAX(bc, fe));
+
+            diff = V_MAX(V_MAX(diff, min), V_SUB(V_ZERO, max));
+        }
+
+        spatial_pred = V_MIN(V_MAX(spatial_pred, V_SUB(d, diff)),
+                             V_ADD(d, diff));
+        V_STORE(dst, spatial_pred);
+
+        dst   += STEP;
+        cur   += STEP;
+        prev  += STEP;
+        next  += STEP;
+        prev2 += STEP;
+        next2 += STEP;
+    }
+
+    if (x < w)
+        yadif_filter_line_c(dst, prev, cur, next, w - x, prefs, mrefs,
+                            parity, mode);
+}
+
+#undef V_SRL1
+#undef V_ADD
+#undef V_SUB
+#undef V_MIN
+#undef V_MAX
+#undef V_ABSDIFF
+#undef V_CHECK
@@ -34,6 +34,7 @@
 #include <vlc_memory.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
 #include "filter_picture.h"
 
 #include <math.h>                                          /* exp(), sqrt() */
@@ -186,6 +187,97 @@ static void Destroy( vlc_object_t *p_this )
     free( p_filter->p_sys );
 }
 
+struct gaussianblur_job
+{
+    const filter_sys_t *p_sys;
+    picture_t *p_pic;
+    picture_t *p_outpic;
+    type_t *pt_buffer[PICTURE_PLANE_MAX]; /* horizontal pass of each plane */
+};
+
+static void HorizontalSlice( void *opaque, const vlc_slice_t *p_slice )
+{
+    const struct gaussianblur_job *p_job = opaque;
+    const picture_t *p_pic = p_job->p_pic;
+    const int i_dim = p_job->p_sys->i_dim;
+    const type_t *pt_distribution = p_job->p_sys->pt_distribution;
+
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    {
+        const uint8_t *p_in = p_pic->p[i_plane].p_pixels;
+        type_t *pt_buffer = p_job->pt_buffer[i_plane];
+
+        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
+        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
+        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
+
+        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
+        const int i_end = vlc_slice_End( p_slice, i_visible_lines );
+
+        for( int i_line = vlc_slice_First( p_slice, i_visible_lines );
+             i_line < i_end; i_line++ )
+        {
+            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
+            {
+                type_t t_value = 0;
+                const int c = i_line*i_in_pitch+i_col;
+                for( int x = __MAX( -i_dim, -i_col*(x_factor+1) );
+                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
+                     x++ )
+                {
+                    t_value += pt_distribution[x+i_dim] *
+                               p_in[c+(x>>x_factor)];
+                }
+                pt_buffer[c] = t_value;
+            }
+        }
+    }
+}
+
+static void VerticalSlice( void *opaque, const vlc_slice_t *p_slice )
+{
+    const struct gaussianblur_job *p_job = opaque;
+    const picture_t *p_pic = p_job->p_pic;
+    picture_t *p_outpic = p_job->p_outpic;
+    const int i_dim = p_job->p_sys->i_dim;
+    const type_t *pt_distribution = p_job->p_sys->pt_distribution;
+    const type_t *pt_scale = p_job->p_sys->pt_scale;
+
+    for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    {
+        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
+        const type_t *pt_buffer = p_job->pt_buffer[i_plane];
+
+        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
+        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
+        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
+
+        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
+        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
+        const int i_end = vlc_slice_End( p_slice, i_visible_lines );
+
+        for( int i_line = vlc_slice_First( p_slice, i_visible_lines );
+             i_line < i_end; i_line++ )
+        {
+            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
+            {
+                type_t t_value = 0;
+                const int c = i_line*i_in_pitch+i_col;
+                for( int y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
+                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
+                     y++ )
+                {
+                    t_value += pt_distribution[y+i_dim] *
+                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
+                }
+
+                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
+                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
+            }
+        }
+    }
+}
+
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
@@ -205,12 +297,16 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
     if( !p_sys->pt_buffer )
     {
+        /* Each plane has its own area so that all of them can be processed
+         * by the same bands */
+        size_t i_size = 0;
+        for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+            i_size += p_pic->p[i_plane].i_visible_lines *
+                      p_pic->p[i_plane].i_pitch;
         p_sys->pt_buffer = realloc_or_free( p_sys->pt_buffer,
-                               p_pic->p[Y_PLANE].i_visible_lines *
-                               p_pic->p[Y_PLANE].i_pitch * sizeof( type_t ) );
+                                            i_size * sizeof( type_t ) );
     }
 
-    pt_buffer = p_sys->pt_buffer;
     if( !p_sys->pt_scale )
     {
         const int i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
@@ -243,55 +339,24 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         }
     }
 
-    pt_scale = p_sys->pt_scale;
+    /* The vertical pass reads the horizontal one from the neighbouring
+     * bands, so that it can only start once the latter is complete. */
+    struct gaussianblur_job job = {
+        .p_sys = p_sys,
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+    };
+    pt_buffer = p_sys->pt_buffer;
     for( int i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
     {
-
-        uint8_t *p_in = p_pic->p[i_plane].p_pixels;
-        uint8_t *p_out = p_outpic->p[i_plane].p_pixels;
-
-        const int i_visible_lines = p_pic->p[i_plane].i_visible_lines;
-        const int i_visible_pitch = p_pic->p[i_plane].i_visible_pitch;
-        const int i_in_pitch = p_pic->p[i_plane].i_pitch;
-
-        const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
-        const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
-
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-                const int c = i_line*i_in_pitch+i_col;
-                for( int x = __MAX( -i_dim, -i_col*(x_factor+1) );
-                     x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
-                     x++ )
-                {
-                    t_value += pt_distribution[x+i_dim] *
-                               p_in[c+(x>>x_factor)];
-                }
-                pt_buffer[c] = t_value;
-            }
-        }
-        for( int i_line = 0; i_line < i_visible_lines; i_line++ )
-        {
-            for( int i_col = 0; i_col < i_visible_pitch; i_col++ )
-            {
-                type_t t_value = 0;
-                const int c = i_line*i_in_pitch+i_col;
-                for( int y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
-                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
-                     y++ )
-                {
-                    t_value += pt_distribution[y+i_dim] *
-                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
-                }
-
-                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
-                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
-            }
-        }
+        job.pt_buffer[i_plane] = pt_buffer;
+        pt_buffer += p_pic->p[i_plane].i_visible_lines *
+                     p_pic->p[i_plane].i_pitch;
     }
+    vlc_slices_Run( p_filter, p_pic->p[Y_PLANE].i_visible_lines, 0,
+                    HorizontalSlice, &job );
+    vlc_slices_Run( p_filter, p_pic->p[Y_PLANE].i_visible_lines, 0,
+                    VerticalSlice, &job );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -36,6 +36,7 @@
 #include <vlc_cpu.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -74,6 +75,7 @@ vlc_module_end()
  * Local prototypes
  *****************************************************************************/
 #define FFMAX(a,b) __MAX(a,b)
+#define FFMIN(a,b) __MIN(a,b)
 #ifdef CAN_COMPILE_MMXEXT
 #   define HAVE_MMX2 1
 #else
@@ -173,6 +175,67 @@ static void Close(vlc_object_t *object)
     free(sys);
 }
 
+struct gradfun_job {
+    const filter_sys_t *sys;
+    const video_format_t *fmt;
+    picture_t *src;
+    picture_t *dst;
+    size_t buf_size;
+};
+
+static void CopyLines(plane_t *dstp, const plane_t *srcp, int first, int end)
+{
+    for (int y = first; y < end; y++)
+        memcpy(&dstp->p_pixels[y * dstp->i_pitch],
+               &srcp->p_pixels[y * srcp->i_pitch],
+               __MIN(dstp->i_visible_pitch, srcp->i_visible_pitch));
+}
+
+static void FilterSlice(void *opaque, const vlc_slice_t *slice)
+{
+    const struct gradfun_job *job = opaque;
+    const filter_sys_t *sys = job->sys;
+    struct vf_priv_s cfg = sys->cfg;
+    uint16_t *buf = cfg.buf;
+
+    /* Each band needs its own blur buffer */
+    if (buf && slice->i_index > 0)
+        buf = aligned_alloc(16, job->buf_size);
+
+    for (int i = 0; i < job->dst->i_planes; i++) {
+        const plane_t *srcp = &job->src->p[i];
+        plane_t       *dstp = &job->dst->p[i];
+
+        const vlc_chroma_description_t *chroma = sys->chroma;
+        int w = job->fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
+        int h = job->fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        int r = (cfg.radius  * chroma->p[i].w.num / chroma->p[i].w.den +
+                 cfg.radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
+        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+        if (__MIN(w, h) > 2 * r && cfg.buf) {
+            /* Lines are blurred and filtered by pairs from line r */
+            unsigned count = (h - r + 1) / 2;
+            int first = vlc_slice_First(slice, count);
+            int last  = vlc_slice_End(slice, count);
+
+            if (buf)
+                filter_plane(&cfg, buf, dstp->p_pixels, srcp->p_pixels,
+                             w, h, dstp->i_pitch, srcp->i_pitch, r,
+                             first, last);
+            else if (first < last)
+                CopyLines(dstp, srcp, r + 2 * first, __MIN(h, r + 2 * last));
+        } else {
+            int lines = __MIN(dstp->i_visible_lines, srcp->i_visible_lines);
+
+            CopyLines(dstp, srcp, vlc_slice_First(slice, lines),
+                      vlc_slice_End(slice, lines));
+        }
+    }
+
+    if (slice->i_index > 0)
+        aligned_free(buf);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -198,23 +261,17 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
                                    (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
     }
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
-
-        const vlc_chroma_description_t *chroma = sys->chroma;
-        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
-                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
-        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
-            plane_CopyPixels(dstp, srcp);
-        }
-    }
+    struct gradfun_job job = {
+        .sys      = sys,
+        .fmt      = fmt,
+        .src      = src,
+        .dst      = dst,
+        .buf_size = (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf),
+    };
+    /* Lines are processed by pairs, and each band recomputes the sums of
+     * radius / 2 pairs above it */
+    vlc_slices_Run(filter, fmt->i_height / 2, cfg->radius / 2,
+                   FilterSlice, &job);
 
     picture_CopyProperties(dst, src);
     picture_Release(src);
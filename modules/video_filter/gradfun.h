@@ -222,37 +222,69 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+static void blur_plane(struct vf_priv_s *ctx, uint16_t *dc, uint16_t *buf,
+                       int bstride, uint8_t *src, int sstride, int width,
+                       int y, int r, uint32_t dc_factor)
+{
+    int mod = ((y+r)/2)%r;
+    uint16_t *buf0 = buf+mod*bstride;
+    uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
+    int x, v;
+    ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
+    for (x=v=0; x<r; x++)
+        v += dc[x];
+    for (; x<width/2; x++) {
+        v += dc[x] - dc[x-r];
+        dc[x-r] = v * dc_factor >> 16;
+    }
+    for (; x<(width+r+1)/2; x++)
+        dc[x-r] = v * dc_factor >> 16;
+    for (x=-r/2; x<0; x++)
+        dc[x] = dc[0];
+}
+
+/* Filters the lines of the iterations [first, last[, each one covering two
+ * lines from line r (the first one also covers lines 0 to r-1).
+ * buf_base must be allocated like vf_priv_s.buf. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *buf_base,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int first, int last)
 {
     int bstride = ((width+15)&~15)/2;
     int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = buf_base+16;
+    uint16_t *buf = buf_base+bstride+32;
     int thresh = ctx->thresh;
+    int y_end = r + 2*last;
+
+    if (first >= last)
+        return;
+
+    if (first == 0) {
+        memset(dc, 0, (bstride+16)*sizeof(*buf));
+        for (y=0; y<r; y++)
+            ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
+    } else {
+        /* Rebuild the column sums of the r pairs of lines before the first
+         * blurred one. As they are only used as differences modulo 2^16,
+         * they can start from zero instead of from the top of the plane. */
+        int y_blur = FFMIN(r + 2*first, r + 2*((height-2*r-1)/2));
+        int j = (y_blur+r)/2;
+
+        memset(buf+(j%r)*bstride, 0, bstride*sizeof(*buf));
+        for (int k=j-r+1; k<j; k++)
+            ctx->blur_line(dc, buf+(k%r)*bstride, buf+((k-1)%r)*bstride, src+2*k*sstride, sstride, width/2);
 
-    memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
+        y = r + 2*first;
+        /* Past the bottom blurred line, the last blur is reused */
+        if (y_blur < y)
+            blur_plane(ctx, dc, buf, bstride, src, sstride, width, y_blur, r, dc_factor);
+    }
     for (;;) {
-        if (y < height-r) {
-            int mod = ((y+r)/2)%r;
-            uint16_t *buf0 = buf+mod*bstride;
-            uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
-            int x, v;
-            ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
-            for (x=v=0; x<r; x++)
-                v += dc[x];
-            for (; x<width/2; x++) {
-                v += dc[x] - dc[x-r];
-                dc[x-r] = v * dc_factor >> 16;
-            }
-            for (; x<(width+r+1)/2; x++)
-                dc[x-r] = v * dc_factor >> 16;
-            for (x=-r/2; x<0; x++)
-                dc[x] = dc[0];
-        }
+        if (y < height-r)
+            blur_plane(ctx, dc, buf, bstride, src, sstride, width, y, r, dc_factor);
         if (y == r) {
             for (y=0; y<r; y++)
                 ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
@@ -260,7 +292,6 @@ static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
         ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
         if (++y >= height) break;
         ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+        if (++y >= height || y >= y_end) break;
     }
 }
-
@@ -33,6 +33,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_slices.h>
 #include "filter_picture.h"
 
 
@@ -93,6 +94,8 @@ struct filter_sys_t
     int w[3], h[3];
 
     struct vf_priv_s cfg;
+    unsigned *strips;   /* wavefront state, see FilterSlice() */
+    size_t   strips_size;
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
@@ -110,7 +113,7 @@ static int Open(vlc_object_t *this)
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
+    int wsum = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -135,10 +138,11 @@ static int Open(vlc_object_t *this)
 
     for (int i = 0; i < 3; ++i) {
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        if (sys->w[i] > wmax) wmax = sys->w[i];
+        wsum += sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
+    /* Each plane has its own line so that the strips never share one */
+    cfg->Line = malloc(wsum*sizeof(unsigned int));
     if (!cfg->Line) {
         free(sys);
         return VLC_ENOMEM;
@@ -186,9 +190,119 @@ static void Close(vlc_object_t *this)
         free(cfg->Frame[i]);
     }
     free(cfg->Line);
+    free(sys->strips);
     free(sys);
 }
 
+/*****************************************************************************
+ * FilterSlice
+ *****************************************************************************/
+#define STRIP_LINES 16
+
+struct hqdn3d_job
+{
+    filter_sys_t *sys;
+    picture_t *src;
+    picture_t *dst;
+
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    bool        b_ready;
+    unsigned   *progress; /* lines done by each strip, all planes included */
+    unsigned   *carry;    /* horizontal state on the right of each strip */
+};
+
+/* The denoiser is recursive both horizontally and vertically, so that the
+ * planes are split in vertical strips instead of horizontal bands. Each line
+ * of a strip starts from the state left by the strip on its left on the same
+ * line: a strip runs STRIP_LINES lines behind the previous one. */
+static void FilterSlice(void *opaque, const vlc_slice_t *slice)
+{
+    struct hqdn3d_job *job = opaque;
+    filter_sys_t *sys = job->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    const unsigned lines = sys->h[0] + sys->h[1] + sys->h[2];
+    vlc_slice_t strip = *slice;
+
+    vlc_mutex_lock(&job->lock);
+    if (!job->b_ready && strip.i_count > 1) {
+        size_t size = strip.i_count * (size_t)(1 + lines);
+
+        if (sys->strips_size < size) {
+            unsigned *strips = realloc(sys->strips, size * sizeof(*strips));
+            if (likely(strips != NULL)) {
+                sys->strips = strips;
+                sys->strips_size = size;
+            }
+        }
+        if (likely(sys->strips_size >= size)) {
+            job->progress = sys->strips;
+            job->carry = sys->strips + strip.i_count;
+            memset(job->progress, 0, strip.i_count * sizeof(*job->progress));
+        }
+    }
+    job->b_ready = true;
+    vlc_mutex_unlock(&job->lock);
+
+    if (strip.i_count > 1 && job->progress == NULL) {
+        /* Out of memory: the first strip does the whole width */
+        if (strip.i_index > 0)
+            return;
+        strip.i_count = 1;
+    }
+
+    const unsigned s = strip.i_index;
+    const bool b_last = s + 1 == strip.i_count;
+    unsigned base = 0;
+
+    for (int i = 0; i < 3; ++i) {
+        const int W = sys->w[i], H = sys->h[i];
+        const long X0 = vlc_slice_First(&strip, W);
+        const long X1 = vlc_slice_End(&strip, W);
+        int *Spatial  = cfg->Coefs[i ? 2 : 0];
+        int *Temporal = cfg->Coefs[i ? 3 : 1];
+        unsigned int *LineAnt = cfg->Line + (i > 0 ? sys->w[0] : 0)
+                                          + (i > 1 ? sys->w[1] : 0);
+        const unsigned *PixelIn = s > 0 ? &job->carry[(s - 1) * lines + base]
+                                        : NULL;
+        unsigned *PixelOut = !b_last ? &job->carry[s * lines + base] : NULL;
+
+        for (long Y0 = 0; Y0 < H; Y0 += STRIP_LINES) {
+            const long Y1 = __MIN(Y0 + STRIP_LINES, H);
+
+            if (!Spatial[0]) {
+                /* No horizontal dependency */
+                deNoiseTemporal(job->src->p[i].p_pixels,
+                                job->dst->p[i].p_pixels, cfg->Frame[i],
+                                W, X0, X1, Y0, Y1,
+                                job->src->p[i].i_pitch,
+                                job->dst->p[i].i_pitch, Temporal);
+            } else {
+                if (s > 0) {
+                    vlc_mutex_lock(&job->lock);
+                    while (job->progress[s - 1] < base + Y1)
+                        vlc_cond_wait(&job->wait, &job->lock);
+                    vlc_mutex_unlock(&job->lock);
+                }
+                deNoiseStrip(job->src->p[i].p_pixels,
+                             job->dst->p[i].p_pixels, LineAnt,
+                             Temporal[0] ? cfg->Frame[i] : NULL,
+                             W, X0, X1, Y0, Y1,
+                             job->src->p[i].i_pitch, job->dst->p[i].i_pitch,
+                             Spatial, Spatial, Temporal, PixelIn, PixelOut);
+            }
+
+            if (!b_last) {
+                vlc_mutex_lock(&job->lock);
+                job->progress[s] = base + Y1;
+                vlc_cond_broadcast(&job->wait);
+                vlc_mutex_unlock(&job->lock);
+            }
+        }
+        base += H;
+    }
+}
+
 /*****************************************************************************
  * Filter
  *****************************************************************************/
@@ -221,32 +335,28 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    for (int i = 0; i < 3; ++i) {
+        if (unlikely(!deNoiseInit(src->p[i].p_pixels, &cfg->Frame[i],
+                                  sys->w[i], sys->h[i], src->p[i].i_pitch)))
+        {
+            picture_Release( src );
+            picture_Release( dst );
+            return NULL;
+        }
     }
 
+    struct hqdn3d_job job = {
+        .sys = sys,
+        .src = src,
+        .dst = dst,
+        .b_ready = false,
+    };
+    vlc_mutex_init(&job.lock);
+    vlc_cond_init(&job.wait);
+    vlc_slices_Run(filter, sys->w[0], 0, FilterSlice, &job);
+    vlc_cond_destroy(&job.wait);
+    vlc_mutex_destroy(&job.lock);
+
     return CopyInfoAndRelease(dst, src);
 }
 
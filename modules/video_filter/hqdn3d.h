@@ -50,13 +50,17 @@ static void deNoiseTemporal(
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned short *FrameAnt,
-                    int W, int H, int sStride, int dStride,
+                    int W, long X0, long X1, long Y0, long Y1,
+                    int sStride, int dStride,
                     int *Temporal)
 {
     unsigned int PixelDst;
 
-    for (long Y = 0; Y < H; Y++){
-        for (long X = 0; X < W; X++){
+    Frame += Y0*sStride;
+    FrameDest += Y0*dStride;
+    FrameAnt += Y0*W;
+    for (long Y = Y0; Y < Y1; Y++){
+        for (long X = X0; X < X1; X++){
             PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
             FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
             FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
@@ -67,115 +71,94 @@ static void deNoiseTemporal(
     }
 }
 
-static void deNoiseSpacial(
+static inline void deNoiseStore(unsigned int PixelSpat,
+                                unsigned short *LinePrev,
+                                unsigned char *LineDest, long X,
+                                int *Temporal)
+{
+    unsigned int PixelDst = PixelSpat;
+
+    if (LinePrev){
+        PixelDst = LowPassMul(LinePrev[X]<<8, PixelSpat, Temporal);
+        LinePrev[X] = ((PixelDst+0x1000007F)>>8);
+    }
+    LineDest[X]= ((PixelDst+0x10007FFF)>>16);
+}
+
+/* Spatial (and temporal, unless FrameAnt is NULL) denoising of the columns
+ * [X0, X1[ of the lines [Y0, Y1[. Each line enters the strip with the
+ * horizontal state PixelIn[Y] left by the strip on its left (if X0 > 0), and
+ * leaves it in PixelOut[Y] (if not NULL). The lines must be processed from
+ * top to bottom, as LineAnt carries the vertical state of the strip. */
+static void deNoiseStrip(
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+                    unsigned short *FrameAnt,
+                    int W, long X0, long X1, long Y0, long Y1,
+                    int sStride, int dStride,
+                    int *Horizontal, int *Vertical, int *Temporal,
+                    const unsigned int *PixelIn, unsigned int *PixelOut)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor, only left. */
-    for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
+    for (long Y = Y0; Y < Y1; Y++){
+        unsigned char *LineSrc = &Frame[Y*sStride];
+        unsigned char *LineDest = &FrameDest[Y*dStride];
+        unsigned short *LinePrev = FrameAnt ? &FrameAnt[Y*W] : NULL;
+        unsigned int PixelAnt = X0 ? PixelIn[Y] : 0;
+        long X = X0;
+
+        if (X == 0){
+            /* First pixel on each line doesn't have previous pixel */
+            PixelAnt = LineSrc[0]<<16;
+            LineAnt[0] = Y ? LowPassMul(LineAnt[0], PixelAnt, Vertical)
+                           : PixelAnt;
+            deNoiseStore(LineAnt[0], LinePrev, LineDest, 0, Temporal);
+            X++;
+        }
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        if (Y == 0){
+            /* First line has no top neighbor, only left. Without temporal
+             * denoising, the left neighbor is always the first pixel. */
+            if (!FrameAnt)
+                PixelAnt = LineSrc[0]<<16;
+            for (; X < X1; X++){
+                LineAnt[X] = LowPassMul(PixelAnt, LineSrc[X]<<16, Horizontal);
+                if (FrameAnt)
+                    PixelAnt = LineAnt[X];
+                deNoiseStore(LineAnt[X], LinePrev, LineDest, X, Temporal);
+            }
+        } else {
+            for (; X < X1; X++){
+                /* The rest are normal */
+                PixelAnt = LowPassMul(PixelAnt, LineSrc[X]<<16, Horizontal);
+                LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+                deNoiseStore(LineAnt[X], LinePrev, LineDest, X, Temporal);
+            }
         }
+
+        if (PixelOut)
+            PixelOut[Y] = PixelAnt;
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+/* Allocates and initializes the previous frame from the first one */
+static unsigned short *deNoiseInit(unsigned char *Frame,  // mpi->planes[x]
+                                   unsigned short **FrameAntPtr,
+                                   int W, int H, int sStride)
 {
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
     unsigned short* FrameAnt=(*FrameAntPtr);
 
     if(!FrameAnt){
         (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
         if(!FrameAnt)
-            return;
+            return NULL;
         for (long Y = 0; Y < H; Y++){
             unsigned short* dst=&FrameAnt[Y*W];
             unsigned char* src=Frame+Y*sStride;
             for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
         }
     }
-
-    if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
-    }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
-        return;
-    }
-
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
-
-    for (long Y = 1; Y < H; Y++){
-        unsigned int PixelAnt;
-        unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
-            unsigned int PixelDst;
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
-        }
-    }
+    return FrameAnt;
 }
 
 
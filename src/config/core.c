@@ -580,7 +580,11 @@ module_config_t *config_FindConfig (vlc_object_t *p_this, const char *name)
 
     module_config_t *const *p;
     p = bsearch (name, config.list, config.count, sizeof (*p), confnamecmp);
-    return p ? *p : NULL;
+    if (p == NULL)
+        return NULL;
+
+    vlc_cache_load_lists((*p)->owner);
+    return *p;
 }
 
 /**
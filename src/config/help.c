@@ -603,6 +603,8 @@ static void Usage (vlc_object_t *p_this, char const *psz_search)
                    module_gettext(m, m->psz_help));
 
         /* Print module options */
+        vlc_cache_load_lists((vlc_plugin_t *)p);
+
         for (size_t j = 0; j < p->conf.size; j++)
         {
             const module_config_t *item = p->conf.items + j;
@@ -184,10 +184,17 @@ static int AStreamNoReadDir(stream_t *s, input_item_node_t *p_node)
     return VLC_EGENERIC;;
 }
 
+struct access_stream_sys
+{
+    access_t *access;
+    uint64_t read_calls; /* last count of system calls reported by access */
+};
+
 /* Block access */
 static block_t *AStreamReadBlock(stream_t *s, bool *restrict eof)
 {
-    access_t *access = s->p_sys;
+    struct access_stream_sys *sys = s->p_sys;
+    access_t *access = sys->access;
     input_thread_t *input = s->p_input;
     block_t * block;
 
@@ -203,13 +210,22 @@ static block_t *AStreamReadBlock(stream_t *s, bool *restrict eof)
 
     if (block != NULL && input != NULL)
     {
-        uint64_t total;
+        uint64_t total, calls = 1;
+
+        /* Batching accesses can return several packets per system call */
+        if (vlc_stream_Control(access, STREAM_GET_READ_CALLS,
+                               &total) == VLC_SUCCESS)
+        {
+            calls = total - sys->read_calls;
+            sys->read_calls = total;
+        }
 
         vlc_mutex_lock(&input_priv(input)->counters.counters_lock);
         stats_Update(input_priv(input)->counters.p_read_bytes,
                      block->i_buffer, &total);
         stats_Update(input_priv(input)->counters.p_input_bitrate, total, NULL);
         stats_Update(input_priv(input)->counters.p_read_packets, 1, NULL);
+        stats_Update(input_priv(input)->counters.p_read_calls, calls, NULL);
         vlc_mutex_unlock(&input_priv(input)->counters.counters_lock);
     }
 
@@ -219,7 +235,8 @@ static block_t *AStreamReadBlock(stream_t *s, bool *restrict eof)
 /* Read access */
 static ssize_t AStreamReadStream(stream_t *s, void *buf, size_t len)
 {
-    access_t *access = s->p_sys;
+    struct access_stream_sys *sys = s->p_sys;
+    access_t *access = sys->access;
     input_thread_t *input = s->p_input;
 
     if (vlc_stream_Eof(access))
@@ -237,6 +254,7 @@ static ssize_t AStreamReadStream(stream_t *s, void *buf, size_t len)
         stats_Update(input_priv(input)->counters.p_read_bytes, val, &total);
         stats_Update(input_priv(input)->counters.p_input_bitrate, total, NULL);
         stats_Update(input_priv(input)->counters.p_read_packets, 1, NULL);
+        stats_Update(input_priv(input)->counters.p_read_calls, 1, NULL);
         vlc_mutex_unlock(&input_priv(input)->counters.counters_lock);
     }
 
@@ -246,7 +264,8 @@ static ssize_t AStreamReadStream(stream_t *s, void *buf, size_t len)
 /* Directory */
 static int AStreamReadDir(stream_t *s, input_item_node_t *p_node)
 {
-    access_t *access = s->p_sys;
+    struct access_stream_sys *sys = s->p_sys;
+    access_t *access = sys->access;
 
     return access->pf_readdir(access, p_node);
 }
@@ -254,39 +273,53 @@ static int AStreamReadDir(stream_t *s, input_item_node_t *p_node)
 /* Common */
 static int AStreamSeek(stream_t *s, uint64_t offset)
 {
-    access_t *access = s->p_sys;
+    struct access_stream_sys *sys = s->p_sys;
+    access_t *access = sys->access;
 
     return vlc_stream_Seek(access, offset);
 }
 
 static int AStreamControl(stream_t *s, int cmd, va_list args)
 {
-    access_t *access = s->p_sys;
+    struct access_stream_sys *sys = s->p_sys;
+    access_t *access = sys->access;
 
     return vlc_stream_vaControl(access, cmd, args);
 }
 
 static void AStreamDestroy(stream_t *s)
 {
-    access_t *access = s->p_sys;
+    struct access_stream_sys *sys = s->p_sys;
 
-    vlc_stream_Delete(access);
+    vlc_stream_Delete(sys->access);
+    free(sys);
 }
 
 stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
                            bool preparsing, const char *url)
 {
+    struct access_stream_sys *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
     stream_t *s = vlc_stream_CommonNew(parent, AStreamDestroy);
     if (unlikely(s == NULL))
+    {
+        free(sys);
         return NULL;
+    }
 
     access_t *access = access_New(VLC_OBJECT(s), input, preparsing, url);
     if (access == NULL)
     {
         stream_CommonDelete(s);
+        free(sys);
         return NULL;
     }
 
+    sys->access = access;
+    sys->read_calls = 0;
+
     s->p_input = input;
     s->psz_url = strdup(access->psz_url);
 
@@ -315,7 +348,7 @@ stream_t *stream_AccessNew(vlc_object_t *parent, input_thread_t *input,
 
     s->pf_seek    = AStreamSeek;
     s->pf_control = AStreamControl;
-    s->p_sys      = access;
+    s->p_sys      = sys;
 
     if (cachename != NULL)
         s = stream_FilterChainNew(s, cachename);
@@ -97,6 +97,12 @@ struct decoder_owner_sys_t
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Time span of the fifo content (protected by the fifo lock) */
+    mtime_t i_fifo_in;  /* end of the last queued block */
+    mtime_t i_fifo_out; /* start of the last dequeued block */
+    mtime_t i_fifo_high;
+    mtime_t i_fifo_low;
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -149,6 +155,15 @@ struct decoder_owner_sys_t
 
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
+
+/* Duration of data queued ahead of a decoder when the output paces the input */
+#define DECODER_PACED_DURATION (CLOCK_FREQ / 2)
+/* Number of blocks queued ahead of a decoder when the output paces the input
+ * and the queued duration is unknown */
+#define DECODER_PACED_COUNT 10
+/* Period at which an input held back by a full decoder fifo checks for
+ * requests (stop, seek, pause...) that need it to resume */
+#define DECODER_FIFO_POLL (CLOCK_FREQ / 20)
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
 
 /**
@@ -1518,6 +1533,70 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+static inline mtime_t DecoderBlockTime( const block_t *p_block )
+{
+    return p_block->i_dts > VLC_TS_INVALID ? p_block->i_dts : p_block->i_pts;
+}
+
+static void DecoderFifoReset( decoder_owner_sys_t *p_owner )
+{
+    p_owner->i_fifo_in = VLC_TS_INVALID;
+    p_owner->i_fifo_out = VLC_TS_INVALID;
+}
+
+/**
+ * Returns the duration of the data queued in the fifo, or -1 if it cannot be
+ * told from the block timestamps (missing).
+ *
+ * A timestamp jump within the fifo counts as twice the high watermark, until
+ * the decoder dequeues the blocks past the jump.
+ *
+ * The fifo must be locked.
+ */
+static mtime_t DecoderFifoDuration( decoder_owner_sys_t *p_owner )
+{
+    if( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        return 0;
+    if( p_owner->i_fifo_in <= VLC_TS_INVALID ||
+        p_owner->i_fifo_out <= VLC_TS_INVALID )
+        return -1;
+
+    mtime_t i_duration = p_owner->i_fifo_in - p_owner->i_fifo_out;
+    /* Backward, or way above the watermarks: most likely a jump */
+    if( i_duration < 0 || i_duration > 2 * p_owner->i_fifo_high )
+        i_duration = 2 * p_owner->i_fifo_high;
+    return i_duration;
+}
+
+static void DecoderFifoQueue( decoder_owner_sys_t *p_owner, block_t *p_block )
+{
+    for( const block_t *p = p_block; p != NULL; p = p->p_next )
+    {
+        mtime_t i_time = DecoderBlockTime( p );
+        if( i_time <= VLC_TS_INVALID )
+            continue;
+        if( p_owner->i_fifo_out <= VLC_TS_INVALID ||
+            vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+            p_owner->i_fifo_out = i_time;
+        p_owner->i_fifo_in = i_time + p->i_length;
+    }
+    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+}
+
+static block_t *DecoderFifoDequeue( decoder_owner_sys_t *p_owner )
+{
+    block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+    if( p_block != NULL && DecoderBlockTime( p_block ) > VLC_TS_INVALID )
+        p_owner->i_fifo_out = DecoderBlockTime( p_block );
+    return p_block;
+}
+
+static void DecoderFifoFlush( decoder_owner_sys_t *p_owner )
+{
+    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    DecoderFifoReset( p_owner );
+}
+
 /**
  * The decoding main loop
  *
@@ -1587,7 +1666,7 @@ static void *DecoderThread( void *p_data )
         vlc_cond_signal( &p_owner->wait_fifo );
         vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
-        block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        block_t *p_block = DecoderFifoDequeue( p_owner );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
@@ -1699,6 +1778,14 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         return NULL;
     }
 
+    DecoderFifoReset( p_owner );
+    p_owner->i_fifo_high = var_InheritInteger( p_dec, "decoder-fifo-high" )
+                         * (CLOCK_FREQ / 1000);
+    p_owner->i_fifo_low = var_InheritInteger( p_dec, "decoder-fifo-low" )
+                        * (CLOCK_FREQ / 1000);
+    if( p_owner->i_fifo_low > p_owner->i_fifo_high )
+        p_owner->i_fifo_low = p_owner->i_fifo_high;
+
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
@@ -2023,14 +2110,36 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
-        /* FIXME: ideally we would check the time amount of data
-         * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
+        /* Hold the input back once the queued data outlasts the high
+         * watermark, until the decoder drains it down to the low watermark.
+         * The FIFO is not consumed when waiting or paused, so this would
+         * deadlock VLC. Locking is not necessary for b_waiting as it is only
+         * read, not written by the decoder thread.
+         * Stop, seek, pause or drain requests are handled by this very
+         * thread, so stop holding back as soon as one is pending. */
+        if( !p_owner->b_waiting && !p_owner->paused && !p_owner->b_draining &&
+            DecoderFifoDuration( p_owner ) > p_owner->i_fifo_high )
+        {
+            msg_Dbg( p_dec, "decoder/packetizer fifo above %"PRId64" ms, "
+                     "holding input back", p_owner->i_fifo_high / 1000 );
+            do
+            {
+                vlc_fifo_TimedWaitCond( p_owner->p_fifo, &p_owner->wait_fifo,
+                                        mdate() + DECODER_FIFO_POLL );
+                if( p_owner->p_input != NULL &&
+                    input_ControlPending( p_owner->p_input ) )
+                    break;
+            }
+            while( DecoderFifoDuration( p_owner ) > p_owner->i_fifo_low );
+        }
+
+        /* Last resort when timestamps do not tell the queued duration.
+         * 400 MiB, i.e. ~ 50mb/s for 60s */
         if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
         {
             msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            DecoderFifoFlush( p_owner );
         }
     }
     else
@@ -2038,11 +2147,17 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        for( ;; )
+        {
+            mtime_t i_duration = DecoderFifoDuration( p_owner );
+            if( i_duration >= 0 ? i_duration < DECODER_PACED_DURATION
+                : vlc_fifo_GetCount( p_owner->p_fifo ) < DECODER_PACED_COUNT )
+                break;
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        }
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    DecoderFifoQueue( p_owner, p_block );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2108,7 +2223,7 @@ void input_DecoderFlush( decoder_t *p_dec )
     vlc_fifo_Lock( p_owner->p_fifo );
 
     /* Empty the fifo */
-    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    DecoderFifoFlush( p_owner );
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
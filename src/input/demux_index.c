@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * demux_index.c: demultiplexer index cache
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_configuration.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+/* Bump whenever the file layout changes */
+#define INDEX_MAGIC   "VIDX"
+#define INDEX_VERSION 1
+
+/* The cache is private to the user and machine: integers are stored in
+ * host byte order */
+struct index_header
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t reserved;
+    uint64_t file_size;   /* identity of the indexed file */
+    int64_t  file_mtime;
+    uint64_t stream_size;
+    uint64_t count;
+};
+
+static char *IndexPath(demux_t *demux, const char *name, bool create)
+{
+    if (demux->psz_file == NULL || demux->s == NULL
+     || !var_InheritBool(demux, "index-cache"))
+        return NULL;
+
+    char *cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    if (cachedir == NULL)
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, name, strlen(name) + 1);
+    AddMD5(&md5, demux->psz_file, strlen(demux->psz_file));
+    EndMD5(&md5);
+
+    char *hash = psz_md5_hash(&md5);
+    char *path = NULL;
+    if (hash != NULL)
+    {
+        if (asprintf(&path, "%s"DIR_SEP"index"DIR_SEP"%s.idx", cachedir,
+                     hash) == -1)
+            path = NULL;
+        else if (create)
+        {   /* create the missing parent directories */
+            char *sep = path;
+            while ((sep = strchr(sep + 1, DIR_SEP_CHAR)) != NULL)
+            {
+                *sep = '\0';
+                vlc_mkdir(path, 0700);
+                *sep = DIR_SEP_CHAR;
+            }
+        }
+        free(hash);
+    }
+    free(cachedir);
+    return path;
+}
+
+static int IndexIdentify(demux_t *demux, struct index_header *hdr)
+{
+    struct stat st;
+
+    if (vlc_stat(demux->psz_file, &st) || !S_ISREG(st.st_mode))
+        return VLC_EGENERIC;
+
+    memset(hdr, 0, sizeof (*hdr));
+    memcpy(hdr->magic, INDEX_MAGIC, 4);
+    hdr->version = INDEX_VERSION;
+    hdr->entry_size = sizeof (vlc_demux_index_entry_t);
+    hdr->file_size = st.st_size;
+    hdr->file_mtime = st.st_mtime;
+    hdr->stream_size = stream_Size(demux->s);
+    return VLC_SUCCESS;
+}
+
+int vlc_demux_index_Load(demux_t *demux, const char *name,
+                         vlc_demux_index_entry_t **entries, size_t *count)
+{
+    struct index_header expected, hdr;
+
+    if (IndexIdentify(demux, &expected))
+        return VLC_EGENERIC;
+
+    char *path = IndexPath(demux, name, false);
+    if (path == NULL)
+        return VLC_EGENERIC;
+
+    FILE *file = vlc_fopen(path, "rb");
+    if (file == NULL)
+    {
+        free(path);
+        return VLC_EGENERIC;
+    }
+
+    vlc_demux_index_entry_t *tab = NULL;
+    struct stat st;
+
+    if (fread(&hdr, sizeof (hdr), 1, file) != 1
+     || fstat(fileno(file), &st)
+     || hdr.count > (st.st_size - sizeof (hdr)) / sizeof (*tab)
+     || hdr.count > SIZE_MAX / sizeof (*tab))
+        goto error;
+
+    /* only the count may differ */
+    expected.count = hdr.count;
+    if (memcmp(&hdr, &expected, sizeof (hdr)))
+    {
+        msg_Dbg(demux, "discarding outdated %s index", name);
+        goto error;
+    }
+
+    tab = malloc((hdr.count ? hdr.count : 1) * sizeof (*tab));
+    if (unlikely(tab == NULL)
+     || fread(tab, sizeof (*tab), hdr.count, file) != hdr.count)
+        goto error;
+
+    fclose(file);
+    free(path);
+
+    msg_Dbg(demux, "loaded %"PRIu64" %s index entries from cache",
+            hdr.count, name);
+    *entries = tab;
+    *count = hdr.count;
+    return VLC_SUCCESS;
+
+error:
+    free(tab);
+    fclose(file);
+    vlc_unlink(path);
+    free(path);
+    return VLC_EGENERIC;
+}
+
+void vlc_demux_index_Store(demux_t *demux, const char *name,
+                           const vlc_demux_index_entry_t *entries,
+                           size_t count)
+{
+    struct index_header hdr;
+
+    if (IndexIdentify(demux, &hdr))
+        return;
+    hdr.count = count;
+
+    char *path = IndexPath(demux, name, true);
+    if (path == NULL)
+        return;
+
+    char *tmppath;
+    if (asprintf(&tmppath, "%s.%"PRIu32, path, (uint32_t)getpid()) == -1)
+    {
+        free(path);
+        return;
+    }
+
+    FILE *file = vlc_fopen(tmppath, "wb");
+    if (file == NULL)
+    {
+        msg_Warn(demux, "cannot create %s: %s", tmppath,
+                 vlc_strerror_c(errno));
+        goto out;
+    }
+
+    bool ok = fwrite(&hdr, sizeof (hdr), 1, file) == 1
+           && fwrite(entries, sizeof (*entries), count, file) == count;
+    if (fclose(file))
+        ok = false;
+    if (!ok)
+    {
+        msg_Warn(demux, "cannot write %s: %s", tmppath,
+                 vlc_strerror_c(errno));
+        vlc_unlink(tmppath);
+        goto out;
+    }
+
+    /* atomically replace the previous index */
+    if (vlc_rename(tmppath, path))
+        vlc_unlink(tmppath);
+    else
+        msg_Dbg(demux, "stored %zu %s index entries", count, name);
+out:
+    free(tmppath);
+    free(path);
+}
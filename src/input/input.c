@@ -538,6 +538,17 @@ bool input_Stopped( input_thread_t *input )
     return ret;
 }
 
+bool input_ControlPending( input_thread_t *input )
+{
+    input_thread_private_t *sys = input_priv(input);
+    bool ret;
+
+    vlc_mutex_lock( &sys->lock_control );
+    ret = sys->is_stopped || sys->i_control > 0;
+    vlc_mutex_unlock( &sys->lock_control );
+    return ret;
+}
+
 /*****************************************************************************
  * Main loop: Fill buffers from access, and demux
  *****************************************************************************/
@@ -807,6 +818,7 @@ static void InitStatistics( input_thread_t *p_input )
     {
         INIT_COUNTER( read_bytes, COUNTER );
         INIT_COUNTER( read_packets, COUNTER );
+        INIT_COUNTER( read_calls, COUNTER );
         INIT_COUNTER( demux_read, COUNTER );
         INIT_COUNTER( input_bitrate, DERIVATIVE );
         INIT_COUNTER( demux_bitrate, DERIVATIVE );
@@ -1394,6 +1406,7 @@ error:
                                input_priv(p_input)->counters.p_##c = NULL; } while(0)
         EXIT_COUNTER( read_bytes );
         EXIT_COUNTER( read_packets );
+        EXIT_COUNTER( read_calls );
         EXIT_COUNTER( demux_read );
         EXIT_COUNTER( input_bitrate );
         EXIT_COUNTER( demux_bitrate );
@@ -1470,6 +1483,7 @@ do { \
             stats_ComputeInputStats( p_input, priv->p_item->p_stats );
             CL_CO( read_bytes );
             CL_CO( read_packets );
+            CL_CO( read_calls );
             CL_CO( demux_read );
             CL_CO( input_bitrate );
             CL_CO( demux_bitrate );
@@ -147,6 +147,7 @@ typedef struct input_thread_private_t
     /* Stats counters */
     struct {
         counter_t *p_read_packets;
+        counter_t *p_read_calls;
         counter_t *p_read_bytes;
         counter_t *p_input_bitrate;
         counter_t *p_demux_read;
@@ -241,6 +242,9 @@ void input_ControlPush( input_thread_t *, int i_type, vlc_value_t * );
 
 bool input_Stopped( input_thread_t * );
 
+/* Returns true if the input is stopped or has control requests queued */
+bool input_ControlPending( input_thread_t * );
+
 /* Bound pts_delay */
 #define INPUT_PTS_DELAY_MAX INT64_C(60000000)
 
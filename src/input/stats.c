@@ -90,6 +90,7 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
 
     /* Input */
     st->i_read_packets = stats_GetTotal(priv->counters.p_read_packets);
+    st->i_read_calls = stats_GetTotal(priv->counters.p_read_calls);
     st->i_read_bytes = stats_GetTotal(priv->counters.p_read_bytes);
     st->f_input_bitrate = stats_GetRate(priv->counters.p_input_bitrate);
     st->i_demux_read_bytes = stats_GetTotal(priv->counters.p_demux_read);
@@ -124,7 +125,7 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
 void stats_ReinitInputStats( input_stats_t *p_stats )
 {
     vlc_mutex_lock( &p_stats->lock );
-    p_stats->i_read_packets = p_stats->i_read_bytes =
+    p_stats->i_read_packets = p_stats->i_read_calls = p_stats->i_read_bytes =
     p_stats->f_input_bitrate = p_stats->f_average_input_bitrate =
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
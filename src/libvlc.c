@@ -65,6 +65,7 @@
 #include "libvlc.h"
 #include "playlist/playlist_internal.h"
 #include "misc/variables.h"
+#include "misc/slices.h"
 
 #include <vlc_vlm.h>
 
@@ -92,6 +93,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv = libvlc_priv (p_libvlc);
     priv->playlist = NULL;
     priv->p_vlm = NULL;
+    priv->slices = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -237,6 +239,16 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     if( !priv->actions )
         goto error;
 
+    /*
+     * Initialize the slice threading pool of the video filters
+     */
+    int i_slice_threads = var_InheritInteger( p_libvlc, "filter-threads" );
+    if( i_slice_threads <= 0 )
+        i_slice_threads = vlc_GetCPUCount();
+    priv->slices = vlc_slices_New( __MIN( i_slice_threads, 64 ) );
+    if( !priv->slices )
+        goto error;
+
     /*
      * Meta data handling
      */
@@ -418,6 +430,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 
     vlc_DeinitActions( p_libvlc, priv->actions );
 
+    if( priv->slices != NULL )
+        vlc_slices_Delete( priv->slices );
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
@@ -193,6 +193,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct vlc_slices_t *slices; ///< Slice threading pool
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -56,6 +56,9 @@ static void vlc_CPU_init (void)
     {
         char *p = line, *cap;
         uint_fast32_t core_caps = 0;
+#if defined (__i386__) || defined (__x86_64__)
+        unsigned avx512 = 0;
+#endif
 
 #if defined (__arm__)
         unsigned ver;
@@ -94,6 +97,10 @@ static void vlc_CPU_init (void)
                 core_caps |= VLC_CPU_AVX;
             if (!strcmp (cap, "avx2"))
                 core_caps |= VLC_CPU_AVX2;
+            if (!strcmp (cap, "avx512f"))
+                avx512 |= 1;
+            if (!strcmp (cap, "avx512bw"))
+                avx512 |= 2;
             if (!strcmp (cap, "3dnow"))
                 core_caps |= VLC_CPU_3dNOW;
             if (!strcmp (cap, "xop"))
@@ -106,6 +113,10 @@ static void vlc_CPU_init (void)
                 core_caps |= VLC_CPU_ALTIVEC;
 #endif
         }
+#if defined (__i386__) || defined (__x86_64__)
+        if (avx512 == 3)
+            core_caps |= VLC_CPU_AVX512;
+#endif
 
         /* Take the intersection of capabilities of each processor */
         all_caps &= core_caps;
@@ -20,6 +20,8 @@
 #  include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_threads.h>
 #include <vlc_arrays.h>
@@ -33,57 +35,74 @@ struct bg_queued_item {
     int timeout; /**< timeout duration in microseconds */
 };
 
+struct bg_thread {
+    struct background_worker* worker;
+    void* id; /**< id of the current task */
+    bool active; /**< true if the thread is running a task */
+    bool probe_request; /**< true if a probe is requested */
+    mtime_t deadline; /**< deadline of the current task */
+};
+
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
 
-    struct {
-        bool probe_request; /**< true if a probe is requested */
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_cond_t wait; /**< wait for update in terms of head */
-        mtime_t deadline; /**< deadline of the current task */
-        void* id; /**< id of the current task */
-        bool active; /**< true if there is an active thread */
-    } head;
-
-    struct {
-        vlc_mutex_t lock; /**< acquire to inspect members that follow */
-        vlc_array_t data; /**< queue of pending entities to process */
-    } tail;
+    vlc_mutex_t lock; /**< acquire to inspect members that follow */
+    vlc_cond_t wait; /**< wait for update in terms of threads */
+    vlc_array_t threads; /**< running threads */
+    vlc_array_t queues[BACKGROUND_WORKER_PRIORITY_COUNT]; /**< pending
+        entities to process, one queue per priority */
 };
 
+/* lock must be held */
+static struct bg_queued_item* QueueTake( struct background_worker* worker )
+{
+    for( int prio = BACKGROUND_WORKER_PRIORITY_COUNT - 1; prio >= 0; --prio )
+    {
+        vlc_array_t* queue = &worker->queues[prio];
+
+        if( vlc_array_count( queue ) )
+        {
+            struct bg_queued_item* item = vlc_array_item_at_index( queue, 0 );
+            vlc_array_remove( queue, 0 );
+            return item;
+        }
+    }
+    return NULL;
+}
+
 static void* Thread( void* data )
 {
-    struct background_worker* worker = data;
+    struct bg_thread* thread = data;
+    struct background_worker* worker = thread->worker;
 
     for( ;; )
     {
-        struct bg_queued_item* item = NULL;
-        void* handle;
+        struct bg_queued_item* item;
+        void* handle = NULL;
 
-        vlc_mutex_lock( &worker->tail.lock );
+        vlc_mutex_lock( &worker->lock );
         {
-            if( vlc_array_count( &worker->tail.data ) )
-            {
-                item = vlc_array_item_at_index( &worker->tail.data, 0 );
-                handle = NULL;
+            item = QueueTake( worker );
 
-                vlc_array_remove( &worker->tail.data, 0 );
-            }
+            thread->deadline = INT64_MAX;
+            thread->active = item != NULL;
+            thread->id = item ? item->id : NULL;
+            thread->probe_request = false;
 
-            vlc_mutex_lock( &worker->head.lock );
-            {
-                worker->head.deadline = INT64_MAX;
-                worker->head.active = item != NULL;
-                worker->head.id = item ? item->id : NULL;
+            if( item && item->timeout > 0 )
+                thread->deadline = mdate() + item->timeout * 1000;
 
-                if( item && item->timeout > 0 )
-                    worker->head.deadline = mdate() + item->timeout * 1000;
+            if( item == NULL )
+            {
+                ssize_t idx = vlc_array_index_of_item( &worker->threads,
+                                                       thread );
+                assert( idx >= 0 );
+                vlc_array_remove( &worker->threads, idx );
             }
-            vlc_cond_broadcast( &worker->head.wait );
-            vlc_mutex_unlock( &worker->head.lock );
         }
-        vlc_mutex_unlock( &worker->tail.lock );
+        vlc_cond_broadcast( &worker->wait );
+        vlc_mutex_unlock( &worker->lock );
 
         if( item == NULL )
             break;
@@ -97,12 +116,12 @@ static void* Thread( void* data )
 
         for( ;; )
         {
-            vlc_mutex_lock( &worker->head.lock );
+            vlc_mutex_lock( &worker->lock );
 
-            bool const b_timeout = worker->head.deadline <= mdate();
-            worker->head.probe_request = false;
+            bool const b_timeout = thread->deadline <= mdate();
+            thread->probe_request = false;
 
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
 
             if( b_timeout ||
                 worker->conf.pf_probe( worker->owner, handle ) )
@@ -113,49 +132,71 @@ static void* Thread( void* data )
                 break;
             }
 
-            vlc_mutex_lock( &worker->head.lock );
-            if( worker->head.probe_request == false &&
-                worker->head.deadline > mdate() )
+            vlc_mutex_lock( &worker->lock );
+            if( thread->probe_request == false &&
+                thread->deadline > mdate() )
             {
-                vlc_cond_timedwait( &worker->head.wait, &worker->head.lock,
-                                     worker->head.deadline );
+                vlc_cond_timedwait( &worker->wait, &worker->lock,
+                                     thread->deadline );
             }
-            vlc_mutex_unlock( &worker->head.lock );
+            vlc_mutex_unlock( &worker->lock );
         }
     }
 
+    free( thread );
     return NULL;
 }
 
-static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
+/* lock must be held */
+static bool BackgroundWorkerRunning( struct background_worker* worker,
+                                     void* id )
 {
-    vlc_mutex_lock( &worker->tail.lock );
-    for( size_t i = 0; i < vlc_array_count( &worker->tail.data ); )
+    bool running = false;
+
+    for( size_t i = 0; i < vlc_array_count( &worker->threads ); ++i )
     {
-        struct bg_queued_item* item =
-            vlc_array_item_at_index( &worker->tail.data, i );
+        struct bg_thread* thread =
+            vlc_array_item_at_index( &worker->threads, i );
 
-        if( id == NULL || item->id == id )
+        if( id == NULL || ( thread->active && thread->id == id ) )
         {
-            vlc_array_remove( &worker->tail.data, i );
-            worker->conf.pf_release( item->entity );
-            free( item );
-            continue;
+            thread->deadline = VLC_TS_0;
+            running = true;
         }
+    }
+    return running;
+}
 
-        ++i;
+static void BackgroundWorkerCancel( struct background_worker* worker, void* id)
+{
+    vlc_mutex_lock( &worker->lock );
+    for( int prio = 0; prio < BACKGROUND_WORKER_PRIORITY_COUNT; ++prio )
+    {
+        vlc_array_t* queue = &worker->queues[prio];
+
+        for( size_t i = 0; i < vlc_array_count( queue ); )
+        {
+            struct bg_queued_item* item = vlc_array_item_at_index( queue, i );
+
+            if( id == NULL || item->id == id )
+            {
+                vlc_array_remove( queue, i );
+                worker->conf.pf_release( item->entity );
+                free( item );
+                continue;
+            }
+
+            ++i;
+        }
     }
-    vlc_mutex_unlock( &worker->tail.lock );
 
-    vlc_mutex_lock( &worker->head.lock );
-    while( ( id == NULL && worker->head.active )
-        || ( id != NULL && worker->head.id == id ) )
+    /* without id, wait for all the threads to exit */
+    while( BackgroundWorkerRunning( worker, id ) )
     {
-        worker->head.deadline = VLC_TS_0;
-        vlc_cond_broadcast( &worker->head.wait );
-        vlc_cond_wait( &worker->head.wait, &worker->head.lock );
+        vlc_cond_broadcast( &worker->wait );
+        vlc_cond_wait( &worker->wait, &worker->lock );
     }
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 struct background_worker* background_worker_New( void* owner,
@@ -168,50 +209,80 @@ struct background_worker* background_worker_New( void* owner,
 
     worker->conf = *conf;
     worker->owner = owner;
-    worker->head.id = NULL;
-    worker->head.active = false;
-    worker->head.deadline = VLC_TS_INVALID;
 
-    vlc_mutex_init( &worker->head.lock );
-    vlc_cond_init( &worker->head.wait );
+    if( worker->conf.max_threads < 1 )
+        worker->conf.max_threads = 1;
+
+    vlc_mutex_init( &worker->lock );
+    vlc_cond_init( &worker->wait );
 
-    vlc_array_init( &worker->tail.data );
-    vlc_mutex_init( &worker->tail.lock );
+    vlc_array_init( &worker->threads );
+    for( int prio = 0; prio < BACKGROUND_WORKER_PRIORITY_COUNT; ++prio )
+        vlc_array_init( &worker->queues[prio] );
 
     return worker;
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
-                        void* id, int timeout )
+                        void* id, int timeout, int priority )
 {
     struct bg_queued_item* item = malloc( sizeof( *item ) );
 
     if( unlikely( !item ) )
         return VLC_EGENERIC;
 
+    assert( priority >= 0 && priority < BACKGROUND_WORKER_PRIORITY_COUNT );
+
     item->id = id;
     item->entity = entity;
     item->timeout = timeout < 0 ? worker->conf.default_timeout : timeout;
 
-    vlc_mutex_lock( &worker->tail.lock );
-    vlc_array_append( &worker->tail.data, item );
-    vlc_mutex_unlock( &worker->tail.lock );
+    /* hold before queuing: a running thread may process and release the
+     * entity as soon as it is visible */
+    worker->conf.pf_hold( item->entity );
 
-    vlc_mutex_lock( &worker->head.lock );
-    if( worker->head.active == false )
+    vlc_mutex_lock( &worker->lock );
+    vlc_array_t* queue = &worker->queues[priority];
+    vlc_array_append( queue, item );
+
+    size_t count = vlc_array_count( &worker->threads );
+    if( count < (size_t)worker->conf.max_threads )
     {
-        worker->head.probe_request = false;
-        worker->head.active =
-            !vlc_clone_detach( NULL, Thread, worker, VLC_THREAD_PRIORITY_LOW );
-    }
+        struct bg_thread* thread = malloc( sizeof( *thread ) );
+
+        if( likely( thread ) )
+        {
+            thread->worker = worker;
+            thread->id = NULL;
+            thread->active = false;
+            thread->probe_request = false;
+            thread->deadline = INT64_MAX;
+
+            vlc_array_append( &worker->threads, thread );
+            if( vlc_clone_detach( NULL, Thread, thread,
+                                  VLC_THREAD_PRIORITY_LOW ) )
+            {
+                vlc_array_remove( &worker->threads, count );
+                free( thread );
+            }
+        }
 
-    if( worker->head.active )
-        worker->conf.pf_hold( item->entity );
+        /* no thread left to process the entity */
+        if( vlc_array_count( &worker->threads ) == 0 )
+        {
+            vlc_array_remove( queue, vlc_array_count( queue ) - 1 );
+            goto error;
+        }
+    }
+    vlc_mutex_unlock( &worker->lock );
 
-    int ret = worker->head.active ? VLC_SUCCESS : VLC_EGENERIC;
-    vlc_mutex_unlock( &worker->head.lock );
+    return VLC_SUCCESS;
 
-    return ret;
+error:
+    vlc_mutex_unlock( &worker->lock );
+    worker->conf.pf_release( item->entity );
+    free( item );
+    return VLC_EGENERIC;
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -221,15 +292,24 @@ void background_worker_Cancel( struct background_worker* worker, void* id )
 
 void background_worker_RequestProbe( struct background_worker* worker )
 {
-    vlc_mutex_lock( &worker->head.lock );
-    worker->head.probe_request = true;
-    vlc_cond_broadcast( &worker->head.wait );
-    vlc_mutex_unlock( &worker->head.lock );
+    vlc_mutex_lock( &worker->lock );
+    for( size_t i = 0; i < vlc_array_count( &worker->threads ); ++i )
+    {
+        struct bg_thread* thread =
+            vlc_array_item_at_index( &worker->threads, i );
+        thread->probe_request = true;
+    }
+    vlc_cond_broadcast( &worker->wait );
+    vlc_mutex_unlock( &worker->lock );
 }
 
 void background_worker_Delete( struct background_worker* worker )
 {
     BackgroundWorkerCancel( worker, NULL );
-    vlc_array_clear( &worker->tail.data );
+    vlc_array_clear( &worker->threads );
+    for( int prio = 0; prio < BACKGROUND_WORKER_PRIORITY_COUNT; ++prio )
+        vlc_array_clear( &worker->queues[prio] );
+    vlc_cond_destroy( &worker->wait );
+    vlc_mutex_destroy( &worker->lock );
     free( worker );
 }
@@ -19,6 +19,19 @@
 #ifndef BACKGROUND_WORKER_H__
 #define BACKGROUND_WORKER_H__
 
+/**
+ * Priorities of the queued entities
+ *
+ * Pending entities of a higher priority are always processed before the ones
+ * of a lower priority, regardless of the order in which they were pushed.
+ **/
+enum background_worker_priority {
+    BACKGROUND_WORKER_PRIORITY_NORMAL, /**< default, e.g. bulk requests */
+    BACKGROUND_WORKER_PRIORITY_HIGH, /**< requests the user is waiting for */
+
+    BACKGROUND_WORKER_PRIORITY_COUNT
+};
+
 struct background_worker_config {
     /**
      * Default timeout for completing a task
@@ -29,6 +42,14 @@ struct background_worker_config {
      **/
     mtime_t default_timeout;
 
+    /**
+     * Maximum number of tasks running at the same time
+     *
+     * Each task runs in its own thread, and the threads claim the pending
+     * entities from a shared queue. A value less-than 1 is treated as 1.
+     **/
+    int max_threads;
+
     /**
      * Release an entity
      *
@@ -119,10 +140,10 @@ struct background_worker* background_worker_New( void* owner,
     struct background_worker_config* config );
 
 /**
- * Request the background-worker to probe the current task
+ * Request the background-worker to probe the current tasks
  *
  * This function is used to signal the background-worker that it should do
- * another probe to see whether the current task is still alive.
+ * another probe to see whether the current tasks are still alive.
  *
  * \warning Note that the function will not wait for the probing to finish, it
  *          will simply ask the background worker to recheck it as soon as
@@ -136,8 +157,10 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * Push an entity into the background-worker
  *
  * This function is used to push an entity into the queue of pending work. The
- * entities will be processed in the order in which they are received (in terms
- * of the order of invocations in a single-threaded environment).
+ * entities of a given priority will be started in the order in which they are
+ * received (in terms of the order of invocations in a single-threaded
+ * environment), but up to \ref background_worker_config.max_threads of them
+ * may run concurrently.
  *
  * \param worker the background-worker
  * \param entity the entity which is to be queued
@@ -145,11 +168,12 @@ void background_worker_RequestProbe( struct background_worker* worker );
  * \param timeout the timeout of the entity in milliseconds, `0` denotes no
  *                timeout, a negative value will use the default timeout
  *                associated with the background-worker.
+ * \param priority the \ref background_worker_priority of the entity
  * \return VLC_SUCCESS if the entity was successfully queued, an error-code on
  *         failure.
  **/
 int background_worker_Push( struct background_worker* worker, void* entity,
-    void* id, int timeout );
+    void* id, int timeout, int priority );
 
 /**
  * Remove entities from the background-worker
@@ -158,12 +182,13 @@ int background_worker_Push( struct background_worker* worker, void* entity,
  * associated id, or to remove all queued (including currently running)
  * entities.
  *
- * \warning if the `id` passed refers to an entity that is currently being
- *          processed, the call will block until the task has been terminated.
+ * \warning if the `id` passed refers to entities that are currently being
+ *          processed, the call will block until the tasks have been
+ *          terminated.
  *
  * \param worker the background-worker
  * \param id NULL if every entity shall be removed, and the currently running
- *        task (if any) shall be cancelled.
+ *        tasks (if any) shall be cancelled.
  **/
 void background_worker_Cancel( struct background_worker* worker, void* id );
 
@@ -171,11 +196,11 @@ void background_worker_Cancel( struct background_worker* worker, void* id );
  * Delete a background-worker
  *
  * This function will destroy a background-worker created through \ref
- * background_worker_New. It will effectively stop the currently running task,
+ * background_worker_New. It will effectively stop the currently running tasks,
  * if any, and empty the queue of pending entities.
  *
- * \warning If there is a currently running task, the function will block until
- *          it has been stopped.
+ * \warning If there are currently running tasks, the function will block until
+ *          they have been stopped.
  *
  * \param worker the background-worker
  **/
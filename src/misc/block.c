@@ -32,6 +32,7 @@
 #include <fcntl.h>
 
 #include <vlc_common.h>
+#include <vlc_atomic.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
 
@@ -91,14 +92,6 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
-static void block_generic_Release (block_t *block)
-{
-    /* That is always true for blocks allocated with block_Alloc(). */
-    assert (block->p_start == (unsigned char *)(block + 1));
-    block_Invalidate (block);
-    free (block);
-}
-
 static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 {
     out->p_next    = in->p_next;
@@ -117,17 +110,328 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Small blocks pool
+ *
+ * Blocks whose whole allocation fits in one of the size classes are recycled
+ * instead of being returned to the heap. Each thread caches freed blocks in
+ * two magazines per class (the loaded one and the previous one) so that the
+ * common case needs neither lock nor atomic read-modify-write. Full and
+ * empty magazines are exchanged with a global depot protected by a mutex.
+ */
+
+/** Smallest size class (total allocation, including the block_t header) */
+#define BLOCK_CLASS_MIN     512
+/** Number of size classes, each twice as large as the previous one */
+#define BLOCK_CLASSES       6
+/** Number of blocks per magazine */
+#define BLOCK_MAGAZINE_SIZE 16
+/** Maximum number of full magazines kept in the depot per size class */
+#define BLOCK_DEPOT_MAX     8
+
+struct block_magazine
+{
+    struct block_magazine *next;
+    unsigned count;
+    block_t *blocks[BLOCK_MAGAZINE_SIZE];
+};
+
+struct block_cache
+{
+    struct
+    {
+        struct block_magazine *loaded;
+        struct block_magazine *previous;
+    } classes[BLOCK_CLASSES];
+};
+
+static vlc_mutex_t depot_lock = VLC_STATIC_MUTEX;
+static struct
+{
+    struct block_magazine *full;
+    struct block_magazine *empty;
+    unsigned full_count;
+} depot[BLOCK_CLASSES];
+
+static vlc_threadvar_t cache_key;
+static bool cache_key_created = false;
+static thread_local struct block_cache *thread_cache = NULL;
+
+static atomic_uint_fast64_t stats_hits = ATOMIC_VAR_INIT(0);
+static atomic_uint_fast64_t stats_misses = ATOMIC_VAR_INIT(0);
+static atomic_size_t stats_in_use = ATOMIC_VAR_INIT(0);
+static atomic_size_t stats_peak = ATOMIC_VAR_INIT(0);
+
+static inline size_t BlockClassSize(unsigned c)
+{
+    return ((size_t)BLOCK_CLASS_MIN) << c;
+}
+
+/** Returns the smallest class fitting the allocation, or BLOCK_CLASSES */
+static unsigned BlockClass(size_t alloc)
+{
+    unsigned c = 0;
+
+    while (c < BLOCK_CLASSES && BlockClassSize(c) < alloc)
+        c++;
+    return c;
+}
+
+static void BlockStatsAdd(size_t size)
+{
+    size_t in_use = atomic_fetch_add_explicit(&stats_in_use, size,
+                                              memory_order_relaxed) + size;
+    size_t peak = atomic_load_explicit(&stats_peak, memory_order_relaxed);
+
+    while (in_use > peak
+        && !atomic_compare_exchange_weak_explicit(&stats_peak, &peak, in_use,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed));
+}
+
+static void BlockStatsRemove(size_t size)
+{
+    atomic_fetch_sub_explicit(&stats_in_use, size, memory_order_relaxed);
+}
+
+static void BlockMagazineEmpty(struct block_magazine *mag)
+{
+    while (mag->count > 0)
+        free(mag->blocks[--mag->count]);
+}
+
+/** Returns a magazine to the depot on thread exit, or frees it. */
+static void BlockMagazineFlush(unsigned c, struct block_magazine *mag)
+{
+    if (mag->count == BLOCK_MAGAZINE_SIZE)
+    {
+        vlc_mutex_lock(&depot_lock);
+        if (depot[c].full_count < BLOCK_DEPOT_MAX)
+        {
+            mag->next = depot[c].full;
+            depot[c].full = mag;
+            depot[c].full_count++;
+            mag = NULL;
+        }
+        vlc_mutex_unlock(&depot_lock);
+        if (mag == NULL)
+            return;
+    }
+
+    BlockMagazineEmpty(mag);
+    free(mag);
+}
+
+static void BlockCacheDestroy(void *data)
+{
+    struct block_cache *cache = data;
+
+    for (unsigned c = 0; c < BLOCK_CLASSES; c++)
+    {
+        BlockMagazineFlush(c, cache->classes[c].loaded);
+        BlockMagazineFlush(c, cache->classes[c].previous);
+    }
+    free(cache);
+    thread_cache = NULL;
+}
+
+static struct block_cache *BlockCacheCreate(void)
+{
+    vlc_mutex_lock(&depot_lock);
+    if (!cache_key_created)
+        cache_key_created = !vlc_threadvar_create(&cache_key,
+                                                  BlockCacheDestroy);
+    vlc_mutex_unlock(&depot_lock);
+    if (unlikely(!cache_key_created))
+        return NULL;
+
+    struct block_cache *cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    unsigned c;
+    for (c = 0; c < BLOCK_CLASSES; c++)
+    {
+        struct block_magazine *loaded = malloc(sizeof (*loaded));
+        struct block_magazine *previous = malloc(sizeof (*previous));
+
+        if (unlikely(loaded == NULL || previous == NULL))
+        {
+            free(loaded);
+            free(previous);
+            goto error;
+        }
+        loaded->count = previous->count = 0;
+        cache->classes[c].loaded = loaded;
+        cache->classes[c].previous = previous;
+    }
+
+    if (unlikely(vlc_threadvar_set(cache_key, cache)))
+        goto error;
+    thread_cache = cache;
+    return cache;
+
+error:
+    while (c-- > 0)
+    {
+        free(cache->classes[c].loaded);
+        free(cache->classes[c].previous);
+    }
+    free(cache);
+    return NULL;
+}
+
+static struct block_cache *BlockCache(void)
+{
+    struct block_cache *cache = thread_cache;
+
+    if (unlikely(cache == NULL))
+        cache = BlockCacheCreate();
+    return cache;
+}
+
+/** Takes a cached block of the given class, or returns NULL. */
+static block_t *BlockCacheGet(unsigned c)
+{
+    struct block_cache *cache = BlockCache();
+    if (unlikely(cache == NULL))
+        return NULL;
+
+    struct block_magazine *loaded = cache->classes[c].loaded;
+    struct block_magazine *previous = cache->classes[c].previous;
+
+    if (loaded->count == 0)
+    {
+        if (previous->count == 0)
+        {   /* Both magazines are empty: swap one for a full one */
+            vlc_mutex_lock(&depot_lock);
+            struct block_magazine *full = depot[c].full;
+            if (full == NULL)
+            {
+                vlc_mutex_unlock(&depot_lock);
+                return NULL;
+            }
+            depot[c].full = full->next;
+            depot[c].full_count--;
+            previous->next = depot[c].empty;
+            depot[c].empty = previous;
+            vlc_mutex_unlock(&depot_lock);
+            previous = full;
+        }
+
+        cache->classes[c].loaded = previous;
+        cache->classes[c].previous = loaded;
+        loaded = previous;
+    }
+
+    return loaded->blocks[--loaded->count];
+}
+
+/** Caches a released block of the given class, or returns false. */
+static bool BlockCachePut(unsigned c, block_t *b)
+{
+    struct block_cache *cache = BlockCache();
+    if (unlikely(cache == NULL))
+        return false;
+
+    struct block_magazine *loaded = cache->classes[c].loaded;
+    struct block_magazine *previous = cache->classes[c].previous;
+
+    if (loaded->count == BLOCK_MAGAZINE_SIZE)
+    {
+        if (previous->count == BLOCK_MAGAZINE_SIZE)
+        {   /* Both magazines are full: swap one for an empty one */
+            vlc_mutex_lock(&depot_lock);
+            if (depot[c].full_count >= BLOCK_DEPOT_MAX)
+            {
+                vlc_mutex_unlock(&depot_lock);
+                return false;
+            }
+
+            struct block_magazine *empty = depot[c].empty;
+            if (empty != NULL)
+                depot[c].empty = empty->next;
+            else
+            {
+                empty = malloc(sizeof (*empty));
+                if (unlikely(empty == NULL))
+                {
+                    vlc_mutex_unlock(&depot_lock);
+                    return false;
+                }
+            }
+            previous->next = depot[c].full;
+            depot[c].full = previous;
+            depot[c].full_count++;
+            vlc_mutex_unlock(&depot_lock);
+            empty->count = 0;
+            previous = empty;
+        }
+
+        cache->classes[c].loaded = previous;
+        cache->classes[c].previous = loaded;
+        loaded = previous;
+    }
+
+    loaded->blocks[loaded->count++] = b;
+    return true;
+}
+
+static void block_pool_Release (block_t *block)
+{
+    const size_t alloc = sizeof (*block) + block->i_size;
+    const unsigned c = BlockClass (alloc);
+
+    assert (block->p_start == (unsigned char *)(block + 1));
+    assert (c < BLOCK_CLASSES && BlockClassSize (c) == alloc);
+    block_Invalidate (block);
+    BlockStatsRemove (alloc);
+
+    if (!BlockCachePut (c, block))
+        free (block);
+}
+
+static void block_generic_Release (block_t *block)
+{
+    /* That is always true for blocks allocated with block_Alloc(). */
+    assert (block->p_start == (unsigned char *)(block + 1));
+    block_Invalidate (block);
+    BlockStatsRemove (sizeof (*block) + block->i_size);
+    free (block);
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
-        return NULL;
+    block_t *b;
+    block_free_t release = block_generic_Release;
+    const unsigned c = BlockClass (alloc);
+
+    if (c < BLOCK_CLASSES)
+    {   /* The whole class size is usable as buffer space */
+        alloc = BlockClassSize (c);
+        release = block_pool_Release;
+        b = BlockCacheGet (c);
+        if (b != NULL)
+            atomic_fetch_add_explicit (&stats_hits, 1, memory_order_relaxed);
+        else
+            atomic_fetch_add_explicit (&stats_misses, 1, memory_order_relaxed);
+    }
+    else
+        b = NULL;
+
+    if (b == NULL)
+    {
+        b = malloc (alloc);
+        if (unlikely(b == NULL))
+            return NULL;
+    }
+    BlockStatsAdd (alloc);
 
     block_Init (b, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
@@ -135,10 +439,20 @@ block_t *block_Alloc (size_t size)
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
+    b->pf_release = release;
     return b;
 }
 
+void block_GetStats (block_stats_t *stats)
+{
+    stats->hits = atomic_load_explicit (&stats_hits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit (&stats_misses,
+                                          memory_order_relaxed);
+    stats->in_use = atomic_load_explicit (&stats_in_use,
+                                          memory_order_relaxed);
+    stats->peak = atomic_load_explicit (&stats_peak, memory_order_relaxed);
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
@@ -0,0 +1,332 @@
+/*****************************************************************************
+ * block_queue.c: bounded lock-free block queue
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_atomic.h>
+
+/* NOTE:
+ * The queue is a ring of slots, each with a sequence number (Vyukov's
+ * bounded queue). A slot is free for the producer at position pos when its
+ * sequence equals pos, and holds a block for the consumer at position pos
+ * when its sequence equals pos + 1. Producers claim positions by bumping
+ * the tail index, with a compare-and-swap only if there are several of
+ * them. The single consumer owns the head index.
+ *
+ * Sleeping is the slow path: the waiting side raises a flag, checks the
+ * ring again, then sleeps on a condition variable. The other side only
+ * takes the lock to wake it up if it sees the flag after updating the ring.
+ * Full memory barriers on both sides guarantee that at least one of them
+ * sees the update of the other. Producers waiting for room are only woken
+ * up once the queue is half empty, so that they do not take turns for each
+ * freed slot.
+ */
+
+#define CACHE_LINE 64
+
+struct block_queue_slot
+{
+    atomic_size_t seq;
+    block_t      *block;
+};
+
+struct block_queue_t
+{
+    size_t              mask;
+    bool                b_multi;      /**< multiple producers */
+
+    /* producer side */
+    char                pad0[CACHE_LINE];
+    atomic_size_t       tail;
+    char                pad1[CACHE_LINE];
+
+    /* consumer side */
+    size_t              head;
+    char                pad2[CACHE_LINE];
+
+    atomic_size_t       i_depth;
+    atomic_size_t       i_size;
+
+    /* slow path */
+    atomic_bool         b_get_waiting;
+    atomic_uint         i_put_waiting;
+    vlc_mutex_t         lock;
+    vlc_cond_t          wait_data;    /**< Wait for a block */
+    vlc_cond_t          wait_space;   /**< Wait for a free slot */
+
+    struct block_queue_slot slots[];
+};
+
+block_queue_t *block_QueueNew(size_t capacity, bool multi_producer)
+{
+    size_t size = 2;
+
+    while (size < capacity)
+    {
+        if (unlikely(size > SIZE_MAX / (2 * sizeof (struct block_queue_slot))))
+            return NULL;
+        size *= 2;
+    }
+
+    block_queue_t *q = malloc(sizeof (*q) + size * sizeof (q->slots[0]));
+    if (unlikely(q == NULL))
+        return NULL;
+
+    q->mask = size - 1;
+    q->b_multi = multi_producer;
+    atomic_init(&q->tail, 0);
+    q->head = 0;
+    atomic_init(&q->i_depth, 0);
+    atomic_init(&q->i_size, 0);
+    atomic_init(&q->b_get_waiting, false);
+    atomic_init(&q->i_put_waiting, 0);
+    vlc_mutex_init(&q->lock);
+    vlc_cond_init(&q->wait_data);
+    vlc_cond_init(&q->wait_space);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        atomic_init(&q->slots[i].seq, i);
+        q->slots[i].block = NULL;
+    }
+    return q;
+}
+
+void block_QueueRelease(block_queue_t *q)
+{
+    block_QueueEmpty(q);
+    vlc_cond_destroy(&q->wait_space);
+    vlc_cond_destroy(&q->wait_data);
+    vlc_mutex_destroy(&q->lock);
+    free(q);
+}
+
+static void WakeUp(block_queue_t *q, vlc_cond_t *cond)
+{
+    vlc_mutex_lock(&q->lock);
+    vlc_cond_broadcast(cond);
+    vlc_mutex_unlock(&q->lock);
+}
+
+static bool Enqueue(block_queue_t *q, block_t *block)
+{
+    struct block_queue_slot *slot;
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    for (;;)
+    {
+        slot = &q->slots[pos & q->mask];
+
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (!q->b_multi)
+            {
+                atomic_store_explicit(&q->tail, pos + 1,
+                                      memory_order_relaxed);
+                break;
+            }
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return false; /* full */
+        else
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    }
+
+    /* Account before publishing, so that the counters never underflow */
+    atomic_fetch_add_explicit(&q->i_depth, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&q->i_size, block->i_buffer,
+                              memory_order_relaxed);
+
+    slot->block = block;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return true;
+}
+
+/* Wakes the consumer up after enqueuing, if it is sleeping */
+static void EnqueueDone(block_queue_t *q)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->b_get_waiting, memory_order_relaxed))
+        WakeUp(q, &q->wait_data);
+}
+
+static block_t *Dequeue(block_queue_t *q)
+{
+    size_t pos = q->head;
+    struct block_queue_slot *slot = &q->slots[pos & q->mask];
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1)
+        return NULL; /* empty */
+
+    block_t *block = slot->block;
+
+    slot->block = NULL;
+    atomic_store_explicit(&slot->seq, pos + q->mask + 1,
+                          memory_order_release);
+    q->head = pos + 1;
+
+    assert(atomic_load_explicit(&q->i_depth, memory_order_relaxed) > 0);
+    atomic_fetch_sub_explicit(&q->i_depth, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&q->i_size, block->i_buffer,
+                              memory_order_relaxed);
+    return block;
+}
+
+/* Wakes the producers up after dequeuing, if any of them is sleeping */
+static void DequeueDone(block_queue_t *q)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->i_put_waiting, memory_order_relaxed) > 0
+     && atomic_load_explicit(&q->i_depth, memory_order_relaxed) <= q->mask / 2)
+        WakeUp(q, &q->wait_space);
+}
+
+bool block_QueueTryPut(block_queue_t *q, block_t *block)
+{
+    assert(block->p_next == NULL);
+    if (!Enqueue(q, block))
+        return false;
+    EnqueueDone(q);
+    return true;
+}
+
+void block_QueuePut(block_queue_t *q, block_t *block)
+{
+    while (block != NULL)
+    {
+        block_t *next = block->p_next;
+
+        block->p_next = NULL;
+        if (!Enqueue(q, block))
+        {
+            int canc = vlc_savecancel();
+
+            vlc_mutex_lock(&q->lock);
+            atomic_fetch_add_explicit(&q->i_put_waiting, 1,
+                                      memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            while (!Enqueue(q, block))
+                vlc_cond_wait(&q->wait_space, &q->lock);
+            atomic_fetch_sub_explicit(&q->i_put_waiting, 1,
+                                      memory_order_relaxed);
+            vlc_mutex_unlock(&q->lock);
+            vlc_restorecancel(canc);
+        }
+        EnqueueDone(q);
+        block = next;
+    }
+}
+
+block_t *block_QueueTryGet(block_queue_t *q)
+{
+    block_t *block = Dequeue(q);
+
+    if (block != NULL)
+        DequeueDone(q);
+    return block;
+}
+
+static void QueueCleanup(void *data)
+{
+    block_queue_t *q = data;
+
+    atomic_store_explicit(&q->b_get_waiting, false, memory_order_relaxed);
+    vlc_mutex_unlock(&q->lock);
+}
+
+/* Dequeues one block, sleeping until there is one */
+static block_t *DequeueWait(block_queue_t *q)
+{
+    block_t *block;
+
+    vlc_testcancel();
+
+    block = Dequeue(q);
+    if (block != NULL)
+        return block;
+
+    vlc_mutex_lock(&q->lock);
+    vlc_cleanup_push(QueueCleanup, q);
+    atomic_store_explicit(&q->b_get_waiting, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    while ((block = Dequeue(q)) == NULL)
+        vlc_cond_wait(&q->wait_data, &q->lock);
+    vlc_cleanup_pop();
+    QueueCleanup(q);
+    return block;
+}
+
+block_t *block_QueueGet(block_queue_t *q)
+{
+    block_t *block = DequeueWait(q);
+
+    DequeueDone(q);
+    return block;
+}
+
+block_t *block_QueueGetBatch(block_queue_t *q, size_t max)
+{
+    block_t *first = DequeueWait(q), *block;
+    block_t **pp_last = &first->p_next;
+
+    for (size_t n = 1; n != max && (block = Dequeue(q)) != NULL; n++)
+    {
+        *pp_last = block;
+        pp_last = &block->p_next;
+    }
+    DequeueDone(q);
+    return first;
+}
+
+void block_QueueEmpty(block_queue_t *q)
+{
+    block_t *block;
+
+    while ((block = Dequeue(q)) != NULL)
+        block_Release(block);
+    DequeueDone(q);
+}
+
+size_t block_QueueGetCount(const block_queue_t *q)
+{
+    return atomic_load_explicit(&((block_queue_t *)q)->i_depth,
+                                memory_order_relaxed);
+}
+
+size_t block_QueueGetBytes(const block_queue_t *q)
+{
+    return atomic_load_explicit(&((block_queue_t *)q)->i_size,
+                                memory_order_relaxed);
+}
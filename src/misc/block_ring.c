@@ -0,0 +1,179 @@
+/*****************************************************************************
+ * block_ring.c: shared block ring
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_atomic.h>
+#include <vlc_block.h>
+
+#include "block_ring.h"
+
+/* maximum number of blocks in a ring, must be a power of 2 */
+#define BLOCK_RING_SLOTS 8192
+
+/* a block shared by the ring and its readers: the readers all get the
+ * same read-only view of the pushed block, and release it as usual */
+typedef struct
+{
+    block_t     self;
+    atomic_uint refs;
+    block_t    *p_block;
+} block_ring_entry_t;
+
+struct block_ring_t
+{
+    vlc_mutex_t lock;
+
+    size_t      i_max_size;
+    size_t      i_size;         /* total size of the kept blocks */
+
+    uint64_t    i_first;        /* sequence of the oldest kept block */
+    uint64_t    i_next;         /* sequence of the next pushed block */
+    uint64_t    i_keyframe;     /* sequence of the last keyframe, 0 if none */
+
+    block_ring_entry_t *entries[BLOCK_RING_SLOTS];
+};
+
+static void EntryRelease(block_ring_entry_t *p_entry)
+{
+    if (atomic_fetch_sub(&p_entry->refs, 1) == 1)
+    {
+        block_Release(p_entry->p_block);
+        free(p_entry);
+    }
+}
+
+static void ViewRelease(block_t *p_block)
+{
+    EntryRelease(container_of(p_block, block_ring_entry_t, self));
+}
+
+block_ring_t *block_RingNew(size_t i_max_size)
+{
+    block_ring_t *p_ring = malloc(sizeof (*p_ring));
+    if (unlikely(p_ring == NULL))
+        return NULL;
+
+    vlc_mutex_init(&p_ring->lock);
+    p_ring->i_max_size = i_max_size;
+    p_ring->i_size = 0;
+    /* sequences start at 1, so that a cursor is never 0 */
+    p_ring->i_first = 1;
+    p_ring->i_next = 1;
+    p_ring->i_keyframe = 0;
+    return p_ring;
+}
+
+void block_RingDelete(block_ring_t *p_ring)
+{
+    for (uint64_t i = p_ring->i_first; i < p_ring->i_next; i++)
+        EntryRelease(p_ring->entries[i % BLOCK_RING_SLOTS]);
+    vlc_mutex_destroy(&p_ring->lock);
+    free(p_ring);
+}
+
+void block_RingPush(block_ring_t *p_ring, block_t *p_block)
+{
+    block_ring_entry_t *p_entry = malloc(sizeof (*p_entry));
+    if (unlikely(p_entry == NULL))
+    {
+        block_Release(p_block);
+        return;
+    }
+
+    p_block->p_next = NULL;
+    atomic_init(&p_entry->refs, 1);
+    p_entry->p_block = p_block;
+
+    block_Init(&p_entry->self, p_block->p_buffer, p_block->i_buffer);
+    p_entry->self.i_flags = p_block->i_flags;
+    p_entry->self.i_nb_samples = p_block->i_nb_samples;
+    p_entry->self.i_pts = p_block->i_pts;
+    p_entry->self.i_dts = p_block->i_dts;
+    p_entry->self.i_length = p_block->i_length;
+    p_entry->self.pf_release = ViewRelease;
+
+    vlc_mutex_lock(&p_ring->lock);
+    /* drop the oldest blocks, readers may still hold them */
+    while (p_ring->i_first < p_ring->i_next
+        && (p_ring->i_next - p_ring->i_first >= BLOCK_RING_SLOTS
+         || p_ring->i_size + p_block->i_buffer > p_ring->i_max_size))
+    {
+        block_ring_entry_t *p_old =
+            p_ring->entries[p_ring->i_first % BLOCK_RING_SLOTS];
+
+        p_ring->i_size -= p_old->p_block->i_buffer;
+        p_ring->i_first++;
+        EntryRelease(p_old);
+    }
+
+    if (p_block->i_flags & BLOCK_FLAG_TYPE_I)
+        p_ring->i_keyframe = p_ring->i_next;
+    p_ring->entries[p_ring->i_next % BLOCK_RING_SLOTS] = p_entry;
+    p_ring->i_size += p_block->i_buffer;
+    p_ring->i_next++;
+    vlc_mutex_unlock(&p_ring->lock);
+}
+
+static uint64_t RingStart(const block_ring_t *p_ring)
+{
+    if (p_ring->i_keyframe >= p_ring->i_first)
+        return p_ring->i_keyframe;
+    if (p_ring->i_next > p_ring->i_first)
+        return p_ring->i_next - 1;
+    return p_ring->i_next;
+}
+
+uint64_t block_RingStart(block_ring_t *p_ring)
+{
+    vlc_mutex_lock(&p_ring->lock);
+    uint64_t i_cursor = RingStart(p_ring);
+    vlc_mutex_unlock(&p_ring->lock);
+    return i_cursor;
+}
+
+block_t *block_RingRead(block_ring_t *p_ring, uint64_t *pi_cursor)
+{
+    block_ring_entry_t *p_entry;
+
+    assert(*pi_cursor > 0);
+
+    vlc_mutex_lock(&p_ring->lock);
+    if (*pi_cursor < p_ring->i_first) /* this reader is not fast enough */
+        *pi_cursor = RingStart(p_ring);
+    if (*pi_cursor >= p_ring->i_next)
+    {
+        vlc_mutex_unlock(&p_ring->lock);
+        return NULL;
+    }
+
+    p_entry = p_ring->entries[*pi_cursor % BLOCK_RING_SLOTS];
+    atomic_fetch_add(&p_entry->refs, 1);
+    (*pi_cursor)++;
+    vlc_mutex_unlock(&p_ring->lock);
+
+    return &p_entry->self;
+}
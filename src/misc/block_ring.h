@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * block_ring.h: shared block ring
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef BLOCK_RING_H__
+#define BLOCK_RING_H__
+
+/**
+ * Single producer, multiple readers ring of blocks.
+ *
+ * The ring keeps the most recent blocks, up to a total size. Each reader
+ * owns a cursor (a sequence number, never 0) and gets read-only references
+ * to the blocks, so the data is never copied whatever the number of readers.
+ *
+ * A reader that falls behind the oldest kept block is moved forward to the
+ * last keyframe still in the ring, or to the most recent block.
+ */
+typedef struct block_ring_t block_ring_t;
+
+/**
+ * Creates a ring keeping at most i_max_size bytes of blocks.
+ */
+block_ring_t *block_RingNew(size_t i_max_size) VLC_USED;
+
+/**
+ * Destroys a ring. Blocks still referenced by readers remain valid.
+ */
+void block_RingDelete(block_ring_t *);
+
+/**
+ * Appends a block to the ring, dropping the oldest blocks if needed.
+ * The ring takes ownership of the block (and not of its p_next chain).
+ */
+void block_RingPush(block_ring_t *, block_t *);
+
+/**
+ * Returns the cursor a new reader should start from: the last keyframe in
+ * the ring if any, otherwise the most recent block.
+ */
+uint64_t block_RingStart(block_ring_t *);
+
+/**
+ * Reads the block at a reader cursor and advances the cursor.
+ *
+ * The returned block is shared with the ring and the other readers, with
+ * nothing allocated per read: neither its data nor its metadata (including
+ * p_next) may be modified. It must be released with block_Release().
+ *
+ * \return a block, or NULL if the reader is up to date
+ */
+block_t *block_RingRead(block_ring_t *, uint64_t *pi_cursor) VLC_USED;
+
+#endif
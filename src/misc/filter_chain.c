@@ -438,6 +438,44 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
     return NULL;
 }
 
+static picture_t *FilterChainVideoDrain( filter_chain_t *p_chain, bool b_wait )
+{
+    /* Pictures left over by a previous call go first */
+    picture_t *p_pic = filter_chain_VideoFilter( p_chain, NULL );
+    if( p_pic )
+        return p_pic;
+
+    /* Upstream filters are drained first, so that their pictures reach the
+     * downstream filters before those are drained. */
+    for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
+    {
+        p_pic = filter_DrainVideo( &f->filter, b_wait );
+        if( !p_pic )
+            continue;
+
+        assert( f->pending == NULL );
+        f->pending = p_pic->p_next;
+        p_pic->p_next = NULL;
+
+        p_pic = FilterChainVideoFilter( f->next, p_pic );
+        if( !p_pic )
+            p_pic = filter_chain_VideoFilter( p_chain, NULL );
+        if( p_pic )
+            return p_pic;
+    }
+    return NULL;
+}
+
+picture_t *filter_chain_VideoDrain( filter_chain_t *p_chain )
+{
+    return FilterChainVideoDrain( p_chain, true );
+}
+
+picture_t *filter_chain_VideoCollect( filter_chain_t *p_chain )
+{
+    return FilterChainVideoDrain( p_chain, false );
+}
+
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
@@ -0,0 +1,194 @@
+/*****************************************************************************
+ * slices.c: slice threading pool
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_slices.h>
+
+#include "libvlc.h"
+#include "slices.h"
+
+/* Bands shorter than this are not worth a thread */
+#define SLICE_MIN_LINES 16
+
+typedef struct slice_job_t slice_job_t;
+struct slice_job_t
+{
+    vlc_slice_cb pf_run;
+    void        *opaque;
+    unsigned     i_count; /* number of bands */
+    unsigned     i_next;  /* next band to start */
+    unsigned     i_done;  /* number of finished bands */
+    slice_job_t *p_next;
+};
+
+struct vlc_slices_t
+{
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait_work; /* a job was queued, or the pool is closing */
+    vlc_cond_t   wait_done; /* a job was completed */
+    slice_job_t *p_first;   /* jobs with bands left to start */
+    slice_job_t **pp_last;
+    bool         b_closing;
+
+    unsigned     i_threads; /* including the calling threads */
+    unsigned     i_started; /* pool threads */
+    vlc_thread_t threads[];
+};
+
+vlc_slices_t *vlc_slices_New(unsigned i_threads)
+{
+    assert(i_threads > 0);
+
+    vlc_slices_t *p_pool = malloc(sizeof (*p_pool)
+                                  + (i_threads - 1) * sizeof (vlc_thread_t));
+    if (unlikely(p_pool == NULL))
+        return NULL;
+
+    vlc_mutex_init(&p_pool->lock);
+    vlc_cond_init(&p_pool->wait_work);
+    vlc_cond_init(&p_pool->wait_done);
+    p_pool->p_first = NULL;
+    p_pool->pp_last = &p_pool->p_first;
+    p_pool->b_closing = false;
+    p_pool->i_threads = i_threads;
+    p_pool->i_started = 0;
+    return p_pool;
+}
+
+void vlc_slices_Delete(vlc_slices_t *p_pool)
+{
+    vlc_mutex_lock(&p_pool->lock);
+    assert(p_pool->p_first == NULL);
+    p_pool->b_closing = true;
+    vlc_cond_broadcast(&p_pool->wait_work);
+    vlc_mutex_unlock(&p_pool->lock);
+
+    for (unsigned i = 0; i < p_pool->i_started; i++)
+        vlc_join(p_pool->threads[i], NULL);
+
+    vlc_cond_destroy(&p_pool->wait_done);
+    vlc_cond_destroy(&p_pool->wait_work);
+    vlc_mutex_destroy(&p_pool->lock);
+    free(p_pool);
+}
+
+/* Starts and runs the next band of a job. Called and returns locked. */
+static void RunBand(vlc_slices_t *p_pool, slice_job_t *p_job)
+{
+    const vlc_slice_t slice = {
+        .i_index = p_job->i_next++,
+        .i_count = p_job->i_count,
+    };
+
+    if (p_job->i_next == p_job->i_count)
+    {   /* last band started: remove the job from the queue */
+        slice_job_t **pp = &p_pool->p_first;
+
+        while (*pp != p_job)
+            pp = &(*pp)->p_next;
+        *pp = p_job->p_next;
+        if (p_pool->pp_last == &p_job->p_next)
+            p_pool->pp_last = pp;
+    }
+
+    vlc_mutex_unlock(&p_pool->lock);
+    p_job->pf_run(p_job->opaque, &slice);
+    vlc_mutex_lock(&p_pool->lock);
+
+    if (++p_job->i_done == p_job->i_count)
+        vlc_cond_broadcast(&p_pool->wait_done);
+}
+
+static void *Thread(void *data)
+{
+    vlc_slices_t *p_pool = data;
+
+    vlc_mutex_lock(&p_pool->lock);
+    for (;;)
+    {
+        while (p_pool->p_first == NULL && !p_pool->b_closing)
+            vlc_cond_wait(&p_pool->wait_work, &p_pool->lock);
+        if (p_pool->p_first == NULL)
+            break;
+        RunBand(p_pool, p_pool->p_first);
+    }
+    vlc_mutex_unlock(&p_pool->lock);
+    return NULL;
+}
+
+void vlc_slices_RunPool(vlc_slices_t *p_pool, unsigned i_lines,
+                        unsigned i_halo, vlc_slice_cb pf_run, void *opaque)
+{
+    unsigned i_min = __MAX(SLICE_MIN_LINES, 4 * i_halo);
+    unsigned i_count = __MIN(i_lines / i_min, p_pool->i_threads);
+
+    if (i_count <= 1)
+    {
+        const vlc_slice_t slice = { .i_index = 0, .i_count = 1 };
+
+        pf_run(opaque, &slice);
+        return;
+    }
+
+    slice_job_t job = {
+        .pf_run = pf_run,
+        .opaque = opaque,
+        .i_count = i_count,
+        .i_next = 0,
+        .i_done = 0,
+        .p_next = NULL,
+    };
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock(&p_pool->lock);
+    /* Start the pool threads on first use */
+    while (p_pool->i_started < p_pool->i_threads - 1
+        && !vlc_clone(&p_pool->threads[p_pool->i_started], Thread, p_pool,
+                      VLC_THREAD_PRIORITY_VIDEO))
+        p_pool->i_started++;
+
+    *p_pool->pp_last = &job;
+    p_pool->pp_last = &job.p_next;
+    vlc_cond_broadcast(&p_pool->wait_work);
+
+    /* Take part, then wait for the bands started by the pool threads */
+    while (job.i_next < job.i_count)
+        RunBand(p_pool, &job);
+    while (job.i_done < job.i_count)
+        vlc_cond_wait(&p_pool->wait_done, &p_pool->lock);
+    vlc_mutex_unlock(&p_pool->lock);
+
+    vlc_restorecancel(canc);
+}
+
+#undef vlc_slices_Run
+void vlc_slices_Run(vlc_object_t *obj, unsigned i_lines, unsigned i_halo,
+                    vlc_slice_cb pf_run, void *opaque)
+{
+    vlc_slices_RunPool(libvlc_priv(obj->obj.libvlc)->slices, i_lines, i_halo,
+                       pf_run, opaque);
+}
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ * slices.h: slice threading pool
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_SLICES_H
+#define LIBVLC_SLICES_H 1
+
+#include <vlc_slices.h>
+
+typedef struct vlc_slices_t vlc_slices_t;
+
+/**
+ * Creates a pool running jobs on up to i_threads threads, including the
+ * calling ones. The pool threads are only started by the first job.
+ */
+vlc_slices_t *vlc_slices_New(unsigned i_threads) VLC_USED;
+
+/**
+ * Stops the pool threads and destroys the pool. No jobs may be running.
+ */
+void vlc_slices_Delete(vlc_slices_t *);
+
+/**
+ * Runs a job from a given pool, see vlc_slices_Run().
+ */
+void vlc_slices_RunPool(vlc_slices_t *, unsigned i_lines, unsigned i_halo,
+                        vlc_slice_cb pf_run, void *opaque);
+
+#endif
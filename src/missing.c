@@ -164,6 +164,12 @@ int httpd_StreamSend (httpd_stream_t *stream, const block_t *p_block)
     vlc_assert_unreachable ();
 }
 
+int httpd_StreamSendBlock (httpd_stream_t *stream, block_t *p_block)
+{
+    (void) stream; (void) p_block;
+    vlc_assert_unreachable ();
+}
+
 int httpd_StreamSetHTTPHeaders (httpd_stream_t * stream,
                                 httpd_header * headers,
                                 size_t i_headers)
@@ -94,7 +94,7 @@ static void vlc_modcap_sort(const void *node, const VISIT which,
 static struct
 {
     vlc_mutex_t lock;
-    block_t *caches;
+    vlc_plugin_cache_t *caches;
     void *caps_tree;
     unsigned usage;
 } modules = { VLC_STATIC_MUTEX, NULL, NULL, 0 };
@@ -142,14 +142,22 @@ error:
 }
 
 /**
- * Adds a plugin (and all its modules) to the bank
+ * Adds a plugin to the bank, without indexing its modules
  */
-static void vlc_plugin_store(vlc_plugin_t *lib)
+static void vlc_plugin_add(vlc_plugin_t *lib)
 {
     /*vlc_assert_locked (&modules.lock);*/
 
     lib->next = vlc_plugins;
     vlc_plugins = lib;
+}
+
+/**
+ * Adds a plugin (and all its modules) to the bank
+ */
+static void vlc_plugin_store(vlc_plugin_t *lib)
+{
+    vlc_plugin_add(lib);
 
     for (module_t *m = lib->module; m != NULL; m = m->next)
         vlc_module_store(m);
@@ -258,7 +266,7 @@ typedef struct module_bank
 
     size_t        size;
     vlc_plugin_t **plugins;
-    vlc_plugin_t *cache;
+    vlc_plugin_cache_t *cache;
 } module_bank_t;
 
 /**
@@ -270,9 +278,9 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
     vlc_plugin_t *plugin = NULL;
 
     /* Check our plugins cache first then load plugin if needed */
-    if (bank->mode & CACHE_READ_FILE)
+    if (bank->cache != NULL)
     {
-        plugin = vlc_cache_lookup(&bank->cache, relpath);
+        plugin = vlc_cache_lookup(bank->cache, relpath);
 
         if (plugin != NULL
          && (plugin->mtime != (int64_t)st->st_mtime
@@ -280,28 +288,25 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
         {
             msg_Err(bank->obj, "stale plugins cache: modified %s",
                     plugin->abspath);
-            vlc_plugin_destroy(plugin);
+            vlc_cache_discard(bank->cache, plugin);
             plugin = NULL;
         }
     }
 
-    if (plugin == NULL)
+    if (plugin != NULL) /* modules are indexed by the cache */
+        vlc_plugin_add(plugin);
+    else
     {
         plugin = module_InitDynamic(bank->obj, abspath, true);
+        if (plugin == NULL)
+            return -1;
 
-        if (plugin != NULL)
-        {
-            plugin->path = xstrdup(relpath);
-            plugin->mtime = st->st_mtime;
-            plugin->size = st->st_size;
-        }
+        plugin->path = xstrdup(relpath);
+        plugin->mtime = st->st_mtime;
+        plugin->size = st->st_size;
+        vlc_plugin_store(plugin);
     }
 
-    if (plugin == NULL)
-        return -1;
-
-    vlc_plugin_store(plugin);
-
     if (bank->mode & CACHE_WRITE_FILE) /* Add entry to to-be-saved cache */
     {
         bank->plugins = xrealloc(bank->plugins,
@@ -406,7 +411,7 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
     };
 
     if (mode & CACHE_READ_FILE)
-        bank.cache = vlc_cache_load(obj, path, &modules.caches);
+        bank.cache = vlc_cache_load(obj, path);
     else
         msg_Dbg(bank.obj, "ignoring plugins cache file");
 
@@ -418,16 +423,32 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
         AllocatePluginDir(&bank, 5, path, NULL);
     }
 
-    /* Deal with unmatched cache entries from cache file */
-    while (bank.cache != NULL)
+    if (bank.cache != NULL)
     {
-        vlc_plugin_t *plugin = bank.cache;
+        vlc_plugin_cache_t *cache = bank.cache;
 
-        bank.cache = plugin->next;
-        if (mode & CACHE_SCAN_DIR)
-            vlc_plugin_destroy(plugin);
-        else
-            vlc_plugin_store(plugin);
+        /* Deal with unmatched cache entries from cache file */
+        while (cache->plugins != NULL)
+        {
+            vlc_plugin_t *plugin = cache->plugins;
+
+            cache->plugins = plugin->next;
+            if (mode & CACHE_SCAN_DIR)
+                vlc_cache_discard(cache, plugin);
+            else
+                vlc_plugin_add(plugin);
+        }
+
+        /* If some cached plug-ins were discarded, the capabilities index of
+         * the cache is stale: index the remaining modules in the bank. */
+        if (cache->capv == NULL)
+            for (size_t i = 0; i < cache->modc; i++)
+                if (cache->modv[i] != NULL)
+                    vlc_module_store(cache->modv[i]);
+
+        /* Keep the cache: the plug-ins point into it */
+        cache->next = modules.caches;
+        modules.caches = cache;
     }
 
     if (mode & CACHE_WRITE_FILE)
@@ -610,7 +631,7 @@ void module_InitBank (void)
 void module_EndBank (bool b_plugins)
 {
     vlc_plugin_t *libs = NULL;
-    block_t *caches = NULL;
+    vlc_plugin_cache_t *caches = NULL;
     void *caps_tree = NULL;
 
     /* If plugins were _not_ loaded, then the caller still has the bank lock
@@ -644,7 +665,17 @@ void module_EndBank (bool b_plugins)
         vlc_plugin_destroy(lib);
     }
 
-    block_ChainRelease(caches);
+#ifdef HAVE_DYNAMIC_PLUGINS
+    while (caches != NULL)
+    {
+        vlc_plugin_cache_t *cache = caches;
+
+        caches = cache->next;
+        vlc_cache_release(cache);
+    }
+#else
+    assert(caches == NULL);
+#endif
 }
 
 #undef module_LoadPlugins
@@ -733,19 +764,59 @@ module_t **module_list_get (size_t *n)
 ssize_t module_list_cap (module_t ***restrict list, const char *name)
 {
     const vlc_modcap_t **cp = tfind(&name, &modules.caps_tree, vlc_modcap_cmp);
-    if (cp == NULL)
+    const vlc_modcap_t *cap = (cp != NULL) ? *cp : NULL;
+    size_t n = (cap != NULL) ? cap->modc : 0;
+    unsigned sources = n > 0;
+
+    /* Modules of the plugins caches are indexed in the cache files */
+#ifdef HAVE_DYNAMIC_PLUGINS
+    for (const vlc_plugin_cache_t *cache = modules.caches;
+         cache != NULL;
+         cache = cache->next)
+    {
+        const uint32_t *modv;
+        size_t modc = vlc_cache_cap(cache, name, &modv);
+
+        n += modc;
+        sources += modc > 0;
+    }
+#endif
+
+    if (n == 0)
     {
         *list = NULL;
         return 0;
     }
 
-    const vlc_modcap_t *cap = *cp;
-    size_t n = cap->modc;
     module_t **tab = malloc (sizeof (*tab) * n);
     *list = tab;
     if (unlikely(tab == NULL))
         return -1;
 
-    memcpy(tab, cap->modv, sizeof (*tab) * n);
+    size_t i = 0;
+
+    if (cap != NULL)
+    {
+        memcpy(tab, cap->modv, sizeof (*tab) * cap->modc);
+        i = cap->modc;
+    }
+
+#ifdef HAVE_DYNAMIC_PLUGINS
+    for (const vlc_plugin_cache_t *cache = modules.caches;
+         cache != NULL;
+         cache = cache->next)
+    {
+        const uint32_t *modv;
+        size_t modc = vlc_cache_cap(cache, name, &modv);
+
+        for (size_t j = 0; j < modc; j++)
+            tab[i++] = cache->modv[modv[j]];
+    }
+#endif
+    assert(i == n);
+
+    /* Each source is already sorted, merge them */
+    if (sources > 1)
+        qsort(tab, n, sizeof (*tab), vlc_module_cmp);
     return n;
 }
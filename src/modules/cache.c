@@ -57,7 +57,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 34
+#define CACHE_SUBVERSION_NUM 35
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -200,18 +200,6 @@ static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
         LOAD_STRING(psz);
         cfg->orig.psz = (char *)psz;
         cfg->value.psz = (psz != NULL) ? strdup (cfg->orig.psz) : NULL;
-
-        if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else
-            LOAD_STRING(cfg->list_cb_name);
-        for (unsigned i = 0; i < cfg->list_count; i++)
-        {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
-                goto error;
-        }
     }
     else
     {
@@ -219,29 +207,103 @@ static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
         LOAD_IMMEDIATE (cfg->min);
         LOAD_IMMEDIATE (cfg->max);
         cfg->value = cfg->orig;
+    }
+
+    /* Values lists are loaded on demand by vlc_cache_load_lists() */
+    if (cfg->list_count == 0)
+        LOAD_STRING(cfg->list_cb_name);
+    return 0;
+error:
+    return -1;
+}
+
+static int vlc_cache_load_config_lists(module_config_t *cfg, block_t *file)
+{
+    const char **list = NULL;
+    const char **text = malloc(cfg->list_count * sizeof (*text));
+    if (unlikely(text == NULL))
+        return -1;
 
-        if (cfg->list_count)
+    if (IsConfigStringType (cfg->i_type))
+    {
+        list = malloc(cfg->list_count * sizeof (*list));
+        if (unlikely(list == NULL))
+            goto error;
+
+        for (unsigned i = 0; i < cfg->list_count; i++)
         {
-            LOAD_ALIGNOF(*cfg->list.i);
+            LOAD_STRING (list[i]);
+            if (list[i] == NULL) /* NULL -> empty string */
+                list[i] = "";
         }
-        else
-            LOAD_STRING(cfg->list_cb_name);
+    }
+    else
+    {
+        const int *values;
 
-        LOAD_ARRAY(cfg->list.i, cfg->list_count);
+        LOAD_ALIGNOF(*cfg->list.i);
+        LOAD_ARRAY(values, cfg->list_count);
+        cfg->list.i = values;
     }
 
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
     for (unsigned i = 0; i < cfg->list_count; i++)
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
-            goto error;
+        LOAD_STRING (text[i]);
+        if (text[i] == NULL) /* NULL -> empty string */
+            text[i] = "";
     }
 
+    if (list != NULL)
+        cfg->list.psz = list;
+    cfg->list_text = text;
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    free(list);
+    free(text);
+    return -1;
+}
+
+/**
+ * Loads the values lists of the configuration items of a cached plug-in.
+ *
+ * Few options have a list of values, and the lists are only needed to show
+ * or to check the choices. They are left in the cache file until an item of
+ * the plug-in is looked up.
+ */
+void vlc_cache_load_lists(vlc_plugin_t *plugin)
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+
+    if (atomic_load_explicit(&plugin->conf.lists, memory_order_acquire) == 0)
+        return; /* fast path: nothing (more) to load */
+
+    vlc_mutex_lock(&lock);
+    uintptr_t lists = atomic_load_explicit(&plugin->conf.lists,
+                                           memory_order_relaxed);
+    if (lists != 0)
+    {
+        block_t file;
+        bool corrupted = false;
+
+        block_Init(&file, (void *)lists, plugin->conf.lists_size);
+
+        for (size_t i = 0; i < plugin->conf.size; i++)
+        {
+            module_config_t *item = plugin->conf.items + i;
+
+            if (item->list_count == 0)
+                continue;
+            /* The cache file was modified behind our back, drop the lists */
+            if (corrupted || vlc_cache_load_config_lists(item, &file))
+            {
+                corrupted = true;
+                item->list_count = 0;
+            }
+        }
+
+        atomic_store_explicit(&plugin->conf.lists, 0, memory_order_release);
+    }
+    vlc_mutex_unlock(&lock);
 }
 
 static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
@@ -283,16 +345,25 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
         item->owner = plugin;
     }
 
+    /* Skip the values lists for now */
+    const unsigned char *lists;
+    uint32_t size;
+
+    LOAD_IMMEDIATE (size);
+    LOAD_ARRAY (lists, size);
+    atomic_store_explicit(&plugin->conf.lists, (uintptr_t)lists,
+                          memory_order_relaxed);
+    plugin->conf.lists_size = size;
     return 0;
 error:
     return -1; /* FIXME: leaks */
 }
 
-static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
+static module_t *vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
 {
     module_t *module = vlc_module_create(plugin);
     if (unlikely(module == NULL))
-        return -1;
+        return NULL;
 
     LOAD_STRING(module->psz_shortname);
     LOAD_STRING(module->psz_longname);
@@ -313,12 +384,18 @@ static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
     LOAD_STRING(module->deactivate_name);
     LOAD_STRING(module->psz_capability);
     LOAD_IMMEDIATE(module->i_score);
-    return 0;
+    return module;
 error:
-    return -1;
+    return NULL;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+/**
+ * Loads a cached plug-in.
+ * \param modv table of the loaded modules, in file order [OUT]
+ * \param room size of the table
+ */
+static vlc_plugin_t *vlc_cache_load_plugin(block_t *file, module_t **modv,
+                                           size_t room)
 {
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
@@ -326,10 +403,16 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
 
     uint32_t modules;
     LOAD_IMMEDIATE(modules);
+    if (modules > room)
+        goto error;
 
+    /* NOTE: the modules list of the plug-in is not in file order */
     for (size_t i = 0; i < modules; i++)
-        if (vlc_cache_load_module(plugin, file))
+    {
+        modv[i] = vlc_cache_load_module(plugin, file);
+        if (modv[i] == NULL)
             goto error;
+    }
 
     if (vlc_cache_load_plugin_config(plugin, file))
         goto error;
@@ -359,6 +442,51 @@ error:
     return NULL;
 }
 
+/** Capabilities index entry */
+struct vlc_cache_cap
+{
+    uint32_t name; /**< Offset of the capability name */
+    uint32_t count; /**< Number of modules */
+    uint32_t first; /**< Offset of the first module number */
+};
+
+static int vlc_cache_load_index(vlc_plugin_cache_t *cache, block_t *file)
+{
+    const struct vlc_cache_cap *capv;
+    const uint32_t *modv;
+    const char *names;
+    uint32_t capc, modc, size;
+
+    LOAD_ALIGNOF(uint32_t);
+    LOAD_IMMEDIATE(capc);
+    LOAD_ARRAY(capv, capc);
+    LOAD_IMMEDIATE(modc);
+    LOAD_ARRAY(modv, modc);
+    LOAD_IMMEDIATE(size);
+    LOAD_ARRAY(names, size);
+
+    if (file->i_buffer > 0 || (size > 0 && names[size - 1] != '\0'))
+        goto error;
+
+    /* Check the bounds once, so that lookups need not */
+    for (size_t i = 0; i < capc; i++)
+        if (capv[i].name >= size || capv[i].first > modc
+         || capv[i].count > modc - capv[i].first)
+            goto error;
+
+    for (size_t i = 0; i < modc; i++)
+        if (modv[i] >= cache->modc)
+            goto error;
+
+    cache->capv = capv;
+    cache->capc = capc;
+    cache->cap_modv = modv;
+    cache->cap_names = names;
+    return 0;
+error:
+    return -1;
+}
+
 /**
  * Loads a plugins cache file.
  *
@@ -366,16 +494,19 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * The file is mapped read-only, and strings are used in place. The modules
+ * of each capability are listed in the file, sorted by score, so the bank
+ * need not index them on every start.
  */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
-                             block_t **backingp)
+vlc_plugin_cache_t *vlc_cache_load(vlc_object_t *p_this, const char *dir)
 {
     char *psz_filename;
 
     assert( dir != NULL );
 
     if( asprintf( &psz_filename, "%s"DIR_SEP CACHE_NAME, dir ) == -1 )
-        return 0;
+        return NULL;
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
@@ -385,7 +516,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
                  vlc_strerror_c(errno));
     free(psz_filename);
     if (file == NULL)
-        return 0;
+        return NULL;
 
     /* Check the file is a plugins cache */
     char cachestr[sizeof (CACHE_STRING) - 1];
@@ -395,7 +526,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
         block_Release(file);
-        return 0;
+        return NULL;
     }
 
 #ifdef DISTRO_VERSION
@@ -407,7 +538,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
         block_Release(file);
-        return 0;
+        return NULL;
     }
 #endif
 
@@ -420,7 +551,7 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
         block_Release(file);
-        return 0;
+        return NULL;
     }
 
     /* Check header marker */
@@ -435,14 +566,41 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
         block_Release(file);
-        return 0;
+        return NULL;
     }
 
-    vlc_plugin_t *cache = NULL;
+    vlc_plugin_cache_t *cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+    {
+        block_Release(file);
+        return NULL;
+    }
 
-    while (file->i_buffer > 0)
+    cache->next = NULL;
+    cache->file = file;
+    cache->plugins = NULL;
+    cache->modv = NULL;
+    cache->modc = 0;
+    cache->capv = NULL;
+    cache->capc = 0;
+
+    uint32_t plugins, modules;
+
+    LOAD_IMMEDIATE(plugins);
+    LOAD_IMMEDIATE(modules);
+
+    if (modules > 0)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
+        cache->modv = malloc(modules * sizeof (*cache->modv));
+        if (unlikely(cache->modv == NULL))
+            goto error;
+    }
+
+    for (size_t i = 0; i < plugins; i++)
+    {
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(file,
+                                                     cache->modv + cache->modc,
+                                                     modules - cache->modc);
         if (plugin == NULL)
             goto error;
 
@@ -454,22 +612,92 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
             goto error;
         }
 
-        plugin->next = cache;
-        cache = plugin;
+        plugin->next = cache->plugins;
+        cache->plugins = plugin;
+        cache->modc += plugin->modules_count;
     }
 
-    file->p_next = *backingp;
-    *backingp = file;
+    if (cache->modc != modules || vlc_cache_load_index(cache, file))
+        goto error;
+
     return cache;
 
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
-
-    /* TODO: cleanup */
-    block_Release(file);
+    vlc_cache_release(cache);
     return NULL;
 }
 
+/**
+ * Looks up a capability in the index of a plugins cache.
+ *
+ * \param modv pointer to the numbers of the modules, by decreasing score,
+ *             within the cache modules table [OUT]
+ * \return the number of modules with the capability
+ */
+size_t vlc_cache_cap(const vlc_plugin_cache_t *cache, const char *name,
+                     const uint32_t **modv)
+{
+    size_t lo = 0, hi = cache->capc;
+
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        const struct vlc_cache_cap *cap = cache->capv + mid;
+        int cmp = strcmp(name, cache->cap_names + cap->name);
+
+        if (cmp == 0)
+        {
+            *modv = cache->cap_modv + cap->first;
+            return cap->count;
+        }
+
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return 0;
+}
+
+/**
+ * Destroys a cached plug-in that cannot be used.
+ *
+ * The capabilities index of the cache is disabled, as it refers to the
+ * modules of the plug-in.
+ */
+void vlc_cache_discard(vlc_plugin_cache_t *cache, vlc_plugin_t *plugin)
+{
+    for (size_t i = 0; i < cache->modc; i++)
+        if (cache->modv[i] != NULL && cache->modv[i]->plugin == plugin)
+            cache->modv[i] = NULL;
+
+    cache->capv = NULL;
+    cache->capc = 0;
+    vlc_plugin_destroy(plugin);
+}
+
+/**
+ * Releases a plugins cache.
+ *
+ * The plug-ins that were taken out of the cache must be destroyed first, as
+ * their strings point into the cache file.
+ */
+void vlc_cache_release(vlc_plugin_cache_t *cache)
+{
+    while (cache->plugins != NULL)
+    {
+        vlc_plugin_t *plugin = cache->plugins;
+
+        cache->plugins = plugin->next;
+        vlc_plugin_destroy(plugin);
+    }
+
+    free(cache->modv);
+    block_Release(cache->file);
+    free(cache);
+}
+
 #define SAVE_IMMEDIATE( a ) \
     if (fwrite (&(a), sizeof(a), 1, file) != 1) \
         goto error
@@ -530,24 +758,31 @@ static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
     if (IsConfigStringType (cfg->i_type))
     {
         SAVE_STRING (cfg->orig.psz);
-        if (cfg->list_count == 0)
-            SAVE_STRING(cfg->list_cb_name);
-
-        for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
     }
     else
     {
         SAVE_IMMEDIATE (cfg->orig);
         SAVE_IMMEDIATE (cfg->min);
         SAVE_IMMEDIATE (cfg->max);
+    }
 
-        if (cfg->list_count > 0)
-        {
-            SAVE_ALIGNOF(*cfg->list.i);
-        }
-        else
-            SAVE_STRING(cfg->list_cb_name);
+    if (cfg->list_count == 0)
+        SAVE_STRING(cfg->list_cb_name);
+    return 0;
+error:
+    return -1;
+}
+
+static int CacheSaveConfigLists (FILE *file, const module_config_t *cfg)
+{
+    if (IsConfigStringType (cfg->i_type))
+    {
+        for (unsigned i = 0; i < cfg->list_count; i++)
+            SAVE_STRING (cfg->list.psz[i]);
+    }
+    else
+    {
+        SAVE_ALIGNOF(*cfg->list.i);
 
         for (unsigned i = 0; i < cfg->list_count; i++)
              SAVE_IMMEDIATE (cfg->list.i[i]);
@@ -570,6 +805,26 @@ static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
         if (CacheSaveConfig(file, plugin->conf.items + i))
            goto error;
 
+    /* Values lists, preceded by their size so they can be skipped */
+    uint32_t size = 0;
+    long start = ftell(file);
+
+    SAVE_IMMEDIATE (size);
+
+    for (size_t i = 0; i < lines; i++)
+        if (plugin->conf.items[i].list_count > 0
+         && CacheSaveConfigLists(file, plugin->conf.items + i))
+           goto error;
+
+    long end = ftell(file);
+    if (start == -1 || end == -1 || fseek(file, start, SEEK_SET))
+        goto error;
+
+    size = end - start - sizeof (size);
+    SAVE_IMMEDIATE (size);
+
+    if (fseek(file, end, SEEK_SET))
+        goto error;
     return 0;
 error:
     return -1;
@@ -594,6 +849,105 @@ error:
     return -1;
 }
 
+typedef struct
+{
+    const char *name;
+    int score;
+    uint32_t number;
+} cache_cap_entry_t;
+
+static int CacheCapCmp(const void *a, const void *b)
+{
+    const cache_cap_entry_t *ea = a, *eb = b;
+    int ret = strcmp(ea->name, eb->name);
+
+    if (ret == 0) /* highest score first */
+        ret = (ea->score < eb->score) - (ea->score > eb->score);
+    if (ret == 0) /* keep the file order otherwise */
+        ret = (ea->number > eb->number) - (ea->number < eb->number);
+    return ret;
+}
+
+/**
+ * Saves the capabilities index: the capabilities sorted by name, each with
+ * the numbers of its modules sorted by decreasing score.
+ */
+static int CacheSaveIndex(FILE *file, vlc_plugin_t *const *cache, size_t n)
+{
+    cache_cap_entry_t *entries = NULL;
+    struct vlc_cache_cap *caps = NULL;
+    uint32_t count = 0, capc = 0, number = 0, names = 0;
+    int ret = -1;
+
+    for (size_t i = 0; i < n; i++)
+        count += cache[i]->modules_count;
+
+    if (count > 0)
+    {
+        entries = malloc(count * sizeof (*entries));
+        caps = malloc(count * sizeof (*caps));
+        if (unlikely(entries == NULL || caps == NULL))
+            goto error;
+    }
+
+    /* Number the modules in the same order as CacheSaveBank() */
+    count = 0;
+    for (size_t i = 0; i < n; i++)
+        for (const module_t *module = cache[i]->module;
+             module != NULL;
+             module = module->next, number++)
+        {
+            if (module->psz_capability == NULL)
+                continue;
+
+            entries[count].name = module->psz_capability;
+            entries[count].score = module->i_score;
+            entries[count].number = number;
+            count++;
+        }
+
+    if (count > 0)
+        qsort(entries, count, sizeof (*entries), CacheCapCmp);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (capc == 0 || strcmp(entries[i].name, entries[i - 1].name))
+        {
+            caps[capc].name = names;
+            caps[capc].count = 0;
+            caps[capc].first = i;
+            names += strlen(entries[i].name) + 1;
+            capc++;
+        }
+        caps[capc - 1].count++;
+    }
+
+    SAVE_ALIGNOF(uint32_t);
+    SAVE_IMMEDIATE(capc);
+    if (capc > 0 && fwrite(caps, sizeof (*caps), capc, file) != capc)
+        goto error;
+
+    SAVE_IMMEDIATE(count);
+    for (uint32_t i = 0; i < count; i++)
+        SAVE_IMMEDIATE(entries[i].number);
+
+    SAVE_IMMEDIATE(names);
+    for (uint32_t i = 0; i < capc; i++)
+    {
+        const char *name = entries[caps[i].first].name;
+        size_t len = strlen(name) + 1;
+
+        if (fwrite(name, 1, len, file) != len)
+            goto error;
+    }
+
+    ret = 0;
+error:
+    free(caps);
+    free(entries);
+    return ret;
+}
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
     uint32_t i_file_size = 0;
@@ -617,11 +971,19 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
+    uint32_t count = n, modules = 0;
+
+    for (size_t i = 0; i < n; i++)
+        modules += cache[i]->modules_count;
+
+    SAVE_IMMEDIATE(count);
+    SAVE_IMMEDIATE(modules);
+
     for (size_t i = 0; i < n; i++)
     {
         const vlc_plugin_t *plugin = cache[i];
-        uint32_t count = plugin->modules_count;
 
+        count = plugin->modules_count;
         SAVE_IMMEDIATE(count);
 
         for (module_t *module = plugin->module;
@@ -642,6 +1004,9 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
         SAVE_IMMEDIATE(plugin->size);
     }
 
+    if (CacheSaveIndex(file, cache, n))
+        goto error;
+
     if (fflush (file)) /* flush libc buffers */
         goto error;
     return 0; /* success! */
@@ -700,9 +1065,9 @@ out:
 /**
  * Looks up a plugin file in a table of cached plugins.
  */
-vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **cache, const char *path)
+vlc_plugin_t *vlc_cache_lookup(vlc_plugin_cache_t *cache, const char *path)
 {
-    vlc_plugin_t **pp = cache, *plugin;
+    vlc_plugin_t **pp = &cache->plugins, *plugin;
 
     while ((plugin = *pp) != NULL)
     {
@@ -436,6 +436,8 @@ module_config_t *module_config_get( const module_t *module, unsigned *restrict p
         return NULL;
     }
 
+    vlc_cache_load_lists((vlc_plugin_t *)plugin);
+
     unsigned i,j;
     size_t size = plugin->conf.size;
     module_config_t *config = malloc( size * sizeof( *config ) );
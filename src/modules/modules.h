@@ -47,6 +47,11 @@ typedef struct vlc_plugin_t
         size_t size; /**< Size of items table */
         size_t count; /**< Number of configuration items */
         size_t booleans; /**< Number of booleal config items */
+#ifdef HAVE_DYNAMIC_PLUGINS
+        /** Cached values lists not loaded yet (or 0) */
+        atomic_uintptr_t lists;
+        size_t lists_size; /**< Size of the cached values lists */
+#endif
     } conf;
 
 #ifdef HAVE_DYNAMIC_PLUGINS
@@ -127,9 +132,40 @@ void *module_Lookup (module_handle_t, const char *);
 void module_Unload (module_handle_t);
 
 /* Plugins cache */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **);
-vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
+struct vlc_cache_cap;
+
+/** Plugins cache file */
+typedef struct vlc_plugin_cache
+{
+    struct vlc_plugin_cache *next;
+    block_t *file; /**< Read-only mapping of the cache file */
+    vlc_plugin_t *plugins; /**< Cached plug-ins not looked up yet */
+    module_t **modv; /**< Cached modules, in file order (NULL if discarded) */
+    size_t modc;
+
+    /* Capabilities index, sorted by name (capv is NULL if unusable) */
+    const struct vlc_cache_cap *capv;
+    size_t capc;
+    const uint32_t *cap_modv; /**< Module numbers, by decreasing score */
+    const char *cap_names;
+} vlc_plugin_cache_t;
+
+vlc_plugin_cache_t *vlc_cache_load(vlc_object_t *, const char *);
+vlc_plugin_t *vlc_cache_lookup(vlc_plugin_cache_t *, const char *relpath);
+void vlc_cache_discard(vlc_plugin_cache_t *, vlc_plugin_t *);
+size_t vlc_cache_cap(const vlc_plugin_cache_t *, const char *,
+                     const uint32_t **);
+void vlc_cache_release(vlc_plugin_cache_t *);
 
 void CacheSave(vlc_object_t *, const char *, vlc_plugin_t *const *, size_t);
 
+#ifdef HAVE_DYNAMIC_PLUGINS
+void vlc_cache_load_lists(vlc_plugin_t *);
+#else
+static inline void vlc_cache_load_lists(vlc_plugin_t *plugin)
+{
+    (void) plugin;
+}
+#endif
+
 #endif /* !LIBVLC_MODULES_H */
@@ -41,6 +41,7 @@
 #include <vlc_mime.h>
 #include <vlc_block.h>
 #include "../libvlc.h"
+#include "../misc/block_ring.h"
 
 #include <string.h>
 #include <errno.h>
@@ -52,6 +53,9 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -67,9 +71,24 @@
 #endif
 
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
-/* each host run in his own thread */
+/* the clients of a host are spread over one or more worker threads */
+typedef struct
+{
+    httpd_host_t *host;
+
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;  /* protects the clients of this worker */
+
+    int            i_client;
+    httpd_client_t **client;
+
+#ifdef HAVE_SYS_EPOLL_H
+    /* edge-triggered readiness of the client sockets */
+    int          epfd;
+#endif
+} httpd_worker_t;
+
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -82,7 +101,6 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -93,8 +111,10 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
+    /* the first worker also accepts the new connections */
+    httpd_worker_t *workers;
+    unsigned        i_worker;
+    unsigned        i_worker_next;
 
     /* TLS data */
     vlc_tls_creds_t *p_tls;
@@ -125,6 +145,7 @@ enum
     HTTPD_CLIENT_RECEIVE_DONE,
 
     HTTPD_CLIENT_SENDING,
+    HTTPD_CLIENT_SEND_MORE, /* buffer sent, ask the callback for more */
     HTTPD_CLIENT_SEND_DONE,
 
     HTTPD_CLIENT_WAITING,
@@ -155,17 +176,17 @@ struct httpd_client_t
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
 
+    /* socket readiness, until an operation would block */
+    bool    b_readable;
+    bool    b_writable;
+
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
     uint8_t *p_buffer;
 
-    /*
-     * If waiting for a keyframe, this is the position (in bytes) of the
-     * last keyframe the stream saw before this client connected.
-     * Otherwise, -1.
-     */
-    int64_t i_keyframe_wait_to_pass;
+    /* shared stream data, p_buffer points to it if not NULL */
+    block_t *p_block;
 
     /* */
     httpd_message_t query;  /* client -> httpd */
@@ -603,19 +624,12 @@ struct httpd_stream_t
     uint8_t *p_header;
     int     i_header;
 
-    /* Some muxes, in particular the avformat mux, can mark given blocks
-     * as keyframes, to ensure that the stream starts with one.
-     * (This is particularly important for WebM streaming to certain
-     * browsers.) Store if we've ever seen any such keyframe blocks,
-     * and if so, the byte position of the start of the last one. */
-    bool        b_has_keyframes;
-    int64_t     i_last_keyframe_seen_pos;
-
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
-    int64_t     i_buffer_pos;       /* absolute position from beginning */
-    int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    /* Blocks shared by all the clients. Some muxes, in particular the
+     * avformat mux, can mark given blocks as keyframes, to ensure that the
+     * stream starts with one. (This is particularly important for WebM
+     * streaming to certain browsers.) New clients start with the last
+     * keyframe if there is one. */
+    block_ring_t *p_ring;
 
     /* custom headers */
     size_t        i_http_headers;
@@ -632,45 +646,22 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
-
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
-        }
-
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+        /* the body offset is the cursor of the client in the ring */
+        uint64_t i_cursor = answer->i_body_offset;
+        block_t *p_block = block_RingRead(stream->p_ring, &i_cursor);
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
+        if (p_block == NULL)
             return VLC_EGENERIC;    /* wait, no data available */
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
-
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
+        /* the client sends the block as is, without copy */
+        assert(cl->p_block == NULL);
+        cl->p_block = p_block;
+        answer->i_body_offset = i_cursor;
 
         return VLC_SUCCESS;
     } else {
@@ -705,12 +696,8 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                 answer->p_body = xmalloc(stream->i_header);
                 memcpy(answer->p_body, stream->p_header, stream->i_header);
             }
-            answer->i_body_offset = stream->i_buffer_last_pos;
-            if (stream->b_has_keyframes)
-                cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
-            else
-                cl->i_keyframe_wait_to_pass = -1;
             vlc_mutex_unlock(&stream->lock);
+            answer->i_body_offset = block_RingStart(stream->p_ring);
         } else {
             httpd_MsgAdd(answer, "Content-Length", "0");
             answer->i_body_offset = 0;
@@ -752,8 +739,15 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     if (!stream)
         return NULL;
 
+    stream->p_ring = block_RingNew(5000000); /* 5 Mo per stream */
+    if (!stream->p_ring) {
+        free(stream);
+        return NULL;
+    }
+
     stream->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
     if (!stream->url) {
+        block_RingDelete(stream->p_ring);
         free(stream);
         return NULL;
     }
@@ -765,14 +759,6 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
-    stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
-    /* We set to 1 to make life simpler
-     * (this way i_body_offset can never be 0) */
-    stream->i_buffer_pos = 1;
-    stream->i_buffer_last_pos = 1;
-    stream->b_has_keyframes = false;
-    stream->i_last_keyframe_seen_pos = 0;
     stream->i_http_headers = 0;
     stream->p_http_headers = NULL;
 
@@ -802,22 +788,14 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+int httpd_StreamSendBlock(httpd_stream_t *stream, block_t *p_block)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
+    if (!p_block)
+        return VLC_SUCCESS;
 
-    stream->i_buffer_pos += i_data;
+    /* the ring does its own locking, and keeps the block for the clients */
+    block_RingPush(stream->p_ring, p_block);
+    return VLC_SUCCESS;
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
@@ -825,20 +803,16 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     if (!p_block || !p_block->p_buffer)
         return VLC_SUCCESS;
 
-    vlc_mutex_lock(&stream->lock);
-
-    /* save this pointer (to be used by new connection) */
-    stream->i_buffer_last_pos = stream->i_buffer_pos;
-
-    if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
-        stream->b_has_keyframes = true;
-        stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
-    }
-
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    block_t *p_copy = block_Alloc(p_block->i_buffer);
+    if (unlikely(p_copy == NULL))
+        return VLC_ENOMEM;
 
-    vlc_mutex_unlock(&stream->lock);
-    return VLC_SUCCESS;
+    memcpy(p_copy->p_buffer, p_block->p_buffer, p_block->i_buffer);
+    p_copy->i_flags  = p_block->i_flags;
+    p_copy->i_pts    = p_block->i_pts;
+    p_copy->i_dts    = p_block->i_dts;
+    p_copy->i_length = p_block->i_length;
+    return httpd_StreamSendBlock(stream, p_copy);
 }
 
 void httpd_StreamDelete(httpd_stream_t *stream)
@@ -852,7 +826,7 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    block_RingDelete(stream->p_ring);
     free(stream);
 }
 
@@ -906,6 +880,69 @@ static struct httpd
     int          i_host;
 } httpd = { VLC_STATIC_MUTEX, NULL, 0 };
 
+static int httpd_WorkerStart(httpd_host_t *host, httpd_worker_t *worker)
+{
+    worker->host     = host;
+    worker->i_client = 0;
+    worker->client   = NULL;
+    vlc_mutex_init(&worker->lock);
+
+#ifdef HAVE_SYS_EPOLL_H
+    worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epfd == -1) {
+        msg_Err(host, "cannot create epoll instance: %s",
+                vlc_strerror_c(errno));
+        goto error;
+    }
+
+    /* listening sockets are level-triggered, tagged with a NULL client */
+    for (unsigned i = 0; worker == host->workers && i < host->nfd; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, host->fds[i], &ev)) {
+            msg_Err(host, "cannot poll listening socket: %s",
+                    vlc_strerror_c(errno));
+            goto error;
+        }
+    }
+#endif
+
+    if (vlc_clone(&worker->thread, httpd_HostThread, worker,
+                   VLC_THREAD_PRIORITY_LOW)) {
+        msg_Err(host, "cannot spawn http host thread");
+        goto error;
+    }
+    return VLC_SUCCESS;
+
+error:
+#ifdef HAVE_SYS_EPOLL_H
+    if (worker->epfd != -1)
+        vlc_close(worker->epfd);
+#endif
+    vlc_mutex_destroy(&worker->lock);
+    return VLC_EGENERIC;
+}
+
+static void httpd_WorkerStop(httpd_worker_t *worker)
+{
+    vlc_cancel(worker->thread);
+    vlc_join(worker->thread, NULL);
+
+    for (int i = 0; i < worker->i_client; i++) {
+        httpd_client_t *cl = worker->client[i];
+
+        if (cl->i_state != HTTPD_CLIENT_DEAD)
+            msg_Warn(worker->host, "client still connected");
+        httpd_ClientDestroy(cl);
+    }
+    TAB_CLEAN(worker->i_client, worker->client);
+
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_close(worker->epfd);
+#endif
+    vlc_mutex_destroy(&worker->lock);
+}
+
 static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        const char *hostvar,
                                        const char *portvar,
@@ -970,16 +1007,25 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
-        goto error;
+    /* create the worker threads */
+#ifdef HAVE_SYS_EPOLL_H
+    unsigned i_worker = var_InheritInteger(p_this, "http-threads");
+#else
+    unsigned i_worker = 1; /* poll() fallback, single threaded */
+#endif
+    host->workers       = xmalloc(i_worker * sizeof (*host->workers));
+    host->i_worker      = 0;
+    host->i_worker_next = 0;
+    while (host->i_worker < i_worker) {
+        if (httpd_WorkerStart(host, &host->workers[host->i_worker]))
+            goto error;
+        host->i_worker++;
     }
+    if (i_worker > 1)
+        msg_Dbg(p_this, "HTTP host on port %u uses %u threads", port,
+                i_worker);
 
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
@@ -993,6 +1039,11 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        if (host->fds != NULL) {
+            for (unsigned i = 0; i < host->i_worker; i++)
+                httpd_WorkerStop(&host->workers[i]);
+            free(host->workers);
+        }
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1024,20 +1075,15 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_worker; i++)
+        httpd_WorkerStop(&host->workers[i]);
+    free(host->workers);
 
     msg_Dbg(host, "HTTP host removed");
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(host->client[i]);
-    }
-    TAB_CLEAN(host->i_client, host->client);
-
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
@@ -1100,26 +1146,36 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
+    vlc_mutex_unlock(&host->lock);
 
-    vlc_mutex_destroy(&url->lock);
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
+    /* A worker may have found the url before it was removed: it uses it
+     * until it releases its own lock. */
+    for (unsigned i = 0; i < host->i_worker; i++) {
+        httpd_worker_t *worker = &host->workers[i];
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
+        vlc_mutex_lock(&worker->lock);
+        for (int j = 0; j < worker->i_client; j++) {
+            httpd_client_t *client = worker->client[j];
 
-        if (client->url != url)
-            continue;
+            if (client->url != url)
+                continue;
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        TAB_REMOVE(host->i_client, host->client, client);
-        httpd_ClientDestroy(client);
-        i--;
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            /* The worker may be waiting on the socket: only mark the client
+             * dead and wake the worker up, it will destroy the client. */
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            shutdown(vlc_tls_GetFD(client->sock), SHUT_RDWR);
+        }
+        vlc_mutex_unlock(&worker->lock);
     }
+
+    vlc_mutex_destroy(&url->lock);
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1199,7 +1255,7 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->i_buffer_size = HTTPD_CL_BUFSIZE;
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc(cl->i_buffer_size);
-    cl->i_keyframe_wait_to_pass = -1;
+    cl->p_block = NULL;
     cl->b_stream_mode = false;
 
     httpd_MsgInit(&cl->query);
@@ -1216,13 +1272,39 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(vlc_tls_GetFD(cl->sock), ip, port) ? NULL : ip;
 }
 
+/* releases the send buffer, or the shared stream block it points to */
+static void httpd_ClientBufferRelease(httpd_client_t *cl)
+{
+    if (cl->p_block != NULL) {
+        block_Release(cl->p_block);
+        cl->p_block = NULL;
+    } else
+        free(cl->p_buffer);
+    cl->p_buffer = NULL;
+}
+
+/* sends the shared stream block, or else the answer body, next */
+static void httpd_ClientSetBody(httpd_client_t *cl)
+{
+    if (cl->p_block != NULL) {
+        cl->p_buffer      = cl->p_block->p_buffer;
+        cl->i_buffer_size = cl->p_block->i_buffer;
+    } else {
+        cl->p_buffer      = cl->answer.p_body;
+        cl->i_buffer_size = cl->answer.i_body;
+        cl->answer.p_body = NULL;
+        cl->answer.i_body = 0;
+    }
+    cl->i_buffer = 0;
+}
+
 static void httpd_ClientDestroy(httpd_client_t *cl)
 {
     vlc_tls_Close(cl->sock);
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
-    free(cl->p_buffer);
+    httpd_ClientBufferRelease(cl);
     free(cl);
 }
 
@@ -1235,6 +1317,8 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock, mtime_t now)
     cl->i_ref   = 0;
     cl->sock    = sock;
     cl->url     = NULL;
+    cl->b_readable = false;
+    cl->b_writable = false;
 
     httpd_ClientInit(cl, now);
     return cl;
@@ -1245,7 +1329,10 @@ ssize_t httpd_NetRecv (httpd_client_t *cl, uint8_t *p, size_t i_len)
 {
     vlc_tls_t *sock = cl->sock;
     struct iovec iov = { .iov_base = p, .iov_len = i_len };
-    return sock->readv(sock, &iov, 1);
+    ssize_t val = sock->readv(sock, &iov, 1);
+    if (val < 0 && errno == EAGAIN)
+        cl->b_readable = false;
+    return val;
 }
 
 static
@@ -1253,7 +1340,10 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
 {
     vlc_tls_t *sock = cl->sock;
     const struct iovec iov = { .iov_base = (void *)p, .iov_len = i_len };
-    return sock->writev(sock, &iov, 1);
+    ssize_t val = sock->writev(sock, &iov, 1);
+    if (val < 0 && errno == EAGAIN)
+        cl->b_writable = false;
+    return val;
 }
 
 
@@ -1577,7 +1667,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
         if (cl->i_buffer_size < i_size) {
             cl->i_buffer_size = i_size;
-            free(cl->p_buffer);
+            httpd_ClientBufferRelease(cl);
             cl->p_buffer = xmalloc(i_size);
         }
         p = (char *)cl->p_buffer;
@@ -1600,31 +1690,9 @@ static void httpd_ClientSend(httpd_client_t *cl)
     if (i_len >= 0) {
         cl->i_buffer += i_len;
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
-            if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
-                /* catch more body data */
-                int     i_msg = cl->query.i_type;
-                int64_t i_offset = cl->answer.i_body_offset;
-
-                httpd_MsgClean(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
-
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query);
-            }
-
-            if (cl->answer.i_body > 0) {
-                /* send the body data */
-                free(cl->p_buffer);
-                cl->p_buffer = cl->answer.p_body;
-                cl->i_buffer_size = cl->answer.i_body;
-                cl->i_buffer = 0;
-
-                cl->answer.i_body = 0;
-                cl->answer.p_body = NULL;
-            } else /* send finished */
-                cl->i_state = HTTPD_CLIENT_SEND_DONE;
-        }
+        /* the callbacks are only invoked with the host lock held */
+        if (cl->i_buffer >= cl->i_buffer_size)
+            cl->i_state = HTTPD_CLIENT_SEND_MORE;
     } else {
 #if defined(_WIN32)
         if ((i_len < 0 && WSAGetLastError() != WSAEWOULDBLOCK) || (i_len == 0))
@@ -1644,11 +1712,31 @@ static void httpd_ClientTlsHandshake(httpd_host_t *host, httpd_client_t *cl)
     {
         case -1: cl->i_state = HTTPD_CLIENT_DEAD;       break;
         case 0:  cl->i_state = HTTPD_CLIENT_RECEIVING;  break;
-        case 1:  cl->i_state = HTTPD_CLIENT_TLS_HS_IN;  break;
-        case 2:  cl->i_state = HTTPD_CLIENT_TLS_HS_OUT; break;
+        case 1:
+            cl->i_state = HTTPD_CLIENT_TLS_HS_IN;
+            cl->b_readable = false;
+            break;
+        case 2:
+            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+            cl->b_writable = false;
+            break;
     }
 }
 
+/* poll events the client is waiting for, 0 if none */
+static short httpd_ClientEvents(const httpd_client_t *cl)
+{
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            return POLLIN;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            return POLLOUT;
+    }
+    return 0;
+}
+
 static bool httpdAuthOk(const char *user, const char *pass, const char *b64)
 {
     if (!*user && !*pass)
@@ -1689,57 +1777,116 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+static void httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
+    httpd_client_t *cl;
+
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return;
     }
 
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return;
+        }
+        sk = tls;
+    }
+
+    cl = httpd_ClientNew(sk, now);
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return;
+    }
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    /* only the first worker accepts, no need to lock the round-robin */
+    httpd_worker_t *worker = &host->workers[host->i_worker_next++
+                                            % host->i_worker];
+
+    vlc_mutex_lock(&worker->lock);
+    TAB_APPEND(worker->i_client, worker->client, cl);
+#ifdef HAVE_SYS_EPOLL_H
+    /* register once for both directions, the worker keeps track of the
+     * readiness edges itself */
+    struct epoll_event ev = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.ptr = cl,
+    };
+
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+        msg_Err(host, "cannot poll client socket: %s", vlc_strerror_c(errno));
+        TAB_REMOVE(worker->i_client, worker->client, cl);
+        httpd_ClientDestroy(cl);
+    }
+#endif
+    vlc_mutex_unlock(&worker->lock);
+}
+
+static void httpdLoop(httpd_worker_t *worker)
+{
+    httpd_host_t *host = worker->host;
+
+    vlc_mutex_lock(&host->lock);
+    /* the first worker does not accept connections until an url exists */
+    while (worker == host->workers && host->i_url <= 0) {
         mutex_cleanup_push(&host->lock);
         vlc_cond_wait(&host->wait, &host->lock);
         vlc_cleanup_pop();
     }
+    vlc_mutex_unlock(&host->lock);
+
+    /* the host lock is only taken to look urls up, in that order */
+    vlc_mutex_lock(&worker->lock);
+
+#ifndef HAVE_SYS_EPOLL_H
+    struct pollfd ufd[host->nfd + worker->i_client];
+    unsigned nfd;
+    for (nfd = 0; nfd < host->nfd; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+#endif
 
     mtime_t now = mdate();
     bool b_low_delay = false;
+    bool b_ready = false;
 
+    /* add all socket that should be read/write and close dead connection */
     int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
         int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
+        httpd_client_t *cl = worker->client[i_client];
         if (cl->i_ref < 0 || (cl->i_ref == 0 &&
                     (cl->i_state == HTTPD_CLIENT_DEAD ||
                       (cl->i_activity_timeout > 0 &&
                         cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            TAB_REMOVE(host->i_client, host->client, cl);
+            TAB_REMOVE(worker->i_client, worker->client, cl);
             i_client--;
             httpd_ClientDestroy(cl);
             continue;
         }
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-        pufd->fd = vlc_tls_GetFD(cl->sock);
-        pufd->events = pufd->revents = 0;
-
         switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
-
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
-
             case HTTPD_CLIENT_RECEIVE_DONE: {
                 httpd_message_t *answer = &cl->answer;
                 httpd_message_t *query  = &cl->query;
@@ -1820,35 +1967,35 @@ static void httpdLoop(httpd_host_t *host)
                         int i_msg = query->i_type;
                         bool b_auth_failed = false;
 
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
+                        /* Search the url (they are unique), it remains
+                         * valid while the worker lock is held */
+                        httpd_url_t *url = NULL;
 
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
+                        vlc_mutex_lock(&host->lock);
+                        for (int i = 0; i < host->i_url; i++)
+                            if (!strcmp(host->url[i]->psz_url, query->psz_url)) {
+                                url = host->url[i];
+                                break;
+                            }
+                        vlc_mutex_unlock(&host->lock);
+
+                        /* and trigger its callback */
+                        if (url != NULL && url->catch[i_msg].cb) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+
+                            if (!b_auth_failed
+                             && !url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query)) {
+                                if (answer->i_proto == HTTPD_PROTO_NONE)
+                                    cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                                else
+                                    cl->i_buffer = -1;
+
+                                answer = NULL;
+                                if (!cl->url)
+                                    cl->url = url;
+                            }
                         }
 
                         if (answer) {
@@ -1879,6 +2026,30 @@ static void httpdLoop(httpd_host_t *host)
                 break;
             }
 
+            case HTTPD_CLIENT_SEND_MORE:
+                httpd_ClientBufferRelease(cl);
+
+                if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+                    /* catch more body data */
+                    int     i_msg = cl->query.i_type;
+                    i_offset = cl->answer.i_body_offset;
+
+                    httpd_MsgClean(&cl->answer);
+                    cl->answer.i_body_offset = i_offset;
+
+                    cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                                              &cl->answer, &cl->query);
+                }
+
+                if (cl->p_block != NULL || cl->answer.i_body > 0) {
+                    /* send the body data */
+                    httpd_ClientSetBody(cl);
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
+                }
+                /* send finished */
+                cl->i_state = HTTPD_CLIENT_SEND_DONE;
+                /* fall through */
             case HTTPD_CLIENT_SEND_DONE:
                 if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
                     const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
@@ -1906,7 +2077,7 @@ static void httpdLoop(httpd_host_t *host)
 
                         cl->i_buffer = 0;
                         cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
+                        httpd_ClientBufferRelease(cl);
                         cl->p_buffer = xmalloc(cl->i_buffer_size);
                         cl->i_state = HTTPD_CLIENT_RECEIVING;
                     } else
@@ -1917,8 +2088,7 @@ static void httpdLoop(httpd_host_t *host)
                     httpd_MsgClean(&cl->answer);
 
                     cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
+                    httpd_ClientBufferRelease(cl);
                     cl->i_buffer = 0;
                     cl->i_buffer_size = 0;
 
@@ -1937,54 +2107,93 @@ static void httpdLoop(httpd_host_t *host)
                         &cl->answer, &cl->query);
                 if (cl->answer.i_type != HTTPD_MSG_NONE) {
                     /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
+                    httpd_ClientSetBody(cl);
                     cl->i_state = HTTPD_CLIENT_SENDING;
                 }
         }
 
-        if (pufd->events != 0)
-            nfd++;
-        else
+        short events = httpd_ClientEvents(cl);
+        if (events == 0) {
             b_low_delay = true;
+            continue;
+        }
+#ifdef HAVE_SYS_EPOLL_H
+        /* edge-triggered: no new event will come until the operation
+         * would block */
+        if ((events & POLLIN) ? cl->b_readable : cl->b_writable)
+            b_ready = true;
+#else
+        ufd[nfd].fd = vlc_tls_GetFD(cl->sock);
+        ufd[nfd].events = events;
+        ufd[nfd].revents = 0;
+        nfd++;
+#endif
     }
-    vlc_mutex_unlock(&host->lock);
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 
     /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
+    int timeout = b_ready ? 0 : b_low_delay ? 20 : -1;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev[64];
+    int ret = epoll_wait(worker->epfd, ev, ARRAY_SIZE(ev), timeout);
+#else
+    int ret = poll(ufd, nfd, timeout);
+#endif
 
     canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
-    switch(ret) {
-        case -1:
-            if (errno != EINTR) {
-                /* Kernel on low memory or a bug: pace */
-                msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
-                msleep(100000);
-            }
-        case 0:
-            vlc_restorecancel(canc);
-            return;
+    if (ret == -1) {
+        if (errno != EINTR) {
+            /* Kernel on low memory or a bug: pace */
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+            msleep(100000);
+        }
+        vlc_restorecancel(canc);
+        return;
     }
 
-    /* Handle client sockets */
     now = mdate();
+    vlc_mutex_lock(&worker->lock);
+
+#ifdef HAVE_SYS_EPOLL_H
+    bool b_accept = false;
+
+    for (int i = 0; i < ret; i++) {
+        httpd_client_t *cl = ev[i].data.ptr;
+
+        if (cl == NULL) {
+            b_accept = true; /* listening socket */
+            continue;
+        }
+        /* only this worker destroys its clients, so cl is still valid */
+        if (ev[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            cl->b_readable = true;
+        if (ev[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+            cl->b_writable = true;
+    }
+#else
     nfd = host->nfd;
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
         const struct pollfd *pufd = &ufd[nfd];
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
-
-        if (vlc_tls_GetFD(cl->sock) != pufd->fd)
+        cl->b_readable = cl->b_writable = false;
+        if (pufd >= &ufd[sizeof(ufd) / sizeof(ufd[0])]
+         || vlc_tls_GetFD(cl->sock) != pufd->fd)
             continue; // we were not waiting for this client
         ++nfd;
-        if (pufd->revents == 0)
+        cl->b_readable = cl->b_writable = pufd->revents != 0;
+    }
+#endif
+
+    /* Handle client sockets */
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
+        short events = httpd_ClientEvents(cl);
+
+        if (events == 0
+         || !((events & POLLIN) ? cl->b_readable : cl->b_writable))
             continue; // no event received
 
         cl->i_activity_date = now;
@@ -1998,65 +2207,31 @@ static void httpdLoop(httpd_host_t *host)
                 break;
         }
     }
+    vlc_mutex_unlock(&worker->lock);
 
     /* Handle server sockets (accept new connections) */
+#ifdef HAVE_SYS_EPOLL_H
+    for (unsigned i = 0; b_accept && i < host->nfd; i++)
+        httpd_HostAccept(host, host->fds[i], now);
+#else
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
-
-        assert (fd == host->fds[nfd]);
+        assert (ufd[nfd].fd == host->fds[nfd]);
 
-        if (ufd[nfd].revents == 0)
-            continue;
-
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
-
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
-            continue;
-        }
-
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
-
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
-        }
-
-        cl = httpd_ClientNew(sk, now);
-
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
-
-        TAB_APPEND(host->i_client, host->client, cl);
+        if (ufd[nfd].revents != 0)
+            httpd_HostAccept(host, ufd[nfd].fd, now);
     }
+#endif
 
     vlc_restorecancel(canc);
 }
 
 static void* httpd_HostThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *worker = data;
 
-    vlc_mutex_lock(&host->lock);
-    while (host->i_ref > 0)
-        httpdLoop(host);
-    vlc_mutex_unlock(&host->lock);
-    return NULL;
+    for (;;)
+        httpdLoop(worker);
+    vlc_assert_unreachable();
 }
 
 int httpd_StreamSetHTTPHeaders(httpd_stream_t * p_stream, httpd_header * p_headers, size_t i_headers)
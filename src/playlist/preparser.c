@@ -124,6 +124,7 @@ playlist_preparser_t* playlist_preparser_New( vlc_object_t *parent )
 
     struct background_worker_config conf = {
         .default_timeout = var_InheritInteger( parent, "preparse-timeout" ),
+        .max_threads = var_InheritInteger( parent, "preparse-threads" ),
         .pf_start = PreparserOpenInput,
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
@@ -175,7 +176,12 @@ void playlist_preparser_Push( playlist_preparser_t *preparser,
             return;
     }
 
-    if( background_worker_Push( preparser->worker, item, id, timeout ) )
+    int priority = ( i_options & META_REQUEST_OPTION_PRIORITY )
+                 ? BACKGROUND_WORKER_PRIORITY_HIGH
+                 : BACKGROUND_WORKER_PRIORITY_NORMAL;
+
+    if( background_worker_Push( preparser->worker, item, id, timeout,
+                                priority ) )
         input_item_SignalPreparseEnded( item, ITEM_PREPARSE_FAILED );
 }
 
@@ -0,0 +1,211 @@
+/*****************************************************************************
+ * background_worker.c: Test for the background worker
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../misc/background_worker.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+/* vlc_clone_detach() is not exported: the threads are never joined instead */
+int vlc_clone_detach(vlc_thread_t *th, void *(*entry)(void *), void *data,
+                     int priority)
+{
+    vlc_thread_t dummy;
+
+    return vlc_clone(th != NULL ? th : &dummy, entry, data, priority);
+}
+
+#define TASKS 8
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static vlc_cond_t wait;
+static bool finish; /* running tasks are done once set */
+static unsigned refs, running, max_running, started;
+static int order[TASKS];
+
+static void Hold(void *entity)
+{
+    (void) entity;
+    vlc_mutex_lock(&lock);
+    refs++;
+    vlc_mutex_unlock(&lock);
+}
+
+static void Release(void *entity)
+{
+    (void) entity;
+    vlc_mutex_lock(&lock);
+    assert(refs > 0);
+    refs--;
+    vlc_cond_broadcast(&wait);
+    vlc_mutex_unlock(&lock);
+}
+
+static int Start(void *owner, void *entity, void **out)
+{
+    (void) owner;
+    vlc_mutex_lock(&lock);
+    order[started++] = (intptr_t)entity;
+    if (++running > max_running)
+        max_running = running;
+    vlc_cond_broadcast(&wait);
+    vlc_mutex_unlock(&lock);
+    *out = entity;
+    return VLC_SUCCESS;
+}
+
+static int Probe(void *owner, void *handle)
+{
+    (void) owner; (void) handle;
+    vlc_mutex_lock(&lock);
+    bool done = finish;
+    vlc_mutex_unlock(&lock);
+    return done;
+}
+
+static void Stop(void *owner, void *handle)
+{
+    (void) owner; (void) handle;
+    vlc_mutex_lock(&lock);
+    running--;
+    vlc_mutex_unlock(&lock);
+}
+
+static struct background_worker *Create(int threads)
+{
+    struct background_worker_config conf = {
+        .default_timeout = 0,
+        .max_threads = threads,
+        .pf_release = Release,
+        .pf_hold = Hold,
+        .pf_start = Start,
+        .pf_probe = Probe,
+        .pf_stop = Stop,
+    };
+
+    finish = false;
+    refs = running = max_running = started = 0;
+
+    struct background_worker *worker = background_worker_New(NULL, &conf);
+    assert(worker != NULL);
+    return worker;
+}
+
+static void WaitStarted(unsigned count)
+{
+    vlc_mutex_lock(&lock);
+    while (started < count)
+        vlc_cond_wait(&wait, &lock);
+    vlc_mutex_unlock(&lock);
+}
+
+static void Finish(struct background_worker *worker)
+{
+    vlc_mutex_lock(&lock);
+    finish = true;
+    vlc_mutex_unlock(&lock);
+    background_worker_RequestProbe(worker);
+
+    vlc_mutex_lock(&lock);
+    while (refs > 0)
+        vlc_cond_wait(&wait, &lock);
+    vlc_mutex_unlock(&lock);
+}
+
+static void test_threads(void)
+{
+    struct background_worker *worker = Create(3);
+
+    for (intptr_t i = 0; i < TASKS; i++)
+        assert(background_worker_Push(worker, (void *)i, NULL, -1,
+                                      BACKGROUND_WORKER_PRIORITY_NORMAL)
+               == VLC_SUCCESS);
+
+    WaitStarted(3);
+    msleep(10000);
+    vlc_mutex_lock(&lock);
+    assert(started == 3 && running == 3);
+    vlc_mutex_unlock(&lock);
+
+    Finish(worker);
+    assert(started == TASKS && max_running == 3);
+    background_worker_Delete(worker);
+}
+
+static void test_priority(void)
+{
+    struct background_worker *worker = Create(1);
+
+    assert(!background_worker_Push(worker, (void *)0, NULL, -1,
+                                   BACKGROUND_WORKER_PRIORITY_NORMAL));
+    WaitStarted(1);
+
+    /* queued behind the running task */
+    for (intptr_t i = 1; i < TASKS; i++)
+        assert(!background_worker_Push(worker, (void *)i, NULL, -1,
+                                       (i & 1) ? BACKGROUND_WORKER_PRIORITY_HIGH
+                                       : BACKGROUND_WORKER_PRIORITY_NORMAL));
+
+    Finish(worker);
+    assert(started == TASKS);
+    static const int expected[TASKS] = { 0, 1, 3, 5, 7, 2, 4, 6 };
+    for (unsigned i = 0; i < TASKS; i++)
+        assert(order[i] == expected[i]);
+    background_worker_Delete(worker);
+}
+
+static void test_cancel(void)
+{
+    struct background_worker *worker = Create(2);
+    int id;
+
+    for (intptr_t i = 0; i < TASKS; i++)
+        assert(!background_worker_Push(worker, (void *)i,
+                                       (i & 1) ? &id : NULL, -1,
+                                       BACKGROUND_WORKER_PRIORITY_NORMAL));
+    WaitStarted(2);
+
+    /* stops the running task 1, drops the queued odd ones */
+    background_worker_Cancel(worker, &id);
+    vlc_mutex_lock(&lock);
+    for (unsigned i = 0; i < started; i++)
+        assert(order[i] == 1 || !(order[i] & 1));
+    vlc_mutex_unlock(&lock);
+
+    /* stops everything else */
+    background_worker_Delete(worker);
+    assert(refs == 0 && running == 0);
+}
+
+int main(void)
+{
+    vlc_cond_init(&wait);
+
+    test_threads();
+    test_priority();
+    test_cancel();
+
+    vlc_cond_destroy(&wait);
+    return 0;
+}
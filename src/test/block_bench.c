@@ -0,0 +1,259 @@
+/*****************************************************************************
+ * block_bench.c: Replays a block allocation trace
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * The trace is a text file with one operation per line:
+ *   a <id> <size>          block_Alloc(size) into slot id
+ *   r <id> <pre> <body>    block_Realloc(slot id, pre, body)
+ *   f <id>                 block_Release(slot id)
+ * Empty lines and lines starting with '#' are ignored. Without argument, a
+ * synthetic trace mixing TS packets, PES, audio frames and RTP packets is
+ * replayed.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+struct op
+{
+    char type;
+    unsigned id;
+    ssize_t pre;
+    size_t size;
+};
+
+#define SLOTS 4096
+#define SYNTHETIC_OPS 200000
+
+static struct op *ops;
+static size_t ops_count, ops_max;
+
+static void AddOp(char type, unsigned id, ssize_t pre, size_t size)
+{
+    if (ops_count == ops_max)
+    {
+        ops_max = ops_max ? 2 * ops_max : 1024;
+        ops = realloc(ops, ops_max * sizeof (*ops));
+        assert(ops != NULL);
+    }
+    ops[ops_count++] = (struct op){ type, id, pre, size };
+}
+
+static void LoadTrace(const char *path)
+{
+    FILE *file = fopen(path, "rt");
+    if (file == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    char line[256];
+    while (fgets(line, sizeof (line), file) != NULL)
+    {
+        unsigned id;
+        long pre;
+        size_t size;
+
+        if (sscanf(line, "a %u %zu", &id, &size) == 2)
+            pre = 0;
+        else if (sscanf(line, "r %u %ld %zu", &id, &pre, &size) == 3)
+            ;
+        else if (sscanf(line, "f %u", &id) == 1)
+            pre = size = 0;
+        else if (line[0] == '#' || line[0] == '\n')
+            continue;
+        else
+        {
+            fprintf(stderr, "%s: invalid line: %s", path, line);
+            exit(1);
+        }
+
+        if (id >= SLOTS)
+        {
+            fprintf(stderr, "%s: slot %u out of range\n", path, id);
+            exit(1);
+        }
+        AddOp(line[0], id, pre, size);
+    }
+    fclose(file);
+}
+
+static void MakeTrace(void)
+{
+    bool live[SLOTS] = { false };
+    unsigned seed = 42;
+
+    for (unsigned i = 0; i < SYNTHETIC_OPS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        unsigned rnd = seed >> 8;
+        unsigned id = rnd % SLOTS;
+
+        if (live[id])
+        {
+            if ((rnd >> 12) % 8 == 0) /* PES reassembly: append data */
+                AddOp('r', id, 0, 184 * (1 + (rnd >> 16) % 64));
+            else
+            {
+                AddOp('f', id, 0, 0);
+                live[id] = false;
+            }
+            continue;
+        }
+
+        size_t size;
+        switch ((rnd >> 12) % 16)
+        {
+            case 0: case 1: case 2: case 3: case 4: case 5: case 6:
+                size = 188; /* TS packet */
+                break;
+            case 7: case 8: case 9:
+                size = 1316; /* RTP packet */
+                break;
+            case 10: case 11: case 12:
+                size = 256 + (rnd >> 16) % 3840; /* audio frame */
+                break;
+            case 13: case 14:
+                size = 2048 + (rnd >> 16) % 14336; /* PES packet */
+                break;
+            default:
+                size = 65536 + (rnd >> 16) % 65536; /* video frame */
+                break;
+        }
+        AddOp('a', id, 0, size);
+        live[id] = true;
+    }
+}
+
+static mtime_t ReplayBlocks(void)
+{
+    block_t *slots[SLOTS] = { NULL };
+    mtime_t ts = mdate();
+
+    for (size_t i = 0; i < ops_count; i++)
+    {
+        const struct op *op = &ops[i];
+        block_t **pp = &slots[op->id];
+
+        switch (op->type)
+        {
+            case 'a':
+                assert(*pp == NULL);
+                *pp = block_Alloc(op->size);
+                assert(*pp != NULL);
+                (*pp)->p_buffer[0] = op->id;
+                break;
+            case 'r':
+                assert(*pp != NULL);
+                *pp = block_Realloc(*pp, op->pre, op->size);
+                assert(*pp != NULL);
+                assert(op->pre != 0 || op->size == 0
+                    || (*pp)->p_buffer[0] == (uint8_t)op->id);
+                break;
+            case 'f':
+                assert(*pp != NULL);
+                block_Release(*pp);
+                *pp = NULL;
+                break;
+        }
+    }
+
+    for (unsigned i = 0; i < SLOTS; i++)
+        if (slots[i] != NULL)
+            block_Release(slots[i]);
+    return mdate() - ts;
+}
+
+/* Same trace with one plain heap allocation per block, as a reference */
+static mtime_t ReplayHeap(void)
+{
+    void *slots[SLOTS] = { NULL };
+    const size_t overhead = sizeof (block_t) + 96;
+    mtime_t ts = mdate();
+
+    for (size_t i = 0; i < ops_count; i++)
+    {
+        const struct op *op = &ops[i];
+        void **pp = &slots[op->id];
+
+        switch (op->type)
+        {
+            case 'a':
+                *pp = malloc(overhead + op->size);
+                assert(*pp != NULL);
+                break;
+            case 'r':
+                *pp = realloc(*pp, overhead + op->pre + op->size);
+                assert(*pp != NULL);
+                break;
+            case 'f':
+                free(*pp);
+                *pp = NULL;
+                break;
+        }
+    }
+
+    for (unsigned i = 0; i < SLOTS; i++)
+        free(slots[i]);
+    return mdate() - ts;
+}
+
+int main(int argc, char *argv[])
+{
+    block_stats_t before, after;
+
+    if (argc > 1)
+        LoadTrace(argv[1]);
+    else
+        MakeTrace();
+
+    /* warm up the heap and the caches first */
+    ReplayHeap();
+    ReplayBlocks();
+
+    block_GetStats(&before);
+    mtime_t blocks = ReplayBlocks();
+    block_GetStats(&after);
+    mtime_t heap = ReplayHeap();
+
+    /* everything was released */
+    assert(after.in_use == before.in_use);
+
+    uint64_t hits = after.hits - before.hits;
+    uint64_t total = hits + after.misses - before.misses;
+
+    printf("%zu operations\n", ops_count);
+    printf("block_Alloc: %"PRId64" us, heap: %"PRId64" us\n", blocks, heap);
+    printf("pool hits: %"PRIu64"/%"PRIu64" (%.1f%%), peak: %zu bytes\n",
+           hits, total, total ? 100. * hits / total : 0., after.peak);
+    free(ops);
+    return 0;
+}
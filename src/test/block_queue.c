@@ -0,0 +1,256 @@
+/*****************************************************************************
+ * block_queue.c: Test and benchmark for the lock-free block queue
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks the block queue semantics, then passes blocks from one or several
+ * producer threads to a consumer thread through a block FIFO and through
+ * block queues, and prints the time taken by each. The optional argument is
+ * the number of blocks per producer (default 100000).
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define PRODUCERS 4
+#define CAPACITY 256
+
+static block_t *MakeBlock(size_t size, mtime_t dts)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+    block->i_dts = dts;
+    return block;
+}
+
+static void TestBasic(void)
+{
+    block_queue_t *q = block_QueueNew(3, false);
+    assert(q != NULL);
+    assert(block_QueueTryGet(q) == NULL);
+
+    /* The capacity is rounded up to 4 */
+    for (unsigned i = 0; i < 4; i++)
+        assert(block_QueueTryPut(q, MakeBlock(10 * i, i)));
+    block_t *extra = MakeBlock(100, 4);
+    assert(!block_QueueTryPut(q, extra));
+    assert(block_QueueGetCount(q) == 4);
+    assert(block_QueueGetBytes(q) == 0 + 10 + 20 + 30);
+
+    block_t *block = block_QueueTryGet(q);
+    assert(block != NULL && block->i_dts == 0);
+    block_Release(block);
+    assert(block_QueueTryPut(q, extra));
+    assert(block_QueueGetCount(q) == 4);
+    assert(block_QueueGetBytes(q) == 10 + 20 + 30 + 100);
+
+    /* Batches are in queue order, and limited */
+    block = block_QueueGetBatch(q, 2);
+    assert(block->i_dts == 1 && block->p_next->i_dts == 2);
+    assert(block->p_next->p_next == NULL);
+    block_ChainRelease(block);
+    block = block_QueueGetBatch(q, 0);
+    assert(block->i_dts == 3 && block->p_next->i_dts == 4);
+    assert(block->p_next->p_next == NULL);
+    block_ChainRelease(block);
+    assert(block_QueueGetCount(q) == 0);
+    assert(block_QueueGetBytes(q) == 0);
+
+    /* Lists are split */
+    block = NULL;
+    block_ChainAppend(&block, MakeBlock(1, 5));
+    block_ChainAppend(&block, MakeBlock(2, 6));
+    block_QueuePut(q, block);
+    assert(block_QueueGetCount(q) == 2);
+    block = block_QueueGet(q);
+    assert(block->i_dts == 5 && block->p_next == NULL);
+    block_Release(block);
+    block_QueueEmpty(q);
+    assert(block_QueueGetCount(q) == 0);
+    assert(block_QueueGetBytes(q) == 0);
+
+    /* Remaining blocks are released with the queue */
+    block_QueuePut(q, MakeBlock(1, 7));
+    block_QueueRelease(q);
+}
+
+static void *Sleeper(void *data)
+{
+    block_queue_t *q = data;
+
+    block_Release(block_QueueGet(q));
+    (void) block_QueueGet(q);
+    abort(); /* never reached */
+}
+
+static void TestCancel(void)
+{
+    block_queue_t *q = block_QueueNew(2, false);
+    vlc_thread_t th;
+
+    assert(q != NULL);
+    assert(vlc_clone(&th, Sleeper, q, VLC_THREAD_PRIORITY_LOW) == 0);
+    block_QueuePut(q, MakeBlock(1, 0));
+    msleep(10000);
+    vlc_cancel(th);
+    vlc_join(th, NULL);
+    block_QueueRelease(q);
+}
+
+/*** Producers and consumer ***/
+
+static unsigned count = 100000;
+static block_t *blocks;
+
+struct producer
+{
+    block_queue_t *queue;
+    block_fifo_t  *fifo;
+    unsigned       index;
+};
+
+static void *Producer(void *data)
+{
+    const struct producer *p = data;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = &blocks[p->index * count + i];
+
+        block->p_next = NULL;
+        if (p->queue != NULL)
+            block_QueuePut(p->queue, block);
+        else
+            block_FifoPut(p->fifo, block);
+    }
+    return NULL;
+}
+
+/* Checks that the blocks of each producer arrive in order */
+static void Consumed(unsigned *next, const block_t *block)
+{
+    unsigned index = (block - blocks) / count;
+
+    assert(index < PRODUCERS);
+    assert(block->i_dts == next[index]);
+    next[index]++;
+}
+
+static mtime_t Run(unsigned producers, block_queue_t *queue,
+                   block_fifo_t *fifo, size_t batch)
+{
+    struct producer p[PRODUCERS];
+    vlc_thread_t th[PRODUCERS];
+    unsigned next[PRODUCERS] = { 0 };
+    mtime_t ts = mdate();
+
+    for (unsigned i = 0; i < producers; i++)
+    {
+        p[i].queue = queue;
+        p[i].fifo = fifo;
+        p[i].index = i;
+        assert(vlc_clone(&th[i], Producer, &p[i],
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+    }
+
+    for (unsigned n = 0; n < producers * count;)
+    {
+        if (queue == NULL)
+        {
+            Consumed(next, block_FifoGet(fifo));
+            n++;
+            continue;
+        }
+
+        for (block_t *block = block_QueueGetBatch(queue, batch);
+             block != NULL; block = block->p_next)
+        {
+            Consumed(next, block);
+            n++;
+        }
+    }
+    ts = mdate() - ts;
+
+    for (unsigned i = 0; i < producers; i++)
+    {
+        vlc_join(th[i], NULL);
+        assert(next[i] == count);
+    }
+    if (queue != NULL)
+        assert(block_QueueGetCount(queue) == 0);
+    else
+        assert(vlc_fifo_GetCount(fifo) == 0);
+    return ts;
+}
+
+static void Bench(unsigned producers)
+{
+    block_fifo_t *fifo = block_FifoNew();
+    block_queue_t *queue = block_QueueNew(CAPACITY, producers > 1);
+
+    assert(fifo != NULL && queue != NULL);
+
+    mtime_t t_fifo = Run(producers, NULL, fifo, 1);
+    mtime_t t_get = Run(producers, queue, NULL, 1);
+    mtime_t t_batch = Run(producers, queue, NULL, 0);
+
+    printf("%u producer(s), %u blocks each:\n", producers, count);
+    printf(" fifo: %"PRId64" us, queue: %"PRId64" us (x%.1f), "
+           "batches: %"PRId64" us (x%.1f)\n", t_fifo,
+           t_get, t_get ? (double)t_fifo / t_get : 0.,
+           t_batch, t_batch ? (double)t_fifo / t_batch : 0.);
+
+    block_QueueRelease(queue);
+    block_FifoRelease(fifo);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 0);
+    if (count == 0)
+        count = 1;
+
+    TestBasic();
+    TestCancel();
+
+    /* The blocks are only passed around, never released */
+    static uint8_t payload[188];
+    blocks = malloc(PRODUCERS * count * sizeof (*blocks));
+    assert(blocks != NULL);
+    for (unsigned i = 0; i < PRODUCERS * count; i++)
+    {
+        block_Init(&blocks[i], payload, sizeof (payload));
+        blocks[i].i_dts = i % count;
+    }
+
+    Bench(1);
+    Bench(PRODUCERS);
+    free(blocks);
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*****************************************************************************
+ * block_ring.c: Test for the shared block ring
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../misc/block_ring.c"
+
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+static block_t *make_block(uint8_t value, size_t size, uint32_t flags)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+    memset(block->p_buffer, value, size);
+    block->i_flags = flags;
+    return block;
+}
+
+static void test_readers(void)
+{
+    block_ring_t *ring = block_RingNew(1000);
+    assert(ring != NULL);
+
+    uint64_t a = block_RingStart(ring), b = a;
+    assert(a > 0);
+    assert(block_RingRead(ring, &a) == NULL);
+
+    for (unsigned i = 0; i < 3; i++)
+        block_RingPush(ring, make_block(i, 100, 0));
+
+    /* every reader gets the same data, without copy */
+    block_t *x = block_RingRead(ring, &a);
+    block_t *y = block_RingRead(ring, &b);
+    assert(x != NULL && y != NULL);
+    assert(x == y && x->p_buffer == y->p_buffer);
+    assert(x->i_buffer == 100 && x->p_buffer[0] == 0);
+    block_Release(x);
+    block_Release(y);
+
+    for (unsigned i = 1; i < 3; i++) {
+        x = block_RingRead(ring, &a);
+        assert(x != NULL && x->p_buffer[99] == i);
+        block_Release(x);
+    }
+    assert(block_RingRead(ring, &a) == NULL);
+
+    /* a reference outlives the ring */
+    x = block_RingRead(ring, &b);
+    block_RingDelete(ring);
+    assert(x->p_buffer[0] == 1);
+    block_Release(x);
+}
+
+static void test_resync(void)
+{
+    block_ring_t *ring = block_RingNew(1000);
+    assert(ring != NULL);
+
+    /* without keyframes, new readers start with the last block */
+    block_RingPush(ring, make_block(0, 100, 0));
+    block_RingPush(ring, make_block(1, 100, 0));
+    uint64_t start = block_RingStart(ring);
+    block_t *x = block_RingRead(ring, &start);
+    assert(x != NULL && x->p_buffer[0] == 1);
+    block_Release(x);
+
+    uint64_t slow = block_RingStart(ring) - 1;
+    block_RingPush(ring, make_block(2, 100, BLOCK_FLAG_TYPE_I));
+    for (unsigned i = 3; i < 10; i++)
+        block_RingPush(ring, make_block(i, 100, 0));
+
+    /* new readers start with the last keyframe */
+    start = block_RingStart(ring);
+    x = block_RingRead(ring, &start);
+    assert(x != NULL && x->p_buffer[0] == 2);
+    assert(x->i_flags & BLOCK_FLAG_TYPE_I);
+    block_Release(x);
+
+    /* the ring is full: the slow reader is moved to the keyframe */
+    block_RingPush(ring, make_block(10, 100, 0));
+    block_RingPush(ring, make_block(11, 100, 0));
+    x = block_RingRead(ring, &slow);
+    assert(x != NULL && x->p_buffer[0] == 2);
+    block_Release(x);
+
+    /* the keyframe is gone: move to the last block */
+    block_RingPush(ring, make_block(12, 100, 0));
+    slow = 1;
+    x = block_RingRead(ring, &slow);
+    assert(x != NULL && x->p_buffer[0] == 12);
+    block_Release(x);
+    assert(block_RingRead(ring, &slow) == NULL);
+
+    block_RingDelete(ring);
+}
+
+int main (void)
+{
+    test_readers();
+    test_resync();
+    return 0;
+}
@@ -106,6 +106,74 @@ static void test(bool zombie)
             picture_Release(pics[i]);
 }
 
+static void test_large(void)
+{
+    const unsigned count = 200; /* more than one bitmap word */
+    picture_t *pics[count];
+
+    pool = picture_pool_NewFromFormat(&fmt, count);
+    assert(pool != NULL);
+    assert(picture_pool_GetSize(pool) == count);
+
+    for (unsigned i = 0; i < count; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+
+    for (unsigned i = 0; i < count; i += 67) {
+        void *plane = pics[i]->p[0].p_pixels;
+        picture_Release(pics[i]);
+
+        pics[i] = picture_pool_Wait(pool);
+        assert(pics[i] != NULL);
+        assert(pics[i]->p[0].p_pixels == plane);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(pics[i]);
+    picture_pool_Release(pool);
+}
+
+#define THREADS 4
+
+static void *test_thread(void *data)
+{
+    picture_pool_t *p = data;
+
+    for (unsigned i = 0; i < 10000; i++) {
+        picture_t *pic = picture_pool_Wait(p);
+        assert(pic != NULL);
+        picture_Release(pic);
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    vlc_thread_t th[THREADS];
+
+    /* fewer pictures than threads, so that some of them have to wait */
+    pool = picture_pool_NewFromFormat(&fmt, THREADS - 1);
+    assert(pool != NULL);
+
+    for (unsigned i = 0; i < THREADS; i++)
+        assert(!vlc_clone(&th[i], test_thread, pool, VLC_THREAD_PRIORITY_LOW));
+    for (unsigned i = 0; i < THREADS; i++)
+        vlc_join(th[i], NULL);
+
+    /* every picture was given back */
+    picture_t *pics[THREADS - 1];
+    for (unsigned i = 0; i < THREADS - 1; i++) {
+        pics[i] = picture_pool_Get(pool);
+        assert(pics[i] != NULL);
+    }
+    assert(picture_pool_Get(pool) == NULL);
+    for (unsigned i = 0; i < THREADS - 1; i++)
+        picture_Release(pics[i]);
+    picture_pool_Release(pool);
+}
+
 int main(void)
 {
     video_format_Setup(&fmt, VLC_CODEC_I420, 320, 200, 320, 200, 1, 1);
@@ -122,6 +190,8 @@ int main(void)
 
     test(false);
     test(true);
+    test_large();
+    test_threads();
 
     return 0;
 }
@@ -0,0 +1,161 @@
+/*****************************************************************************
+ * slices.c: Test for the slice threading pool
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../misc/slices.c"
+
+#include <vlc_atomic.h>
+
+#undef NDEBUG
+#include <assert.h>
+
+#define LINES 1080
+#define CALLERS 4
+
+struct job
+{
+    atomic_uint lines[LINES]; /* times each line was processed */
+    atomic_uint bands;
+    unsigned    count;
+    /* wavefront progress, in lines of each band */
+    vlc_mutex_t lock;
+    vlc_cond_t  wait;
+    unsigned    progress[64];
+};
+
+static void InitJob(struct job *job)
+{
+    for (unsigned i = 0; i < LINES; i++)
+        atomic_init(&job->lines[i], 0);
+    atomic_init(&job->bands, 0);
+    job->count = 0;
+    vlc_mutex_init(&job->lock);
+    vlc_cond_init(&job->wait);
+    for (unsigned i = 0; i < 64; i++)
+        job->progress[i] = 0;
+}
+
+static void CheckJob(struct job *job)
+{
+    for (unsigned i = 0; i < LINES; i++)
+        assert(atomic_load(&job->lines[i]) == 1);
+    assert(atomic_load(&job->bands) == job->count);
+    vlc_cond_destroy(&job->wait);
+    vlc_mutex_destroy(&job->lock);
+}
+
+static void Band(void *opaque, const vlc_slice_t *slice)
+{
+    struct job *job = opaque;
+
+    assert(slice->i_index < slice->i_count);
+    job->count = slice->i_count;
+    for (unsigned y = vlc_slice_First(slice, LINES);
+         y < vlc_slice_End(slice, LINES); y++)
+        atomic_fetch_add(&job->lines[y], 1);
+    atomic_fetch_add(&job->bands, 1);
+}
+
+/* Each line of a band depends on the same line of the previous band */
+static void Wavefront(void *opaque, const vlc_slice_t *slice)
+{
+    struct job *job = opaque;
+    const unsigned i = slice->i_index;
+
+    assert(i < 64);
+    job->count = slice->i_count;
+    for (unsigned y = 0; y < LINES; y++)
+    {
+        vlc_mutex_lock(&job->lock);
+        while (i > 0 && job->progress[i - 1] <= y)
+            vlc_cond_wait(&job->wait, &job->lock);
+        job->progress[i] = y + 1;
+        vlc_cond_broadcast(&job->wait);
+        vlc_mutex_unlock(&job->lock);
+
+        if (i == 0)
+            atomic_fetch_add(&job->lines[y], 1);
+    }
+    atomic_fetch_add(&job->bands, 1);
+}
+
+static vlc_slices_t *pool;
+
+static void *Caller(void *data)
+{
+    struct job *job = data;
+
+    for (unsigned i = 0; i < 100; i++)
+    {
+        InitJob(job);
+        vlc_slices_RunPool(pool, LINES, 0, (i & 1) ? Wavefront : Band, job);
+        CheckJob(job);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    static struct job job, jobs[CALLERS];
+
+    pool = vlc_slices_New(8);
+    assert(pool != NULL);
+
+    /* Short jobs are not split */
+    InitJob(&job);
+    vlc_slices_RunPool(pool, 31, 0, Band, &job);
+    assert(job.count == 1);
+    assert(pool->i_started == 0);
+    CheckJob(&job);
+
+    /* The halo limits the number of bands */
+    InitJob(&job);
+    vlc_slices_RunPool(pool, LINES, 90, Band, &job);
+    assert(job.count == 3);
+    CheckJob(&job);
+
+    InitJob(&job);
+    vlc_slices_RunPool(pool, LINES, 0, Band, &job);
+    assert(job.count == 8);
+    CheckJob(&job);
+
+    /* Concurrent jobs, including wavefront ones */
+    vlc_thread_t th[CALLERS];
+    for (unsigned i = 0; i < CALLERS; i++)
+        assert(vlc_clone(&th[i], Caller, &jobs[i],
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+    for (unsigned i = 0; i < CALLERS; i++)
+        vlc_join(th[i], NULL);
+
+    vlc_slices_Delete(pool);
+
+    /* Single threaded pool */
+    pool = vlc_slices_New(1);
+    assert(pool != NULL);
+    InitJob(&job);
+    vlc_slices_RunPool(pool, LINES, 0, Wavefront, &job);
+    assert(job.count == 1);
+    CheckJob(&job);
+    vlc_slices_Delete(pool);
+    return 0;
+}
@@ -913,8 +913,13 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
             }
         }
 
-        if (!decoded)
+        if (!decoded) {
+            /* No new input: take the pictures that the filters completed
+             * in the meantime (e.g. deinterlaced ahead on another thread),
+             * without waiting for the others. */
+            picture = filter_chain_VideoCollect(vout->p->filter.chain_static);
             break;
+        }
         reuse = false;
 
         if (vout->p->displayed.decoded)
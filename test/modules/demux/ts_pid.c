@@ -0,0 +1,184 @@
+/*****************************************************************************
+ * ts_pid.c: TS demuxer PID lookup tests and micro-benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../modules/demux/mpeg/ts_pid.c"
+
+#ifdef NDEBUG
+ #undef NDEBUG
+#endif
+#include <assert.h>
+
+/* ts_pid.c object constructors are not exercised here */
+ts_pat_t *ts_pat_New( demux_t *d ) { VLC_UNUSED(d); return NULL; }
+void ts_pat_Del( demux_t *d, ts_pat_t *p ) { VLC_UNUSED(d); VLC_UNUSED(p); }
+ts_pmt_t *ts_pmt_New( demux_t *d ) { VLC_UNUSED(d); return NULL; }
+void ts_pmt_Del( demux_t *d, ts_pmt_t *p ) { VLC_UNUSED(d); VLC_UNUSED(p); }
+ts_stream_t *ts_stream_New( demux_t *d, ts_pmt_t *p ) { VLC_UNUSED(d); VLC_UNUSED(p); return NULL; }
+void ts_stream_Del( demux_t *d, ts_stream_t *p ) { VLC_UNUSED(d); VLC_UNUSED(p); }
+ts_si_t *ts_si_New( demux_t *d ) { VLC_UNUSED(d); return NULL; }
+void ts_si_Del( demux_t *d, ts_si_t *p ) { VLC_UNUSED(d); VLC_UNUSED(p); }
+ts_psip_t *ts_psip_New( demux_t *d ) { VLC_UNUSED(d); return NULL; }
+void ts_psip_Del( demux_t *d, ts_psip_t *p ) { VLC_UNUSED(d); VLC_UNUSED(p); }
+
+/* Previous implementation: last pid cache, then bsearch over sorted pids */
+typedef struct
+{
+    ts_pid_t **pp_all;
+    int        i_all;
+    uint16_t   i_last_pid;
+    ts_pid_t  *p_last;
+} legacy_list_t;
+
+static int legacy_Compare( const void *key, const void *other )
+{
+    return *(const uint16_t *)key - (*(ts_pid_t * const *)other)->i_pid;
+}
+
+static ts_pid_t *legacy_Get( legacy_list_t *p_list, uint16_t i_pid )
+{
+    if( p_list->p_last && p_list->i_last_pid == i_pid )
+        return p_list->p_last;
+
+    ts_pid_t **pp = bsearch( &i_pid, p_list->pp_all, p_list->i_all,
+                             sizeof(ts_pid_t *), legacy_Compare );
+    ts_pid_t *p_pid;
+    if( pp )
+        p_pid = *pp;
+    else
+    {
+        p_pid = calloc( 1, sizeof(*p_pid) );
+        p_list->pp_all = realloc( p_list->pp_all,
+                                  (p_list->i_all + 1) * sizeof(ts_pid_t *) );
+        assert( p_pid && p_list->pp_all );
+        p_pid->i_pid = i_pid;
+        int i = p_list->i_all++;
+        for( ; i > 0 && p_list->pp_all[i - 1]->i_pid > i_pid; i-- )
+            p_list->pp_all[i] = p_list->pp_all[i - 1];
+        p_list->pp_all[i] = p_pid;
+    }
+    p_list->p_last = p_pid;
+    p_list->i_last_pid = i_pid;
+    return p_pid;
+}
+
+/* PIDs and packet share of a DVB-T2 multiplex recording: 6 services with
+ * video, audio, audio description and teletext/subtitles, plus SI and null */
+static const struct
+{
+    uint16_t i_pid;
+    unsigned i_weight;
+} mux_pattern[] = {
+    { 0x0000, 2 }, { 0x0010, 1 }, { 0x0011, 1 }, { 0x0012, 6 }, { 0x0014, 1 },
+    { 0x0100, 2 }, { 0x0101, 420 }, { 0x0102, 28 }, { 0x0103, 14 }, { 0x0104, 6 },
+    { 0x0200, 2 }, { 0x0201, 380 }, { 0x0202, 28 }, { 0x0203, 14 }, { 0x0204, 6 },
+    { 0x0300, 2 }, { 0x0301, 350 }, { 0x0302, 28 }, { 0x0303, 14 }, { 0x0305, 4 },
+    { 0x0400, 2 }, { 0x0401, 300 }, { 0x0402, 24 }, { 0x0404, 6 },
+    { 0x0500, 2 }, { 0x0501, 260 }, { 0x0502, 24 }, { 0x0503, 12 },
+    { 0x0600, 2 }, { 0x0601, 220 }, { 0x0602, 24 }, { 0x0604, 6 },
+    { 0x0bb8, 4 }, { 0x0bb9, 4 }, { 0x1ffb, 2 }, { 0x1fff, 90 },
+};
+
+#define PATTERN_PACKETS (1 << 20)
+
+/* Interleave pids packet by packet, as a multiplexer does */
+static void BuildSequence( uint16_t *p_seq, size_t i_seq )
+{
+    unsigned i_total = 0;
+    int64_t credit[ARRAY_SIZE(mux_pattern)] = { 0 };
+
+    for( size_t i = 0; i < ARRAY_SIZE(mux_pattern); i++ )
+        i_total += mux_pattern[i].i_weight;
+
+    for( size_t i = 0; i < i_seq; i++ )
+    {
+        size_t i_best = 0;
+        for( size_t j = 0; j < ARRAY_SIZE(mux_pattern); j++ )
+        {
+            credit[j] += mux_pattern[j].i_weight;
+            if( credit[j] > credit[i_best] )
+                i_best = j;
+        }
+        credit[i_best] -= i_total;
+        p_seq[i] = mux_pattern[i_best].i_pid;
+    }
+}
+
+int main( void )
+{
+    uint16_t *p_seq = malloc( PATTERN_PACKETS * sizeof(*p_seq) );
+    ts_pid_list_t *p_list = calloc( 1, sizeof(*p_list) );
+    legacy_list_t legacy = { NULL, 0, 0, NULL };
+    assert( p_seq && p_list );
+
+    BuildSequence( p_seq, PATTERN_PACKETS );
+    ts_pid_list_Init( p_list );
+
+    /* Lookups return the same pid object each time */
+    ts_pid_t *pp_seen[TS_PID_COUNT] = { NULL };
+    for( size_t i = 0; i < PATTERN_PACKETS; i++ )
+    {
+        ts_pid_t *p_pid = ts_pid_Get( p_list, p_seq[i] );
+        assert( p_pid->i_pid == p_seq[i] );
+        assert( pp_seen[p_seq[i]] == NULL || pp_seen[p_seq[i]] == p_pid );
+        pp_seen[p_seq[i]] = p_pid;
+    }
+
+    /* Iteration goes in increasing pid order over non-common pids */
+    ts_pid_next_context_t ctx = ts_pid_NextContextInitValue;
+    ts_pid_t *p_pid;
+    int i_count = 0, i_prev = -1;
+    while( (p_pid = ts_pid_Next( p_list, &ctx )) )
+    {
+        assert( (int)p_pid->i_pid > i_prev );
+        assert( p_pid->i_pid != 0x0000 && p_pid->i_pid != 0x1FFB &&
+                p_pid->i_pid != 0x1FFF );
+        i_prev = p_pid->i_pid;
+        i_count++;
+    }
+    assert( i_count == p_list->i_all );
+    assert( i_count == (int)ARRAY_SIZE(mux_pattern) - 3 );
+
+    /* Benchmark */
+    uint64_t i_sum = 0;
+    mtime_t i_start = mdate();
+    for( size_t i = 0; i < PATTERN_PACKETS; i++ )
+        i_sum += legacy_Get( &legacy, p_seq[i] )->i_pid;
+    mtime_t i_legacy = mdate() - i_start;
+
+    i_start = mdate();
+    for( size_t i = 0; i < PATTERN_PACKETS; i++ )
+        i_sum += ts_pid_Get( p_list, p_seq[i] )->i_pid;
+    mtime_t i_table = mdate() - i_start;
+
+    printf( "%d packets over %zu pids (checksum %"PRIu64")\n",
+            PATTERN_PACKETS, ARRAY_SIZE(mux_pattern), i_sum );
+    printf( "cached bsearch: %6.2f ns/lookup\n",
+            i_legacy * 1000.0 / PATTERN_PACKETS );
+    printf( "direct table  : %6.2f ns/lookup\n",
+            i_table * 1000.0 / PATTERN_PACKETS );
+
+    for( int i = 0; i < legacy.i_all; i++ )
+        free( legacy.pp_all[i] );
+    free( legacy.pp_all );
+    ts_pid_list_Release( NULL, p_list );
+    free( p_list );
+    free( p_seq );
+    return 0;
+}
@@ -0,0 +1,193 @@
+/*****************************************************************************
+ * csa.c: CSA batch (de)scrambling tests
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that csa_EncryptBatch() and csa_DecryptBatch() give the same
+ * packets as csa_Encrypt() and csa_Decrypt() called on each packet.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the keys are set without a VLC object */
+#define TS_NO_CSA_CK_MSG
+#include "../../../modules/mux/mpeg/csa.c"
+
+#undef NDEBUG
+#include <assert.h>
+
+#define TS_SIZE 188
+
+static const int batch_sizes[] = {
+    1, 2, 7, BS_LANES - 1, BS_LANES, BS_LANES + 1,
+    CSA_BATCH, CSA_BATCH + 13, 3 * CSA_BATCH + 5,
+};
+
+static unsigned Random(void)
+{
+    static unsigned seed = 42;
+
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+/* Fills a clear packet, with an adaptation field one time out of three.
+ * Some adaptation fields leave less than a block of payload, or none. */
+static void FillPacket(uint8_t *p)
+{
+    for (int i = 0; i < TS_SIZE; i++)
+        p[i] = Random();
+
+    p[0] = 0x47;
+    p[1] &= 0x1f;
+    p[3] = 0x10 | (p[3] & 0x0f);
+
+    switch (Random() % 6)
+    {
+        case 0:
+            p[3] |= 0x20;
+            p[4] = Random() % 184;
+            break;
+        case 1:
+            p[3] |= 0x20;
+            p[4] = TS_SIZE - 5 - Random() % 12;
+            break;
+        default:
+            break;
+    }
+}
+
+static void CheckEncrypt(csa_t *c, int i_pkts, bool odd)
+{
+    uint8_t *batch = malloc(i_pkts * TS_SIZE);
+    uint8_t *scalar = malloc(i_pkts * TS_SIZE);
+    uint8_t **pp = malloc(i_pkts * sizeof(*pp));
+    assert(batch != NULL && scalar != NULL && pp != NULL);
+
+    for (int i = 0; i < i_pkts; i++)
+    {
+        FillPacket(&batch[i * TS_SIZE]);
+        pp[i] = &batch[i * TS_SIZE];
+    }
+    memcpy(scalar, batch, i_pkts * TS_SIZE);
+
+    csa_UseKey(NULL, c, odd);
+    for (int i = 0; i < i_pkts; i++)
+        csa_Encrypt(c, &scalar[i * TS_SIZE], TS_SIZE);
+    csa_EncryptBatch(c, pp, i_pkts, TS_SIZE);
+
+    for (int i = 0; i < i_pkts; i++)
+        if (memcmp(&batch[i * TS_SIZE], &scalar[i * TS_SIZE], TS_SIZE))
+        {
+            fprintf(stderr, "%s encryption of packet %d/%d differs\n",
+                    odd ? "odd" : "even", i, i_pkts);
+            exit(1);
+        }
+
+    free(pp);
+    free(scalar);
+    free(batch);
+}
+
+static void CheckDecrypt(csa_t *c, int i_pkts)
+{
+    uint8_t *clear = malloc(i_pkts * TS_SIZE);
+    uint8_t *batch = malloc(i_pkts * TS_SIZE);
+    uint8_t *scalar = malloc(i_pkts * TS_SIZE);
+    uint8_t **pp = malloc(i_pkts * sizeof(*pp));
+    assert(clear != NULL && batch != NULL && scalar != NULL && pp != NULL);
+
+    /* scramble with mixed parities, and leave some packets in the clear */
+    for (int i = 0; i < i_pkts; i++)
+    {
+        uint8_t *p = &clear[i * TS_SIZE];
+
+        FillPacket(p);
+        memcpy(&batch[i * TS_SIZE], p, TS_SIZE);
+        switch (Random() % 5)
+        {
+            case 0:
+                break;
+            case 1:
+            case 2:
+                csa_UseKey(NULL, c, true);
+                csa_Encrypt(c, &batch[i * TS_SIZE], TS_SIZE);
+                break;
+            default:
+                csa_UseKey(NULL, c, false);
+                csa_Encrypt(c, &batch[i * TS_SIZE], TS_SIZE);
+                break;
+        }
+        pp[i] = &batch[i * TS_SIZE];
+    }
+    memcpy(scalar, batch, i_pkts * TS_SIZE);
+
+    for (int i = 0; i < i_pkts; i++)
+        csa_Decrypt(c, &scalar[i * TS_SIZE], TS_SIZE);
+    csa_DecryptBatch(c, pp, i_pkts, TS_SIZE);
+
+    for (int i = 0; i < i_pkts; i++)
+    {
+        if (memcmp(&batch[i * TS_SIZE], &scalar[i * TS_SIZE], TS_SIZE))
+        {
+            fprintf(stderr, "decryption of packet %d/%d differs\n",
+                    i, i_pkts);
+            exit(1);
+        }
+        /* the scrambling control bits are cleared, the payload restored */
+        clear[i * TS_SIZE + 3] &= 0x3f;
+        assert(!memcmp(&batch[i * TS_SIZE], &clear[i * TS_SIZE], TS_SIZE));
+    }
+
+    free(pp);
+    free(scalar);
+    free(batch);
+    free(clear);
+}
+
+int main(void)
+{
+    csa_t *c = csa_New();
+    assert(c != NULL);
+
+    char even[] = "0x0123456789abcdef";
+    char odd[] = "fedcba9876543210";
+    assert(csa_SetCW(NULL, c, even, false) == VLC_SUCCESS);
+    assert(csa_SetCW(NULL, c, odd, true) == VLC_SUCCESS);
+
+    for (size_t i = 0; i < ARRAY_SIZE(batch_sizes); i++)
+    {
+        CheckEncrypt(c, batch_sizes[i], false);
+        CheckEncrypt(c, batch_sizes[i], true);
+        CheckDecrypt(c, batch_sizes[i]);
+    }
+
+    /* empty batches are no-ops */
+    csa_EncryptBatch(c, NULL, 0, TS_SIZE);
+    csa_DecryptBatch(c, NULL, 0, TS_SIZE);
+
+    csa_Delete(c);
+    return 0;
+}
@@ -0,0 +1,511 @@
+/*****************************************************************************
+ * pixel_kernels.c: SIMD pixel kernels tests and benchmark
+ *****************************************************************************
+ * Copyright (C) 2017 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Runs every x86 version of the deinterlacer merge and Yadif line filters,
+ * of the surface copy routines and of the I420 to RGB32 conversion on whole
+ * frames, checks that they match the C version, and prints their time per
+ * frame for common resolutions. The optional argument is the number of
+ * frames to time (default 3).
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "../../../modules/video_filter/deinterlace/merge.c"
+#include "../../../modules/video_filter/deinterlace/common.h"
+#include "../../../modules/video_filter/deinterlace/yadif.h"
+#include "../../../modules/video_chroma/copy.c"
+#if defined(CAN_COMPILE_SSE2)
+# include "../../../modules/video_chroma/i420_rgb_sse2.h"
+# include "../../../modules/video_chroma/i420_rgb_avx2.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#define MARGIN 64
+
+/* copy.c redefines some vlc_CPU_*() macros in terms of this variable */
+static unsigned cpu;
+
+static const struct
+{
+    unsigned width, height;
+} sizes[] = {
+    {  720,  576 },
+    { 1280,  720 },
+    { 1920, 1080 },
+    { 3840, 2160 },
+};
+
+static unsigned frames = 3;
+static unsigned width, height;
+static size_t pitch;
+static uint8_t *src[3], *dst, *ref;
+
+static void FillRandom(uint8_t *p, size_t size)
+{
+    static unsigned seed = 42;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        p[i] = seed >> 16;
+    }
+}
+
+/* Times a version of a kernel, and checks its output against the C one */
+#define BENCH(name, call, size) \
+    do { \
+        call; /* warm up */ \
+        mtime_t ts = mdate(); \
+        for (unsigned n = 0; n < frames; n++) \
+            call; \
+        ts = (mdate() - ts) / frames; \
+        if (reference) { \
+            memcpy(ref, dst, size); \
+            c_time = ts; \
+            printf(" %10s %6"PRId64" us", name, ts); \
+        } else { \
+            if (memcmp(ref, dst, size)) { \
+                fprintf(stderr, "\n%s output differs from C\n", name); \
+                exit(1); \
+            } \
+            printf(" %10s %6"PRId64" us (x%.1f)", name, ts, \
+                   ts ? (double)c_time / ts : 0.); \
+        } \
+        reference = false; \
+        fflush(stdout); \
+    } while (0)
+
+/*** Deinterlacer merge ***/
+
+typedef void (*merge_t)(void *, const void *, const void *, size_t);
+
+static void MergeFrame(merge_t merge, size_t bytes)
+{
+    for (unsigned y = 0; y + 1 < height; y++)
+        merge(dst + y * pitch, src[0] + y * pitch, src[0] + (y + 1) * pitch,
+              bytes);
+}
+
+static void MergeRounded(void *d, const void *a, const void *b, size_t n)
+{   /* the SIMD versions round up */
+    uint8_t *pd = d;
+    const uint8_t *pa = a, *pb = b;
+
+    for (size_t i = 0; i < n; i++)
+        pd[i] = (pa[i] + pb[i] + 1) >> 1;
+}
+
+static void MergeRounded16(void *d, const void *a, const void *b, size_t n)
+{
+    uint16_t *pd = d;
+    const uint16_t *pa = a, *pb = b;
+
+    for (size_t i = 0; i < n / 2; i++)
+        pd[i] = (pa[i] + pb[i] + 1) >> 1;
+}
+
+static void BenchMerge(void)
+{
+    const size_t size = height * pitch;
+    bool reference = true;
+    mtime_t c_time = 0;
+
+    printf("%-10s", "merge8");
+    BENCH("C", MergeFrame(MergeRounded, width), size);
+#if defined(CAN_COMPILE_SSE)
+    if (vlc_CPU_SSE2())
+        BENCH("SSE2", MergeFrame(Merge8BitSSE2, width), size);
+#endif
+#if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        BENCH("AVX2", MergeFrame(Merge8BitAVX2, width), size);
+#endif
+#if defined(CAN_COMPILE_AVX512)
+    if (vlc_CPU_AVX512())
+        BENCH("AVX-512", MergeFrame(Merge8BitAVX512, width), size);
+#endif
+    putchar('\n');
+
+    /* same number of bytes, half the pixels */
+    reference = true;
+    printf("%-10s", "merge16");
+    BENCH("C", MergeFrame(MergeRounded16, width), size);
+#if defined(CAN_COMPILE_SSE)
+    if (vlc_CPU_SSE2())
+        BENCH("SSE2", MergeFrame(Merge16BitSSE2, width), size);
+#endif
+#if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        BENCH("AVX2", MergeFrame(Merge16BitAVX2, width), size);
+#endif
+#if defined(CAN_COMPILE_AVX512)
+    if (vlc_CPU_AVX512())
+        BENCH("AVX-512", MergeFrame(Merge16BitAVX512, width), size);
+#endif
+    putchar('\n');
+}
+
+/*** Yadif ***/
+
+typedef void (*yadif_t)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                        int, int, int, int, int);
+
+static void YadifFrame(yadif_t filter)
+{
+    /* same line parameters as RenderYadif() for the bottom field */
+    for (unsigned y = 1; y < height - 1; y += 2)
+    {
+        int mode = (y >= 2 && y < height - 2) ? 0 : 2;
+        filter(dst + y * pitch, src[0] + y * pitch, src[1] + y * pitch,
+               src[2] + y * pitch, width,
+               y < height - 2 ? (int)pitch : -(int)pitch,
+               y - 1 ? -(int)pitch : (int)pitch, 1, mode);
+        /* the MMX and SSE versions write past the line end */
+        memset(dst + y * pitch + width, 0, pitch - width);
+    }
+}
+
+static void BenchYadif(void)
+{
+    const size_t size = height * pitch;
+    bool reference = true;
+    mtime_t c_time = 0;
+
+    memset(dst, 0, size);
+    printf("%-10s", "yadif");
+    BENCH("C", YadifFrame(yadif_filter_line_c), size);
+#if defined(HAVE_YADIF_SSE2)
+    if (vlc_CPU_SSE2())
+        BENCH("SSE2", YadifFrame(yadif_filter_line_sse2), size);
+#endif
+#if defined(HAVE_YADIF_SSSE3)
+    if (vlc_CPU_SSSE3())
+        BENCH("SSSE3", YadifFrame(yadif_filter_line_ssse3), size);
+#endif
+#if defined(HAVE_YADIF_AVX2)
+    if (vlc_CPU_AVX2())
+        BENCH("AVX2", YadifFrame(yadif_filter_line_avx2), size);
+#endif
+#if defined(HAVE_YADIF_AVX512)
+    if (vlc_CPU_AVX512())
+        BENCH("AVX-512", YadifFrame(yadif_filter_line_avx512), size);
+#endif
+    putchar('\n');
+}
+
+/*** Surface copy ***/
+
+#if defined(CAN_COMPILE_SSE2)
+static copy_cache_t cache;
+#endif
+
+/* the destination pitch differs, so that the planes are copied line per
+ * line, as for hardware surfaces */
+static void CopyFrame(unsigned cpu)
+{
+#if defined(CAN_COMPILE_SSE2)
+    if (cpu)
+        SSE_CopyPlane(dst, pitch + 64, src[0], pitch, cache.buffer,
+                      cache.size, height - 1, cpu);
+    else
+#endif
+        CopyPlane(dst, pitch + 64, src[0], pitch, height - 1);
+}
+
+static void SplitFrame(unsigned cpu)
+{
+    uint8_t *dstu = dst, *dstv = dst + height * pitch / 2;
+
+#if defined(CAN_COMPILE_SSE2)
+    if (cpu)
+        SSE_SplitPlanes(dstu, pitch / 2, dstv, pitch / 2, src[0], pitch,
+                        cache.buffer, cache.size, height, cpu);
+    else
+#endif
+        SplitPlanes(dstu, pitch / 2, dstv, pitch / 2, src[0], pitch, height);
+}
+
+static void InterleaveFrame(unsigned cpu)
+{
+    uint8_t *srcu = src[1], *srcv = src[2];
+
+#if defined(CAN_COMPILE_SSE2)
+    if (cpu)
+        SSE_InterleavePlanes(dst, pitch, srcu, pitch / 2, srcv, pitch / 2,
+                             cache.buffer, cache.size, height, cpu);
+    else
+#endif
+    for (unsigned y = 0; y < height; y++)
+        for (unsigned x = 0; x < pitch / 2; x++)
+        {
+            dst[y * pitch + 2 * x + 0] = srcu[y * pitch / 2 + x];
+            dst[y * pitch + 2 * x + 1] = srcv[y * pitch / 2 + x];
+        }
+}
+
+static void BenchCopy(void)
+{
+    size_t size = (height - 1) * (pitch + 64);
+    bool reference = true;
+    mtime_t c_time = 0;
+#if defined(CAN_COMPILE_SSE2)
+    const unsigned sse = cpu & ~(VLC_CPU_AVX2 | VLC_CPU_AVX512);
+#endif
+
+    printf("%-10s", "copy");
+    BENCH("C", CopyFrame(0), size);
+#if defined(CAN_COMPILE_SSE2)
+    if (vlc_CPU_SSE2())
+        BENCH("SSE", CopyFrame(sse), size);
+# if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        BENCH("AVX2", CopyFrame(cpu), size);
+# endif
+#endif
+    putchar('\n');
+
+    size = height * pitch;
+
+    reference = true;
+    printf("%-10s", "split");
+    BENCH("C", SplitFrame(0), size);
+#if defined(CAN_COMPILE_SSE2)
+    if (vlc_CPU_SSE2())
+        BENCH("SSE", SplitFrame(sse), size);
+# if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        BENCH("AVX2", SplitFrame(cpu), size);
+# endif
+#endif
+    putchar('\n');
+
+    reference = true;
+    printf("%-10s", "interleave");
+    BENCH("C", InterleaveFrame(0), size);
+#if defined(CAN_COMPILE_SSE2)
+    if (vlc_CPU_SSE2())
+        BENCH("SSE", InterleaveFrame(sse), size);
+# if defined(CAN_COMPILE_AVX2)
+    if (vlc_CPU_AVX2())
+        BENCH("AVX2", InterleaveFrame(cpu), size);
+# endif
+#endif
+    putchar('\n');
+}
+
+/*** I420 to RGB32 ***/
+
+/* the fixed point arithmetic of the SIMD versions */
+static int16_t sat16(int v)
+{
+    return v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : v;
+}
+
+static int16_t mulhi(int16_t a, int16_t b)
+{
+    return ((int32_t)a * b) >> 16;
+}
+
+static uint8_t satu8(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static void RGB32Frame_C(unsigned order)
+{
+    static const uint8_t shifts[4][3] = { /* B, G, R */
+        { 0, 8, 16 }, { 8, 16, 24 }, { 24, 16, 8 }, { 16, 8, 0 },
+    };
+    uint32_t *out = (uint32_t *)dst;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        const uint8_t *p_y = src[0] + y * width;
+        const uint8_t *p_u = src[1] + y / 2 * width / 2;
+        const uint8_t *p_v = src[2] + y / 2 * width / 2;
+
+        for (unsigned x = 0; x < width; x++)
+        {
+            int16_t u = (p_u[x / 2] - 128) * 8, v = (p_v[x / 2] - 128) * 8;
+            int16_t g = sat16(mulhi(u, (int16_t)0xf37d)
+                            + mulhi(v, (int16_t)0xe5fc));
+            int16_t b = mulhi(u, 0x4093), r = mulhi(v, 0x3312);
+            int16_t l = mulhi(__MAX(p_y[x] - 16, 0) * 8, 0x253f);
+
+            *out++ = (uint32_t)satu8(sat16(b + l)) << shifts[order][0]
+                   | (uint32_t)satu8(sat16(g + l)) << shifts[order][1]
+                   | (uint32_t)satu8(sat16(r + l)) << shifts[order][2];
+        }
+    }
+}
+
+#if defined(CAN_COMPILE_SSE2)
+VLC_SSE
+static void RGB32Frame_SSE2(unsigned order)
+{
+    uint32_t *p_buffer = (uint32_t *)dst;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        const uint8_t *p_y = src[0] + y * width;
+        const uint8_t *p_u = src[1] + y / 2 * width / 2;
+        const uint8_t *p_v = src[2] + y / 2 * width / 2;
+
+        for (unsigned x = 0; x < width; x += 16)
+        {
+            switch (order)
+            {
+#define CASE(n, fmt) \
+                case n: \
+                    SSE2_CALL(SSE2_INIT_32_UNALIGNED SSE2_YUV_MUL \
+                              SSE2_YUV_ADD SSE2_UNPACK_32_##fmt##_UNALIGNED); \
+                    break;
+                CASE(0, ARGB) CASE(1, RGBA) CASE(2, BGRA) CASE(3, ABGR)
+#undef CASE
+            }
+            p_y += 16;
+            p_u += 8;
+            p_v += 8;
+            p_buffer += 16;
+        }
+    }
+    SSE2_END;
+}
+#endif
+
+#if defined(CAN_COMPILE_AVX2)
+VLC_AVX2
+static void RGB32Frame_AVX2(unsigned order)
+{
+    uint32_t *p_buffer = (uint32_t *)dst;
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        const uint8_t *p_y = src[0] + y * width;
+        const uint8_t *p_u = src[1] + y / 2 * width / 2;
+        const uint8_t *p_v = src[2] + y / 2 * width / 2;
+
+        switch (order)
+        {
+            case 0: AVX2_CALL_32(AVX2_UNPACK_32_ARGB, width / 32); break;
+            case 1: AVX2_CALL_32(AVX2_UNPACK_32_RGBA, width / 32); break;
+            case 2: AVX2_CALL_32(AVX2_UNPACK_32_BGRA, width / 32); break;
+            case 3: AVX2_CALL_32(AVX2_UNPACK_32_ABGR, width / 32); break;
+        }
+        if (width % 32)
+        {
+            switch (order)
+            {
+#define CASE(n, fmt) \
+                case n: \
+                    SSE2_CALL(SSE2_INIT_32_UNALIGNED SSE2_YUV_MUL \
+                              SSE2_YUV_ADD SSE2_UNPACK_32_##fmt##_UNALIGNED); \
+                    break;
+                CASE(0, ARGB) CASE(1, RGBA) CASE(2, BGRA) CASE(3, ABGR)
+#undef CASE
+            }
+            p_buffer += 16;
+        }
+    }
+    SSE2_END;
+}
+#endif
+
+static void BenchRGB32(void)
+{
+    static const char names[4][6] = { "argb", "rgba", "bgra", "abgr" };
+    const size_t size = width * height * 4;
+
+    for (unsigned order = 0; order < 4; order++)
+    {
+        bool reference = true;
+        mtime_t c_time = 0;
+
+        printf("%-10s", names[order]);
+        BENCH("C", RGB32Frame_C(order), size);
+#if defined(CAN_COMPILE_SSE2)
+        if (vlc_CPU_SSE2())
+            BENCH("SSE2", RGB32Frame_SSE2(order), size);
+#endif
+#if defined(CAN_COMPILE_AVX2)
+        if (vlc_CPU_AVX2())
+            BENCH("AVX2", RGB32Frame_AVX2(order), size);
+#endif
+        putchar('\n');
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    cpu = vlc_CPU();
+    if (argc > 1)
+        frames = strtoul(argv[1], NULL, 0);
+    if (frames == 0)
+        frames = 1;
+
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        width = sizes[i].width;
+        height = sizes[i].height;
+        pitch = (width * 2 + 63) & ~63;
+
+        /* room for RGB32 output and for the Yadif overwrites */
+        const size_t size = __MAX(height * pitch, width * height * 4) + MARGIN;
+        for (unsigned j = 0; j < 3; j++)
+        {
+            src[j] = aligned_alloc(64, size);
+            assert(src[j] != NULL);
+            FillRandom(src[j], size);
+        }
+        dst = aligned_alloc(64, size);
+        ref = malloc(size);
+        assert(dst != NULL && ref != NULL);
+#if defined(CAN_COMPILE_SSE2)
+        assert(CopyInitCache(&cache, pitch) == VLC_SUCCESS);
+#endif
+
+        printf("%ux%u, %u frames\n", width, height, frames);
+        BenchMerge();
+        BenchYadif();
+        BenchCopy();
+        BenchRGB32();
+
+#if defined(CAN_COMPILE_SSE2)
+        CopyCleanCache(&cache);
+#endif
+        free(ref);
+        aligned_free(dst);
+        for (unsigned j = 0; j < 3; j++)
+            aligned_free(src[j]);
+    }
+    return 0;
+}